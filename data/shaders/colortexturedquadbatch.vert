@@ -0,0 +1,13 @@
+#version 130
+in vec2 position;
+in vec2 texcoord;
+in vec4 color;
+out vec2 uv;
+out vec4 col;
+
+void main()
+{
+	col = color;
+	uv = texcoord;
+	gl_Position = vec4(position, 0., 1.);
+}
@@ -14,6 +14,7 @@ src/animations/three_d_animation.cpp
 src/audio/music_information.cpp
 src/audio/music_manager.cpp
 src/audio/music_ogg.cpp
+src/audio/sfx_base.cpp
 src/audio/sfx_buffer.cpp
 src/audio/sfx_manager.cpp
 src/audio/sfx_openal.cpp
@@ -98,8 +99,11 @@ src/input/input_device.cpp
 src/input/input_manager.cpp
 src/input/wiimote.cpp
 src/input/wiimote_manager.cpp
+src/io/content_cache.cpp
 src/io/file_manager.cpp
+src/io/mapped_file.cpp
 src/io/xml_node.cpp
+src/io/xml_stream_reader.cpp
 src/io/xml_writer.cpp
 src/items/attachment.cpp
 src/items/attachment_manager.cpp
@@ -146,6 +150,7 @@ src/modes/easter_egg_hunt.cpp
 src/modes/follow_the_leader.cpp
 src/modes/linear_world.cpp
 src/modes/overworld.cpp
+src/modes/profile_batch.cpp
 src/modes/profile_world.cpp
 src/modes/soccer_world.cpp
 src/modes/standard_race.cpp
@@ -155,8 +160,10 @@ src/modes/world.cpp
 src/modes/world_status.cpp
 src/modes/world_with_rank.cpp
 src/network/client_network_manager.cpp
+src/network/clock_estimator.cpp
 src/network/event.cpp
 src/network/game_setup.cpp
+src/network/kart_snapshot.cpp
 src/network/network_interface.cpp
 src/network/network_manager.cpp
 src/network/network_string.cpp
@@ -315,9 +322,11 @@ src/utils/log.cpp
 src/utils/profiler.cpp
 src/utils/random_generator.cpp
 src/utils/string_utils.cpp
+src/utils/tick_stats.cpp
 src/utils/time.cpp
 src/utils/translation.cpp
 src/utils/vec3.cpp
+src/utils/worker_pool.cpp
 )
 set(STK_HEADERS
 src/achievements/achievement.hpp
@@ -421,8 +430,11 @@ src/input/input_device.hpp
 src/input/input_manager.hpp
 src/input/wiimote.hpp
 src/input/wiimote_manager.hpp
+src/io/content_cache.hpp
 src/io/file_manager.hpp
+src/io/mapped_file.hpp
 src/io/xml_node.hpp
+src/io/xml_stream_reader.hpp
 src/io/xml_writer.hpp
 src/items/attachment.hpp
 src/items/attachment_manager.hpp
@@ -470,6 +482,7 @@ src/modes/easter_egg_hunt.hpp
 src/modes/follow_the_leader.hpp
 src/modes/linear_world.hpp
 src/modes/overworld.hpp
+src/modes/profile_batch.hpp
 src/modes/profile_world.hpp
 src/modes/soccer_world.hpp
 src/modes/standard_race.hpp
@@ -479,8 +492,10 @@ src/modes/world.hpp
 src/modes/world_status.hpp
 src/modes/world_with_rank.hpp
 src/network/client_network_manager.hpp
+src/network/clock_estimator.hpp
 src/network/event.hpp
 src/network/game_setup.hpp
+src/network/kart_snapshot.hpp
 src/network/network_interface.hpp
 src/network/network_manager.hpp
 src/network/network_string.hpp
@@ -651,9 +666,11 @@ src/utils/ptr_vector.hpp
 src/utils/random_generator.hpp
 src/utils/string_utils.hpp
 src/utils/synchronised.hpp
+src/utils/tick_stats.hpp
 src/utils/time.hpp
 src/utils/translation.hpp
 src/utils/types.hpp
 src/utils/vec3.hpp
 src/utils/vs.hpp
+src/utils/worker_pool.hpp
 )
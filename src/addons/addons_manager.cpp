@@ -24,6 +24,7 @@
 #include "addons/zip.hpp"
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
+#include "io/xml_stream_reader.hpp"
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "online/http_request.hpp"
@@ -130,8 +131,7 @@ void AddonsManager::init(const XMLNode *xml,
     else
         Log::info("NetworkHttp", "Using cached addons.xml");
         
-    const XMLNode *xml_addons = new XMLNode(filename);
-    addons_manager->initAddons(xml_addons);   // will free xml_addons
+    addons_manager->initAddons(filename);
     if(UserConfigParams::logAddons())
         Log::info("addons", "Addons manager list downloaded");
 }   // init
@@ -141,10 +141,12 @@ void AddonsManager::init(const XMLNode *xml,
  *  downloaded list of available addons. It is called from init(), which is
  *  called from a separate thread, so blocking download requests can be used
  *  without blocking the GUI. This function will update the state variable.
- *  \param xml The xml tree of addons.xml with information about all available
+ *  The file contains a long list of addons and is read one addon at a time
+ *  without creating a XMLNode tree.
+ *  \param filename Name of addons.xml with information about all available
  *         addons.
  */
-void AddonsManager::initAddons(const XMLNode *xml)
+void AddonsManager::initAddons(const std::string &filename)
 {
     m_addons_list.lock();
     // Clear the list in case that a reinit is being done.
@@ -152,9 +154,18 @@ void AddonsManager::initAddons(const XMLNode *xml)
     loadInstalledAddons();
     m_addons_list.unlock();
 
-    for(unsigned int i=0; i<xml->getNumNodes(); i++)
+    XMLStreamReader *xml = file_manager->createXMLStreamReader(filename);
+    if(!xml || !xml->next())
+    {
+        Log::error("addons", "Can't read '%s'.", filename.c_str());
+        delete xml;
+        return;
+    }
+
+    while(xml->next())
     {
-        const XMLNode *node = xml->getNode(i);
+        if(xml->getDepth()!=1) continue;
+        const XMLNode *node = &xml->getElement();
         const std::string &name = node->getName();
         // Ignore news/redirect, which is handled by the NewsManager
         if(name=="include" || name=="message")
@@ -230,7 +241,7 @@ void AddonsManager::initAddons(const XMLNode *xml)
                     node->getName().c_str());
             fprintf(stderr, "[addons] Ignored.\n");
         }
-    }   // for i<xml->getNumNodes
+    }   // while xml->next()
     delete xml;
 
     // Now remove all items from the addons-installed list, that are not
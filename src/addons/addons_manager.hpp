@@ -59,7 +59,7 @@ public:
                  AddonsManager();
                 ~AddonsManager();
     void         init(const XMLNode *xml, bool force_refresh);
-    void         initAddons(const XMLNode *xml);
+    void         initAddons(const std::string &filename);
     void         checkInstalledAddons();
     const Addon* getAddon(const std::string &id) const;
     int          getAddonIndex(const std::string &id) const;
@@ -22,34 +22,86 @@
 
 #include "audio/sfx_base.hpp"
 
+#include <algorithm>
+
 
 
 /**
  * \brief Dummy sound when ogg or openal aren't available
+ *  Nothing is played, but the state of the sfx is kept and voices are
+ *  requested from the SFXManager just like SFXOpenAL does, so the voice
+ *  management works the same without a sound device.
  * \ingroup audio
  */
 class DummySFX : public SFXBase
 {
+private:
+    SFXBuffer *m_buffer;
 public:
-                       DummySFX(SFXBuffer* buffer, bool positional, float gain) {}
-    virtual           ~DummySFX()                     {}
+                       DummySFX(SFXBuffer* buffer, bool positional, float gain,
+                                bool owns_buffer = false)
+                       {
+                           m_buffer = NULL;
+                           reset(buffer, positional, gain, owns_buffer);
+                       }
+    virtual           ~DummySFX()
+                       {
+                           if(m_has_voice) sfx_manager->freeVoice(this);
+                       }
 
     /** Late creation, if SFX was initially disabled */
     virtual bool       init() { return true; }
+    virtual void       reset(SFXBuffer *buffer, bool positional, float gain,
+                             bool owns_buffer)
+    {
+        if(m_has_voice) sfx_manager->freeVoice(this);
+        m_buffer = buffer;
+        resetState(buffer, positional, gain);
+    }   // reset
 
-    virtual void       position(const Vec3 &position) {}
-    virtual void       setLoop(bool status)           {}
-    virtual void       play()                         {}
-    virtual void       stop()                         {}
-    virtual void       pause()                        {}
-    virtual void       resume()                       {}
-    virtual void       speed(float factor)            {}
-    virtual void       volume(float gain)             {}
-    virtual SFXManager::SFXStatus  getStatus()        { return SFXManager::SFX_STOPPED; }
+    virtual void       position(const Vec3 &position)
+    {
+        if(m_positional) m_position = position;
+    }
+    virtual void       setLoop(bool status)    { m_loop = status;        }
+    virtual void       play()
+    {
+        m_status    = SFXManager::SFX_PLAYING;
+        m_play_time = 0;
+        sfx_manager->requestVoice(this);
+    }   // play
+    virtual void       stop()
+    {
+        m_loop   = false;
+        m_status = SFXManager::SFX_STOPPED;
+        if(m_has_voice) sfx_manager->freeVoice(this);
+    }   // stop
+    virtual void       pause()
+    {
+        if(m_status!=SFXManager::SFX_PLAYING) return;
+        m_status = SFXManager::SFX_PAUSED;
+        if(m_has_voice) sfx_manager->freeVoice(this);
+    }   // pause
+    virtual void       resume()
+    {
+        if(m_status==SFXManager::SFX_PLAYING) return;
+        if(m_status!=SFXManager::SFX_PAUSED) m_play_time = 0;
+        m_status = SFXManager::SFX_PLAYING;
+        sfx_manager->requestVoice(this);
+    }   // resume
+    virtual void       speed(float factor)
+    {
+        // Same range as SFXOpenAL, so that the play time is the same
+        if(factor==factor)
+            m_pitch = std::max(0.5f, std::min(2.0f, factor));
+    }   // speed
+    virtual void       volume(float gain)      { m_gain  = m_default_gain*gain; }
+    virtual void       masterVolume(float gain){ m_master_gain = gain;   }
+    virtual SFXManager::SFXStatus  getStatus() { return m_status;        }
     virtual void       onSoundEnabledBack()           {}
-    virtual void       setRolloff(float rolloff)      {}
+    virtual void       setRolloff(float rolloff){ m_rolloff = rolloff;   }
 
-    virtual const SFXBuffer* getBuffer() const        { return NULL; }
+    virtual const SFXBuffer* getBuffer() const { return m_buffer;        }
 
 };   // DummySFX
 
@@ -20,7 +20,9 @@
 
 #include "audio/music_ogg.hpp"
 
+#include <algorithm>
 #include <stdexcept>
+#include <string.h>
 #ifdef __APPLE__
 #  include <OpenAL/al.h>
 #else
@@ -38,6 +40,14 @@ MusicOggStream::MusicOggStream()
     m_soundSource     = -1;
     m_pausedMusic     = true;
     m_playing         = false;
+    m_ring_read       = 0;
+    m_ring_filled     = 0;
+    m_decoder_running = false;
+    m_stop_decoder    = false;
+    m_decoder_done    = false;
+    pthread_mutex_init(&m_ring_mutex, NULL);
+    pthread_cond_init(&m_data_cond, NULL);
+    pthread_cond_init(&m_space_cond, NULL);
 }   // MusicOggStream
 
 //-----------------------------------------------------------------------------
@@ -45,12 +55,16 @@ MusicOggStream::~MusicOggStream()
 {
     if(stopMusic() == false)
         Log::warn("MusicOgg", "problems while stopping music.\n");
+    pthread_cond_destroy(&m_space_cond);
+    pthread_cond_destroy(&m_data_cond);
+    pthread_mutex_destroy(&m_ring_mutex);
 }   // ~MusicOggStream
 
 //-----------------------------------------------------------------------------
 bool MusicOggStream::load(const std::string& filename)
 {
-    if (isPlaying()) stopMusic();
+    // Also stops the decoder thread if a file was already loaded
+    release();
 
     m_error = true;
     m_fileName = filename;
@@ -120,10 +134,121 @@ bool MusicOggStream::load(const std::string& filename)
     alSourcef (m_soundSource, AL_GAIN,            1.0          );
     alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_TRUE      );
 
+    if(!startDecoder()) return false;
+
     m_error=false;
     return true;
 }   // load
 
+//-----------------------------------------------------------------------------
+/** Starts the thread that decodes the stream into the ring buffer.
+ *  \return False if the thread could not be created.
+ */
+bool MusicOggStream::startDecoder()
+{
+    m_ring.resize(m_ring_size);
+    m_ring_read    = 0;
+    m_ring_filled  = 0;
+    m_stop_decoder = false;
+    m_decoder_done = false;
+    int error = pthread_create(&m_decoder_thread, NULL,
+                               &MusicOggStream::decoderLoop, this);
+    if(error)
+    {
+        Log::error("MusicOgg", "Could not create decoder thread for '%s', "
+                   "error=%d.", m_fileName.c_str(), error);
+        return false;
+    }
+    m_decoder_running = true;
+    return true;
+}   // startDecoder
+
+//-----------------------------------------------------------------------------
+/** Stops the decoder thread and waits for it to exit. */
+void MusicOggStream::stopDecoder()
+{
+    if(!m_decoder_running) return;
+    pthread_mutex_lock(&m_ring_mutex);
+    m_stop_decoder = true;
+    pthread_cond_signal(&m_space_cond);
+    pthread_mutex_unlock(&m_ring_mutex);
+    pthread_join(m_decoder_thread, NULL);
+    m_decoder_running = false;
+}   // stopDecoder
+
+//-----------------------------------------------------------------------------
+/** The main function of the decoder thread.
+ *  \param obj The MusicOggStream to decode.
+ */
+void *MusicOggStream::decoderLoop(void *obj)
+{
+    ((MusicOggStream*)obj)->decode();
+    return NULL;
+}   // decoderLoop
+
+//-----------------------------------------------------------------------------
+/** Decodes the stream into the free part of the ring buffer until the
+ *  thread is stopped. At the end of the stream decoding starts again at the
+ *  beginning, so the music loops.
+ */
+void MusicOggStream::decode()
+{
+    const int is_big_endian = (IS_LITTLE_ENDIAN ? 0 : 1);
+    // ov_read returns at most 4096 bytes at a time, so don't wake up
+    // for less than that.
+    const int min_space = 4096;
+    bool restarted = false;
+    while(true)
+    {
+        pthread_mutex_lock(&m_ring_mutex);
+        while(!m_stop_decoder && m_ring_size-m_ring_filled < min_space)
+            pthread_cond_wait(&m_space_cond, &m_ring_mutex);
+        if(m_stop_decoder)
+        {
+            pthread_mutex_unlock(&m_ring_mutex);
+            break;
+        }
+        int write = (m_ring_read + m_ring_filled) % m_ring_size;
+        int space = m_ring_size - m_ring_filled;
+        pthread_mutex_unlock(&m_ring_mutex);
+
+        // Only write up to the end of the ring, the rest of the free
+        // space is filled in the next iteration.
+        if(write + space > m_ring_size)
+            space = m_ring_size - write;
+
+        int portion;
+        int result = ov_read(&m_oggStream, &m_ring[write], space,
+                             is_big_endian, 2, 1, &portion);
+        // A hole in the data is reported, but decoding can continue
+        if(result == OV_HOLE)
+            continue;
+        if(result == 0 && !restarted)
+        {
+            // End of stream. Seek to beginning (causes the sound to loop)
+            ov_time_seek(&m_oggStream, 0);
+            restarted = true;
+            continue;
+        }
+        if(result <= 0)
+        {
+            if(result < 0)
+                Log::error("MusicOgg", "Error decoding '%s': %s",
+                           m_fileName.c_str(), errorString(result).c_str());
+            pthread_mutex_lock(&m_ring_mutex);
+            m_decoder_done = true;
+            pthread_cond_signal(&m_data_cond);
+            pthread_mutex_unlock(&m_ring_mutex);
+            break;
+        }
+        restarted = false;
+        pthread_mutex_lock(&m_ring_mutex);
+        m_ring_filled += result;
+        pthread_cond_signal(&m_data_cond);
+        pthread_mutex_unlock(&m_ring_mutex);
+    }   // while true
+}   // decode
+
 //-----------------------------------------------------------------------------
 bool MusicOggStream::empty()
 {
@@ -151,6 +276,7 @@ bool MusicOggStream::release()
     }
 
     pauseMusic();
+    stopDecoder();
     m_fileName= "";
 
     empty();
@@ -287,13 +413,10 @@ void MusicOggStream::update()
         alSourceUnqueueBuffers(m_soundSource, 1, &buffer);
         if(!check("alSourceUnqueueBuffers")) return;
 
+        // The decoder loops the music, so this only fails if the
+        // stream can not be decoded.
         active = streamIntoBuffer(buffer);
-        if(!active)
-        {
-            // no more data. Seek to beginning (causes the sound to loop)
-            ov_time_seek(&m_oggStream, 0);
-            active = streamIntoBuffer(buffer);//now there really should be data
-        }
+        if(!active) break;
 
         alSourceQueueBuffers(m_soundSource, 1, &buffer);
         if (!check("alSourceQueueBuffers")) return;
@@ -314,40 +437,53 @@ void MusicOggStream::update()
     }
     else
     {
-        Log::warn("MusicOgg", "Attempt to stream music into buffer failed "
-                              "twice in a row.\n");
+        Log::warn("MusicOgg", "Attempt to stream music into buffer "
+                              "failed.\n");
     }
 }   // update
 
 //-----------------------------------------------------------------------------
+/** Fills an OpenAL buffer with data from the ring buffer. Usually the
+ *  decoder is far ahead, but if not enough data is available (e.g. right
+ *  after loading) this waits for the decoder thread.
+ *  \return False if the stream has no more data.
+ */
 bool MusicOggStream::streamIntoBuffer(ALuint buffer)
 {
-    char pcm[m_buffer_size];
-    const int isBigEndian = (IS_LITTLE_ENDIAN ? 0 : 1);
+    pthread_mutex_lock(&m_ring_mutex);
+    while(m_ring_filled < m_buffer_size && !m_decoder_done &&
+          m_decoder_running)
+        pthread_cond_wait(&m_data_cond, &m_ring_mutex);
+    int size = std::min(m_ring_filled, (int)m_buffer_size);
+    int read = m_ring_read;
+    pthread_mutex_unlock(&m_ring_mutex);
 
-    int  size = 0;
-    int  portion;
-    int  result;
+    if(size == 0) return false;
 
-    while(size < m_buffer_size)
+    // The decoder does not touch the filled part of the ring, so the data
+    // can be used without holding the lock.
+    if(read + size <= m_ring_size)
     {
-        result = ov_read(&m_oggStream, pcm + size, m_buffer_size - size,
-                         isBigEndian, 2, 1, &portion);
-
-        if(result > 0)
-            size += result;
-        else
-            if(result < 0)
-                throw errorString(result);
-            else
-                break;
+        alBufferData(buffer, nb_channels, &m_ring[read], size,
+                     m_vorbisInfo->rate);
+    }
+    else
+    {
+        m_pcm.resize(m_buffer_size);
+        const int first = m_ring_size - read;
+        memcpy(&m_pcm[0],     &m_ring[read], first);
+        memcpy(&m_pcm[first], &m_ring[0],    size-first);
+        alBufferData(buffer, nb_channels, &m_pcm[0], size,
+                     m_vorbisInfo->rate);
     }
-
-    if(size == 0) return false;
-
-    alBufferData(buffer, nb_channels, pcm, size, m_vorbisInfo->rate);
     check("alBufferData");
 
+    pthread_mutex_lock(&m_ring_mutex);
+    m_ring_read    = (m_ring_read + size) % m_ring_size;
+    m_ring_filled -= size;
+    pthread_cond_signal(&m_space_cond);
+    pthread_mutex_unlock(&m_ring_mutex);
+
     return true;
 }   // streamIntoBuffer
 
@@ -21,7 +21,9 @@
 
 #if HAVE_OGGVORBIS
 
+#include <pthread.h>
 #include <string>
+#include <vector>
 
 #include <ogg/ogg.h>
 // Disable warning about potential loss of precision in vorbisfile.h
@@ -42,6 +44,10 @@
 
 /**
   * \brief ogg files based implementation of the Music interface
+  * The vorbis stream is decoded by a separate thread (one per loaded
+  * stream) into a ring buffer that holds a few seconds of PCM data ahead
+  * of playback. The main thread (update()) only copies decoded data into
+  * the OpenAL buffers that were played and queues them again.
   * \ingroup audio
   */
 class MusicOggStream : public Music
@@ -71,6 +77,10 @@ protected:
 private:
     bool release();
     bool streamIntoBuffer(ALuint buffer);
+    bool startDecoder();
+    void stopDecoder();
+    static void *decoderLoop(void *obj);
+    void decode();
 
     std::string     m_fileName;
     FILE*           m_oggFile;
@@ -86,6 +96,36 @@ private:
 
     bool m_pausedMusic;
     static const int m_buffer_size = 11025*4;//one full second of audio at 44100 samples per second
+
+    /** Size of the ring buffer of decoded data, in bytes. */
+    static const int m_ring_size   = 8*m_buffer_size;
+
+    /** The decoded PCM data. The decoder thread only writes to the free
+     *  part of the ring, the main thread only reads the filled part, so
+     *  the mutex is only needed to update the read position and the
+     *  fill level, not while decoding or copying data. */
+    std::vector<char> m_ring;
+    /** Offset of the first byte to be played in m_ring. */
+    int               m_ring_read;
+    /** Number of decoded bytes in m_ring. */
+    int               m_ring_filled;
+    /** Used when the data for one OpenAL buffer wraps around the end
+     *  of the ring. */
+    std::vector<char> m_pcm;
+
+    pthread_t         m_decoder_thread;
+    pthread_mutex_t   m_ring_mutex;
+    /** Signalled by the decoder when new data is available. */
+    pthread_cond_t    m_data_cond;
+    /** Signalled by the main thread when data was consumed. */
+    pthread_cond_t    m_space_cond;
+    /** True while the decoder thread exists. */
+    bool              m_decoder_running;
+    /** Tells the decoder thread to exit. Protected by m_ring_mutex. */
+    bool              m_stop_decoder;
+    /** Set by the decoder if the stream can not be decoded anymore.
+     *  Protected by m_ring_mutex. */
+    bool              m_decoder_done;
 };
 
 #endif
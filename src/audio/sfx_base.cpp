@@ -0,0 +1,125 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "audio/sfx_base.hpp"
+
+#include "audio/sfx_buffer.hpp"
+
+#include <math.h>
+
+/** Sets the state of a sfx that was just created or recycled.
+ *  \param buffer The sfx buffer used (can be NULL).
+ *  \param positional If this is a positional sfx.
+ *  \param gain The default gain of this sfx.
+ */
+void SFXBase::resetState(const SFXBuffer *buffer, bool positional,
+                         float gain)
+{
+    m_status       = SFXManager::SFX_INITIAL;
+    m_loop         = false;
+    m_positional   = positional;
+    m_position     = Vec3(0, 0, 0);
+    m_default_gain = gain;
+    m_gain         = -1.0f;
+    m_master_gain  = 1.0f;
+    m_pitch        = 1.0f;
+    m_rolloff      = buffer ? buffer->getRolloff() : 0.1f;
+    m_play_time    = 0.0f;
+    m_has_voice    = false;
+    m_voice        = 0;
+}   // resetState
+
+// ----------------------------------------------------------------------------
+/** Called by the SFXManager when this sfx gets a voice. The implementation
+ *  must start playing the voice at the current play time.
+ *  \param voice The voice to use.
+ */
+void SFXBase::assignVoice(ALuint voice)
+{
+    m_voice     = voice;
+    m_has_voice = true;
+}   // assignVoice
+
+// ----------------------------------------------------------------------------
+/** Called by the SFXManager when the voice of this sfx is taken away. The
+ *  sfx keeps its status, i.e. a playing sfx is still playing.
+ *  \return The voice that was used.
+ */
+ALuint SFXBase::removeVoice()
+{
+    m_has_voice = false;
+    return m_voice;
+}   // removeVoice
+
+// ----------------------------------------------------------------------------
+/** Returns true if the voice of this sfx has stopped playing. Without a
+ *  sound device only the play time is used to determine when a sfx ends.
+ */
+bool SFXBase::hasVoiceFinished()
+{
+    return false;
+}   // hasVoiceFinished
+
+// ----------------------------------------------------------------------------
+/** Advances the play time of a playing sfx.
+ *  \param dt Time step size.
+ *  \return False if the sfx is not looped and the end was reached. A sfx of
+ *          unknown length (e.g. because its buffer could not be loaded)
+ *          ends immediately.
+ */
+bool SFXBase::updatePlayTime(float dt)
+{
+    const SFXBuffer *buffer = getBuffer();
+    const float duration = buffer ? buffer->getDuration() : 0.0f;
+    m_play_time += dt*m_pitch;
+    if(!m_loop)
+        return m_play_time < duration;
+    if(duration > 0.0f)
+        m_play_time = fmodf(m_play_time, duration);
+    return true;
+}   // updatePlayTime
+
+// ----------------------------------------------------------------------------
+/** Returns an estimate of how loud this sfx is for a listener at the given
+ *  position. This uses OpenAL's default distance model (inverse distance,
+ *  clamped, reference distance 1).
+ *  \param listener Position of the listener.
+ */
+float SFXBase::getAudibility(const Vec3 &listener) const
+{
+    const float gain = getEffectiveGain();
+    const SFXBuffer *buffer = getBuffer();
+    if(!m_positional || !buffer)
+        return gain;
+
+    float distance = (m_position - listener).length();
+    if(distance > buffer->getMaxDist())
+        return 0.0f;
+    if(distance < 1.0f)
+        distance = 1.0f;
+    return gain / (1.0f + m_rolloff*(distance - 1.0f));
+}   // getAudibility
+
+// ----------------------------------------------------------------------------
+/** Returns the priority of this sfx, see SFXBuffer::getPriority(). */
+int SFXBase::getPriority() const
+{
+    const SFXBuffer *buffer = getBuffer();
+    return buffer ? buffer->getPriority() : 0;
+}   // getPriority
@@ -22,13 +22,14 @@
 
 #include "audio/sfx_manager.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
 
 /**
  * \defgroup audio
  * This module handles audio (sound effects and music).
  */
 
-class Vec3;
+class SFXBuffer;
 
 /**
  * \brief The base class for sound effects.
@@ -37,16 +38,62 @@ class Vec3;
  *  effect object, use sfx_manager->getSFX(...); do not create an instance
  *  with new, since SFXManager makes sure to stop/restart all SFX (esp.
  *  looping sfx like engine sounds) when necessary.
+ *
+ *  Only a limited number of sound effects can be played at the same time.
+ *  The SFXManager assigns its voices (OpenAL sources) to the most important
+ *  sound effects that are playing. A sound effect without a voice is still
+ *  playing as far as the rest of STK is concerned: this class keeps track of
+ *  its state (status, position, play time, ...), so that it can continue at
+ *  the right place when it gets a voice again.
  * \ingroup audio
  */
 class SFXBase : public NoCopy
 {
+protected:
+    /** The status of this sfx as seen by the game. This is independent of
+     *  whether the sfx currently has a voice. */
+    SFXManager::SFXStatus m_status;
+
+    bool   m_loop;
+    bool   m_positional;
+    Vec3   m_position;
+
+    /** The gain from the sfx buffer. */
+    float  m_default_gain;
+
+    /** Contains a volume if set through the "volume" method, or a negative
+     *  number if this method was not called. */
+    float  m_gain;
+
+    /** The master gain set in user preferences */
+    float  m_master_gain;
+
+    float  m_pitch;
+
+    /** Rolloff factor, initially the one of the sfx buffer. */
+    float  m_rolloff;
+
+    /** How long this sfx has been playing (taking the pitch into account),
+     *  used to start a sfx that gets a voice at the right offset. */
+    float  m_play_time;
+
+    /** True if this sfx currently has a voice. */
+    bool   m_has_voice;
+    ALuint m_voice;
+
+    void resetState(const SFXBuffer *buffer, bool positional, float gain);
+
 public:
+                       SFXBase() { resetState(NULL, false, 1.0f); }
     virtual           ~SFXBase()                       {}
 
     /** Late creation, if SFX was initially disabled */
     virtual bool       init() = 0;
 
+    /** Prepares a recycled object to be used for a different sound. */
+    virtual void       reset(SFXBuffer *buffer, bool positional, float gain,
+                             bool owns_buffer) = 0;
+
     virtual void       position(const Vec3 &position) = 0;
     virtual void       setLoop(bool status)      = 0;
     virtual void       play()                    = 0;
@@ -63,8 +110,30 @@ public:
 
     virtual const SFXBuffer* getBuffer() const = 0;
 
+    virtual void       assignVoice(ALuint voice);
+    virtual ALuint     removeVoice();
+    virtual bool       hasVoiceFinished();
+
+    float              getAudibility(const Vec3 &listener) const;
+    int                getPriority() const;
+    bool               updatePlayTime(float dt);
+    // ------------------------------------------------------------------------
+    /** True if this sfx is currently played by a voice. */
+    bool               hasVoice() const { return m_has_voice; }
+    // ------------------------------------------------------------------------
+    /** True if this sfx is playing, with or without a voice. */
+    bool               isPlaying() const
+    {
+        return m_status==SFXManager::SFX_PLAYING;
+    }   // isPlaying
+    // ------------------------------------------------------------------------
+    /** Returns the gain with which this sfx is played. */
+    float              getEffectiveGain() const
+    {
+        return (m_gain < 0.0f ? m_default_gain : m_gain) * m_master_gain;
+    }   // getEffectiveGain
+
 };   // SfxBase
 
 
 #endif // HEADER_SFX_HPP
-
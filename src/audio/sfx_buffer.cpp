@@ -47,6 +47,8 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_rolloff     = 0.1f;
     m_loaded      = false;
     m_max_dist    = max_width;
+    m_duration    = 0.0f;
+    m_priority    = 0;
     m_file        = file;
 
     m_rolloff     = rolloff;
@@ -65,8 +67,11 @@ SFXBuffer::SFXBuffer(const std::string& file,
     m_max_dist    = 300.0f;
     m_positional  = false;
     m_loaded      = false;
+    m_duration    = 0.0f;
+    m_priority    = 0;
     m_file        = file;
 
+    node->get("priority",    &m_priority   );
     node->get("rolloff",     &m_rolloff    );
     node->get("positional",  &m_positional );
     node->get("volume",      &m_gain       );
@@ -181,6 +186,7 @@ bool SFXBuffer::loadVorbisBuffer(const std::string &name, ALuint buffer)
     alBufferData(buffer, (info->channels == 1) ? AL_FORMAT_MONO16
                  : AL_FORMAT_STEREO16,
                  data, len, info->rate);
+    m_duration = (float)ov_pcm_total(&oggFile, -1) / info->rate;
     success = true;
 
     free(data);
@@ -57,6 +57,11 @@ private:
     float    m_rolloff;
     float    m_gain;
     float    m_max_dist;
+    /** Length of the sound in seconds, 0 if not known. */
+    float    m_duration;
+    /** Sound effects with a higher priority get a voice before less
+     *  important ones, independent of how audible they are. */
+    int      m_priority;
 
     bool loadVorbisBuffer(const std::string &name, ALuint buffer);
 
@@ -99,9 +104,12 @@ public:
     float    getRolloff()     const { return m_rolloff;    }
     float    getGain()        const { return m_gain;       }
     float    getMaxDist()     const { return m_max_dist;   }
+    float    getDuration()    const { return m_duration;   }
+    int      getPriority()    const { return m_priority;   }
     std::string getFileName() const { return m_file;       }
 
     void     setPositional(bool positional) { m_positional = positional; }
+    void     setPriority(int priority)      { m_priority   = priority;   }
 
     LEAK_CHECK()
 };
@@ -25,6 +25,7 @@
 #include <algorithm>
 #include <map>
 
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -57,8 +58,13 @@ SFXManager::SFXManager()
     m_master_gain = UserConfigParams::m_sfx_volume;
     // Init position, since it can be used before positionListener is called.
     m_position    = Vec3(0,0,0);
+    m_num_voices  = 0;
+    m_num_playing = 0;
+    m_num_virtual = 0;
+    m_num_stolen  = 0;
 
     loadSfx();
+    createVoices();
     if (!sfxAllowed()) return;
     setMasterSFXVolume( UserConfigParams::m_sfx_volume );
 
@@ -86,6 +92,18 @@ SFXManager::~SFXManager()
     }
     m_quick_sounds.clear();
 
+    for (unsigned int i=0; i<m_free_sfx.size(); i++)
+        delete m_free_sfx[i];
+    m_free_sfx.clear();
+
+    // All sfx are deleted now, so all voices are free
+    assert(m_voiced_sfx.size()==0);
+#if HAVE_OGGVORBIS
+    for (unsigned int i=0; i<m_free_voices.size(); i++)
+        alDeleteSources(1, &m_free_voices[i]);
+#endif
+    m_free_voices.clear();
+
     // ---- clear m_all_sfx_types
     {
         std::map<std::string, SFXBuffer*>::iterator i = m_all_sfx_types.begin();
@@ -140,6 +158,44 @@ bool SFXManager::sfxAllowed()
         return true;
 }   // sfxAllowed
 
+//----------------------------------------------------------------------------
+/** Creates the voices, i.e. the OpenAL sources that are shared by all sfx.
+ *  If the sound device supports less sources than requested, some sources
+ *  are left for the music.
+ */
+void SFXManager::createVoices()
+{
+    const int max_voices = std::max(1, (int)UserConfigParams::m_sfx_voices);
+#if HAVE_OGGVORBIS
+    if (!m_initialized) return;
+
+    alGetError();
+    for (int i=0; i<max_voices; i++)
+    {
+        ALuint source;
+        alGenSources(1, &source);
+        if (alGetError() != AL_NO_ERROR)
+        {
+            // Out of sources: the music streams need some, too
+            for (int j=0; j<4 && m_free_voices.size()>1; j++)
+            {
+                alDeleteSources(1, &m_free_voices.back());
+                m_free_voices.pop_back();
+            }
+            break;
+        }
+        m_free_voices.push_back(source);
+    }
+#else
+    // Without sound device the voices are only used for the accounting
+    for (int i=0; i<max_voices; i++)
+        m_free_voices.push_back(i+1);
+#endif
+    m_num_voices = m_free_voices.size();
+    Log::info("SFXManager", "Using %d voices for sound effects.",
+              m_num_voices);
+}   // createVoices
+
 //----------------------------------------------------------------------------
 /** Loads all sounds specified in the sound config file.
  */
@@ -268,12 +324,14 @@ SFXBuffer* SFXManager::loadSingleSfx(const XMLNode* node,
 
     SFXBuffer tmpbuffer(full_path, node);
 
-    return addSingleSfx(sfx_name, full_path,
-                        tmpbuffer.isPositional(),
-                        tmpbuffer.getRolloff(),
-                        tmpbuffer.getMaxDist(),
-                        tmpbuffer.getGain(),
-                        load);
+    SFXBuffer *buffer = addSingleSfx(sfx_name, full_path,
+                                     tmpbuffer.isPositional(),
+                                     tmpbuffer.getRolloff(),
+                                     tmpbuffer.getMaxDist(),
+                                     tmpbuffer.getGain(),
+                                     load);
+    m_all_sfx_types[sfx_name]->setPriority(tmpbuffer.getPriority());
+    return buffer;
 
 }   // loadSingleSfx
 
@@ -281,7 +339,7 @@ SFXBuffer* SFXManager::loadSingleSfx(const XMLNode* node,
 /** Creates a new SFX object. The memory for this object is managed completely
  *  by the SFXManager. This makes it easy to use different implementations of
  *  SFX - since createSoundSource can return whatever type is used. To free the memory,
- *  call deleteSFX().
+ *  call deleteSFX(). Objects freed with deleteSFX are reused.
  *  \param id Identifier of the sound effect to create.
  */
 SFXBase* SFXManager::createSoundSource(SFXBuffer* buffer,
@@ -300,12 +358,22 @@ SFXBase* SFXManager::createSoundSource(SFXBuffer* buffer,
     //       positional,
     //       race_manager->getNumLocalPlayers(), buffer->isPositional());
 
+    SFXBase* sfx;
+    if (m_free_sfx.size() > 0)
+    {
+        sfx = m_free_sfx.back();
+        m_free_sfx.pop_back();
+        sfx->reset(buffer, positional, buffer->getGain(), owns_buffer);
+    }
+    else
+    {
 #if HAVE_OGGVORBIS
-    //assert( alIsBuffer(buffer->getBufferID()) ); crashes on server
-    SFXBase* sfx = new SFXOpenAL(buffer, positional, buffer->getGain(), owns_buffer);
+        //assert( alIsBuffer(buffer->getBufferID()) ); crashes on server
+        sfx = new SFXOpenAL(buffer, positional, buffer->getGain(), owns_buffer);
 #else
-    SFXBase* sfx = new DummySFX(buffer, positional, buffer->getGain(), owns_buffer);
+        sfx = new DummySFX(buffer, positional, buffer->getGain(), owns_buffer);
 #endif
+    }
 
     sfx->masterVolume(m_master_gain);
 
@@ -322,6 +390,9 @@ void SFXManager::dump()
     {
         Log::debug("SFXManager", "Sound %i : %s \n", n, m_all_sfx[n]->getBuffer()->getFileName().c_str());
     }
+    Log::debug("SFXManager", "%d voices, %d sfx playing, %d without voice, "
+               "%d voices stolen.\n", m_num_voices, m_num_playing,
+               m_num_virtual, m_num_stolen);
 }
 
 //----------------------------------------------------------------------------
@@ -370,8 +441,7 @@ void SFXManager::deleteSFXMapping(const std::string &name)
 
 //----------------------------------------------------------------------------
 /** Delete a sound effect object, and removes it from the internal list of
- *  all SFXs. This call deletes the object, and removes it from the list of
- *  all SFXs.
+ *  all SFXs. The object is kept to be reused by createSoundSource.
  *  \param sfx SFX object to delete.
  */
 void SFXManager::deleteSFX(SFXBase *sfx)
@@ -386,12 +456,155 @@ void SFXManager::deleteSFX(SFXBase *sfx)
         return;
     }
 
-    delete sfx;
-
     m_all_sfx.erase(i);
 
+    // Free the buffer if it is owned by the sfx
+    sfx->reset(NULL, false, 1.0f, false);
+    m_free_sfx.push_back(sfx);
+
 }   // deleteSFX
 
+//----------------------------------------------------------------------------
+/** Returns the data used to decide which sfx gets a voice.
+ *  \param sfx The sfx.
+ */
+SFXManager::VoiceCandidate SFXManager::getCandidate(SFXBase *sfx) const
+{
+    VoiceCandidate candidate;
+    candidate.m_sfx        = sfx;
+    candidate.m_priority   = sfx->getPriority();
+    candidate.m_audibility = sfx->getAudibility(m_position);
+    // Prefer sfx that already have a voice, so that two sfx of similar
+    // loudness don't keep taking the voice from each other.
+    if (sfx->hasVoice())
+        candidate.m_audibility *= 1.2f;
+    return candidate;
+}   // getCandidate
+
+//----------------------------------------------------------------------------
+/** Called from the sfx when it starts playing. It gets a free voice if there
+ *  is one. Otherwise the voice of the least important sfx is taken if that
+ *  one is less important than this sfx, else this sfx plays without a voice
+ *  until update() can give it one.
+ *  \param sfx The sfx that needs a voice.
+ */
+void SFXManager::requestVoice(SFXBase *sfx)
+{
+    if (sfx->hasVoice()) return;
+
+    if (m_free_voices.size() == 0)
+    {
+        const VoiceCandidate candidate = getCandidate(sfx);
+        int weakest = -1;
+        VoiceCandidate weakest_candidate;
+        for (unsigned int i=0; i<m_voiced_sfx.size(); i++)
+        {
+            VoiceCandidate c = getCandidate(m_voiced_sfx[i]);
+            if (weakest < 0 || weakest_candidate < c)
+            {
+                weakest           = i;
+                weakest_candidate = c;
+            }
+        }
+        if (weakest < 0 || !(candidate < weakest_candidate))
+            return;
+        freeVoice(m_voiced_sfx[weakest]);
+        m_num_stolen++;
+    }
+
+    m_voiced_sfx.push_back(sfx);
+    const ALuint voice = m_free_voices.back();
+    m_free_voices.pop_back();
+    sfx->assignVoice(voice);
+}   // requestVoice
+
+//----------------------------------------------------------------------------
+/** Takes the voice from a sfx and makes it available again.
+ *  \param sfx A sfx that has a voice.
+ */
+void SFXManager::freeVoice(SFXBase *sfx)
+{
+    assert(sfx->hasVoice());
+    std::vector<SFXBase*>::iterator i = std::find(m_voiced_sfx.begin(),
+                                                  m_voiced_sfx.end(), sfx);
+    if (i != m_voiced_sfx.end())
+    {
+        *i = m_voiced_sfx.back();
+        m_voiced_sfx.pop_back();
+    }
+    m_free_voices.push_back(sfx->removeVoice());
+}   // freeVoice
+
+//----------------------------------------------------------------------------
+/** Updates the play time of a playing sfx and stops it when it has ended.
+ *  \return True if the sfx is still playing.
+ */
+bool SFXManager::updateSFX(SFXBase *sfx, float dt)
+{
+    if (!sfx->isPlaying()) return false;
+    bool playing = sfx->updatePlayTime(dt);
+    // A sfx with a voice is finished when the voice is, which is more
+    // precise than the play time.
+    if (sfx->hasVoice())
+        playing = !sfx->hasVoiceFinished();
+    if (!playing)
+        sfx->stop();
+    return playing;
+}   // updateSFX
+
+//----------------------------------------------------------------------------
+/** Assigns the voices to the most important playing sfx: sfx with a higher
+ *  priority first, then the sfx that are the loudest for the listener.
+ *  The other sfx keep playing without a voice.
+ *  \param dt Time step size.
+ */
+void SFXManager::update(float dt)
+{
+    m_candidates.clear();
+    for (unsigned int i=0; i<m_all_sfx.size(); i++)
+    {
+        if (updateSFX(m_all_sfx[i], dt))
+            m_candidates.push_back(getCandidate(m_all_sfx[i]));
+    }
+    std::map<std::string, SFXBase*>::iterator q;
+    for (q=m_quick_sounds.begin(); q!=m_quick_sounds.end(); q++)
+    {
+        if (updateSFX(q->second, dt))
+            m_candidates.push_back(getCandidate(q->second));
+    }
+    m_num_playing = m_candidates.size();
+
+    if (m_candidates.size() > m_num_voices)
+    {
+        std::sort(m_candidates.begin(), m_candidates.end());
+        // First free the voices of the less important sfx
+        for (unsigned int i=m_num_voices; i<m_candidates.size(); i++)
+        {
+            if (m_candidates[i].m_sfx->hasVoice())
+            {
+                freeVoice(m_candidates[i].m_sfx);
+                m_num_stolen++;
+            }
+        }
+    }
+
+    m_num_virtual = 0;
+    for (unsigned int i=0; i<m_candidates.size(); i++)
+    {
+        SFXBase *sfx = m_candidates[i].m_sfx;
+        if (sfx->hasVoice()) continue;
+        if (i < m_num_voices && m_free_voices.size() > 0)
+        {
+            m_voiced_sfx.push_back(sfx);
+            const ALuint voice = m_free_voices.back();
+            m_free_voices.pop_back();
+            sfx->assignVoice(voice);
+        }
+        else
+            m_num_virtual++;
+    }
+}   // update
+
 //----------------------------------------------------------------------------
 /** Pauses all looping SFXs. Non-looping SFX will be finished, since it's
  *  otherwise not possible to determine which SFX must be resumed (i.e. were
@@ -90,6 +90,39 @@ private:
     /** The actual instances (sound sources) */
     std::vector<SFXBase*> m_all_sfx;
 
+    /** Deleted sfx objects, which are reused by createSoundSource. */
+    std::vector<SFXBase*> m_free_sfx;
+
+    /** The voices (OpenAL sources) that are not used by any sfx. */
+    std::vector<ALuint>   m_free_voices;
+
+    /** All sfx that currently have a voice. */
+    std::vector<SFXBase*> m_voiced_sfx;
+
+    /** Used in update() to sort the playing sfx by importance. */
+    struct VoiceCandidate
+    {
+        SFXBase *m_sfx;
+        int      m_priority;
+        float    m_audibility;
+        bool operator<(const VoiceCandidate &other) const
+        {
+            if(m_priority!=other.m_priority)
+                return m_priority > other.m_priority;
+            return m_audibility > other.m_audibility;
+        }
+    };   // VoiceCandidate
+    std::vector<VoiceCandidate> m_candidates;
+
+    /** Total number of voices. */
+    unsigned int          m_num_voices;
+    /** Number of sfx playing, and how many of them have no voice, at the
+     *  last update. */
+    unsigned int          m_num_playing;
+    unsigned int          m_num_virtual;
+    /** How often a voice was taken away from a playing sfx. */
+    unsigned int          m_num_stolen;
+
     /** To play non-positional sounds without having to create a new object for each */
     static std::map<std::string, SFXBase*> m_quick_sounds;
 
@@ -100,6 +133,9 @@ private:
     float                     m_master_gain;
 
     void                      loadSfx();
+    void                      createVoices();
+    bool                      updateSFX(SFXBase *sfx, float dt);
+    VoiceCandidate            getCandidate(SFXBase *sfx) const;
 
 public:
                              SFXManager();
@@ -123,6 +159,9 @@ public:
                                                const bool addToSFXList=true);
 
     void                     deleteSFX(SFXBase *sfx);
+    void                     update(float dt);
+    void                     requestVoice(SFXBase *sfx);
+    void                     freeVoice(SFXBase *sfx);
     void                     deleteSFXMapping(const std::string &name);
     void                     pauseAll();
     void                     resumeAll();
@@ -144,6 +183,17 @@ public:
 
     Vec3 getListenerPos() const { return m_position; }
 
+    /** Returns the number of voices (sfx that can be played at the same
+     *  time). */
+    unsigned int getNumVoices() const { return m_num_voices; }
+    /** Returns the number of sfx that were playing at the last update. */
+    unsigned int getNumPlayingSFX() const { return m_num_playing; }
+    /** Returns the number of playing sfx that had no voice at the last
+     *  update. */
+    unsigned int getNumVirtualSFX() const { return m_num_virtual; }
+    /** Returns how often a voice was taken from a playing sfx. */
+    unsigned int getNumStolenVoices() const { return m_num_stolen; }
+
 };
 
 extern SFXManager* sfx_manager;
@@ -40,33 +40,17 @@
 
 SFXOpenAL::SFXOpenAL(SFXBuffer* buffer, bool positional, float gain, bool ownsBuffer) : SFXBase()
 {
-    m_soundBuffer = buffer;
-    m_soundSource = 0;
-    m_ok          = false;
-    m_positional  = positional;
-    m_defaultGain = gain;
-    m_loop        = false;
-    m_gain        = -1.0f;
-    m_master_gain = 1.0f;
-    m_owns_buffer = ownsBuffer;
-
-    // Don't initialise anything else if the sfx manager was not correctly
-    // initialised. First of all the initialisation will not work, and it
-    // will not be used anyway.
-    if (sfx_manager->sfxAllowed())
-    {
-        init();
-    }
+    m_soundBuffer = NULL;
+    m_owns_buffer = false;
+    reset(buffer, positional, gain, ownsBuffer);
 }   // SFXOpenAL
 
 //-----------------------------------------------------------------------------
 
 SFXOpenAL::~SFXOpenAL()
 {
-    if (m_ok)
-    {
-        alDeleteSources(1, &m_soundSource);
-    }
+    if (m_has_voice)
+        sfx_manager->freeVoice(this);
 
     if (m_owns_buffer && m_soundBuffer != NULL)
     {
@@ -76,48 +60,112 @@ SFXOpenAL::~SFXOpenAL()
 }   // ~SFXOpenAL
 
 //-----------------------------------------------------------------------------
-
+/** Voices are assigned by the SFXManager when needed, so there is nothing
+ *  to create here.
+ */
 bool SFXOpenAL::init()
 {
-    alGenSources(1, &m_soundSource );
-    if (!SFXManager::checkError("generating a source")) return false;
+    return true;
+}   // init
 
-    assert( alIsBuffer(m_soundBuffer->getBufferID()) );
-    assert( alIsSource(m_soundSource) );
+//-----------------------------------------------------------------------------
+/** Prepares this object to be reused for a different sound effect. A buffer
+ *  owned by this object is freed.
+ *  \param buffer The new sfx buffer, can be NULL.
+ */
+void SFXOpenAL::reset(SFXBuffer *buffer, bool positional, float gain,
+                      bool owns_buffer)
+{
+    if (m_has_voice)
+        sfx_manager->freeVoice(this);
 
-    //std::cout << "Setting a source with buffer " << m_soundBuffer << ", rolloff " << rolloff
-    //          << ", gain=" << m_defaultGain << ", positional=" << (positional ? "true" : "false") << std::endl;
+    if (m_owns_buffer && m_soundBuffer != NULL)
+    {
+        m_soundBuffer->unload();
+        delete m_soundBuffer;
+    }
+    m_soundBuffer = buffer;
+    m_owns_buffer = owns_buffer;
+    resetState(buffer, positional, gain);
+}   // reset
 
-    alSourcei (m_soundSource, AL_BUFFER,          m_soundBuffer->getBufferID());
+//-----------------------------------------------------------------------------
+/** Called by the SFXManager when this sfx gets a voice. Sets up the OpenAL
+ *  source with the state of this sfx, and starts it at the current play
+ *  time if the sfx is playing.
+ *  \param voice The OpenAL source to use.
+ */
+void SFXOpenAL::assignVoice(ALuint voice)
+{
+    SFXBase::assignVoice(voice);
+
+    alSourcei (m_voice, AL_BUFFER,          m_soundBuffer->getBufferID());
+    alSourcef (m_voice, AL_ROLLOFF_FACTOR,  m_rolloff);
+    alSourcef (m_voice, AL_MAX_DISTANCE,    m_soundBuffer->getMaxDist());
+    alSource3f(m_voice, AL_VELOCITY,        0.0, 0.0, 0.0);
+    alSource3f(m_voice, AL_DIRECTION,       0.0, 0.0, 0.0);
+    if (m_positional)
+    {
+        alSourcei (m_voice, AL_SOURCE_RELATIVE, AL_FALSE);
+        alSource3f(m_voice, AL_POSITION, (float)m_position.getX(),
+                   (float)m_position.getY(), (float)m_position.getZ());
+    }
+    else
+    {
+        alSourcei (m_voice, AL_SOURCE_RELATIVE, AL_TRUE);
+        alSource3f(m_voice, AL_POSITION,    0.0, 0.0, 0.0);
+    }
+    alSourcef (m_voice, AL_PITCH,           m_pitch);
+    alSourcei (m_voice, AL_LOOPING,         m_loop ? AL_TRUE : AL_FALSE);
+    updateGain();
 
-    if (!SFXManager::checkError("attaching the buffer to the source")) return false;
+    if (m_status == SFXManager::SFX_PLAYING)
+    {
+        alSourcef(m_voice, AL_SEC_OFFSET, m_play_time);
+        alSourcePlay(m_voice);
+    }
+    SFXManager::checkError("assigning a voice");
+}   // assignVoice
 
-    alSource3f(m_soundSource, AL_POSITION,        0.0, 0.0, 0.0);
-    alSource3f(m_soundSource, AL_VELOCITY,        0.0, 0.0, 0.0);
-    alSource3f(m_soundSource, AL_DIRECTION,       0.0, 0.0, 0.0);
+//-----------------------------------------------------------------------------
+/** Stops the OpenAL source when the SFXManager takes the voice away.
+ */
+ALuint SFXOpenAL::removeVoice()
+{
+    alSourceStop(m_voice);
+    // Detach the buffer, so that it can be freed while the source is unused
+    alSourcei(m_voice, AL_BUFFER, 0);
+    SFXManager::checkError("removing a voice");
+    return SFXBase::removeVoice();
+}   // removeVoice
 
-    alSourcef (m_soundSource, AL_ROLLOFF_FACTOR,  m_soundBuffer->getRolloff());
+//-----------------------------------------------------------------------------
+/** Returns true if the OpenAL source has finished playing. */
+bool SFXOpenAL::hasVoiceFinished()
+{
+    int state = 0;
+    alGetSourcei(m_voice, AL_SOURCE_STATE, &state);
+    return state != AL_PLAYING;
+}   // hasVoiceFinished
 
-    alSourcef (m_soundSource, AL_MAX_DISTANCE,    m_soundBuffer->getMaxDist());
+//-----------------------------------------------------------------------------
+/** Sets the gain of the source. Positional sounds that are further away than
+ *  the maximum distance of the buffer are muted.
+ */
+void SFXOpenAL::updateGain()
+{
+    if (!m_has_voice) return;
 
-    if (m_gain < 0.0f)
+    if (m_positional &&
+        sfx_manager->getListenerPos().distance(m_position) > m_soundBuffer->getMaxDist())
     {
-        alSourcef (m_soundSource, AL_GAIN,        m_defaultGain * m_master_gain);
+        alSourcef(m_voice, AL_GAIN, 0);
     }
     else
     {
-        alSourcef (m_soundSource, AL_GAIN,        m_gain * m_master_gain);
+        alSourcef(m_voice, AL_GAIN, getEffectiveGain());
     }
-
-    if (m_positional) alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_FALSE);
-    else              alSourcei (m_soundSource, AL_SOURCE_RELATIVE, AL_TRUE);
-
-    alSourcei(m_soundSource, AL_LOOPING, m_loop ? AL_TRUE : AL_FALSE);
-
-    m_ok = SFXManager::checkError("setting up the source");
-
-    return m_ok;
-}
+}   // updateGain
 
 //-----------------------------------------------------------------------------
 /** Changes the pitch of a sound effect.
@@ -125,7 +173,7 @@ bool SFXOpenAL::init()
  */
 void SFXOpenAL::speed(float factor)
 {
-    if(!m_ok || isnan(factor)) return;
+    if(isnan(factor)) return;
 
     //OpenAL only accepts pitches in the range of 0.5 to 2.0
     if(factor > 2.0f)
@@ -136,7 +184,10 @@ void SFXOpenAL::speed(float factor)
     {
         factor = 0.5f;
     }
-    alSourcef(m_soundSource,AL_PITCH,factor);
+    m_pitch = factor;
+
+    if(!m_has_voice) return;
+    alSourcef(m_voice,AL_PITCH,factor);
     SFXManager::checkError("changing the speed");
 }   // speed
 
@@ -146,11 +197,11 @@ void SFXOpenAL::speed(float factor)
  */
 void SFXOpenAL::volume(float gain)
 {
-    m_gain = m_defaultGain * gain;
+    m_gain = m_default_gain * gain;
 
-    if(!m_ok) return;
+    if(!m_has_voice) return;
 
-    alSourcef(m_soundSource, AL_GAIN, m_gain * m_master_gain);
+    updateGain();
     SFXManager::checkError("setting volume");
 }   // volume
 
@@ -160,9 +211,9 @@ void SFXOpenAL::masterVolume(float gain)
 {
     m_master_gain = gain;
     
-    if(!m_ok) return;
+    if(!m_has_voice) return;
 
-    alSourcef(m_soundSource, AL_GAIN, (m_gain < 0.0f ? m_defaultGain : m_gain) * m_master_gain);
+    updateGain();
     SFXManager::checkError("setting volume");
 }
 
@@ -173,9 +224,9 @@ void SFXOpenAL::setLoop(bool status)
 {
     m_loop = status;
 
-    if(!m_ok) return;
+    if(!m_has_voice) return;
 
-    alSourcei(m_soundSource, AL_LOOPING, status ? AL_TRUE : AL_FALSE);
+    alSourcei(m_voice, AL_LOOPING, status ? AL_TRUE : AL_FALSE);
     SFXManager::checkError("looping");
 }   // loop
 
@@ -184,41 +235,36 @@ void SFXOpenAL::setLoop(bool status)
  */
 void SFXOpenAL::stop()
 {
-    if(!m_ok) return;
-
-    m_loop = false;
-    alSourcei(m_soundSource, AL_LOOPING, AL_FALSE);
-    alSourceStop(m_soundSource);
-    SFXManager::checkError("stoping");
+    m_loop   = false;
+    m_status = SFXManager::SFX_STOPPED;
+    if(m_has_voice)
+        sfx_manager->freeVoice(this);
 }   // stop
 
 //-----------------------------------------------------------------------------
 /** Pauses a SFX that's currently played. Nothing happens it the effect is
- *  currently not being played.
+ *  currently not being played. The voice is given back to the SFXManager,
+ *  the sfx continues at the same position when it is resumed.
  */
 void SFXOpenAL::pause()
 {
-    if(!m_ok) return;
-    alSourcePause(m_soundSource);
-    SFXManager::checkError("pausing");
+    if(m_status != SFXManager::SFX_PLAYING) return;
+    m_status = SFXManager::SFX_PAUSED;
+    if(m_has_voice)
+        sfx_manager->freeVoice(this);
 }   // pause
 
 //-----------------------------------------------------------------------------
-/** Resumes a sound effect.
+/** Resumes a sound effect. A sfx that was not paused starts from the
+ *  beginning.
  */
 void SFXOpenAL::resume()
 {
-    if (!m_ok)
-    {
-        // lazily create OpenAL source when needed
-        init();
-
-        // creation of OpenAL source failed, giving up
-        if (!m_ok) return;
-    }
-
-    alSourcePlay(m_soundSource);
-    SFXManager::checkError("resuming");
+    if (m_status == SFXManager::SFX_PLAYING) return;
+    if (m_status != SFXManager::SFX_PAUSED)
+        m_play_time = 0;
+    m_status = SFXManager::SFX_PLAYING;
+    sfx_manager->requestVoice(this);
 }   // resume
 
 //-----------------------------------------------------------------------------
@@ -227,17 +273,17 @@ void SFXOpenAL::resume()
 void SFXOpenAL::play()
 {
     if (!sfx_manager->sfxAllowed()) return;
-    if (!m_ok)
-    {
-        // lazily create OpenAL source when needed
-        init();
 
-        // creation of OpenAL source failed, giving up
-        if (!m_ok) return;
+    m_status    = SFXManager::SFX_PLAYING;
+    m_play_time = 0;
+    if (m_has_voice)
+    {
+        // Restarts the sfx if it is already playing
+        alSourcePlay(m_voice);
+        SFXManager::checkError("playing");
     }
-
-    alSourcePlay(m_soundSource);
-    SFXManager::checkError("playing");
+    else
+        sfx_manager->requestVoice(this);
 }   // play
 
 //-----------------------------------------------------------------------------
@@ -248,11 +294,6 @@ void SFXOpenAL::position(const Vec3 &position)
 {
     if(!UserConfigParams::m_sfx)
         return;
-    if (!m_ok)
-    {
-        Log::warn("SFX", "Position called on non-ok SFX <%s>", m_soundBuffer->getFileName().c_str());
-        return;
-    }
     if (!m_positional)
     {
         // in multiplayer, all sounds are positional, so in this case don't bug users with
@@ -265,38 +306,23 @@ void SFXOpenAL::position(const Vec3 &position)
         return;
     }
 
-    alSource3f(m_soundSource, AL_POSITION,
-               (float)position.getX(), (float)position.getY(), (float)position.getZ());
+    m_position = position;
+    if (!m_has_voice) return;
 
-    if (sfx_manager->getListenerPos().distance(position) > m_soundBuffer->getMaxDist())
-    {
-        alSourcef(m_soundSource, AL_GAIN, 0);
-    }
-    else
-    {
-        alSourcef(m_soundSource, AL_GAIN, (m_gain < 0.0f ? m_defaultGain : m_gain) * m_master_gain);
-    }
+    alSource3f(m_voice, AL_POSITION,
+               (float)position.getX(), (float)position.getY(), (float)position.getZ());
+    updateGain();
 
     SFXManager::checkError("positioning");
 }   // position
 
 //-----------------------------------------------------------------------------
-/** Returns the status of this sound effect.
+/** Returns the status of this sound effect. A sfx that is playing without a
+ *  voice is reported as playing.
  */
 SFXManager::SFXStatus SFXOpenAL::getStatus()
 {
-    if(!m_ok) return SFXManager::SFX_UNKNOWN;
-
-    int state = 0;
-    alGetSourcei(m_soundSource, AL_SOURCE_STATE, &state);
-    switch(state)
-    {
-    case AL_STOPPED: return SFXManager::SFX_STOPPED;
-    case AL_PLAYING: return SFXManager::SFX_PLAYING;
-    case AL_PAUSED:  return SFXManager::SFX_PAUSED;
-    case AL_INITIAL: return SFXManager::SFX_INITIAL;
-    default:         return SFXManager::SFX_UNKNOWN;
-    }
+    return m_status;
 }   // getStatus
 
 //-----------------------------------------------------------------------------
@@ -305,14 +331,8 @@ void SFXOpenAL::onSoundEnabledBack()
 {
     if (m_loop)
     {
-        if (!m_ok) init();
-        if (m_ok)
-        {
-            alSourcef(m_soundSource, AL_GAIN, 0);
-            play();
-            pause();
-            alSourcef(m_soundSource, AL_GAIN, (m_gain < 0.0f ? m_defaultGain : m_gain) * m_master_gain);
-        }
+        play();
+        pause();
     }
 }
 
@@ -320,7 +340,9 @@ void SFXOpenAL::onSoundEnabledBack()
 
 void SFXOpenAL::setRolloff(float rolloff)
 {
-    alSourcef (m_soundSource, AL_ROLLOFF_FACTOR,  rolloff);
+    m_rolloff = rolloff;
+    if (m_has_voice)
+        alSourcef (m_voice, AL_ROLLOFF_FACTOR,  rolloff);
 }
 
 #endif //if HAVE_OGGVORBIS
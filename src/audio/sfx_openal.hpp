@@ -33,34 +33,20 @@
 
 /**
   * \brief OpenAL implementation of the abstract SFXBase interface
+  * An OpenAL source is only used while the SFXManager has assigned a voice
+  * to this sfx, all state changes are stored so that they can be applied
+  * when a voice is assigned.
   * \ingroup audio
   */
 class SFXOpenAL : public SFXBase
 {
 private:
     SFXBuffer*   m_soundBuffer;   //!< Buffers hold sound data.
-    ALuint       m_soundSource;   //!< Sources are points emitting sound.
-    bool         m_ok;
-    bool         m_positional;
-    float        m_defaultGain;
-
-    /** The OpenAL source contains this info, but if audio is disabled initially then
-        the sound source won't be created and we'll be left with no clue when enabling
-        sounds later */
-    bool m_loop;
-
-    /** Contains a volume if set through the "volume" method, or a negative number if
-     this method was not called.
-     The OpenAL source contains this info, but if audio is disabled initially then
-     the sound source won't be created and we'll be left with no clue when enabling
-     sounds later. */
-    float m_gain;
-    
-    /** The master gain set in user preferences */
-    float m_master_gain;
 
     bool m_owns_buffer;
 
+    void                          updateGain();
+
 public:
                                   SFXOpenAL(SFXBuffer* buffer, bool positional, float gain,
                                             bool owns_buffer = false);
@@ -68,6 +54,8 @@ public:
 
     /** Late creation, if SFX was initially disabled */
     virtual bool                  init();
+    virtual void                  reset(SFXBuffer *buffer, bool positional,
+                                        float gain, bool owns_buffer);
 
     virtual void                  play();
     virtual void                  setLoop(bool status);
@@ -82,6 +70,10 @@ public:
     virtual void                  onSoundEnabledBack();
     virtual void                  setRolloff(float rolloff);
 
+    virtual void                  assignVoice(ALuint voice);
+    virtual ALuint                removeVoice();
+    virtual bool                  hasVoiceFinished();
+
     virtual const SFXBuffer* getBuffer() const { return m_soundBuffer; }
 
     LEAK_CHECK()
@@ -387,13 +387,16 @@ void  STKConfig::getAllScores(std::vector<int> *all_scores, int num_karts)
 {
     if (num_karts == 0) return;
 
-    assert(num_karts <= m_max_karts);
     all_scores->resize(num_karts);
     (*all_scores)[num_karts-1] = 1;  // last position gets one point
 
     // Must be signed, in case that num_karts==1
     for(int i=num_karts-2; i>=0; i--)
     {
-        (*all_scores)[i] = (*all_scores)[i+1] + m_score_increase[i];
+        // Profile mode can use more karts than the maximum, the additional
+        // positions then get the same points as the last kart.
+        const int increase = i<(int)m_score_increase.size()
+                           ? m_score_increase[i] : 0;
+        (*all_scores)[i] = (*all_scores)[i+1] + increase;
     }
 }   // getAllScores
@@ -351,6 +351,11 @@ namespace UserConfigParams
     PARAM_PREFIX FloatUserConfigParam       m_music_volume
             PARAM_DEFAULT(  FloatUserConfigParam(0.7f, "music_volume",
             &m_audio_group, "Music volume from 0.0 to 1.0") );
+    PARAM_PREFIX IntUserConfigParam         m_sfx_voices
+            PARAM_DEFAULT(  IntUserConfigParam(32, "sfx_voices",
+            &m_audio_group, "Maximum number of sound effects played at the "
+                            "same time. Less audible sound effects are "
+                            "silenced until a voice is available.") );
 
     // ---- Race setup
     PARAM_PREFIX GroupUserConfigParam        m_race_setup_group
@@ -524,6 +529,10 @@ namespace UserConfigParams
     /** True if hardware skinning should be enabled */
     PARAM_PREFIX bool m_hw_skinning_enabled  PARAM_DEFAULT( false );
 
+    /** Number of threads used for the AI of the karts, 0 means one thread
+     *  per processor. */
+    PARAM_PREFIX int  m_ai_threads        PARAM_DEFAULT( 0 );
+
     // not saved to file
 
     // ---- Networking
@@ -690,6 +699,11 @@ namespace UserConfigParams
                                                "wasn't asked, 1: allowed, 2: "
                                                "not allowed") );
 
+    PARAM_PREFIX IntUserConfigParam        m_max_http_requests
+            PARAM_DEFAULT(  IntUserConfigParam(4, "max_http_requests",
+                                               "Maximum number of http requests "
+                                               "executed at the same time.") );
+
     // ---- Online gameplay related
 
     PARAM_PREFIX GroupUserConfigParam       m_online_group
@@ -468,6 +468,249 @@ void draw2DImage(const video::ITexture* texture, const core::rect<s32>& destRect
 	      tex_center_pos_x, tex_center_pos_y, tex_width, tex_height);
 }
 
+static GLuint ColorTexturedQuadBatchShader;
+static GLuint ColorTexturedQuadBatchAttribPosition;
+static GLuint ColorTexturedQuadBatchAttribTexCoord;
+static GLuint ColorTexturedQuadBatchAttribColor;
+static GLuint ColorTexturedQuadBatchUniformTexture;
+static GLuint CTQBvao;
+static GLuint CTQBbuffer;
+
+struct BatchVertex
+{
+	float position[2];
+	float texcoord[2];
+	unsigned char color[4];
+};
+
+// Clips a quad against clipRect and moves the texture coordinates with the
+// clipped edges. Returns false if nothing of the quad is left.
+static bool clipQuad(const core::rect<s32>& destRect, const core::rect<s32>& sourceRect,
+	const core::rect<s32>* clipRect, core::rect<f32>& dest, core::rect<f32>& source)
+{
+	dest = core::rect<f32>((f32)destRect.UpperLeftCorner.X, (f32)destRect.UpperLeftCorner.Y,
+		(f32)destRect.LowerRightCorner.X, (f32)destRect.LowerRightCorner.Y);
+	source = core::rect<f32>((f32)sourceRect.UpperLeftCorner.X, (f32)sourceRect.UpperLeftCorner.Y,
+		(f32)sourceRect.LowerRightCorner.X, (f32)sourceRect.LowerRightCorner.Y);
+	if (dest.getWidth() <= 0 || dest.getHeight() <= 0)
+		return false;
+	if (!clipRect)
+		return true;
+
+	const f32 su = source.getWidth() / dest.getWidth();
+	const f32 sv = source.getHeight() / dest.getHeight();
+	if (dest.UpperLeftCorner.X < clipRect->UpperLeftCorner.X)
+	{
+		source.UpperLeftCorner.X += (clipRect->UpperLeftCorner.X - dest.UpperLeftCorner.X) * su;
+		dest.UpperLeftCorner.X = (f32)clipRect->UpperLeftCorner.X;
+	}
+	if (dest.LowerRightCorner.X > clipRect->LowerRightCorner.X)
+	{
+		source.LowerRightCorner.X -= (dest.LowerRightCorner.X - clipRect->LowerRightCorner.X) * su;
+		dest.LowerRightCorner.X = (f32)clipRect->LowerRightCorner.X;
+	}
+	if (dest.UpperLeftCorner.Y < clipRect->UpperLeftCorner.Y)
+	{
+		source.UpperLeftCorner.Y += (clipRect->UpperLeftCorner.Y - dest.UpperLeftCorner.Y) * sv;
+		dest.UpperLeftCorner.Y = (f32)clipRect->UpperLeftCorner.Y;
+	}
+	if (dest.LowerRightCorner.Y > clipRect->LowerRightCorner.Y)
+	{
+		source.LowerRightCorner.Y -= (dest.LowerRightCorner.Y - clipRect->LowerRightCorner.Y) * sv;
+		dest.LowerRightCorner.Y = (f32)clipRect->LowerRightCorner.Y;
+	}
+	return dest.UpperLeftCorner.X < dest.LowerRightCorner.X &&
+		dest.UpperLeftCorner.Y < dest.LowerRightCorner.Y;
+}
+
+static void draw2DImageBatchGLSL(const video::ITexture* texture,
+	const std::vector<core::rect<s32> >& destRects,
+	const std::vector<core::rect<s32> >& sourceRects,
+	const std::vector<video::SColor>& colors,
+	const core::rect<s32>* clipRect, bool useAlphaChannelOfTexture)
+{
+	core::dimension2d<u32> frame_size =
+		irr_driver->getVideoDriver()->getCurrentRenderTargetSize();
+	const f32 screen_w = (f32)frame_size.Width;
+	const f32 screen_h = (f32)frame_size.Height;
+	const core::dimension2d<u32>& ss = texture->getOriginalSize();
+	const f32 invW = 1.f / static_cast<f32>(ss.Width);
+	const f32 invH = 1.f / static_cast<f32>(ss.Height);
+
+	// Two triangles per quad, corners in the order of the colors:
+	// upper left, lower left, lower right, upper right
+	static const unsigned corners[] = { 0, 1, 2, 0, 2, 3 };
+	static std::vector<BatchVertex> vertices;
+	vertices.clear();
+	for (unsigned i = 0; i < destRects.size(); i++)
+	{
+		core::rect<f32> dest, source;
+		if (!clipQuad(destRects[i], sourceRects[i], clipRect, dest, source))
+			continue;
+		const f32 x[] = { dest.UpperLeftCorner.X, dest.UpperLeftCorner.X,
+		                  dest.LowerRightCorner.X, dest.LowerRightCorner.X };
+		const f32 y[] = { dest.UpperLeftCorner.Y, dest.LowerRightCorner.Y,
+		                  dest.LowerRightCorner.Y, dest.UpperLeftCorner.Y };
+		const f32 u[] = { source.UpperLeftCorner.X, source.UpperLeftCorner.X,
+		                  source.LowerRightCorner.X, source.LowerRightCorner.X };
+		const f32 v[] = { source.UpperLeftCorner.Y, source.LowerRightCorner.Y,
+		                  source.LowerRightCorner.Y, source.UpperLeftCorner.Y };
+		for (unsigned j = 0; j < 6; j++)
+		{
+			const unsigned c = corners[j];
+			const video::SColor& col = colors[4 * i + c];
+			BatchVertex vertex;
+			vertex.position[0] = 2.f * x[c] / screen_w - 1.f;
+			vertex.position[1] = 1.f - 2.f * y[c] / screen_h;
+			vertex.texcoord[0] = u[c] * invW;
+			vertex.texcoord[1] = v[c] * invH;
+			vertex.color[0] = col.getRed();
+			vertex.color[1] = col.getGreen();
+			vertex.color[2] = col.getBlue();
+			vertex.color[3] = col.getAlpha();
+			vertices.push_back(vertex);
+		}
+	}
+	if (vertices.empty())
+		return;
+
+	initGL();
+
+	if (!ColorTexturedQuadBatchShader)
+	{
+		ColorTexturedQuadBatchShader = LoadProgram(file_manager->getAsset("shaders/colortexturedquadbatch.vert").c_str(), file_manager->getAsset("shaders/colortexturedquadbatch.frag").c_str());
+		ColorTexturedQuadBatchAttribPosition = glGetAttribLocation(ColorTexturedQuadBatchShader, "position");
+		ColorTexturedQuadBatchAttribTexCoord = glGetAttribLocation(ColorTexturedQuadBatchShader, "texcoord");
+		ColorTexturedQuadBatchAttribColor = glGetAttribLocation(ColorTexturedQuadBatchShader, "color");
+		ColorTexturedQuadBatchUniformTexture = glGetUniformLocation(ColorTexturedQuadBatchShader, "texture");
+		glGenBuffers(1, &CTQBbuffer);
+		glGenVertexArrays(1, &CTQBvao);
+		glBindVertexArray(CTQBvao);
+		glEnableVertexAttribArray(ColorTexturedQuadBatchAttribPosition);
+		glEnableVertexAttribArray(ColorTexturedQuadBatchAttribTexCoord);
+		glEnableVertexAttribArray(ColorTexturedQuadBatchAttribColor);
+		glBindBuffer(GL_ARRAY_BUFFER, CTQBbuffer);
+		glVertexAttribPointer(ColorTexturedQuadBatchAttribPosition, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), 0);
+		glVertexAttribPointer(ColorTexturedQuadBatchAttribTexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (GLvoid *)(2 * sizeof(float)));
+		glVertexAttribPointer(ColorTexturedQuadBatchAttribColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(BatchVertex), (GLvoid *)(4 * sizeof(float)));
+		glBindVertexArray(0);
+	}
+
+	if (useAlphaChannelOfTexture)
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	else
+	{
+		glDisable(GL_BLEND);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, CTQBbuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(BatchVertex), &vertices[0], GL_STREAM_DRAW);
+	glUseProgram(ColorTexturedQuadBatchShader);
+	glBindVertexArray(CTQBvao);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, static_cast<const irr::video::COpenGLTexture*>(texture)->getOpenGLTextureName());
+	glUniform1i(ColorTexturedQuadBatchUniformTexture, 0);
+	glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+static unsigned BatchDrawCalls = 0;
+static unsigned BatchQuads = 0;
+
+void getDraw2DImageBatchStats(unsigned *draw_calls, unsigned *quads)
+{
+	*draw_calls = BatchDrawCalls;
+	*quads = BatchQuads;
+	BatchDrawCalls = 0;
+	BatchQuads = 0;
+}
+
+void draw2DImageBatch(const video::ITexture* texture,
+	const std::vector<core::rect<s32> >& destRects,
+	const std::vector<core::rect<s32> >& sourceRects,
+	const std::vector<video::SColor>& colors,
+	const core::rect<s32>* clipRect, bool useAlphaChannelOfTexture)
+{
+	if (destRects.empty())
+		return;
+	BatchQuads += destRects.size();
+
+	if (irr_driver->isGLSL())
+	{
+		draw2DImageBatchGLSL(texture, destRects, sourceRects, colors, clipRect,
+			useAlphaChannelOfTexture);
+		BatchDrawCalls++;
+		return;
+	}
+
+	video::IVideoDriver* driver = irr_driver->getVideoDriver();
+	const video::E_DRIVER_TYPE type = driver->getDriverType();
+	if (type == video::EDT_NULL || type == video::EDT_SOFTWARE ||
+		type == video::EDT_BURNINGSVIDEO)
+	{
+		// The software drivers can not draw 2d vertex lists
+		for (unsigned i = 0; i < destRects.size(); i++)
+			driver->draw2DImage(texture, destRects[i], sourceRects[i], clipRect,
+				&colors[4 * i], useAlphaChannelOfTexture);
+		BatchDrawCalls += destRects.size();
+		return;
+	}
+
+	video::SMaterial material;
+	material.setTexture(0, const_cast<video::ITexture*>(texture));
+	material.Lighting = false;
+	material.MaterialType = video::EMT_ONETEXTURE_BLEND;
+	material.MaterialTypeParam = video::pack_textureBlendFunc(video::EBF_SRC_ALPHA,
+		video::EBF_ONE_MINUS_SRC_ALPHA, video::EMFN_MODULATE_1X,
+		useAlphaChannelOfTexture ? video::EAS_TEXTURE | video::EAS_VERTEX_COLOR
+		                         : video::EAS_VERTEX_COLOR);
+	driver->setMaterial(material);
+
+	const core::dimension2d<u32>& ss = texture->getOriginalSize();
+	const f32 invW = 1.f / static_cast<f32>(ss.Width);
+	const f32 invH = 1.f / static_cast<f32>(ss.Height);
+
+	// 16 bit indices, so at most 16384 quads per call
+	const unsigned max_quads = 16384;
+	static std::vector<video::S3DVertex> vertices;
+	static std::vector<u16> indices;
+	unsigned i = 0;
+	while (i < destRects.size())
+	{
+		vertices.clear();
+		indices.clear();
+		for (; i < destRects.size() && vertices.size() < 4 * max_quads; i++)
+		{
+			core::rect<f32> dest, source;
+			if (!clipQuad(destRects[i], sourceRects[i], clipRect, dest, source))
+				continue;
+			const u16 base = (u16)vertices.size();
+			vertices.push_back(video::S3DVertex(dest.UpperLeftCorner.X, dest.UpperLeftCorner.Y, 0,
+				0, 0, 1, colors[4 * i], source.UpperLeftCorner.X * invW, source.UpperLeftCorner.Y * invH));
+			vertices.push_back(video::S3DVertex(dest.UpperLeftCorner.X, dest.LowerRightCorner.Y, 0,
+				0, 0, 1, colors[4 * i + 1], source.UpperLeftCorner.X * invW, source.LowerRightCorner.Y * invH));
+			vertices.push_back(video::S3DVertex(dest.LowerRightCorner.X, dest.LowerRightCorner.Y, 0,
+				0, 0, 1, colors[4 * i + 2], source.LowerRightCorner.X * invW, source.LowerRightCorner.Y * invH));
+			vertices.push_back(video::S3DVertex(dest.LowerRightCorner.X, dest.UpperLeftCorner.Y, 0,
+				0, 0, 1, colors[4 * i + 3], source.LowerRightCorner.X * invW, source.UpperLeftCorner.Y * invH));
+			const u16 quad[] = { 0, 1, 2, 0, 2, 3 };
+			for (unsigned j = 0; j < 6; j++)
+				indices.push_back(base + quad[j]);
+		}
+		if (!vertices.empty())
+		{
+			driver->draw2DVertexPrimitiveList(&vertices[0], vertices.size(),
+				&indices[0], indices.size() / 3, video::EVT_STANDARD,
+				scene::EPT_TRIANGLES, video::EIT_16BIT);
+			BatchDrawCalls++;
+		}
+	}
+}
+
 static GLuint ColoredQuadShader;
 static GLuint ColoredQuadUniformCenter;
 static GLuint ColoredQuadUniformSize;
@@ -81,11 +81,24 @@ extern PFNGLVERTEXATTRIBIPOINTERPROC glVertexAttribIPointer;
 // core::rect<s32> needs these includes
 #include <rect.h>
 #include "utils/vec3.hpp"
+#include <vector>
 
 void draw2DImage(const irr::video::ITexture* texture, const irr::core::rect<s32>& destRect,
 	const irr::core::rect<s32>& sourceRect, const irr::core::rect<s32>* clipRect,
 	const irr::video::SColor* const colors, bool useAlphaChannelOfTexture);
 
+/** Draws many quads of the same texture with one draw call. colors contains
+ *  four colors per quad, in the same order as for draw2DImage. */
+void draw2DImageBatch(const irr::video::ITexture* texture,
+	const std::vector<irr::core::rect<s32> >& destRects,
+	const std::vector<irr::core::rect<s32> >& sourceRects,
+	const std::vector<irr::video::SColor>& colors,
+	const irr::core::rect<s32>* clipRect, bool useAlphaChannelOfTexture);
+
+/** Returns the number of draw calls and quads of draw2DImageBatch since the
+ *  last call of this function. */
+void getDraw2DImageBatchStats(unsigned *draw_calls, unsigned *quads);
+
 void GL32_draw2DRectangle(irr::video::SColor color, const irr::core::rect<s32>& position,
 	const irr::core::rect<s32>* clip = 0);
 #endif
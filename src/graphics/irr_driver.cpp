@@ -1477,12 +1477,17 @@ void IrrDriver::displayFPS()
     if (low > kilotris) low = kilotris;
     if (high < kilotris) high = kilotris;
 
-    static char buffer[64];
+    static char buffer[128];
+    // The 2d batches of the previous frame, including this text
+    unsigned batch_calls, batch_quads;
+    getDraw2DImageBatchStats(&batch_calls, &batch_quads);
 
     if (UserConfigParams::m_artist_debug_mode)
     {
-        sprintf(buffer, "FPS: %i/%i/%i - %.2f/%.2f/%.2f KTris - LightDst : ~%d",
-                min, fps, max, low, kilotris, high, m_last_light_bucket_distance);
+        sprintf(buffer, "FPS: %i/%i/%i - %.2f/%.2f/%.2f KTris - LightDst : ~%d"
+                " - 2D: %u calls/%u quads",
+                min, fps, max, low, kilotris, high, m_last_light_bucket_distance,
+                batch_calls, batch_quads);
     }
     else
     {
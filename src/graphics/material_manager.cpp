@@ -28,6 +28,7 @@
 #include "io/xml_node.hpp"
 #include "modes/world.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
 #include <ITexture.h>
@@ -41,6 +42,8 @@ MaterialManager::MaterialManager()
     /* Create list - and default material zero */
 
     m_materials.reserve(256);
+    m_lookup_count       = 0;
+    m_lookup_found_count = 0;
     // We can't call init/loadMaterial here, since the global variable
     // material_manager has not yet been initialised, and
     // material_manager is used in the Material constructor.
@@ -58,8 +61,35 @@ MaterialManager::~MaterialManager()
         delete m_materials[i];
     }
     m_materials.clear();
+    m_material_index.clear();
 }   // ~MaterialManager
 
+//-----------------------------------------------------------------------------
+/** Adds the material with the given index in m_materials to the name index.
+ *  Must be called for each material added to m_materials.
+ */
+void MaterialManager::addToIndex(int index)
+{
+    m_material_index[m_materials[index]->getTexFname()].push_back(index);
+}   // addToIndex
+
+//-----------------------------------------------------------------------------
+/** Returns the index of the material with the given texture name, or -1 if
+ *  there is no such material. If several materials have the same name, the
+ *  one added last (i.e. a temporary material if it exists) is returned.
+ *  \param basename Texture name (without path) of the material.
+ */
+int MaterialManager::findMaterial(const std::string& basename) const
+{
+    m_lookup_count++;
+    std::map<std::string, std::vector<int> >::const_iterator i =
+        m_material_index.find(basename);
+    if(i==m_material_index.end())
+        return -1;
+    m_lookup_found_count++;
+    return i->second.back();
+}   // findMaterial
+
 //-----------------------------------------------------------------------------
 
 Material* MaterialManager::getMaterialFor(video::ITexture* t,
@@ -67,17 +97,9 @@ Material* MaterialManager::getMaterialFor(video::ITexture* t,
 {
     assert(t != NULL);
     const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            return m_materials[i];
-        }
-    }   // for i
-
-    return NULL;
-}
+    const int index = findMaterial(image);
+    return index>=0 ? m_materials[index] : NULL;
+}   // getMaterialFor
 
 //-----------------------------------------------------------------------------
 /** Searches for the material in the given texture, and calls a function
@@ -143,15 +165,9 @@ void MaterialManager::adjustForFog(video::ITexture* t,
                                    bool use_fog) const
 {
     const std::string image = StringUtils::getBasename(core::stringc(t->getName()).c_str());
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if (m_materials[i]->getTexFname()==image)
-        {
-            m_materials[i]->adjustForFog(parent, &(mb->getMaterial()), use_fog);
-            return;
-        }
-    }   // for i
+    const int index = findMaterial(image);
+    if(index>=0)
+        m_materials[index]->adjustForFog(parent, &(mb->getMaterial()), use_fog);
 }   // adjustForFog
 
 //-----------------------------------------------------------------------------
@@ -174,6 +190,7 @@ void MaterialManager::setAllUntexturedMaterialFlags(scene::IMeshBuffer *mb) cons
 int MaterialManager::addEntity(Material *m)
 {
     m_materials.push_back(m);
+    addToIndex((int)m_materials.size()-1);
     return (int)m_materials.size()-1;
 }
 
@@ -245,6 +262,7 @@ bool MaterialManager::pushTempMaterial(const XMLNode *root,
         try
         {
             m_materials.push_back(new Material(node, m_materials.size(), deprecated));
+            addToIndex((int)m_materials.size()-1);
         }
         catch(std::exception& e)
         {
@@ -261,9 +279,23 @@ void MaterialManager::popTempMaterial()
 {
     for(int i=(int)m_materials.size()-1; i>=this->m_shared_material_index; i--)
     {
+        // Materials are removed in reverse order, so this material is the
+        // last entry for its name in the index.
+        std::map<std::string, std::vector<int> >::iterator entry =
+            m_material_index.find(m_materials[i]->getTexFname());
+        assert(entry!=m_material_index.end() && entry->second.back()==i);
+        entry->second.pop_back();
+        if(entry->second.empty())
+            m_material_index.erase(entry);
         delete m_materials[i];
         m_materials.pop_back();
     }   // for i6
+
+    Log::debug("MaterialManager", "%u material lookups, %u found, "
+               "%u materials.", m_lookup_count, m_lookup_found_count,
+               (unsigned int)m_materials.size());
+    m_lookup_count       = 0;
+    m_lookup_found_count = 0;
 }   // popTempMaterial
 
 //-----------------------------------------------------------------------------
@@ -304,15 +336,14 @@ Material *MaterialManager::getMaterial(const std::string& fname,
     else
         basename = fname;
         
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return m_materials[i];
-    }
+    // Temporary (track) textures are found first
+    const int index = findMaterial(basename);
+    if(index>=0) return m_materials[index];
 
     // Add the new material
     Material* m=new Material(fname, m_materials.size(), is_full_path, complain_if_not_found);
     m_materials.push_back(m);
+    addToIndex((int)m_materials.size()-1);
     if(make_permanent)
     {
         assert(m_shared_material_index==(int)m_materials.size()-1);
@@ -334,11 +365,5 @@ void MaterialManager::makeMaterialsPermanent()
 bool MaterialManager::hasMaterial(const std::string& fname)
 {
     std::string basename=StringUtils::getBasename(fname);
-
-    // Search backward so that temporary (track) textures are found first
-    for(int i = (int)m_materials.size()-1; i>=0; i-- )
-    {
-        if(m_materials[i]->getTexFname()==basename) return true;
-    }
-    return false;
+    return findMaterial(basename)>=0;
 }
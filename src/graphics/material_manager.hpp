@@ -29,6 +29,7 @@ namespace irr
 }
 using namespace irr;
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -44,9 +45,22 @@ class MaterialManager : public NoCopy
 private:
 
     void    parseMaterialFile(const std::string& filename);
+    void    addToIndex(int index);
+    int     findMaterial(const std::string& basename) const;
     int     m_shared_material_index;
 
     std::vector<Material*> m_materials;
+
+    /** Maps the texture name of a material to the indices in m_materials
+     *  of all materials with this name, in increasing order. The last
+     *  entry is the one found by a search from the end of m_materials, i.e.
+     *  temporary (track) materials hide shared materials of the same name. */
+    std::map<std::string, std::vector<int> > m_material_index;
+
+    /** Number of material lookups by name, and how many of them found a
+     *  material. Reset each time the temporary materials are removed. */
+    mutable unsigned int m_lookup_count;
+    mutable unsigned int m_lookup_found_count;
 public:
               MaterialManager();
              ~MaterialManager();
@@ -76,6 +90,13 @@ public:
     bool      hasMaterial(const std::string& fname);
 
     Material* getLatestMaterial() { return m_materials[m_materials.size()-1]; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of material lookups since the last time the
+     *  temporary materials were removed. */
+    unsigned int getLookupCount() const { return m_lookup_count; }
+    // ------------------------------------------------------------------------
+    /** Returns how many of the lookups found a material. */
+    unsigned int getLookupFoundCount() const { return m_lookup_found_count; }
 };   // MaterialManager
 
 extern MaterialManager *material_manager;
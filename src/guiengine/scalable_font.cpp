@@ -10,6 +10,10 @@
 #include <IVideoDriver.h>
 #include <IGUISpriteBank.h>
 
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
 #include "guiengine/engine.hpp"
 #include "io/file_manager.hpp"
 #include "utils/translation.hpp"
@@ -38,6 +42,8 @@ ScalableFont::ScalableFont(IGUIEnvironment *env, const io::path& filename)
     m_shadow                 = false;
     m_mono_space_digits      = false;
     m_rtl                    = translations->isRTLLanguage();
+    m_num_quad_batches       = 0;
+    m_outline_pages          = new std::map<std::pair<s32, s32>, OutlinePage>();
 
     if (Environment)
     {
@@ -71,6 +77,14 @@ ScalableFont::~ScalableFont()
 {
     if (!m_is_hollow_copy)
     {
+        std::map<std::pair<s32, s32>, OutlinePage>::iterator i;
+        for (i = m_outline_pages->begin(); i != m_outline_pages->end(); i++)
+        {
+            if (i->second.m_texture && Driver)
+                Driver->removeTexture(i->second.m_texture);
+        }
+        delete m_outline_pages;
+
         if (Driver)     Driver->drop();
         if (SpriteBank) SpriteBank->drop();
     }
@@ -263,6 +277,7 @@ bool ScalableFont::load(io::IXMLReader* xml)
     }
 
     doReadXmlFile(xml);
+    m_glyph_runs.clear();
 
     // set bad character
     WrongCharacter = getAreaIDFromCharacter(L' ', NULL);
@@ -418,6 +433,7 @@ const ScalableFont::SFontArea &ScalableFont::getAreaFromCharacter(const wchar_t
 void ScalableFont::setInvisibleCharacters( const wchar_t *s )
 {
     Invisible = s;
+    m_glyph_runs.clear();
 }
 
 
@@ -498,31 +514,120 @@ void ScalableFont::draw(const core::stringw& text,
         m_shadow = true; // set back
     }
 
+    const GlyphRun &run = getGlyphRun(text);
+    const core::dimension2d<s32> &text_dimension = run.m_dimension;
+
     core::position2d<s32> offset = position.UpperLeftCorner;
-    core::dimension2d<s32> text_dimension;
+    s32 line_start = position.UpperLeftCorner.X;
 
-    if (m_rtl || hcenter || vcenter || clip)
-    {
-        text_dimension = getDimension(text.c_str());
+    if (hcenter)    offset.X += (position.getWidth() - text_dimension.Width) / 2;
+    else if (m_rtl) offset.X += (position.getWidth() - text_dimension.Width);
+    if (hcenter)    line_start += (position.getWidth() - text_dimension.Width) >> 1;
 
-        if (hcenter)    offset.X += (position.getWidth() - text_dimension.Width) / 2;
-        else if (m_rtl) offset.X += (position.getWidth() - text_dimension.Width);
+    if (vcenter)    offset.Y += (position.getHeight() - text_dimension.Height) / 2;
+    if (clip)
+    {
+        core::rect<s32> clippedRect(offset, text_dimension);
+        clippedRect.clipAgainst(*clip);
+        if (!clippedRect.isValid()) return;
+    }
 
-        if (vcenter)    offset.Y += (position.getHeight() - text_dimension.Height) / 2;
-        if (clip)
+    // ---- do the actual rendering: first all outlines, then all glyphs,
+    //      with one draw call per texture
+    video::SColor colors[] = {color, color, color, color};
+    for (unsigned int pass = m_black_border ? 0 : 1; pass < 2; pass++)
+    {
+        for (unsigned int n = 0; n < run.m_quads.size(); n++)
         {
-            core::rect<s32> clippedRect(offset, text_dimension);
-            clippedRect.clipAgainst(*clip);
-            if (!clippedRect.isValid()) return;
+            const GlyphQuad &quad = run.m_quads[n];
+            const core::rect<s32> dest = quad.m_dest +
+                core::position2di(quad.m_first_line ? offset.X : line_start,
+                                  offset.Y);
+            if (pass == 0)
+            {
+                addOutlineQuad(quad, dest, color);
+            }
+            else if (quad.m_fallback)
+            {
+                // draw text over
+                static video::SColor orange(color.getAlpha(), 255, 100, 0);
+                static video::SColor yellow(color.getAlpha(), 255, 220, 15);
+                video::SColor title_colors[] = {yellow, orange, orange, yellow};
+                addQuad(quad.m_texture, dest, quad.m_source, title_colors);
+            }
+            else
+            {
+                addQuad(quad.m_texture, dest, quad.m_source, colors);
+
+#ifdef FONT_DEBUG
+                video::IVideoDriver* driver = GUIEngine::getDriver();
+                driver->draw2DLine(core::position2d<s32>(dest.UpperLeftCorner.X,  dest.UpperLeftCorner.Y),
+                                   core::position2d<s32>(dest.UpperLeftCorner.X,  dest.LowerRightCorner.Y),
+                                   video::SColor(255, 255,0,0));
+                driver->draw2DLine(core::position2d<s32>(dest.LowerRightCorner.X, dest.LowerRightCorner.Y),
+                                   core::position2d<s32>(dest.LowerRightCorner.X, dest.UpperLeftCorner.Y),
+                                   video::SColor(255, 255,0,0));
+                driver->draw2DLine(core::position2d<s32>(dest.LowerRightCorner.X, dest.LowerRightCorner.Y),
+                                   core::position2d<s32>(dest.UpperLeftCorner.X,  dest.LowerRightCorner.Y),
+                                   video::SColor(255, 255,0,0));
+                driver->draw2DLine(core::position2d<s32>(dest.UpperLeftCorner.X,  dest.UpperLeftCorner.Y),
+                                   core::position2d<s32>(dest.LowerRightCorner.X, dest.UpperLeftCorner.Y),
+                                   video::SColor(255, 255,0,0));
+#endif
+            }
         }
+        drawQuadBatches(clip);
     }
+}
 
-    // ---- collect character locations
-    const unsigned int text_size = text.size();
-    core::array<s32>               indices(text_size);
-    core::array<core::position2di> offsets(text_size);
-    std::vector<bool>              fallback(text_size);
+/** Returns the layout of a string, reusing the previous layout if the font
+ *  settings did not change since.
+ */
+const ScalableFont::GlyphRun &ScalableFont::getGlyphRun(const core::stringw &text)
+{
+    std::map<core::stringw, GlyphRun>::iterator i = m_glyph_runs.find(text);
+    if (i != m_glyph_runs.end())
+    {
+        const GlyphRun &run = i->second;
+        if (run.m_scale                  == m_scale                  &&
+            run.m_fallback_scale         == m_fallback_font_scale    &&
+            run.m_kerning_width          == GlobalKerningWidth       &&
+            run.m_fallback_kerning_width == m_fallback_kerning_width &&
+            run.m_max_height             == MaxHeight                &&
+            run.m_mono_space_digits      == m_mono_space_digits         )
+            return run;
+    }
+    else
+    {
+        // Strings that change all the time (e.g. timers) would otherwise
+        // fill the cache forever.
+        if (m_glyph_runs.size() >= MAX_GLYPH_RUNS)
+            m_glyph_runs.clear();
+        i = m_glyph_runs.insert(std::make_pair(text, GlyphRun())).first;
+    }
+
+    layoutGlyphRun(text, &i->second);
+    return i->second;
+}   // getGlyphRun
+
+/** Computes the position, texture and source rectangle of all visible
+ *  glyphs of a string. Textures are loaded if necessary.
+ */
+void ScalableFont::layoutGlyphRun(const core::stringw &text, GlyphRun *run)
+{
+    run->m_quads.clear();
+    run->m_dimension              = getDimension(text.c_str());
+    run->m_scale                  = m_scale;
+    run->m_fallback_scale         = m_fallback_font_scale;
+    run->m_kerning_width          = GlobalKerningWidth;
+    run->m_fallback_kerning_width = m_fallback_kerning_width;
+    run->m_max_height             = MaxHeight;
+    run->m_mono_space_digits      = m_mono_space_digits;
+
+    core::position2d<s32> offset(0, 0);
+    bool first_line = true;
 
+    const unsigned int text_size = text.size();
     for (u32 i = 0; i<text_size; i++)
     {
         wchar_t c = text[i];
@@ -531,107 +636,48 @@ void ScalableFont::draw(const core::stringw& text,
             c == L'\n'    )        // Unix breaks
         {
             if(c==L'\r' && text[i+1]==L'\n') c = text[++i];
-            offset.Y += (int)(MaxHeight*m_scale);
-            offset.X  = position.UpperLeftCorner.X;
-            if (hcenter)
-                offset.X += (position.getWidth() - text_dimension.Width) >> 1;
+            offset.Y  += (int)(MaxHeight*m_scale);
+            offset.X   = 0;
+            first_line = false;
             continue;
         }   // if lineBreak
 
         bool use_fallback_font = false;
         const SFontArea &area  = getAreaFromCharacter(c, &use_fallback_font);
-        fallback[i]            = use_fallback_font;
         offset.X              += area.underhang;
-        offsets.push_back(offset);
-        // Invisible character. add something to the array anyway so that
-        // indices from the various arrays remain in sync
-        indices.push_back( Invisible.findFirst(c) < 0  ? area.spriteno
-                                                       : -1            );
-        offset.X += getCharWidth(area, fallback[i]);
-    }   // for i<text_size
-
-    // ---- do the actual rendering
-    const int indiceAmount                    = indices.size();
-    core::array< SGUISprite >& sprites        = SpriteBank->getSprites();
-    core::array< core::rect<s32> >& positions = SpriteBank->getPositions();
-    core::array< SGUISprite >* fallback_sprites;
-    core::array< core::rect<s32> >* fallback_positions;
-    if(m_fallback_font!=NULL)
-    {
-        fallback_sprites   = &m_fallback_font->SpriteBank->getSprites();
-        fallback_positions = &m_fallback_font->SpriteBank->getPositions();
-    }
-    else
-    {
-        fallback_sprites   = NULL;
-        fallback_positions = NULL;
-    }
-
-    video::IVideoDriver* driver = GUIEngine::getDriver();
-    const int spriteAmount      = sprites.size();
-    for (int n=0; n<indiceAmount; n++)
-    {
-        const int spriteID = indices[n];
-        if (!fallback[n] && (spriteID < 0 || spriteID >= spriteAmount)) continue;
-        if (indices[n] == -1) continue;
+        const core::position2di glyph_offset = offset;
+        const s32 spriteID     = area.spriteno;
+        offset.X              += getCharWidth(area, use_fallback_font);
 
-        //assert(sprites[spriteID].Frames.size() > 0);
+        if (Invisible.findFirst(c) >= 0) continue;
 
-        const int texID = (fallback[n] ?
-                           (*fallback_sprites)[spriteID].Frames[0].textureNumber :
-                           sprites[spriteID].Frames[0].textureNumber);
+        ScalableFont *font = use_fallback_font ? m_fallback_font : this;
+        core::array< SGUISprite >& sprites        = font->SpriteBank->getSprites();
+        core::array< core::rect<s32> >& positions = font->SpriteBank->getPositions();
+        if (spriteID < 0 || spriteID >= (s32)sprites.size()) continue;
 
-        core::rect<s32> source = (fallback[n] ?
-                                  (*fallback_positions)[(*fallback_sprites)[spriteID].Frames[0].rectNumber] :
-                                  positions[sprites[spriteID].Frames[0].rectNumber]);
+        const int texID = sprites[spriteID].Frames[0].textureNumber;
+        const u32 rect_number = sprites[spriteID].Frames[0].rectNumber;
+        const core::rect<s32> &source = positions[rect_number];
 
-        const TextureInfo& info = (fallback[n] ?
-                                   (*(m_fallback_font->m_texture_files.find(texID))).second :
-                                   (*(m_texture_files.find(texID))).second
-                                   );
+        const TextureInfo& info = (*(font->m_texture_files.find(texID))).second;
         float char_scale = info.m_scale;
 
         core::dimension2d<s32> size = source.getSize();
 
-        float scale = (fallback[n] ? m_scale*m_fallback_font_scale : m_scale);
+        float scale = (use_fallback_font ? m_scale*m_fallback_font_scale : m_scale);
         size.Width  = (int)(size.Width  * scale * char_scale);
         size.Height = (int)(size.Height * scale * char_scale);
 
         // align vertically if character is smaller
         int y_shift = (size.Height < MaxHeight*m_scale ? (int)((MaxHeight*m_scale - size.Height)/2.0f) : 0);
 
-        core::rect<s32> dest(offsets[n] + core::position2di(0, y_shift), size);
-
-        video::SColor colors[] = {color, color, color, color};
-
-        video::ITexture* texture = (fallback[n] ?
-                                    m_fallback_font->SpriteBank->getTexture(texID) :
-                                    SpriteBank->getTexture(texID) );
-
-        /*
-        if (fallback[n])
-        {
-            std::cout << "USING fallback font " << core::stringc(texture->getName()).c_str()
-                      << "; source area is " << source.UpperLeftCorner.X << ", " << source.UpperLeftCorner.Y
-                      << ", size " << source.getWidth() << ", " << source.getHeight() << "; dest = "
-                      << offsets[n].X << ", " << offsets[n].Y << std::endl;
-        }
-        */
-
+        video::ITexture* texture = font->SpriteBank->getTexture(texID);
         if (texture == NULL)
         {
             // perform lazy loading
-
-            if (fallback[n])
-            {
-                m_fallback_font->lazyLoadTexture(texID);
-                texture = m_fallback_font->SpriteBank->getTexture(texID);
-            }
-            else
-            {
-                lazyLoadTexture(texID);
-                texture = SpriteBank->getTexture(texID);
-            }
+            font->lazyLoadTexture(texID);
+            texture = font->SpriteBank->getTexture(texID);
 
             if (texture == NULL)
             {
@@ -640,63 +686,260 @@ void ScalableFont::draw(const core::stringw& text,
             }
         }
 
-        if (m_black_border)
+        GlyphQuad quad;
+        quad.m_texture     = texture;
+        quad.m_dest        = core::rect<s32>(glyph_offset + core::position2di(0, y_shift), size);
+        quad.m_source      = source;
+        quad.m_tex_id      = texID;
+        quad.m_rect_number = rect_number;
+        quad.m_texel_scale = scale * char_scale;
+        quad.m_fallback    = use_fallback_font;
+        quad.m_first_line  = first_line;
+        run->m_quads.push_back(quad);
+    }   // for i<text_size
+}   // layoutGlyphRun
+
+/** Returns the outline texture of a font texture, creating it when it is
+ *  used for the first time. Each pixel of the outline is covered as much as
+ *  the glyph drawn shifted by up to 'radius' texels in each direction, which
+ *  is what was drawn before the outlines were baked.
+ *  \param tex_id The font texture.
+ *  \param radius Width of the outline in texels.
+ *  \return The outline page, or NULL if it can not be created.
+ */
+const ScalableFont::OutlinePage *ScalableFont::getOutlinePage(s32 tex_id,
+                                                              s32 radius)
+{
+    const std::pair<s32, s32> key(tex_id, radius);
+    std::map<std::pair<s32, s32>, OutlinePage>::iterator p =
+        m_outline_pages->find(key);
+    if (p != m_outline_pages->end())
+        return p->second.m_texture ? &p->second : NULL;
+
+    // Also remember failures, to not try again every frame
+    OutlinePage &page = (*m_outline_pages)[key];
+    page.m_texture = NULL;
+
+    std::map<int, TextureInfo>::const_iterator info = m_texture_files.find(tex_id);
+    if (info == m_texture_files.end())
+        return NULL;
+    video::IImage *image = Driver->createImageFromFile(info->second.m_file_name);
+    if (!image)
+        return NULL;
+    const core::dimension2d<u32> &image_size = image->getDimension();
+
+    // ---- place the cells of all glyphs of this texture in rows
+    core::array< SGUISprite >& sprites        = SpriteBank->getSprites();
+    core::array< core::rect<s32> >& positions = SpriteBank->getPositions();
+    const s32 width = std::max((s32)image_size.Width, 256);
+    s32 x = 0, y = 0, row_height = 0;
+    for (u32 i = 0; i < sprites.size(); i++)
+    {
+        if (sprites[i].Frames.size() == 0 ||
+            sprites[i].Frames[0].textureNumber != (u32)tex_id)
+            continue;
+        const u32 rect_number = sprites[i].Frames[0].rectNumber;
+        if (page.m_rects.find(rect_number) != page.m_rects.end())
+            continue;
+        const core::rect<s32> &source = positions[rect_number];
+        const s32 w = std::min(source.getWidth() + 2*radius, width);
+        const s32 h = source.getHeight() + 2*radius;
+        if (x + w > width)
         {
-            // draw black border
-            video::SColor black(color.getAlpha(),0,0,0);
-            video::SColor black_colors[] = {black, black, black, black};
+            x           = 0;
+            y          += row_height;
+            row_height  = 0;
+        }
+        page.m_rects[rect_number] = core::rect<s32>(x, y, x + w, y + h);
+        x         += w;
+        row_height = std::max(row_height, h);
+    }
+    const s32 height = y + row_height;
+    if (height == 0)
+    {
+        image->drop();
+        return NULL;
+    }
+
+    // ---- draw the outlines
+    // The outline of a texel is the product of the transparencies of the
+    // texels around it, like the shifted glyphs drawn by addOutlineQuad. It
+    // is computed as a sum of logarithms with summed area tables, so the
+    // cost only depends on the number of texels and not on the radius.
+    video::IImage *outline =
+        Driver->createImage(video::ECF_A8R8G8B8,
+                            core::dimension2d<u32>(width, height));
+    outline->fill(video::SColor(0, 255, 255, 255));
+    const core::rect<s32> image_rect(0, 0, image_size.Width, image_size.Height);
+    std::vector<double> logs, box, row, col;
+    std::map<u32, core::rect<s32> >::const_iterator r;
+    for (r = page.m_rects.begin(); r != page.m_rects.end(); r++)
+    {
+        const core::rect<s32> &glyph = positions[r->first];
+        const core::rect<s32> &cell  = r->second;
+        core::rect<s32> source = glyph;
+        source.clipAgainst(image_rect);
+        const s32 sw = source.getWidth();
+        const s32 sh = source.getHeight();
+        if (sw <= 0 || sh <= 0)
+            continue;
 
-            for (int x_delta=-2; x_delta<=2; x_delta++)
+        // box[(y+1)*stride+x+1]: sum of all logs in [0,x]x[0,y],
+        // row[y*stride+x+1]: sum of the logs in [0,x] of row y,
+        // col[(y+1)*sw+x]: sum of the logs in [0,y] of column x.
+        const s32 stride = sw + 1;
+        logs.assign(sw*sh, 0.0);
+        box.assign(stride*(sh+1), 0.0);
+        row.assign(stride*sh, 0.0);
+        col.assign(sw*(sh+1), 0.0);
+        for (s32 y = 0; y < sh; y++)
+        {
+            for (s32 x = 0; x < sw; x++)
             {
-                for (int y_delta=-2; y_delta<=2; y_delta++)
-                {
-                    if (x_delta == 0 || y_delta == 0) continue;
-                    draw2DImage(texture,
-                                        dest + core::position2d<s32>(x_delta, y_delta),
-                                        source,
-                                        clip,
-                                        black_colors, true);
-                }
+                const u32 alpha = image->getPixel(source.UpperLeftCorner.X + x,
+                                                  source.UpperLeftCorner.Y + y)
+                                       .getAlpha();
+                // Opaque texels would give log(0)
+                const double l = log(std::max(1.0 - alpha / 255.0,
+                                              1.0 / 1024.0));
+                logs[y*sw + x]            = l;
+                row[y*stride + x + 1]     = row[y*stride + x] + l;
+                col[(y+1)*sw + x]         = col[y*sw + x] + l;
+                box[(y+1)*stride + x + 1] = box[y*stride + x + 1]
+                                          + row[y*stride + x + 1];
             }
         }
 
-        if (fallback[n])
+        for (s32 cy = 0; cy < cell.getHeight(); cy++)
         {
-            // draw text over
-            static video::SColor orange(color.getAlpha(), 255, 100, 0);
-            static video::SColor yellow(color.getAlpha(), 255, 220, 15);
-            video::SColor title_colors[] = {yellow, orange, orange, yellow};
-            draw2DImage(texture,
-                                dest,
-                                source,
-                                clip,
-                                title_colors, true);
+            for (s32 cx = 0; cx < cell.getWidth(); cx++)
+            {
+                // The texel of the glyph at the center of this outline texel
+                const s32 u = glyph.UpperLeftCorner.X + cx - radius
+                            - source.UpperLeftCorner.X;
+                const s32 v = glyph.UpperLeftCorner.Y + cy - radius
+                            - source.UpperLeftCorner.Y;
+                const s32 x0 = std::max(u - radius, 0);
+                const s32 x1 = std::min(u + radius, sw - 1);
+                const s32 y0 = std::max(v - radius, 0);
+                const s32 y1 = std::min(v + radius, sh - 1);
+                if (x0 > x1 || y0 > y1)
+                    continue;
+                // The box around the texel, without the row and column
+                // through it (the shifted glyphs have no zero offsets).
+                double sum = box[(y1+1)*stride + x1 + 1] - box[y0*stride + x1 + 1]
+                           - box[(y1+1)*stride + x0]     + box[y0*stride + x0];
+                if (v >= 0 && v < sh)
+                    sum -= row[v*stride + x1 + 1] - row[v*stride + x0];
+                if (u >= 0 && u < sw)
+                    sum -= col[(y1+1)*sw + u] - col[y0*sw + u];
+                if (u >= 0 && u < sw && v >= 0 && v < sh)
+                    sum += logs[v*sw + u];
+                const u32 alpha = (u32)((1.0 - exp(sum)) * 255.0 + 0.5);
+                outline->setPixel(cell.UpperLeftCorner.X + cx,
+                                  cell.UpperLeftCorner.Y + cy,
+                                  video::SColor(alpha, 255, 255, 255));
+            }
         }
-        else
+    }
+    image->drop();
+
+    io::path name = info->second.m_file_name;
+    name += "_outline";
+    name += radius;
+    page.m_texture = Driver->addTexture(name, outline);
+    outline->drop();
+    return page.m_texture ? &page : NULL;
+}   // getOutlinePage
+
+/** Adds the black outline of a glyph to the quad batches.
+ *  \param quad The glyph.
+ *  \param dest Position of the glyph on the screen.
+ *  \param color The text color, its alpha is used for the outline.
+ */
+void ScalableFont::addOutlineQuad(const GlyphQuad &quad,
+                                  const core::rect<s32> &dest,
+                                  const video::SColor &color)
+{
+    video::SColor black(color.getAlpha(),0,0,0);
+    video::SColor black_colors[] = {black, black, black, black};
+
+    // The outline is about 2 pixels wide on the screen
+    const s32 radius = core::clamp((s32)(2.0f / quad.m_texel_scale + 0.5f), 1, 8);
+    ScalableFont *font = quad.m_fallback ? m_fallback_font : this;
+    const OutlinePage *page = font->getOutlinePage(quad.m_tex_id, radius);
+    if (page)
+    {
+        std::map<u32, core::rect<s32> >::const_iterator cell =
+            page->m_rects.find(quad.m_rect_number);
+        if (cell != page->m_rects.end())
         {
-            draw2DImage(texture,
-                                dest,
-                                source,
-                                clip,
-                                colors, true);
+            const s32 pad = (s32)(radius * quad.m_texel_scale + 0.5f);
+            core::rect<s32> outline(dest.UpperLeftCorner.X  - pad,
+                                    dest.UpperLeftCorner.Y  - pad,
+                                    dest.LowerRightCorner.X + pad,
+                                    dest.LowerRightCorner.Y + pad);
+            addQuad(page->m_texture, outline, cell->second, black_colors);
+            return;
+        }
+    }
 
-#ifdef FONT_DEBUG
-            driver->draw2DLine(core::position2d<s32>(dest.UpperLeftCorner.X,  dest.UpperLeftCorner.Y),
-                               core::position2d<s32>(dest.UpperLeftCorner.X,  dest.LowerRightCorner.Y),
-                               video::SColor(255, 255,0,0));
-            driver->draw2DLine(core::position2d<s32>(dest.LowerRightCorner.X, dest.LowerRightCorner.Y),
-                               core::position2d<s32>(dest.LowerRightCorner.X, dest.UpperLeftCorner.Y),
-                               video::SColor(255, 255,0,0));
-            driver->draw2DLine(core::position2d<s32>(dest.LowerRightCorner.X, dest.LowerRightCorner.Y),
-                               core::position2d<s32>(dest.UpperLeftCorner.X,  dest.LowerRightCorner.Y),
-                               video::SColor(255, 255,0,0));
-            driver->draw2DLine(core::position2d<s32>(dest.UpperLeftCorner.X,  dest.UpperLeftCorner.Y),
-                               core::position2d<s32>(dest.LowerRightCorner.X, dest.UpperLeftCorner.Y),
-                               video::SColor(255, 255,0,0));
-#endif
+    // No outline texture, draw the glyph shifted in all directions instead
+    for (int x_delta=-2; x_delta<=2; x_delta++)
+    {
+        for (int y_delta=-2; y_delta<=2; y_delta++)
+        {
+            if (x_delta == 0 || y_delta == 0) continue;
+            addQuad(quad.m_texture,
+                    dest + core::position2d<s32>(x_delta, y_delta),
+                    quad.m_source, black_colors);
         }
     }
-}
+}   // addOutlineQuad
+
+/** Adds a quad to the batch of its texture.
+ *  \param colors The four corner colors, in the order used by draw2DImage.
+ */
+void ScalableFont::addQuad(video::ITexture *texture,
+                           const core::rect<s32> &dest,
+                           const core::rect<s32> &source,
+                           const video::SColor *colors)
+{
+    QuadBatch *batch = NULL;
+    for (unsigned int i = 0; i < m_num_quad_batches; i++)
+    {
+        if (m_quad_batches[i].m_texture == texture)
+        {
+            batch = &m_quad_batches[i];
+            break;
+        }
+    }
+    if (!batch)
+    {
+        if (m_num_quad_batches == m_quad_batches.size())
+            m_quad_batches.push_back(QuadBatch());
+        batch = &m_quad_batches[m_num_quad_batches++];
+        batch->m_texture = texture;
+    }
+    batch->m_dest.push_back(dest);
+    batch->m_source.push_back(source);
+    batch->m_colors.insert(batch->m_colors.end(), colors, colors + 4);
+}   // addQuad
+
+/** Draws and empties all quad batches. */
+void ScalableFont::drawQuadBatches(const core::rect<s32> *clip)
+{
+    for (unsigned int i = 0; i < m_num_quad_batches; i++)
+    {
+        QuadBatch &batch = m_quad_batches[i];
+        draw2DImageBatch(batch.m_texture, batch.m_dest, batch.m_source,
+                         batch.m_colors, clip, true);
+        batch.m_dest.clear();
+        batch.m_source.clear();
+        batch.m_colors.clear();
+    }
+    m_num_quad_batches = 0;
+}   // drawQuadBatches
 
 
 void ScalableFont::lazyLoadTexture(int texID)
@@ -14,6 +14,7 @@
 #include "IReadFile.h"
 #include "irrArray.h"
 #include <map>
+#include <vector>
 
 #include "utils/leak_check.hpp"
 
@@ -24,6 +25,7 @@ namespace video
 {
     class IVideoDriver;
     class IImage;
+    class ITexture;
 }
 
 namespace gui
@@ -170,6 +172,80 @@ private:
     s32             GlobalKerningWidth, GlobalKerningHeight;
 
     core::stringw Invisible;
+
+    /** One glyph of a laid out string. */
+    struct GlyphQuad
+    {
+        video::ITexture *m_texture;
+        /** Position of the glyph. X is relative to the start of its line,
+         *  Y to the top of the text. */
+        core::rect<s32>  m_dest;
+        core::rect<s32>  m_source;
+        /** Texture and source rectangle index in the sprite bank, used to
+         *  find the glyph in the outline textures. */
+        s32              m_tex_id;
+        u32              m_rect_number;
+        /** Size of one texel on the screen. */
+        float            m_texel_scale;
+        bool             m_fallback;
+        /** The first line can be shifted for right to left languages, the
+         *  other lines start at the left border. */
+        bool             m_first_line;
+    };
+
+    /** A laid out string. Since the GUI draws the same strings every frame,
+     *  the layout is kept and only moved to the position of the text. */
+    struct GlyphRun
+    {
+        std::vector<GlyphQuad>  m_quads;
+        core::dimension2d<s32>  m_dimension;
+        /** The font settings used for the layout. */
+        float                   m_scale;
+        float                   m_fallback_scale;
+        s32                     m_kerning_width;
+        s32                     m_fallback_kerning_width;
+        s32                     m_max_height;
+        bool                    m_mono_space_digits;
+    };
+
+    /** Maximum number of strings for which the layout is kept. */
+    static const unsigned int MAX_GLYPH_RUNS = 256;
+    std::map<core::stringw, GlyphRun> m_glyph_runs;
+
+    /** Black outlines of all glyphs of one font texture, each glyph in its
+     *  own cell so that it does not pick up pixels of its neighbours. */
+    struct OutlinePage
+    {
+        video::ITexture                *m_texture;
+        /** The cell of each source rectangle of the font texture. */
+        std::map<u32, core::rect<s32> > m_rects;
+    };
+
+    /** The outline pages, indexed by texture id and outline radius in
+     *  texels. Shared with hollow copies. */
+    std::map<std::pair<s32, s32>, OutlinePage> *m_outline_pages;
+
+    /** The quads of one texture to draw with a single call. */
+    struct QuadBatch
+    {
+        video::ITexture                *m_texture;
+        std::vector<core::rect<s32> >   m_dest;
+        std::vector<core::rect<s32> >   m_source;
+        std::vector<video::SColor>      m_colors;
+    };
+    /** Batches are kept between draws to reuse their memory, only the
+     *  first m_num_quad_batches are in use. */
+    std::vector<QuadBatch> m_quad_batches;
+    unsigned int           m_num_quad_batches;
+
+    const GlyphRun &getGlyphRun(const core::stringw &text);
+    void layoutGlyphRun(const core::stringw &text, GlyphRun *run);
+    const OutlinePage *getOutlinePage(s32 tex_id, s32 radius);
+    void addOutlineQuad(const GlyphQuad &quad, const core::rect<s32> &dest,
+                        const video::SColor &color);
+    void addQuad(video::ITexture *texture, const core::rect<s32> &dest,
+                 const core::rect<s32> &source, const video::SColor *colors);
+    void drawQuadBatches(const core::rect<s32> *clip);
 };
 
 } // end namespace gui
@@ -0,0 +1,352 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "io/content_cache.hpp"
+
+#include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
+#include "io/xml_node.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef WIN32
+#  include <process.h>
+#  include <windows.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
+
+ContentCache *ContentCache::m_content_cache = NULL;
+
+/** Magic number at the start of the cache file ("STKC"). */
+static const uint32_t CONTENT_CACHE_MAGIC   = 0x434B5453;
+/** Increase whenever the format of the cache file or of the binary XML
+ *  trees changes. */
+static const uint32_t CONTENT_CACHE_VERSION = 2;
+
+// ----------------------------------------------------------------------------
+/** Creates the content cache and loads the cache file. */
+void ContentCache::create()
+{
+    assert(!m_content_cache);
+    m_content_cache = new ContentCache();
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Saves the cache (if it was changed) and destroys it. */
+void ContentCache::destroy()
+{
+    if(!m_content_cache) return;
+    m_content_cache->save();
+    delete m_content_cache;
+    m_content_cache = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+ContentCache::ContentCache()
+{
+    m_filename        = file_manager->getUserConfigFile("content_cache.bin");
+    m_changed         = false;
+    m_num_hits        = 0;
+    m_num_misses      = 0;
+    m_num_invalidated = 0;
+    load();
+}   // ContentCache
+
+// ----------------------------------------------------------------------------
+ContentCache::~ContentCache()
+{
+}   // ~ContentCache
+
+// ----------------------------------------------------------------------------
+/** Reads the cache file. If it does not exist or is damaged, the cache
+ *  starts empty. */
+void ContentCache::load()
+{
+    MappedFile file;
+    if(!file.open(m_filename))
+        return;
+    const unsigned char *p   = file.getData();
+    const unsigned char *end = p + file.getSize();
+
+    // Header: magic, version, size of wchar_t and number of entries.
+    uint32_t header[4];
+    if(end-p < (int)sizeof(header))
+        return;
+    memcpy(header, p, sizeof(header));
+    p += sizeof(header);
+    if(header[0]!=CONTENT_CACHE_MAGIC || header[1]!=CONTENT_CACHE_VERSION ||
+       header[2]!=sizeof(wchar_t))
+    {
+        Log::info("ContentCache", "Cache '%s' is out of date.",
+                  m_filename.c_str());
+        return;
+    }
+
+    for(unsigned int i=0; i<header[3]; i++)
+    {
+        // Each entry: name size, tree size, mtime, file size, name, tree.
+        uint32_t sizes[2];
+        Entry entry;
+        const size_t fixed = sizeof(sizes) + sizeof(entry.m_mtime)
+                           + sizeof(entry.m_size);
+        if((size_t)(end-p) < fixed)
+            break;
+        memcpy(sizes,          p, sizeof(sizes));
+        p += sizeof(sizes);
+        memcpy(&entry.m_mtime, p, sizeof(entry.m_mtime));
+        p += sizeof(entry.m_mtime);
+        memcpy(&entry.m_size,  p, sizeof(entry.m_size));
+        p += sizeof(entry.m_size);
+        if((size_t)(end-p) < (size_t)sizes[0] + sizes[1])
+            break;
+        std::string name((const char*)p, sizes[0]);
+        p += sizes[0];
+        entry.m_tree.assign((const char*)p, sizes[1]);
+        p += sizes[1];
+        entry.m_checked = false;
+        m_entries[name] = entry;
+    }
+    if(m_entries.size()!=header[3])
+    {
+        Log::warn("ContentCache", "Cache '%s' is damaged, ignored.",
+                  m_filename.c_str());
+        m_entries.clear();
+    }
+}   // load
+
+// ----------------------------------------------------------------------------
+/** Writes the cache file if any entry was changed. The data is written to a
+ *  temporary file first, so that several instances of STK started at the
+ *  same time never read a partial file.
+ */
+void ContentCache::save()
+{
+    if(!m_changed)
+        return;
+
+    std::string tmp = m_filename + "."
+                    + StringUtils::toString(getpid()) + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if(!f)
+    {
+        Log::warn("ContentCache", "Can't write cache '%s'.", tmp.c_str());
+        return;
+    }
+
+    // Don't keep removed content in the cache
+    std::vector<std::map<std::string, Entry>::const_iterator> entries;
+    std::map<std::string, Entry>::const_iterator i;
+    for(i=m_entries.begin(); i!=m_entries.end(); i++)
+    {
+        int64_t mtime;
+        uint64_t size;
+        if(i->second.m_checked || getFileStamp(i->first, &mtime, &size))
+            entries.push_back(i);
+    }
+
+    uint32_t header[4] = { CONTENT_CACHE_MAGIC, CONTENT_CACHE_VERSION,
+                           sizeof(wchar_t), (uint32_t)entries.size() };
+    bool ok = fwrite(header, sizeof(header), 1, f)==1;
+    for(unsigned int j=0; ok && j<entries.size(); j++)
+    {
+        const std::string &name = entries[j]->first;
+        const Entry &entry      = entries[j]->second;
+        uint32_t sizes[2] = { (uint32_t)name.size(),
+                              (uint32_t)entry.m_tree.size() };
+        ok = fwrite(sizes,           sizeof(sizes),         1, f)==1 &&
+             fwrite(&entry.m_mtime,  sizeof(entry.m_mtime), 1, f)==1 &&
+             fwrite(&entry.m_size,   sizeof(entry.m_size),  1, f)==1 &&
+             fwrite(name.c_str(),    name.size(),           1, f)==1 &&
+             fwrite(entry.m_tree.c_str(), entry.m_tree.size(), 1, f)==1;
+    }
+    ok &= fclose(f)==0;
+    if(ok)
+    {
+        // rename does not overwrite existing files on windows
+        remove(m_filename.c_str());
+        ok = rename(tmp.c_str(), m_filename.c_str())==0;
+    }
+    if(!ok)
+    {
+        Log::warn("ContentCache", "Can't write cache '%s'.",
+                  m_filename.c_str());
+        remove(tmp.c_str());
+        return;
+    }
+    m_changed = false;
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Gets the modification time and size of a file. The time includes the
+ *  sub-second part where the file system stores it, so that a file that is
+ *  changed twice within a second (e.g. by an exporter) is still detected.
+ *  \param mtime On return the modification time in nanoseconds.
+ *  \return False if the file does not exist.
+ */
+bool ContentCache::getFileStamp(const std::string &filename, int64_t *mtime,
+                                uint64_t *size)
+{
+#ifdef WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(!GetFileAttributesExA(filename.c_str(), GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        return false;
+    // The FILETIME counts 100 nanosecond intervals
+    *mtime = (int64_t)(((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32)
+                       | data.ftLastWriteTime.dwLowDateTime) * 100;
+    *size  = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+    struct stat mystat;
+    if(stat(filename.c_str(), &mystat) < 0 || !S_ISREG(mystat.st_mode))
+        return false;
+#  ifdef __APPLE__
+    const long nsec = mystat.st_mtimespec.tv_nsec;
+#  else
+    const long nsec = mystat.st_mtim.tv_nsec;
+#  endif
+    *mtime = (int64_t)mystat.st_mtime*1000000000 + nsec;
+    *size  = (uint64_t)mystat.st_size;
+#endif
+    return true;
+}   // getFileStamp
+
+// ----------------------------------------------------------------------------
+/** Checks the cache entries of the given files, and parses all files that
+ *  are not in the cache or were changed. The files are parsed in parallel.
+ *  Files that don't exist are ignored.
+ *  \param files The full names of the XML files.
+ */
+void ContentCache::prefetch(const std::vector<std::string> &files)
+{
+    unsigned int hits = 0, misses = 0, invalidated = 0;
+    std::vector<ParseJob> jobs;
+    for(unsigned int i=0; i<files.size(); i++)
+    {
+        ParseJob job;
+        if(!getFileStamp(files[i], &job.m_mtime, &job.m_size))
+            continue;
+        std::map<std::string, Entry>::iterator e = m_entries.find(files[i]);
+        if(e!=m_entries.end())
+        {
+            if(e->second.m_mtime==job.m_mtime &&
+               e->second.m_size ==job.m_size    )
+            {
+                e->second.m_checked = true;
+                hits++;
+                continue;
+            }
+            // Remove the old data, in case that the new file can't be parsed
+            m_entries.erase(e);
+            m_changed = true;
+            invalidated++;
+        }
+        else
+            misses++;
+        job.m_filename = files[i];
+        jobs.push_back(job);
+    }   // for i<files.size()
+
+    if(jobs.size()>0)
+    {
+        unsigned int num_threads = WorkerPool::getNumCores();
+        if(num_threads>jobs.size())
+            num_threads = jobs.size();
+        WorkerPool pool(num_threads);
+        pool.run(&ContentCache::parseFile, &jobs, jobs.size());
+    }
+
+    for(unsigned int i=0; i<jobs.size(); i++)
+    {
+        // Files that can't be parsed are not cached, so loading them
+        // later reports the errors.
+        if(jobs[i].m_tree.size()==0) continue;
+        Entry &entry    = m_entries[jobs[i].m_filename];
+        entry.m_mtime   = jobs[i].m_mtime;
+        entry.m_size    = jobs[i].m_size;
+        entry.m_tree.swap(jobs[i].m_tree);
+        entry.m_checked = true;
+        m_changed       = true;
+    }
+
+    m_num_hits        += hits;
+    m_num_misses      += misses;
+    m_num_invalidated += invalidated;
+    Log::info("ContentCache", "%d files: %d hits, %d misses, "
+              "%d invalidated.", hits+misses+invalidated, hits, misses,
+              invalidated);
+}   // prefetch
+
+// ----------------------------------------------------------------------------
+/** Called from the threads started in prefetch() to parse one file.
+ *  \param obj The vector of jobs.
+ *  \param index Index of the job to do.
+ */
+void ContentCache::parseFile(void *obj, unsigned int index)
+{
+    ParseJob &job = (*(std::vector<ParseJob>*)obj)[index];
+    MappedFile file;
+    if(!file.open(job.m_filename) || file.getSize()==0)
+        return;
+    std::string content((const char*)file.getData(), file.getSize());
+    XMLNode *root = file_manager->createXMLTreeFromString(content);
+    if(!root)
+        return;
+    if(root->getName().size()>0)
+        root->writeBinary(&job.m_tree);
+    delete root;
+}   // parseFile
+
+// ----------------------------------------------------------------------------
+/** Returns the XMLNode tree of a file. If the cache contains the file and it
+ *  was not changed since, the tree is restored from the cache. Otherwise
+ *  the file is parsed.
+ *  \param filename Full name of the XML file.
+ *  \return The tree, or NULL if the file can not be read. The caller must
+ *          delete it.
+ */
+XMLNode *ContentCache::createXMLTree(const std::string &filename)
+{
+    std::map<std::string, Entry>::iterator e = m_entries.find(filename);
+    int64_t mtime;
+    uint64_t size;
+    if(e!=m_entries.end() && getFileStamp(filename, &mtime, &size) &&
+       e->second.m_mtime==mtime && e->second.m_size==size)
+    {
+        const unsigned char *p   =
+                               (const unsigned char*)e->second.m_tree.c_str();
+        const unsigned char *end = p + e->second.m_tree.size();
+        XMLNode *root = XMLNode::readBinary(&p, end, filename);
+        if(root && p==end)
+            return root;
+        delete root;
+        Log::warn("ContentCache", "Cached data of '%s' is damaged.",
+                  filename.c_str());
+        m_entries.erase(e);
+        m_changed = true;
+    }
+    return file_manager->createXMLTree(filename);
+}   // createXMLTree
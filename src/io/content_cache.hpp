@@ -0,0 +1,119 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_CONTENT_CACHE_HPP
+#define HEADER_CONTENT_CACHE_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class XMLNode;
+
+/**
+ * \brief Caches the content of the XML files that are read when searching
+ *  for tracks and karts (track.xml, kart.xml, ...).
+ *
+ *  Each file is stored as a binary XMLNode tree (see XMLNode::writeBinary),
+ *  together with the modification time and size of the file. If both are
+ *  unchanged, the tree is restored from the cache instead of parsing the
+ *  file again. The cache is kept in one file in the user config directory.
+ *
+ *  The track and kart managers call prefetch() with all files they are
+ *  going to read, which parses all files not in the cache in parallel.
+ *  Track and KartProperties then get their trees from createXMLTree().
+ * \ingroup io
+ */
+class ContentCache : public NoCopy
+{
+private:
+    static ContentCache *m_content_cache;
+
+    /** The cached data of one file. */
+    struct Entry
+    {
+        /** Modification time (in nanoseconds, as precise as the file
+         *  system allows) and size of the file when it was cached. */
+        int64_t     m_mtime;
+        uint64_t    m_size;
+        /** The binary XMLNode tree. */
+        std::string m_tree;
+        /** True if the file was checked in this run. Entries for files
+         *  that were not checked and don't exist anymore are not saved. */
+        bool        m_checked;
+    };   // Entry
+
+    /** A file that needs to be parsed by prefetch(). */
+    struct ParseJob
+    {
+        std::string m_filename;
+        int64_t     m_mtime;
+        uint64_t    m_size;
+        /** The binary tree, empty if the file could not be parsed. */
+        std::string m_tree;
+    };   // ParseJob
+
+    /** All cached files, indexed by file name. */
+    std::map<std::string, Entry> m_entries;
+
+    /** Name of the cache file. */
+    std::string  m_filename;
+
+    /** True if the entries were changed since the cache was loaded. */
+    bool         m_changed;
+
+    /** Number of files restored from the cache, parsed because they were
+     *  not in the cache, and parsed because the file was changed. */
+    unsigned int m_num_hits;
+    unsigned int m_num_misses;
+    unsigned int m_num_invalidated;
+
+         ContentCache();
+        ~ContentCache();
+    void load();
+    static bool getFileStamp(const std::string &filename, int64_t *mtime,
+                             uint64_t *size);
+    static void parseFile(void *obj, unsigned int index);
+
+public:
+    static void create();
+    static void destroy();
+    void        prefetch(const std::vector<std::string> &files);
+    XMLNode    *createXMLTree(const std::string &filename);
+    void        save();
+    // ------------------------------------------------------------------------
+    /** Returns the content cache. */
+    static ContentCache *get() { return m_content_cache; }
+    // ------------------------------------------------------------------------
+    /** Number of files that were restored from the cache by prefetch(). */
+    unsigned int getNumHits() const { return m_num_hits; }
+    // ------------------------------------------------------------------------
+    /** Number of files that prefetch() parsed because they were not in the
+     *  cache. */
+    unsigned int getNumMisses() const { return m_num_misses; }
+    // ------------------------------------------------------------------------
+    /** Number of files that prefetch() parsed because they changed since
+     *  they were cached. */
+    unsigned int getNumInvalidated() const { return m_num_invalidated; }
+};   // ContentCache
+
+#endif
@@ -23,7 +23,9 @@
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "io/xml_stream_reader.hpp"
 #include "karts/kart_properties_manager.hpp"
+#include "modes/profile_batch.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
 #include "utils/log.hpp"
@@ -188,7 +190,9 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
 
 #ifdef WIN32
-    redirectOutput();
+    // The output of batch races is redirected by the batch runner
+    if(!ProfileBatch::isChild())
+        redirectOutput();
 
 #endif
 
@@ -385,7 +389,9 @@ XMLNode *FileManager::createXMLTree(const std::string &filename)
 }   // createXMLTree
 
 //-----------------------------------------------------------------------------
-/** Reads in XML from a string and converts it into a XMLNode tree.
+/** Reads in XML from a string and converts it into a XMLNode tree. This
+ *  function does not use the search paths, so it can be called from other
+ *  threads.
  *  \param content the string containing the XML content.
  */
 XMLNode *FileManager::createXMLTreeFromString(const std::string & content)
@@ -394,8 +400,9 @@ XMLNode *FileManager::createXMLTreeFromString(const std::string & content)
     {
         char *b = new char[content.size()];
         memcpy(b, content.c_str(), content.size());
-        io::IReadFile * ireadfile = m_file_system->createMemoryReadFile(b, strlen(b), "tempfile", true);
+        io::IReadFile * ireadfile = m_file_system->createMemoryReadFile(b, content.size(), "tempfile", true);
         io::IXMLReader * reader = m_file_system->createXMLReader(ireadfile);
+        ireadfile->drop();
         XMLNode* node = new XMLNode(reader);
         reader->drop();
         return node;
@@ -410,6 +417,27 @@ XMLNode *FileManager::createXMLTreeFromString(const std::string & content)
     }
 }   // createXMLTreeFromString
 
+//-----------------------------------------------------------------------------
+/** Creates a reader that reads a XML file one element at a time, see
+ *  XMLStreamReader.
+ *  \param filename Name of the XML file to read.
+ *  \return The reader, or NULL if the file can not be opened.
+ */
+XMLStreamReader *FileManager::createXMLStreamReader(const std::string &filename)
+{
+    io::IXMLReader *xml = createXMLReader(filename);
+    if(!xml)
+    {
+        if (UserConfigParams::logMisc())
+        {
+            Log::error("FileManager", "createXMLStreamReader: Cannot find "
+                       "file %s\n", filename.c_str());
+        }
+        return NULL;
+    }
+    return new XMLStreamReader(xml, filename);
+}   // createXMLStreamReader
+
 //-----------------------------------------------------------------------------
 /** In order to add and later remove paths we have to specify the absolute
  *  filename (and replace '\' with '/' on windows).
@@ -37,6 +37,8 @@ using namespace irr;
 #include "io/xml_node.hpp"
 #include "utils/no_copy.hpp"
 
+class XMLStreamReader;
+
 /**
   * \brief class handling files and paths
   * \ingroup io
@@ -85,7 +87,6 @@ private:
     bool              checkAndCreateDirectory(const std::string &path);
     io::path          createAbsoluteFilename(const std::string &f);
     void              checkAndCreateConfigDir();
-    bool              isDirectory(const std::string &path) const;
     void              checkAndCreateAddonsDir();
     void              checkAndCreateScreenshotDir();
 #if !defined(WIN32) && !defined(__CYGWIN__) && !defined(__APPLE__)
@@ -104,9 +105,11 @@ public:
     io::IXMLReader   *createXMLReader(const std::string &filename);
     XMLNode          *createXMLTree(const std::string &filename);
     XMLNode          *createXMLTreeFromString(const std::string & content);
+    XMLStreamReader  *createXMLStreamReader(const std::string &filename);
 
     std::string       getScreenshotDir() const;
     bool              checkAndCreateDirectoryP(const std::string &path);
+    bool              isDirectory(const std::string &path) const;
     const std::string &getAddonsDir() const;
     std::string        getAddonsFile(const std::string &name);
     void checkAndCreateDirForAddons(const std::string &dir);
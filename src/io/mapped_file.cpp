@@ -0,0 +1,150 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "io/mapped_file.hpp"
+
+#include "utils/log.hpp"
+
+#include <stdio.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    m_data      = NULL;
+    m_size      = 0;
+    m_is_mapped = false;
+#ifdef WIN32
+    m_file_handle    = NULL;
+    m_mapping_handle = NULL;
+#endif
+}   // MappedFile
+
+// ----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{
+    close();
+}   // ~MappedFile
+
+// ----------------------------------------------------------------------------
+/** Opens a file and makes its content available with getData(). A file
+ *  that was opened before is closed first.
+ *  \param filename Name of the file to open.
+ *  \return True if the file could be opened (an empty file can not be
+ *          opened).
+ */
+bool MappedFile::open(const std::string &filename)
+{
+    close();
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ,
+                              FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file!=INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        if(GetFileSizeEx(file, &size) && size.QuadPart>0)
+        {
+            HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY,
+                                                0, 0, NULL);
+            void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ,
+                                                 0, 0, 0)
+                                 : NULL;
+            if(data)
+            {
+                m_file_handle    = file;
+                m_mapping_handle = mapping;
+                m_data           = (const unsigned char*)data;
+                m_size           = (size_t)size.QuadPart;
+                m_is_mapped      = true;
+                return true;
+            }
+            if(mapping) CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd>=0)
+    {
+        struct stat st;
+        if(fstat(fd, &st)==0 && st.st_size>0)
+        {
+            void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data!=MAP_FAILED)
+            {
+                // The mapping stays valid after closing the descriptor.
+                ::close(fd);
+                m_data      = (const unsigned char*)data;
+                m_size      = st.st_size;
+                m_is_mapped = true;
+                return true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    // Mapping failed (or is not supported), read the file instead.
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file)
+        return false;
+    unsigned char block[4096];
+    size_t n;
+    while((n=fread(block, 1, sizeof(block), file))>0)
+        m_buffer.insert(m_buffer.end(), block, block+n);
+    fclose(file);
+    if(m_buffer.empty())
+        return false;
+    Log::debug("MappedFile", "Could not map '%s', reading it instead.",
+               filename.c_str());
+    m_data = &(m_buffer[0]);
+    m_size = m_buffer.size();
+    return true;
+}   // open
+
+// ----------------------------------------------------------------------------
+/** Releases the content of the file. */
+void MappedFile::close()
+{
+    if(m_is_mapped)
+    {
+#ifdef WIN32
+        UnmapViewOfFile((void*)m_data);
+        CloseHandle((HANDLE)m_mapping_handle);
+        CloseHandle((HANDLE)m_file_handle);
+        m_file_handle    = NULL;
+        m_mapping_handle = NULL;
+#else
+        munmap((void*)m_data, m_size);
+#endif
+    }
+    m_buffer.clear();
+    m_data      = NULL;
+    m_size      = 0;
+    m_is_mapped = false;
+}   // close
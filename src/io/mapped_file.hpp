@@ -0,0 +1,71 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_MAPPED_FILE_HPP
+#define HEADER_MAPPED_FILE_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * \brief Read only access to the content of a file through a memory
+ *  mapping. If the file can not be mapped, its content is read into memory
+ *  instead, so callers don't have to care which method was used.
+ * \ingroup io
+ */
+class MappedFile : public NoCopy
+{
+private:
+    /** Start of the file content, or NULL if no file is open. */
+    const unsigned char *m_data;
+
+    /** Size of the file in bytes. */
+    size_t               m_size;
+
+    /** True if m_data is a memory mapping (and not m_buffer). */
+    bool                 m_is_mapped;
+
+    /** Content of the file if it could not be mapped. */
+    std::vector<unsigned char> m_buffer;
+
+#ifdef WIN32
+    /** Windows handles of the file and the mapping. */
+    void                *m_file_handle;
+    void                *m_mapping_handle;
+#endif
+
+public:
+                MappedFile();
+               ~MappedFile();
+    bool        open(const std::string &filename);
+    void        close();
+    // ------------------------------------------------------------------------
+    /** Returns the content of the file, or NULL if no file is open. */
+    const unsigned char *getData() const { return m_data; }
+    // ------------------------------------------------------------------------
+    /** Returns the size of the file. */
+    size_t      getSize() const { return m_size; }
+    // ------------------------------------------------------------------------
+    /** Returns true if a file is open. */
+    bool        isOpen() const { return m_data!=NULL; }
+};   // MappedFile
+
+#endif
@@ -22,9 +22,30 @@
 #include "utils/interpolation_array.hpp"
 #include "utils/vec3.hpp"
 
+#include <pthread.h>
+#include <set>
 #include <stdexcept>
+#include <string.h>
 
-XMLNode::XMLNode(io::IXMLReader *xml)
+/** All element and attribute names, each name is only stored once. */
+static std::set<std::string> g_interned_names;
+/** Trees are created in several threads at the same time (see
+ *  ContentCache::prefetch), so access to the names must be locked. */
+static pthread_mutex_t       g_interned_names_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Name of nodes that were not read from a file yet. */
+static const std::string     g_no_name;
+
+/** Nodes with more sub nodes than this get an index to find a sub node by
+ *  name, for fewer nodes a linear search is faster. */
+static const unsigned int    MIN_CHILDREN_FOR_INDEX = 8;
+
+// ----------------------------------------------------------------------------
+XMLNode::XMLNode() : m_name(&g_no_name)
+{
+}   // XMLNode
+
+// ----------------------------------------------------------------------------
+XMLNode::XMLNode(io::IXMLReader *xml) : m_name(&g_no_name)
 {
     m_file_name = "[unknown]";
 
@@ -36,7 +57,7 @@ XMLNode::XMLNode(io::IXMLReader *xml)
 /** Reads a XML file and convert it into a XMLNode tree.
  *  \param filename Name of the XML file to read.
  */
-XMLNode::XMLNode(const std::string &filename)
+XMLNode::XMLNode(const std::string &filename) : m_name(&g_no_name)
 {
     m_file_name = filename;
 
@@ -85,19 +106,121 @@ XMLNode::~XMLNode()
     m_nodes.clear();
 }   // ~XMLNode
 
+// ----------------------------------------------------------------------------
+/** Returns the one copy of a name that is shared by all nodes, so that
+ *  each element and attribute name is only stored once.
+ *  \param name The name to intern.
+ */
+const std::string *XMLNode::intern(const std::string &name)
+{
+    pthread_mutex_lock(&g_interned_names_mutex);
+    const std::string *result = &*g_interned_names.insert(name).first;
+    pthread_mutex_unlock(&g_interned_names_mutex);
+    return result;
+}   // intern
+
+// ----------------------------------------------------------------------------
+/** Sets the value of an attribute, replacing an existing attribute with
+ *  the same name.
+ *  \param name Name of the attribute.
+ *  \param value Value of the attribute.
+ */
+void XMLNode::setAttribute(const std::string &name,
+                           const core::stringw &value)
+{
+    for(unsigned int i=0; i<m_attributes.size(); i++)
+    {
+        if(*m_attributes[i].m_name==name)
+        {
+            m_attributes[i].m_value  = value;
+            m_attributes[i].m_parsed = false;
+            return;
+        }
+    }
+    m_attributes.push_back(Attribute());
+    Attribute &a   = m_attributes.back();
+    a.m_name       = intern(name);
+    a.m_value      = value;
+    a.m_parsed     = false;
+    a.m_is_numeric = false;
+}   // setAttribute
+
+// ----------------------------------------------------------------------------
+/** Returns the attribute with the given name, or NULL if it is not defined.
+ *  \param name Name of the attribute.
+ */
+const XMLNode::Attribute *XMLNode::findAttribute(const std::string &name) const
+{
+    for(unsigned int i=0; i<m_attributes.size(); i++)
+    {
+        if(*m_attributes[i].m_name==name)
+            return &m_attributes[i];
+    }
+    return NULL;
+}   // findAttribute
+
+// ----------------------------------------------------------------------------
+/** Returns the numbers in an attribute that contains a space separated list
+ *  of numbers, or NULL if the attribute is not defined or contains anything
+ *  else. The numbers are parsed on the first call and then kept, so getting
+ *  the same attribute again (as done for coordinates in track files) does
+ *  not parse the string again.
+ *  \param name Name of the attribute.
+ */
+const std::vector<float> *XMLNode::getNumbers(const std::string &name) const
+{
+    const Attribute *a = findAttribute(name);
+    if(!a) return NULL;
+    if(!a->m_parsed)
+    {
+        a->m_parsed     = true;
+        a->m_is_numeric = true;
+        a->m_numbers.clear();
+        std::vector<std::string> v =
+            StringUtils::split(std::string(core::stringc(a->m_value).c_str()),
+                               ' ');
+        for(unsigned int i=0; i<v.size(); i++)
+        {
+            float f;
+            if(!StringUtils::parseString<float>(v[i], &f))
+            {
+                a->m_is_numeric = false;
+                a->m_numbers.clear();
+                break;
+            }
+            a->m_numbers.push_back(f);
+        }
+    }
+    return a->m_is_numeric ? &a->m_numbers : NULL;
+}   // getNumbers
+
+// ----------------------------------------------------------------------------
+/** Creates the index to find the first sub node with a given name, if this
+ *  node has enough sub nodes to make this worthwhile.
+ */
+void XMLNode::createChildIndex()
+{
+    m_child_index.clear();
+    if(m_nodes.size()<MIN_CHILDREN_FOR_INDEX)
+        return;
+    // Insert from the back, so the first sub node with a name is kept
+    for(unsigned int i=m_nodes.size(); i>0; i--)
+        m_child_index[m_nodes[i-1]->m_name] = i-1;
+}   // createChildIndex
+
 // ----------------------------------------------------------------------------
 /** Stores all attributes, and reads in all children.
  *  \param xml The XML reader.
  */
 void XMLNode::readXML(io::IXMLReader *xml)
 {
-    m_name = std::string(core::stringc(xml->getNodeName()).c_str());
+    m_name = intern(core::stringc(xml->getNodeName()).c_str());
 
+    m_attributes.reserve(xml->getAttributeCount());
     for(unsigned int i=0; i<xml->getAttributeCount(); i++)
     {
-        std::string   name  = core::stringc(xml->getAttributeName(i)).c_str();
-        core::stringw value = xml->getAttributeValue(i);
-        m_attributes[name] = value;
+        setAttribute(core::stringc(xml->getAttributeName(i)).c_str(),
+                     xml->getAttributeValue(i));
     }   // for i
 
     // If no children, we are done
@@ -118,6 +241,7 @@ void XMLNode::readXML(io::IXMLReader *xml)
             }
         case io::EXN_ELEMENT_END:
             // End of this element found.
+            createChildIndex();
             return;
             break;
         case io::EXN_UNKNOWN:            break;
@@ -143,6 +267,12 @@ const XMLNode *XMLNode::getNode(unsigned int i) const
  */
 const XMLNode *XMLNode::getNode(const std::string &s) const
 {
+    if(!m_child_index.empty())
+    {
+        std::map<const std::string*, unsigned int, NameLess>::const_iterator
+            i = m_child_index.find(&s);
+        return i==m_child_index.end() ? NULL : m_nodes[i->second];
+    }
     for(unsigned int i=0; i<m_nodes.size(); i++)
     {
         if(m_nodes[i]->getName()==s) return m_nodes[i];
@@ -174,26 +304,30 @@ const void XMLNode::getNodes(const std::string &s, std::vector<XMLNode*>& out) c
 */
 int XMLNode::get(const std::string &attribute, std::string *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value=core::stringc(o->second).c_str();
+    const Attribute *a = findAttribute(attribute);
+    if(!a) return 0;
+    *value=core::stringc(a->m_value).c_str();
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::stringw *value) const
 {
-    if(m_attributes.size()==0) return 0;
-    std::map<std::string, core::stringw>::const_iterator o;
-    o = m_attributes.find(attribute);
-    if(o==m_attributes.end()) return 0;
-    *value = o->second;
+    const Attribute *a = findAttribute(attribute);
+    if(!a) return 0;
+    *value = a->m_value;
     return 1;
 }   // get
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, core::vector2df *value) const
 {
+    const std::vector<float> *numbers = getNumbers(attribute);
+    if(numbers && numbers->size()==2)
+    {
+        value->X = (*numbers)[0];
+        value->Y = (*numbers)[1];
+        return 1;
+    }
+
     std::string s = "";
     if(!get(attribute, &s)) return 0;
 
@@ -217,6 +351,15 @@ int XMLNode::get(const std::string &attribute, core::vector3df *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, Vec3 *value) const
 {
+    const std::vector<float> *numbers = getNumbers(attribute);
+    if(numbers && numbers->size()==3)
+    {
+        value->setX((*numbers)[0]);
+        value->setY((*numbers)[1]);
+        value->setZ((*numbers)[2]);
+        return 1;
+    }
+
     std::string s = "";
     if(!get(attribute, &s)) return 0;
 
@@ -306,7 +449,7 @@ int XMLNode::get(const std::string &attribute, int32_t *value) const
     if (!StringUtils::parseString<int>(s, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -322,7 +465,7 @@ int XMLNode::get(const std::string &attribute, int64_t *value) const
     if (!StringUtils::parseString<int64_t>(s, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -339,7 +482,7 @@ int XMLNode::get(const std::string &attribute, uint16_t *value) const
     if (!StringUtils::parseString<uint16_t>(s, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -355,7 +498,7 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
     if (!StringUtils::parseString<unsigned int>(s, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected uint but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -365,13 +508,20 @@ int XMLNode::get(const std::string &attribute, uint32_t *value) const
 // ----------------------------------------------------------------------------
 int XMLNode::get(const std::string &attribute, float *value) const
 {
+    const std::vector<float> *numbers = getNumbers(attribute);
+    if(numbers && numbers->size()==1)
+    {
+        *value = (*numbers)[0];
+        return 1;
+    }
+
     std::string s;
     if(!get(attribute, &s)) return 0;
 
     if (!StringUtils::parseString<float>(s, value))
     {
         fprintf(stderr, "[XMLNode] WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                s.c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                s.c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
         return 0;
     }
 
@@ -417,6 +567,13 @@ int XMLNode::get(const std::string &attribute,
 int XMLNode::get(const std::string &attribute,
                  std::vector<float> *value) const
 {
+    const std::vector<float> *numbers = getNumbers(attribute);
+    if(numbers)
+    {
+        *value = *numbers;
+        return value->size();
+    }
+
     std::string s;
     if(!get(attribute, &s)) return 0;
 
@@ -430,7 +587,7 @@ int XMLNode::get(const std::string &attribute,
         if (!StringUtils::parseString<float>(v[i], &curr))
         {
             fprintf(stderr, "[XMLNode] WARNING: Expected float but found '%s' for attribute '%s' of node '%s' in file %s\n",
-                    v[i].c_str(), attribute.c_str(), m_name.c_str(), m_file_name.c_str());
+                    v[i].c_str(), attribute.c_str(), m_name->c_str(), m_file_name.c_str());
             return 0;
         }
 
@@ -461,7 +618,7 @@ int XMLNode::get(const std::string &attribute, std::vector<int> *value) const
         if (!StringUtils::parseString<int>(v[i], &val))
         {
             fprintf(stderr, "[XMLNode] WARNING: Expected int but found '%s' for attribute '%s' of node '%s'\n",
-                    v[i].c_str(), attribute.c_str(), m_name.c_str());
+                    v[i].c_str(), attribute.c_str(), m_name->c_str());
             return 0;
         }
 
@@ -619,9 +776,152 @@ int XMLNode::getHPR(Vec3 *value) const
 
 bool XMLNode::hasChildNamed(const char* name) const
 {
+    if(!m_child_index.empty())
+    {
+        const std::string s(name);
+        return m_child_index.find(&s)!=m_child_index.end();
+    }
     for (unsigned int i = 0; i < m_nodes.size(); i++)
     {
         if (m_nodes[i]->getName() == name) return true;
     }
     return false;
 }
+
+// ----------------------------------------------------------------------------
+/** Appends a 32 bit value to a binary XML tree. */
+static void writeUInt32(std::string *out, uint32_t value)
+{
+    out->append((const char*)&value, sizeof(value));
+}   // writeUInt32
+
+// ----------------------------------------------------------------------------
+/** Reads a 32 bit value written by writeUInt32.
+ *  \return False if the data is truncated.
+ */
+static bool readUInt32(const unsigned char **data, const unsigned char *end,
+                       uint32_t *value)
+{
+    if((size_t)(end-*data) < sizeof(*value))
+        return false;
+    memcpy(value, *data, sizeof(*value));
+    *data += sizeof(*value);
+    return true;
+}   // readUInt32
+
+// ----------------------------------------------------------------------------
+/** Reads a string with its length written before it.
+ *  \return False if the data is truncated.
+ */
+static bool readString(const unsigned char **data, const unsigned char *end,
+                       std::string *s)
+{
+    uint32_t size;
+    if(!readUInt32(data, end, &size) || (size_t)(end-*data) < size)
+        return false;
+    s->assign((const char*)*data, size);
+    *data += size;
+    return true;
+}   // readString
+
+// ----------------------------------------------------------------------------
+/** Appends this node and all its children in a compact binary form to a
+ *  string. This is used to cache the content of XML files, reading the
+ *  binary form with readBinary() is a lot faster than parsing the XML file.
+ *  The data can only be read on the same platform.
+ *  \param out The string to append to.
+ */
+void XMLNode::writeBinary(std::string *out) const
+{
+    writeUInt32(out, m_name->size());
+    out->append(*m_name);
+    writeUInt32(out, m_attributes.size());
+    for(unsigned int i=0; i<m_attributes.size(); i++)
+    {
+        writeUInt32(out, m_attributes[i].m_name->size());
+        out->append(*m_attributes[i].m_name);
+        const core::stringw &value = m_attributes[i].m_value;
+        writeUInt32(out, value.size());
+        for(unsigned int j=0; j<value.size(); j++)
+            writeUInt32(out, (uint32_t)value[j]);
+    }
+    writeUInt32(out, m_nodes.size());
+    for(unsigned int j=0; j<m_nodes.size(); j++)
+        m_nodes[j]->writeBinary(out);
+}   // writeBinary
+
+// ----------------------------------------------------------------------------
+/** Creates a XMLNode tree from the data written by writeBinary().
+ *  \param data Pointer to the data, on return it points after the tree.
+ *  \param end End of the data.
+ *  \param filename Name of the XML file the data was created from, used in
+ *         error messages.
+ *  \return The tree, or NULL if the data is damaged.
+ */
+XMLNode *XMLNode::readBinary(const unsigned char **data,
+                             const unsigned char *end,
+                             const std::string &filename)
+{
+    return readBinaryNode(data, end, filename, 0);
+}   // readBinary
+
+// ----------------------------------------------------------------------------
+/** Reads one node and its children, see readBinary().
+ *  \param depth Depth of this node, used to stop on damaged data.
+ */
+XMLNode *XMLNode::readBinaryNode(const unsigned char **data,
+                                 const unsigned char *end,
+                                 const std::string &filename,
+                                 unsigned int depth)
+{
+    if(depth>100)
+        return NULL;
+    XMLNode *node = new XMLNode();
+    node->m_file_name = filename;
+    uint32_t count;
+    std::string name;
+    if(!readString(data, end, &name) ||
+       !readUInt32(data, end, &count))
+    {
+        delete node;
+        return NULL;
+    }
+    node->m_name = intern(name);
+    core::stringw value;
+    for(unsigned int i=0; i<count; i++)
+    {
+        uint32_t size;
+        if(!readString(data, end, &name) || !readUInt32(data, end, &size) ||
+           size > (size_t)(end-*data)/sizeof(uint32_t) )
+        {
+            delete node;
+            return NULL;
+        }
+        value = L"";
+        value.reserve(size);
+        for(unsigned int j=0; j<size; j++)
+        {
+            uint32_t c;
+            readUInt32(data, end, &c);
+            value.append((wchar_t)c);
+        }
+        node->setAttribute(name, value);
+    }
+    if(!readUInt32(data, end, &count))
+    {
+        delete node;
+        return NULL;
+    }
+    for(unsigned int i=0; i<count; i++)
+    {
+        XMLNode *child = readBinaryNode(data, end, filename, depth+1);
+        if(!child)
+        {
+            delete node;
+            return NULL;
+        }
+        node->m_nodes.push_back(child);
+    }
+    node->createChildIndex();
+    return node;
+}   // readBinaryNode
@@ -46,17 +46,59 @@ class Vec3;
 class XMLNode : public NoCopy
 {
 private:
-    /** Name of this element. */
-    std::string                          m_name;
-    /** List of all attributes. */
-    std::map<std::string, core::stringw> m_attributes;
+    friend class XMLStreamReader;
+
+    /** Orders interned names by their content, which allows to search a
+     *  map of interned names with a pointer to any string. */
+    struct NameLess
+    {
+        bool operator()(const std::string *a, const std::string *b) const
+        {
+            return *a < *b;
+        }
+    };   // NameLess
+
+    /** One attribute. The numbers in the value are only parsed the first
+     *  time a numerical value is requested, and then kept. */
+    struct Attribute
+    {
+        /** The interned name of the attribute. */
+        const std::string          *m_name;
+        core::stringw               m_value;
+        /** True once m_numbers and m_is_numeric are set. */
+        mutable bool                m_parsed;
+        /** True if the value is a space separated list of numbers. */
+        mutable bool                m_is_numeric;
+        mutable std::vector<float>  m_numbers;
+    };   // Attribute
+
+    /** Interned name of this element. */
+    const std::string                   *m_name;
+    /** List of all attributes, usually only a handful, so a linear search
+     *  is faster than a map. */
+    std::vector<Attribute>               m_attributes;
     /** List of all sub nodes. */
     std::vector<XMLNode *>               m_nodes;
+    /** Index of the first sub node with each name, only created for nodes
+     *  with many sub nodes. */
+    std::map<const std::string*, unsigned int, NameLess> m_child_index;
 
     void readXML(io::IXMLReader *xml);
 
     std::string                          m_file_name;
 
+         XMLNode();
+    static XMLNode *readBinaryNode(const unsigned char **data,
+                                   const unsigned char *end,
+                                   const std::string &filename,
+                                   unsigned int depth);
+    static const std::string *intern(const std::string &name);
+    void             setAttribute(const std::string &name,
+                                  const core::stringw &value);
+    const Attribute *findAttribute(const std::string &name) const;
+    const std::vector<float> *getNumbers(const std::string &name) const;
+    void             createChildIndex();
+
 public:
          LEAK_CHECK();
          XMLNode(io::IXMLReader *xml);
@@ -66,7 +108,7 @@ public:
 
         ~XMLNode();
 
-    const std::string &getName() const {return m_name; }
+    const std::string &getName() const {return *m_name; }
     const XMLNode     *getNode(const std::string &name) const;
     const void         getNodes(const std::string &s, std::vector<XMLNode*>& out) const;
     const XMLNode     *getNode(unsigned int i) const;
@@ -96,6 +138,11 @@ public:
 
     bool hasChildNamed(const char* name) const;
 
+    void writeBinary(std::string *out) const;
+    static XMLNode *readBinary(const unsigned char **data,
+                               const unsigned char *end,
+                               const std::string &filename);
+
     /** Handy functions to test the bit pattern returned by get(vector3df*).*/
     static bool hasX(int b) { return (b&1)==1; }
     static bool hasY(int b) { return (b&2)==2; }
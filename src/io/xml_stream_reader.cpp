@@ -0,0 +1,78 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "io/xml_stream_reader.hpp"
+
+/** Creates a reader for a XML file.
+ *  \param xml The irrlicht XML reader of the file, it is dropped when this
+ *         object is deleted.
+ *  \param filename Name of the file, used in error messages.
+ */
+XMLStreamReader::XMLStreamReader(io::IXMLReader *xml,
+                                 const std::string &filename)
+{
+    m_xml                    = xml;
+    m_element.m_file_name    = filename;
+    m_depth                  = 0;
+    m_next_depth             = 0;
+}   // XMLStreamReader
+
+// ----------------------------------------------------------------------------
+XMLStreamReader::~XMLStreamReader()
+{
+    m_xml->drop();
+}   // ~XMLStreamReader
+
+// ----------------------------------------------------------------------------
+/** Reads the next element (the start tag of it) in the file, which can be a
+ *  sub element of the current element, the next element on the same level,
+ *  or an element on a higher level (see getDepth()).
+ *  \return False if the end of the file is reached.
+ */
+bool XMLStreamReader::next()
+{
+    while(m_xml->read())
+    {
+        switch(m_xml->getNodeType())
+        {
+        case io::EXN_ELEMENT:
+            {
+                m_depth      = m_next_depth;
+                m_next_depth = m_xml->isEmptyElement() ? m_depth : m_depth+1;
+                m_element.m_name =
+                    XMLNode::intern(core::stringc(m_xml->getNodeName()).c_str());
+                m_element.m_attributes.clear();
+                for(unsigned int i=0; i<m_xml->getAttributeCount(); i++)
+                {
+                    m_element.setAttribute(
+                        core::stringc(m_xml->getAttributeName(i)).c_str(),
+                        m_xml->getAttributeValue(i));
+                }
+                return true;
+            }
+        case io::EXN_ELEMENT_END:
+            if(m_next_depth>0)
+                m_next_depth--;
+            break;
+        default:
+            break;   // Ignore comments, text, ...
+        }   // switch
+    }   // while
+    return false;
+}   // next
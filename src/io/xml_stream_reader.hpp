@@ -0,0 +1,85 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_XML_STREAM_READER_HPP
+#define HEADER_XML_STREAM_READER_HPP
+
+#include "io/xml_node.hpp"
+#include "utils/no_copy.hpp"
+
+#include <string>
+
+/**
+ * \brief Reads a XML file one element at a time, without creating a
+ *  XMLNode tree.
+ *
+ *  This is used for large files which consist of a long list of similar
+ *  elements (quads.xml, graph.xml, addons.xml): only the current element is
+ *  kept in memory. Its attributes can be read with all get functions of
+ *  XMLNode by using getElement(), the returned node has no sub nodes.
+ *  Usage:
+ *  \code
+ *  XMLStreamReader *xml = file_manager->createXMLStreamReader(filename);
+ *  while(xml->next())
+ *  {
+ *      if(xml->getDepth()!=1) continue;
+ *      const XMLNode &node = xml->getElement();
+ *      ...
+ *  }
+ *  delete xml;
+ *  \endcode
+ * \ingroup io
+ */
+class XMLStreamReader : public NoCopy
+{
+private:
+    io::IXMLReader *m_xml;
+
+    /** The current element, the node object is reused for each element
+     *  to avoid allocations. */
+    XMLNode         m_element;
+
+    /** Depth of the current element, the root element has depth 0. */
+    unsigned int    m_depth;
+
+    /** Depth of the next element if it is found before the end of the
+     *  current element. */
+    unsigned int    m_next_depth;
+
+public:
+                       XMLStreamReader(io::IXMLReader *xml,
+                                       const std::string &filename);
+                      ~XMLStreamReader();
+    bool               next();
+    // ------------------------------------------------------------------------
+    /** Returns the current element, which is only valid till the next call
+     *  of next(). */
+    const XMLNode     &getElement() const { return m_element; }
+    // ------------------------------------------------------------------------
+    /** Returns the name of the current element. */
+    const std::string &getName() const { return m_element.getName(); }
+    // ------------------------------------------------------------------------
+    /** Returns the depth of the current element, 0 for the root element. */
+    unsigned int       getDepth() const { return m_depth; }
+    // ------------------------------------------------------------------------
+    /** Returns the name of the file that is read. */
+    const std::string &getFileName() const { return m_element.m_file_name; }
+};   // XMLStreamReader
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "items/item_manager.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <sstream>
@@ -42,6 +43,7 @@ std::vector<scene::IMesh *> ItemManager::m_item_mesh;
 std::vector<scene::IMesh *> ItemManager::m_item_lowres_mesh;
 std::vector<video::SColorf> ItemManager::m_glow_color;
 ItemManager *               ItemManager::m_item_manager = NULL;
+const float                 ItemManager::GRID_CELL_SIZE = 8.0f;
 
 
 //-----------------------------------------------------------------------------
@@ -166,6 +168,7 @@ ItemManager::ItemManager()
     {
         m_items_in_quads = NULL;
     }
+    m_item_grid.resize(GRID_BUCKETS);
 }   // ItemManager
 
 //-----------------------------------------------------------------------------
@@ -231,8 +234,62 @@ void ItemManager::insertItem(Item *item)
         else  // otherwise store it in the 'outside' index
             (*m_items_in_quads)[m_items_in_quads->size()-1].push_back(item);
     }   // if m_items_in_quads
+
+    addToGrid(item);
 }   // insertItem
 
+//-----------------------------------------------------------------------------
+/** Computes the range of grid cells that overlap the circle in which the
+ *  given item can be collected.
+ */
+void ItemManager::getGridCells(const Item *item, int *min_x, int *min_z,
+                               int *max_x, int *max_z) const
+{
+    const Vec3 &xyz = item->getXYZ();
+    float radius    = sqrtf(item->getDistance2());
+    *min_x = getGridCoordinate(xyz.getX()-radius);
+    *max_x = getGridCoordinate(xyz.getX()+radius);
+    *min_z = getGridCoordinate(xyz.getZ()-radius);
+    *max_z = getGridCoordinate(xyz.getZ()+radius);
+}   // getGridCells
+
+//-----------------------------------------------------------------------------
+/** Adds an item to all grid buckets it can be hit from. */
+void ItemManager::addToGrid(Item *item)
+{
+    int min_x, min_z, max_x, max_z;
+    getGridCells(item, &min_x, &min_z, &max_x, &max_z);
+    for(int x=min_x; x<=max_x; x++)
+    {
+        for(int z=min_z; z<=max_z; z++)
+        {
+            AllItemTypes &bucket = m_item_grid[getGridBucket(x, z)];
+            // Different cells can be hashed to the same bucket
+            if(std::find(bucket.begin(), bucket.end(), item)==bucket.end())
+                bucket.push_back(item);
+        }
+    }
+}   // addToGrid
+
+//-----------------------------------------------------------------------------
+/** Removes an item from the grid buckets it was added to. */
+void ItemManager::removeFromGrid(Item *item)
+{
+    int min_x, min_z, max_x, max_z;
+    getGridCells(item, &min_x, &min_z, &max_x, &max_z);
+    for(int x=min_x; x<=max_x; x++)
+    {
+        for(int z=min_z; z<=max_z; z++)
+        {
+            AllItemTypes &bucket = m_item_grid[getGridBucket(x, z)];
+            AllItemTypes::iterator it = std::find(bucket.begin(),
+                                                  bucket.end(), item);
+            if(it!=bucket.end())
+                bucket.erase(it);
+        }
+    }
+}   // removeFromGrid
+
 //-----------------------------------------------------------------------------
 /** Creates a new item.
  *  \param type Type of the item.
@@ -293,6 +350,13 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
     kart->collectedItem(item, add_info);
 }   // collectedItem
 
+//-----------------------------------------------------------------------------
+/** Sort function for items by their index in m_all_items. */
+static bool compareItemId(const Item *a, const Item *b)
+{
+    return a->getItemId() < b->getItemId();
+}   // compareItemId
+
 //-----------------------------------------------------------------------------
 /** Checks if any item was collected by the given kart. This function calls
  *  collectedItem if an item was collected.
@@ -300,33 +364,43 @@ void ItemManager::collectedItem(Item *item, AbstractKart *kart, int add_info)
  */
 void  ItemManager::checkItemHit(AbstractKart* kart)
 {
-    // We could use m_items_in_quads to to check for item hits: take the quad
-    // of the graph node of the kart, and only check items in that quad. But
-    // then we also need to check for any adjacent quads (since an item just
-    // on the order of one quad might get hit from an adjacent quad). Then
-    // it is possible that a quad is that short that we need to test adjacent
-    // of adjacent quads. And check for items outside of the track.
-    // Since at this stace item detection is by far not a bottle neck,
-    // the original, simple and stable algorithm is left in place.
-
-    for(AllItemTypes::iterator i =m_all_items.begin();
-        i!=m_all_items.end();  i++)
+    // Only the items stored in the grid bucket of the kart's position can
+    // be hit (each item is stored in all cells it can be hit from).
+    const Vec3 &xyz = kart->getXYZ();
+    const AllItemTypes &bucket =
+        m_item_grid[getGridBucket(getGridCoordinate(xyz.getX()),
+                                  getGridCoordinate(xyz.getZ()))];
+
+    // Collect the hits first: collecting an item can add new items (e.g. a
+    // switch), which would modify the bucket.
+    std::vector<Item*> hit_items;
+    for(AllItemTypes::const_iterator i =bucket.begin();
+        i!=bucket.end();  i++)
     {
-        if((!*i) || (*i)->wasCollected()) continue;
+        if((*i)->wasCollected()) continue;
         // To allow inlining and avoid including kart.hpp in item.hpp,
         // we pass the kart and the position separately.
-        if((*i)->hitKart(kart->getXYZ(), kart))
+        if((*i)->hitKart(xyz, kart))
+            hit_items.push_back(*i);
+    }   // for bucket
+
+    // Keep the order in which items were collected before the grid was
+    // used, i.e. the order of m_all_items.
+    if(hit_items.size()>1)
+        std::sort(hit_items.begin(), hit_items.end(), compareItemId);
+
+    for(unsigned int i=0; i<hit_items.size(); i++)
+    {
+        Item *item = hit_items[i];
+        // if we're not playing online, pick the item.
+        if (!NetworkWorld::getInstance()->isRunning())
+            collectedItem(item, kart);
+        else if (NetworkManager::getInstance()->isServer())
         {
-            // if we're not playing online, pick the item.
-            if (!NetworkWorld::getInstance()->isRunning())
-                collectedItem(*i, kart);
-            else if (NetworkManager::getInstance()->isServer())
-            {
-                collectedItem(*i, kart);
-                NetworkWorld::getInstance()->collectedItem(*i, kart);
-            }
-        }   // if hit
-    }   // for m_all_items
+            collectedItem(item, kart);
+            NetworkWorld::getInstance()->collectedItem(item, kart);
+        }
+    }   // for hit_items
 }   // checkItemHit
 
 //-----------------------------------------------------------------------------
@@ -418,18 +492,20 @@ void ItemManager::deleteItem(Item *item)
     // First check if the item needs to be removed from the items-in-quad list
     if(m_items_in_quads)
     {
-        const Vec3 &xyz = item->getXYZ();
-        int sector = QuadGraph::UNKNOWN_SECTOR;
-        QuadGraph::get()->findRoadSector(xyz, &sector);
-        unsigned int indx = sector==QuadGraph::UNKNOWN_SECTOR
-                          ? m_items_in_quads->size()-1
-                          : sector;
+        // Use the same quad as insertItem, which uses the graph node that
+        // was determined when the item was created.
+        int graph_node = item->getGraphNode();
+        unsigned int indx = graph_node > -1
+                          ? QuadGraph::get()->getNode(graph_node).getQuadIndex()
+                          : m_items_in_quads->size()-1;
         AllItemTypes &items = (*m_items_in_quads)[indx];
         AllItemTypes::iterator it = std::find(items.begin(), items.end(),item);
         assert(it!=items.end());
         items.erase(it);
     }   // if m_items_in_quads
 
+    removeFromGrid(item);
+
     int index = item->getItemId();
     m_all_items[index] = NULL;
     delete item;
@@ -25,6 +25,7 @@
 #include <SColor.h>
 
 #include <assert.h>
+#include <math.h>
 #include <map>
 #include <string>
 #include <vector>
@@ -82,6 +83,38 @@ private:
      *  field is undefined if no QuadGraph exist, e.g. in battle mode. */
     std::vector< AllItemTypes > *m_items_in_quads;
 
+    /** Size of a cell of the item grid. */
+    static const float GRID_CELL_SIZE;
+    /** Number of buckets of the item grid, must be a power of 2. */
+    static const unsigned int GRID_BUCKETS = 1024;
+
+    /** A spatial hash of all items in the X/Z plane, used to quickly find
+     *  the items a kart can hit. The plane is divided into square cells of
+     *  size GRID_CELL_SIZE, and each cell is hashed into one of
+     *  GRID_BUCKETS buckets. An item is stored in the buckets of all cells
+     *  that overlap the circle in which it can be collected. Items don't
+     *  move, so the grid only changes when items are added or deleted. */
+    std::vector< AllItemTypes > m_item_grid;
+
+    void  addToGrid(Item *item);
+    void  removeFromGrid(Item *item);
+    void  getGridCells(const Item *item, int *min_x, int *min_z,
+                       int *max_x, int *max_z) const;
+    // ------------------------------------------------------------------------
+    /** Returns the bucket index of a grid cell. */
+    unsigned int getGridBucket(int x, int z) const
+    {
+        // Large primes to spread neighbouring cells over all buckets
+        return ((unsigned int)x*73856093u ^ (unsigned int)z*19349663u)
+               & (GRID_BUCKETS-1);
+    }   // getGridBucket
+    // ------------------------------------------------------------------------
+    /** Returns the grid cell coordinate of a position on one axis. */
+    static int getGridCoordinate(float f)
+    {
+        return (int)floorf(f/GRID_CELL_SIZE);
+    }   // getGridCoordinate
+
     /** What item this item is switched to. */
     std::vector<Item::ItemType> m_switch_to;
 
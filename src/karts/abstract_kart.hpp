@@ -37,6 +37,7 @@ class Material;
 class Powerup;
 class Skidding;
 class SlipStream;
+class TerrainInfo;
 
 /** An abstract interface for the actual karts. Some functions are actually
  *  implemented here in order to allow inlining.
@@ -399,6 +400,13 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the pitch of the terrain depending on the heading. */
     virtual float getTerrainPitch(float heading) const = 0;
+    // ------------------------------------------------------------------------
+    /** Returns the terrain info that is updated with the terrain below this
+     *  kart, or NULL if the kart does not need it. */
+    virtual TerrainInfo *getTerrainInfo() = 0;
+    // ------------------------------------------------------------------------
+    /** Returns the start of the ray that finds the terrain below the kart. */
+    virtual Vec3 getTerrainRayStart() const = 0;
     // -------------------------------------------------------------------------
     /** Returns a bullet transform object located at the kart's position
         and oriented in the direction the kart is going. Can be useful
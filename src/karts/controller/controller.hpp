@@ -63,6 +63,12 @@ public:
     virtual      ~Controller         () {};
     virtual void  reset              () = 0;
     virtual void  update             (float dt) = 0;
+    // ------------------------------------------------------------------------
+    /** Called by the world before the karts are updated, for all karts at
+     *  the same time in different threads. A controller can compute here
+     *  what it needs for its next update(), but it must only read shared
+     *  data (karts, track, world) and modify nothing except itself. */
+    virtual void  think              (float dt) {};
     virtual void  handleZipper       (bool play_sound) = 0;
     virtual void  collectedItem      (const Item &item, int add_info=-1,
                                       float previous_energy=0) = 0;
@@ -190,6 +190,9 @@ void SkiddingAI::reset()
     m_avoid_item_close           = false;
     m_skid_probability_state     = SKID_PROBAB_NOT_YET;
     m_last_item_random           = NULL;
+    m_has_thought                = false;
+    m_has_aim_point              = false;
+    m_aim_last_node              = QuadGraph::UNKNOWN_SECTOR;
 
     AIBaseController::reset();
     m_track_node               = QuadGraph::UNKNOWN_SECTOR;
@@ -228,6 +231,38 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
     return m_successor_index[index];
 }   // getNextSector
 
+//-----------------------------------------------------------------------------
+/** Computes the information used by update() that only depends on the
+ *  state of the world: the nearest karts, possible crashes, the direction
+ *  of the track and the point to aim for. This function can be called for
+ *  all AI karts in parallel, so it must not modify anything except the
+ *  data of this AI. If it is not called, update() computes the same
+ *  information itself.
+ *  \param dt Time step size.
+ */
+void SkiddingAI::think(float dt)
+{
+    m_has_thought   = false;
+    m_has_aim_point = false;
+
+    // Same tests as in update(): these cases don't need the information.
+    if(m_kart->getKartAnimation() || isStuck() || m_world->isStartPhase())
+        return;
+
+    computeNearestKarts();
+    checkCrashes(m_kart->getXYZ());
+    determineTrackDirection();
+
+    // Only needed if handleSteering() doesn't steer to the center of the
+    // road or away from a kart.
+    if(!isOutsideOfRoad() && !avoidsKartCrash())
+    {
+        findAimPoint(&m_aim_point, &m_aim_last_node);
+        m_has_aim_point = true;
+    }
+    m_has_thought = true;
+}   // think
+
 //-----------------------------------------------------------------------------
 /** This is the main entry point for the AI.
  *  It is called once per frame for each AI and determines the behaviour of
@@ -235,6 +270,10 @@ unsigned int SkiddingAI::getNextSector(unsigned int index)
  */
 void SkiddingAI::update(float dt)
 {
+    // Use the results of think() only in this frame.
+    const bool has_thought = m_has_thought;
+    m_has_thought = false;
+
     // This is used to enable firing an item backwards.
     m_controls->m_look_back = false;
     m_controls->m_nitro     = false;
@@ -309,14 +348,19 @@ void SkiddingAI::update(float dt)
     }
 
     // Get information that is needed by more than 1 of the handling funcs
-    computeNearestKarts();
+    if(!has_thought)
+        computeNearestKarts();
 
     m_kart->setSlowdown(MaxSpeed::MS_DECREASE_AI,
                         m_ai_properties->getSpeedCap(m_distance_to_player),
                         /*fade_in_time*/0.0f);
     //Detect if we are going to crash with the track and/or kart
-    checkCrashes(m_kart->getXYZ());
-    determineTrackDirection();
+    if(!has_thought)
+    {
+        m_has_aim_point = false;
+        checkCrashes(m_kart->getXYZ());
+        determineTrackDirection();
+    }
 
     // Special behaviour if we have a bomb attach: try to hit the kart ahead
     // of us.
@@ -474,11 +518,7 @@ void SkiddingAI::handleSteering(float dt)
      *finite state machine.
      */
     //Reaction to being outside of the road
-    float side_dist =
-        m_world->getDistanceToCenterForKart( m_kart->getWorldKartId() );
-
-    if( fabsf(side_dist)  >
-       0.5f* QuadGraph::get()->getNode(m_track_node).getPathWidth()+0.5f )
+    if(isOutsideOfRoad())
     {
         steer_angle = steerToPoint(QuadGraph::get()->getQuadOfNode(next)
                                                     .getCenter());
@@ -491,7 +531,7 @@ void SkiddingAI::handleSteering(float dt)
     }
     //If we are going to crash against a kart, avoid it if it doesn't
     //drives the kart out of the road
-    else if( m_crashes.m_kart != -1 && !m_crashes.m_road )
+    else if(avoidsKartCrash())
     {
         //-1 = left, 1 = right, 0 = no crash.
         if( m_start_kart_crash_direction == 1 )
@@ -532,15 +572,13 @@ void SkiddingAI::handleSteering(float dt)
         Vec3 aim_point;
         int last_node = QuadGraph::UNKNOWN_SECTOR;
 
-        switch(m_point_selection_algorithm)
+        if(m_has_aim_point)
         {
-        case PSA_FIXED : findNonCrashingPointFixed(&aim_point, &last_node);
-                         break;
-        case PSA_NEW:    findNonCrashingPointNew(&aim_point, &last_node);
-                         break;
-        case PSA_DEFAULT:findNonCrashingPoint(&aim_point, &last_node);
-                         break;
+            aim_point = m_aim_point;
+            last_node = m_aim_last_node;
         }
+        else
+            findAimPoint(&aim_point, &last_node);
 #ifdef AI_DEBUG
         m_debug_sphere[m_point_selection_algorithm]->setPosition(aim_point.toIrrVector());
 #endif
@@ -559,9 +597,49 @@ void SkiddingAI::handleSteering(float dt)
         steer_angle = steerToPoint(aim_point);
     }  // if m_current_track_direction!=LEFT/RIGHT
 
+    m_has_aim_point = false;
     setSteering(steer_angle, dt);
 }   // handleSteering
 
+//-----------------------------------------------------------------------------
+/** Returns true if the kart is that far away from the center of the road
+ *  that handleSteering() steers back to the road.
+ */
+bool SkiddingAI::isOutsideOfRoad() const
+{
+    float side_dist =
+        m_world->getDistanceToCenterForKart( m_kart->getWorldKartId() );
+    return fabsf(side_dist) >
+           0.5f* QuadGraph::get()->getNode(m_track_node).getPathWidth()+0.5f;
+}   // isOutsideOfRoad
+
+//-----------------------------------------------------------------------------
+/** Returns true if the kart is going to crash with another kart, and can
+ *  avoid it without getting off the road (see checkCrashes()).
+ */
+bool SkiddingAI::avoidsKartCrash() const
+{
+    return m_crashes.m_kart != -1 && !m_crashes.m_road;
+}   // avoidsKartCrash
+
+//-----------------------------------------------------------------------------
+/** Finds the point to aim for using the selected point selection algorithm.
+ *  \param aim_point On return the point to aim for.
+ *  \param last_node On return the graph node the aim point is in.
+ */
+void SkiddingAI::findAimPoint(Vec3 *aim_point, int *last_node)
+{
+    switch(m_point_selection_algorithm)
+    {
+    case PSA_FIXED : findNonCrashingPointFixed(aim_point, last_node);
+                     break;
+    case PSA_NEW:    findNonCrashingPointNew(aim_point, last_node);
+                     break;
+    case PSA_DEFAULT:findNonCrashingPoint(aim_point, last_node);
+                     break;
+    }
+}   // findAimPoint
+
 //-----------------------------------------------------------------------------
 /** Decides if the currently selected aim at point (as determined by
  *  handleSteering) should be changed in order to collect/avoid an item.
@@ -88,6 +88,12 @@ the AI does the following steps:
 - Finally, it checks if it has a zipper but selected to use nitro, and
   under certain circumstances will use zipper instead of nitro.
 
+The steps that only read the state of the world (nearest karts, crashes,
+track direction and the point to aim for) can be done in advance by
+think(), which the world calls for all AI karts in parallel before the
+karts are updated. update() then only does the remaining steps, which
+modify the kart or use random numbers.
+
 \ingroup controller
 */
 class SkiddingAI : public AIBaseController
@@ -199,6 +205,16 @@ private:
     enum {PSA_DEFAULT, PSA_FIXED, PSA_NEW}
           m_point_selection_algorithm;
 
+    /** True if think() has computed the nearest karts, crashes and track
+     *  direction for the next call of update(). */
+    bool m_has_thought;
+
+    /** True if think() has also computed the point to aim for, which is
+     *  then stored in m_aim_point and m_aim_last_node. */
+    bool m_has_aim_point;
+    Vec3 m_aim_point;
+    int  m_aim_last_node;
+
 #ifdef DEBUG
     /** For skidding debugging: shows the estimated turn shape. */
     ShowCurve **m_curve;
@@ -242,6 +258,9 @@ private:
     void  findNonCrashingPointFixed(Vec3 *result, int *last_node);
     void  findNonCrashingPointNew(Vec3 *result, int *last_node);
     void  findNonCrashingPoint(Vec3 *result, int *last_node);
+    void  findAimPoint(Vec3 *aim_point, int *last_node);
+    bool  isOutsideOfRoad() const;
+    bool  avoidsKartCrash() const;
 
     void  determineTrackDirection();
     void  determineTurnRadius(const Vec3 &start,
@@ -259,6 +278,7 @@ protected:
 public:
                  SkiddingAI(AbstractKart *kart);
                 ~SkiddingAI();
+    virtual void think       (float delta) ;
     virtual void update      (float delta) ;
     virtual void reset       ();
     virtual const irr::core::stringw& getNamePostfix() const;
@@ -51,12 +51,29 @@ void GhostKart::addTransform(float time, const btTransform &trans)
     // FIXME: for now avoid that transforms for the same time are set
     // twice (to avoid division by zero in update). This should be
     // done when saving in replay
-    if(m_all_times.size()>0 && m_all_times.back()==time)
+    if(m_transforms.size()>0 &&
+       m_transforms.getTime(m_transforms.size()-1)==time)
         return;
-    m_all_times.push_back(time);
-    m_all_transform.push_back(trans);
+    m_transforms.add(time, trans);
 }   // addTransform
 
+// ----------------------------------------------------------------------------
+/** Uses the transforms stored in a memory mapped binary replay file, which
+ *  are read when needed. The replay file ensures that no two transforms
+ *  have the same time.
+ *  \param data Start of the transforms in the file.
+ *  \param count Number of transforms.
+ *  \param index Start of the seek index in the file.
+ *  \param index_count Number of entries of the seek index.
+ */
+void GhostKart::setMappedTransforms(const unsigned char *data,
+                                    unsigned int count,
+                                    const unsigned char *index,
+                                    unsigned int index_count)
+{
+    m_transforms.setMapped(data, count, index, index_count);
+}   // setMappedTransforms
+
 // ----------------------------------------------------------------------------
 /** Adds a replay event for this kart.
  */
@@ -92,27 +109,33 @@ void GhostKart::update(float dt)
 void GhostKart::updateTransform(float t, float dt)
 {
 
+    const unsigned int size = m_transforms.size();
+    // If the time jumped ahead, use the seek index instead of testing
+    // each transform.
+    if(m_current_transform+ReplayBase::INDEX_STRIDE < size &&
+       t>=m_transforms.getTime(m_current_transform+ReplayBase::INDEX_STRIDE))
+    {
+        m_current_transform = m_transforms.find(t);
+    }
     // Find (if necessary) the next index to use
-    while(m_current_transform+1 < m_all_times.size() &&
-          t>=m_all_times[m_current_transform+1])
+    while(m_current_transform+1 < size &&
+          t>=m_transforms.getTime(m_current_transform+1))
     {
           m_current_transform ++;
     }
-    if(m_current_transform+1>=m_all_times.size())
+    if(m_current_transform+1>=size)
     {
         m_node->setVisible(false);
         return;
     }
 
-    float f =(t - m_all_times[m_current_transform])
-           / (  m_all_times[m_current_transform+1]
-              - m_all_times[m_current_transform]  );
-    setXYZ((1-f)*m_all_transform[m_current_transform  ].getOrigin()
-           + f  *m_all_transform[m_current_transform+1].getOrigin() );
-    const btQuaternion q = m_all_transform[m_current_transform].getRotation()
-                          .slerp(m_all_transform[m_current_transform+1]
-                                 .getRotation(),
-                                 f);
+    const float t0 = m_transforms.getTime(m_current_transform);
+    const float t1 = m_transforms.getTime(m_current_transform+1);
+    const btTransform p0 = m_transforms.getTransform(m_current_transform);
+    const btTransform p1 = m_transforms.getTransform(m_current_transform+1);
+    float f =(t - t0) / (t1 - t0);
+    setXYZ((1-f)*p0.getOrigin() + f*p1.getOrigin() );
+    const btQuaternion q = p0.getRotation().slerp(p1.getRotation(), f);
     setRotation(q);
     Moveable::updateGraphics(dt, Vec3(0,0,0), btQuaternion(0, 0, 0, 1));
 }   // update
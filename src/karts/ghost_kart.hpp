@@ -36,16 +36,13 @@
 class GhostKart : public Kart
 {
 private:
-    /** The list of the times at which the transform were reached. */
-    std::vector<float>       m_all_times;
-
-    /** The transforms to assume at the corresponding time in m_all_times. */
-    std::vector<btTransform> m_all_transform;
+    /** The transforms and the times at which they were reached. */
+    ReplayBase::TransformStream m_transforms;
 
     std::vector<ReplayBase::KartReplayEvent> m_replay_events;
 
-    /** Pointer to the last index in m_all_times that is smaller than
-     *  the current world time. */
+    /** Pointer to the last index in m_transforms with a time that is
+     *  smaller than the current world time. */
     unsigned int m_current_transform;
 
     /** Index of the next kart replay event. */
@@ -56,12 +53,23 @@ public:
                  GhostKart(const std::string& ident);
     virtual void update (float dt);
     virtual void addTransform(float time, const btTransform &trans);
+    void         setMappedTransforms(const unsigned char *data,
+                                     unsigned int count,
+                                     const unsigned char *index,
+                                     unsigned int index_count);
     virtual void addReplayEvent(const ReplayBase::KartReplayEvent &kre);
     virtual void reset();
     // ------------------------------------------------------------------------
     /** No physics body for ghost kart, so nothing to adjust. */
     virtual void updateWeight() {};
     // ------------------------------------------------------------------------
+    /** The transform of a ghost kart is set from the replay in update(). */
+    virtual void updatePosition() {};
+    // ------------------------------------------------------------------------
+    /** Ghost karts only replay their transforms, they don't need to know
+     *  the terrain. */
+    virtual TerrainInfo *getTerrainInfo() { return NULL; }
+    // ------------------------------------------------------------------------
     /** No physics for ghost kart. */
     virtual void applyEngineForce (float force) {}
     // ------------------------------------------------------------------------
@@ -70,6 +70,7 @@
 #include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/log.hpp" //TODO: remove after debugging is done
+#include "utils/tick_stats.hpp"
 #include "utils/vs.hpp"
 
 
@@ -473,6 +474,20 @@ float Kart::getTerrainPitch(float heading) const
     return m_terrain_info->getTerrainPitch(heading);
 }   // getTerrainPitch
 
+// -----------------------------------------------------------------------------
+/** Returns the start of the ray that finds the terrain below the kart. A
+ *  certain epsilon (0.3) is added to the height of the kart. This avoids
+ *  problems of the ray being cast from under the track (which happened
+ *  e.g. on tux tollway when jumping down from the ramp, when the chassis
+ *  partly tunnels through the track). While tunneling should not be
+ *  happening (since Z velocity is clamped), the epsilon is left in place
+ *  just to be on the safe side (it will not hit the chassis itself).
+ */
+Vec3 Kart::getTerrainRayStart() const
+{
+    return getTrans().getOrigin()+btVector3(0,0.3f,0);
+}   // getTerrainRayStart
+
 // -----------------------------------------------------------------------------
 /** Returns the height of the terrain. we're currently above */
 float Kart::getHoT() const
@@ -1085,7 +1100,11 @@ void Kart::update(float dt)
     Moveable::update(dt);
 
     if(!history->replayHistory())
+    {
+        TickStats::start(TickStats::TS_AI);
         m_controller->update(dt);
+        TickStats::stop(TickStats::TS_AI);
+    }
 
     // if its view is blocked by plunger, decrease remaining time
     if(m_view_blocked_by_plunger > 0) m_view_blocked_by_plunger -= dt;
@@ -1185,14 +1204,9 @@ void Kart::update(float dt)
         new RescueAnimation(this, /*is_auto_rescue*/true);
     }
 
-    btTransform trans=getTrans();
-    // Add a certain epsilon (0.3) to the height of the kart. This avoids
-    // problems of the ray being cast from under the track (which happened
-    // e.g. on tux tollway when jumping down from the ramp, when the chassis
-    // partly tunnels through the track). While tunneling should not be
-    // happening (since Z velocity is clamped), the epsilon is left in place
-    // just to be on the safe side (it will not hit the chassis itself).
-    Vec3 pos_plus_epsilon = trans.getOrigin()+btVector3(0,0.3f,0);
+    // If the kart has not moved since World::update cast the rays of all
+    // karts, the result of that ray is used.
+    Vec3 pos_plus_epsilon = getTerrainRayStart();
 
     // Make sure that the ray doesn't hit the kart. This is done by
     // resetting the collision filter group, so that this collision
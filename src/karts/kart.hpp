@@ -421,7 +421,9 @@ public:
     virtual void showStarEffect(float t);
     // ------------------------------------------------------------------------
     /** Returns the terrain info oject. */
-    TerrainInfo *getTerrainInfo() { return m_terrain_info; }
+    virtual TerrainInfo *getTerrainInfo() { return m_terrain_info; }
+    // ------------------------------------------------------------------------
+    virtual Vec3 getTerrainRayStart() const;
     // ------------------------------------------------------------------------
     virtual void setOnScreenText(const wchar_t *text);
 };   // Kart
@@ -22,6 +22,7 @@
 #include "config/stk_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
+#include "io/content_cache.hpp"
 #include "io/file_manager.hpp"
 #include "karts/controller/ai_properties.hpp"
 #include "karts/kart_model.hpp"
@@ -187,7 +188,7 @@ void KartProperties::load(const std::string &filename, const std::string &node)
         m_ident = Addon::createAddonId(m_ident);
     try
     {
-        root = new XMLNode(filename);
+        root = ContentCache::get()->createXMLTree(filename);
         if(!root || root->getName()!="kart")
         {
             std::ostringstream msg;
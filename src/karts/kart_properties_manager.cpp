@@ -30,6 +30,7 @@
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "guiengine/engine.hpp"
+#include "io/content_cache.hpp"
 #include "io/file_manager.hpp"
 #include "karts/kart_properties.hpp"
 #include "utils/log.hpp"
@@ -157,6 +158,28 @@ void KartPropertiesManager::removeKart(const std::string &ident)
 void KartPropertiesManager::loadAllKarts(bool loading_icon)
 {
     m_all_kart_dirs.clear();
+
+    // Find all directories that might contain a kart, and read all their
+    // kart.xml files (in parallel, or from the content cache) before the
+    // karts are created.
+    std::vector<std::set<std::string> > all_dirs(m_kart_search_path.size());
+    std::vector<std::string> files;
+    for(unsigned int i=0; i<m_kart_search_path.size(); i++)
+    {
+        // Same name as used in loadKart
+        const std::string &dir = m_kart_search_path[i];
+        files.push_back(dir+"/kart.xml");
+        if(file_manager->fileExists(files.back())) continue;
+        file_manager->listFiles(all_dirs[i], dir);
+        for(std::set<std::string>::const_iterator subdir=all_dirs[i].begin();
+            subdir!=all_dirs[i].end(); subdir++)
+        {
+            if(*subdir=="." || *subdir=="..") continue;
+            files.push_back(dir+*subdir+"/kart.xml");
+        }
+    }
+    ContentCache::get()->prefetch(files);
+
     std::vector<std::string>::const_iterator dir;
     for(dir = m_kart_search_path.begin(); dir!=m_kart_search_path.end(); dir++)
     {
@@ -166,8 +189,10 @@ void KartPropertiesManager::loadAllKarts(bool loading_icon)
 
         // If not, check each subdir of this directory.
         // --------------------------------------------
-        std::set<std::string> result;
-        file_manager->listFiles(result, *dir);
+        std::set<std::string> &result =
+                                  all_dirs[dir-m_kart_search_path.begin()];
+        if(result.size()==0)
+            file_manager->listFiles(result, *dir);
         for(std::set<std::string>::const_iterator subdir=result.begin();
             subdir!=result.end(); subdir++)
         {
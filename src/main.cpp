@@ -160,6 +160,7 @@
 #include "input/input_manager.hpp"
 #include "input/device_manager.hpp"
 #include "input/wiimote_manager.hpp"
+#include "io/content_cache.hpp"
 #include "io/file_manager.hpp"
 #include "items/attachment_manager.hpp"
 #include "items/item_manager.hpp"
@@ -168,6 +169,7 @@
 #include "karts/kart_properties.hpp"
 #include "karts/kart_properties_manager.hpp"
 #include "modes/demo_world.hpp"
+#include "modes/profile_batch.hpp"
 #include "modes/profile_world.hpp"
 #include "network/network_manager.hpp"
 #include "network/client_network_manager.hpp"
@@ -193,6 +195,7 @@
 #include "states_screens/story_mode_lobby.hpp"
 #include "states_screens/state_manager.hpp"
 #include "states_screens/dialogs/message_dialog.hpp"
+#include "tracks/quad_graph.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/command_line.hpp"
@@ -200,6 +203,8 @@
 #include "utils/crash_reporting.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/tick_stats.hpp"
 #include "utils/translation.hpp"
 
 static void cleanSuperTuxKart();
@@ -403,7 +408,8 @@ void cmdLineHelp()
     "       --gp=NAME          Start the specified Grand Prix.\n"
     "       --stk-config=FILE  use ./data/FILE instead of "
                               "./data/stk_config.xml\n"
-    "  -k,  --numkarts=NUM     Number of karts on the racetrack.\n"
+    "  -k,  --numkarts=NUM     Number of karts on the racetrack (in profile\n"
+    "                          mode it can exceed the usual maximum).\n"
     "       --kart=NAME        Use kart number NAME.\n"
     "       --ai=a,b,...       Use the karts a, b, ... for the AI.\n"
     "       --laps=N           Define number of laps to N.\n"
@@ -424,6 +430,23 @@ void cmdLineHelp()
                               "seconds.\n"
     "       --no-graphics      Do not display the actual race.\n"
     "       --with-profile     Enables the profile mode.\n"
+    "       --tick-rate=n      Use a fixed time step of 1/n seconds.\n"
+    "       --fast             With a fixed time step: don't wait for real "
+                              "time.\n"
+    "       --tick-stats[=FILE] Write time per frame and subsystem as\n"
+    "                          JSON to FILE (or stdout) at exit.\n"
+    "       --profiler-trace=FILE Record all profiler markers and write them\n"
+    "                          at exit as CSV (.csv) or chrome trace JSON.\n"
+    "       --seed=n           Random seed, to reproduce a race.\n"
+    "       --ai-threads=n     Number of threads used for the AI (default: "
+                              "one per processor).\n"
+    "       --profile-results=FILE Write the result of a profile race as CSV.\n"
+    "       --batch=FILE       Run the profile races described in FILE.\n"
+    "       --batch-jobs=n     Number of batch races run at the same time.\n"
+    "       --batch-output=FILE Merged batch results, CSV or .json "
+                              "(default batch_results.csv).\n"
+    "       --benchmark-sectors Times the driveline sector lookup on all "
+                              "tracks.\n"
     "       --demo-mode=t      Enables demo mode after t seconds idle time in "
                                "main menu.\n"
     "       --demo-tracks=t1,t2 List of tracks to be used in demo mode. No\n"
@@ -675,6 +698,29 @@ int handleCmdLine()
         }    // for i
     }   // --kartsize-debug
 
+    if(CommandLine::has("--benchmark-sectors"))
+    {
+        for(unsigned int i=0; i<track_manager->getNumberOfTracks(); i++)
+        {
+            const Track *track = track_manager->getTrack(i);
+            std::string quad_file = track->getTrackFile("quads.xml");
+            if(!file_manager->fileExists(quad_file))
+                continue;
+            QuadGraph::benchmarkSectorLookup(quad_file,
+                                         track->getTrackFile("graph.xml"));
+        }   // for i
+        exit(0);
+    }   // --benchmark-sectors
+
+    if(CommandLine::has("--batch", &s))
+    {
+        int jobs = 0;
+        CommandLine::has("--batch-jobs", &jobs);
+        std::string output = "batch_results.csv";
+        CommandLine::has("--batch-output", &output);
+        exit(ProfileBatch::run(s, jobs, output));
+    }   // --batch
+
     if(CommandLine::has("--kart", &s))
     {
         unlock_manager->setCurrentSlot(UserConfigParams::m_all_players[0]
@@ -801,15 +847,14 @@ int handleCmdLine()
         race_manager->setGrandPrix(*gp);
     }   // --gp
 
+    bool num_karts_set = false;
     if(CommandLine::has("--numkarts", &n) ||CommandLine::has("-k", &n))
     {
+        num_karts_set = true;
         UserConfigParams::m_num_karts = n;
-        if(UserConfigParams::m_num_karts > stk_config->m_max_karts)
-        {
-            Log::warn("main", "Number of karts reset to maximum number %d.",
-                      stk_config->m_max_karts);
-            UserConfigParams::m_num_karts = stk_config->m_max_karts;
-        }
+        // The number of karts is limited after the profile options are
+        // known, since profile mode can use large fields to benchmark
+        // e.g. the ranking.
         race_manager->setNumKarts( UserConfigParams::m_num_karts );
         Log::verbose("main", "%d karts will be used.",
                      (int)UserConfigParams::m_num_karts);
@@ -839,7 +884,7 @@ int handleCmdLine()
         }
     }   // --laps
 
-    if(CommandLine::has("--profile-laps=",  &n))
+    if(CommandLine::has("--profile-laps",  &n))
     {
         if (n < 0)
         {
@@ -863,6 +908,56 @@ int handleCmdLine()
         race_manager->setNumLaps(999999); // profile end depends on time
     }   // --profile-time
 
+    if(num_karts_set && !ProfileWorld::isProfileMode() &&
+       UserConfigParams::m_num_karts > stk_config->m_max_karts)
+    {
+        Log::warn("main", "Number of karts reset to maximum number %d.",
+                  stk_config->m_max_karts);
+        UserConfigParams::m_num_karts = stk_config->m_max_karts;
+        race_manager->setNumKarts( UserConfigParams::m_num_karts );
+    }
+
+    if(CommandLine::has("--tick-rate", &n))
+    {
+        if (n <= 0)
+        {
+            Log::error("main", "Invalid tick rate: %i.", n);
+            return 0;
+        }
+        main_loop->setFixedTimestep(1.0f/n, CommandLine::has("--fast"));
+    }   // --tick-rate
+    else if(CommandLine::has("--fast"))
+        main_loop->setFixedTimestep(1.0f/60.0f, /*run_fast*/true);
+
+    if(CommandLine::has("--ai-threads", &n))
+    {
+        if (n <= 0)
+        {
+            Log::error("main", "Invalid number of AI threads: %i.", n);
+            return 0;
+        }
+        UserConfigParams::m_ai_threads = n;
+    }   // --ai-threads
+
+    if(CommandLine::has("--tick-stats", &s))
+        TickStats::enable(s);
+    else if(CommandLine::has("--tick-stats"))
+        TickStats::enable("");
+
+    if(CommandLine::has("--profiler-trace", &s))
+        profiler.enableTrace(s);
+
+    if(CommandLine::has("--seed", &n))
+    {
+        // srand was called with the current time in main(), override it
+        // so that races can be reproduced.
+        srand(n);
+        Log::info("main", "Using random seed %d.", n);
+    }   // --seed
+
+    if(CommandLine::has("--profile-results", &s))
+        ProfileWorld::setResultsFile(s);
+
     if(CommandLine::has("--with-profile") )
     {
         // Set default profile mode of 1 lap if we haven't already set one
@@ -1041,6 +1136,7 @@ void initRest()
     track_manager->addTrackSearchDir(
                  file_manager->getAddonsFile("tracks/"));
 
+    ContentCache::create();
     track_manager->loadTrackList();
     music_manager->addMusicToTracks();
 
@@ -1102,6 +1198,7 @@ static void cleanSuperTuxKart()
     if(projectile_manager)      delete projectile_manager;
     if(kart_properties_manager) delete kart_properties_manager;
     if(track_manager)           delete track_manager;
+    if(ContentCache::get())     ContentCache::destroy();
     if(material_manager)        delete material_manager;
     if(history)                 delete history;
     ReplayRecorder::destroy();
@@ -1157,6 +1254,9 @@ int main(int argc, char *argv[] )
         {
             FileManager::addRootDirs(s);
         }
+        // Must be known before the output is redirected
+        if(CommandLine::has("--batch-child"))
+            ProfileBatch::setIsChild();
 
         // Init the minimum managers so that user config exists, then
         // handle all command line options that do not need (or must
@@ -1167,9 +1267,11 @@ int main(int argc, char *argv[] )
 
         initRest();
 
-        // Windows 32 always redirects output
+        // Windows 32 always redirects output. The races of a batch run
+        // in parallel, their output is redirected by the batch runner.
 #ifndef WIN32
-        file_manager->redirectOutput();
+        if(!ProfileBatch::isChild())
+            file_manager->redirectOutput();
 #endif
 
         input_manager = new InputManager ();
@@ -1185,6 +1287,8 @@ int main(int argc, char *argv[] )
         GUIEngine::addLoadingIcon( irr_driver->getTexture(FileManager::GUI,
                                                           "options_video.png"));
         kart_properties_manager -> loadAllKarts    ();
+        // Store the cache now, so that it is not lost if stk crashes later
+        ContentCache::get()->save();
         handleXmasMode();
         unlock_manager          = new UnlockManager();
         GUIEngine::addLoadingIcon( irr_driver->getTexture(FileManager::GUI, 
@@ -1243,10 +1347,8 @@ int main(int argc, char *argv[] )
             Online::RequestManager::IPERM_ALLOWED)
         {
             std::string xml_file = file_manager->getAddonsFile("addons.xml");
-            if (file_manager->fileExists(xml_file)) {
-                const XMLNode *xml = new XMLNode (xml_file);
-                addons_manager->initAddons(xml);
-            }
+            if (file_manager->fileExists(xml_file))
+                addons_manager->initAddons(xml_file);
         }
 
         // no graphics, and no profile mode
@@ -1396,7 +1498,10 @@ int main(int argc, char *argv[] )
     {
         // In case that abort is triggered before user_config exists
         if (UserConfigParams::m_crashed) UserConfigParams::m_crashed = false;
-        user_config->saveConfig();
+        // Races of a batch run in parallel, don't let them overwrite the
+        // config of the user.
+        if(!ProfileBatch::isChild())
+            user_config->saveConfig();
     }
 
 #ifdef ENABLE_WIIUSE
@@ -22,6 +22,7 @@
 #include <assert.h>
 
 #include "audio/music_manager.hpp"
+#include "audio/sfx_manager.hpp"
 #include "config/user_config.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
@@ -36,6 +37,7 @@
 #include "race/race_manager.hpp"
 #include "states_screens/state_manager.hpp"
 #include "utils/profiler.hpp"
+#include "utils/tick_stats.hpp"
 
 MainLoop* main_loop = 0;
 
@@ -43,8 +45,11 @@ MainLoop::MainLoop() :
 m_abort(false),
 m_frame_count(0)
 {
-    m_curr_time = 0;
-    m_prev_time = 0;
+    m_curr_time       = 0;
+    m_prev_time       = 0;
+    m_fixed_dt        = 0;
+    m_run_fast        = false;
+    m_next_frame_time = 0;
 }  // MainLoop
 
 //-----------------------------------------------------------------------------
@@ -52,6 +57,20 @@ MainLoop::~MainLoop()
 {
 }   // ~MainLoop
 
+//-----------------------------------------------------------------------------
+/** Uses the same time step for each frame instead of the real time that
+ *  has passed, which makes races reproducible (given the same random seed).
+ *  \param dt The time step to use.
+ *  \param run_fast If true, frames are computed as fast as possible.
+ *         Otherwise the main loop waits till a frame is due in real time.
+ */
+void MainLoop::setFixedTimestep(float dt, bool run_fast)
+{
+    m_fixed_dt        = dt;
+    m_run_fast        = run_fast;
+    m_next_frame_time = 0;
+}   // setFixedTimestep
+
 //-----------------------------------------------------------------------------
 /** Returns the current dt, which guarantees a limited frame rate. If dt is
  *  too low (the frame rate too high), the process will sleep to reach the
@@ -62,6 +81,20 @@ float MainLoop::getLimitedDt()
     IrrlichtDevice* device = irr_driver->getDevice();
     m_prev_time = m_curr_time;
 
+    if(m_fixed_dt>0)
+    {
+        m_curr_time = device->getTimer()->getRealTime();
+        if(m_run_fast)
+            return m_fixed_dt;
+        // If the computer can't keep up, don't try to catch up later.
+        if(m_next_frame_time==0 || m_curr_time > m_next_frame_time+250)
+            m_next_frame_time = m_curr_time;
+        else if(m_curr_time < m_next_frame_time)
+            StkTime::sleep((int)(m_next_frame_time - m_curr_time));
+        m_next_frame_time += m_fixed_dt*1000.0;
+        return m_fixed_dt;
+    }
+
     float dt;  // needed outside of the while loop
     while( 1 )
     {
@@ -97,7 +130,7 @@ float MainLoop::getLimitedDt()
  */
 void MainLoop::updateRace(float dt)
 {
-    if(ProfileWorld::isProfileMode()) dt=1.0f/60.0f;
+    if(ProfileWorld::isProfileMode() && m_fixed_dt==0) dt=1.0f/60.0f;
 
     if (NetworkWorld::getInstance<NetworkWorld>()->isRunning())
         NetworkWorld::getInstance<NetworkWorld>()->update(dt);
@@ -119,6 +152,7 @@ void MainLoop::run()
 
         m_prev_time = m_curr_time;
         float dt   = getLimitedDt();
+        TickStats::startTick();
 
         if (World::getWorld())  // race is active if world exists
         {
@@ -130,6 +164,12 @@ void MainLoop::run()
         // since the GUI engine is no more to be called then.
         // Also only do music, input, and graphics update if graphics are
         // enabled.
+        // The sfx manager keeps track of which sfx are playing, so this
+        // is needed even without graphics.
+        PROFILER_PUSH_CPU_MARKER("SFX manager update", 0x7F, 0x00, 0x7F);
+        sfx_manager->update(dt);
+        PROFILER_POP_CPU_MARKER();
+
         if (!m_abort && !ProfileWorld::isNoGraphics())
         {
             PROFILER_PUSH_CPU_MARKER("Music manager update", 0x7F, 0x00, 0x00);
@@ -152,7 +192,9 @@ void MainLoop::run()
             PROFILER_POP_CPU_MARKER();
 
             PROFILER_PUSH_CPU_MARKER("Protocol manager update", 0x7F, 0x00, 0x7F);
+            TickStats::start(TickStats::TS_PROTOCOLS);
             ProtocolManager::getInstance()->update();
+            TickStats::stop(TickStats::TS_PROTOCOLS);
             PROFILER_POP_CPU_MARKER();
 
             PROFILER_PUSH_CPU_MARKER("Database polling update", 0x00, 0x7F, 0x7F);
@@ -164,7 +206,9 @@ void MainLoop::run()
         else if (!m_abort && ProfileWorld::isNoGraphics())
         {
             PROFILER_PUSH_CPU_MARKER("Protocol manager update", 0x7F, 0x00, 0x7F);
+            TickStats::start(TickStats::TS_PROTOCOLS);
             ProtocolManager::getInstance()->update();
+            TickStats::stop(TickStats::TS_PROTOCOLS);
             PROFILER_POP_CPU_MARKER();
 
             PROFILER_PUSH_CPU_MARKER("Database polling update", 0x00, 0x7F, 0x7F);
@@ -172,10 +216,14 @@ void MainLoop::run()
             PROFILER_POP_CPU_MARKER();
         }
 
+        TickStats::endTick(dt);
         PROFILER_SYNC_FRAME();
         PROFILER_POP_CPU_MARKER();
     }  // while !m_exit
 
+    TickStats::writeSummary();
+    profiler.writeTrace();
+
 }   // run
 
 //-----------------------------------------------------------------------------
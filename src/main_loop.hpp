@@ -33,6 +33,19 @@ private:
     int      m_frame_count;
     Uint32   m_curr_time;
     Uint32   m_prev_time;
+
+    /** If not 0, the time step used for each frame instead of the
+     *  measured time. */
+    float    m_fixed_dt;
+
+    /** With a fixed time step: true if the next frame is started as soon
+     *  as the previous one is done, instead of waiting for its real time. */
+    bool     m_run_fast;
+
+    /** With a fixed time step: real time in ms at which the next frame is
+     *  due. */
+    double   m_next_frame_time;
+
     float    getLimitedDt();
     void     updateRace(float dt);
 public:
@@ -40,6 +53,7 @@ public:
         ~MainLoop();
     void run();
     void abort();
+    void setFixedTimestep(float dt, bool run_fast);
     // ------------------------------------------------------------------------
     /** Returns true if STK is to be stoppe. */
     bool isAborted() const { return m_abort; }
@@ -25,12 +25,14 @@
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/controller.hpp"
 #include "karts/kart_properties.hpp"
+#include "modes/profile_world.hpp"
 #include "physics/physics.hpp"
 #include "race/history.hpp"
 #include "states_screens/race_gui_base.hpp"
 #include "tracks/track_sector.hpp"
 #include "tracks/track.hpp"
 #include "utils/constants.hpp"
+#include "utils/profiler.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
 
@@ -44,6 +46,8 @@ LinearWorld::LinearWorld() : WorldWithRank()
     m_last_lap_sfx_played  = false;
     m_last_lap_sfx_playing = false;
     m_fastest_lap          = 9999999.9f;
+    m_ranking_time         = 0.0;
+    m_ranking_count        = 0;
 }   // LinearWorld
 
 // ----------------------------------------------------------------------------
@@ -63,6 +67,12 @@ void LinearWorld::init()
 
     // The values are initialised in reset()
     m_kart_info.resize(m_karts.size());
+
+    // The karts are usually created in starting order, which is then
+    // already the order by distance.
+    m_rank_order.resize(m_karts.size());
+    for(unsigned int i=0; i<m_karts.size(); i++)
+        m_rank_order[i] = i;
 }   // init
 
 //-----------------------------------------------------------------------------
@@ -631,12 +641,33 @@ btTransform LinearWorld::getRescueTransform(unsigned int index) const
 }   // getRescueTransform
 
 //-----------------------------------------------------------------------------
-/** Find the position (rank) of every kart. ATM it uses a stable O(n^2)
- *  algorithm by counting for each kart how many other karts are ahead of
- *  it.
+/** Returns true if kart a is ahead of kart b based on the overall distance,
+ *  or on the start position if both have driven exactly the same distance.
+ */
+bool LinearWorld::isAheadOf(unsigned int a, unsigned int b) const
+{
+    const float distance_a = m_kart_info[a].m_overall_distance;
+    const float distance_b = m_kart_info[b].m_overall_distance;
+    if(distance_a != distance_b)
+        return distance_a > distance_b;
+    return m_karts[a]->getInitialPosition() < m_karts[b]->getInitialPosition();
+}   // isAheadOf
+
+//-----------------------------------------------------------------------------
+/** Find the position (rank) of every kart. The karts are kept sorted by
+ *  the distance they have driven, and the order is fixed up with an
+ *  insertion sort each frame. Since usually no or only a few karts
+ *  overtake each other between two frames, this is about linear in the
+ *  number of karts. A kart that is still racing is behind all karts that
+ *  have finished the race (but are not eliminated), and behind all racing
+ *  karts that have driven further.
  */
 void LinearWorld::updateRacePosition()
 {
+    const bool profile = ProfileWorld::isProfileMode();
+    const uint64_t start_time =
+        profile ? Profiler::getTimeNanoseconds() : 0;
+
     // Mostly for debugging:
     beginSetKartPositions();
     const unsigned int kart_amount = m_karts.size();
@@ -645,11 +676,34 @@ void LinearWorld::updateRacePosition()
     bool rank_changed = false;
 #endif
 
+    for (unsigned int i=1; i<m_rank_order.size(); i++)
+    {
+        const unsigned int kart_id = m_rank_order[i];
+        unsigned int j = i;
+        while(j>0 && isAheadOf(kart_id, m_rank_order[j-1]))
+        {
+            m_rank_order[j] = m_rank_order[j-1];
+            j--;
+        }
+        m_rank_order[j] = kart_id;
+    }   // for i<m_rank_order.size()
+
+    // All karts that have finished the race are ahead of the karts
+    // still racing.
+    unsigned int num_finished = 0;
+    for (unsigned int i=0; i<kart_amount; i++)
+    {
+        if(m_karts[i]->hasFinishedRace() && !m_karts[i]->isEliminated())
+            num_finished++;
+    }
+
     // NOTE: if you do any changes to this loop, the next loop (see
     // DEBUG_KART_RANK below) needs to have the same changes applied
     // so that debug output is still correct!!!!!!!!!!!
-    for (unsigned int i=0; i<kart_amount; i++)
+    int p = num_finished + 1;
+    for (unsigned int n=0; n<m_rank_order.size(); n++)
     {
+        const unsigned int i = m_rank_order[n];
         AbstractKart* kart = m_karts[i];
         // Karts that are either eliminated or have finished the
         // race already have their (final) position assigned. If
@@ -665,34 +719,6 @@ void LinearWorld::updateRacePosition()
         }
         KartInfo& kart_info = m_kart_info[i];
 
-        int p = 1 ;
-
-        const unsigned int my_id = kart->getWorldKartId();
-        const float my_distance  = m_kart_info[my_id].m_overall_distance;
-
-        // Count karts ahead of the current kart, i.e. kart that are
-        // already finished or have covered a larger overall distance.
-        for (unsigned int j = 0 ; j < kart_amount ; j++)
-        {
-            // don't compare a kart with itself and ignore eliminated karts
-            if(j == my_id || m_karts[j]->isEliminated())
-                continue;
-
-            // If the other kart has:
-            // - finished the race (but this kart hasn't)
-            // - or is ahead
-            // - or has the same distance (very unlikely) but started earlier
-            // it is ahead --> increase position
-            if((!kart->hasFinishedRace() && m_karts[j]->hasFinishedRace()) ||
-                m_kart_info[j].m_overall_distance > my_distance            ||
-               (m_kart_info[j].m_overall_distance == my_distance &&
-                m_karts[j]->getInitialPosition()<kart->getInitialPosition() ) )
-            {
-                p++;
-            }
-
-        } //next kart
-
 #ifndef DEBUG
         setKartPosition(i, p);
 #else
@@ -714,10 +740,12 @@ void LinearWorld::updateRacePosition()
             }
 
             std::cerr <<  "Who has each ranking so far :\n";
-            for (unsigned int d=0; d<i; d++)
+            for (unsigned int d=0; d<n; d++)
             {
-                std::cerr << "    " << m_karts[d]->getIdent() << " has rank "
-                          << m_karts[d]->getPosition() << std::endl;
+                std::cerr << "    " << m_karts[m_rank_order[d]]->getIdent()
+                          << " has rank "
+                          << m_karts[m_rank_order[d]]->getPosition()
+                          << std::endl;
             }
 
             std::cerr << "    --> And " << kart->getIdent()
@@ -740,7 +768,8 @@ void LinearWorld::updateRacePosition()
             music_manager->switchToFastMusic();
             m_faster_music_active=true;
         }
-    }   // for i<kart_amount
+        p++;
+    }   // for n<m_rank_order.size()
 
     // Define this to get a detailled analyses each time a race position
     // changes.
@@ -811,6 +840,12 @@ void LinearWorld::updateRacePosition()
 #endif
 
     endSetKartPositions();
+
+    if(profile)
+    {
+        m_ranking_time += (Profiler::getTimeNanoseconds()-start_time)*1.0e-9;
+        m_ranking_count++;
+    }
 }   // updateRacePosition
 
 //-----------------------------------------------------------------------------
@@ -111,8 +111,19 @@ protected:
       */
     AlignedArray<KartInfo> m_kart_info;
 
+    /** The world ids of all karts, sorted by the distance they have
+     *  driven. Since karts overtake each other rarely, this order is only
+     *  fixed up each frame instead of being recomputed. */
+    std::vector<unsigned int> m_rank_order;
+
+    /** In profile mode: the total time spent in updateRacePosition (in
+     *  seconds), and the number of calls, to benchmark large fields. */
+    double        m_ranking_time;
+    unsigned int  m_ranking_count;
+
     virtual void  checkForWrongDirection(unsigned int i);
     void          updateRacePosition();
+    bool          isAheadOf(unsigned int a, unsigned int b) const;
     virtual float estimateFinishTimeForKart(AbstractKart* kart) OVERRIDE;
 
 public:
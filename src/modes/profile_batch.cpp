@@ -0,0 +1,463 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "modes/profile_batch.hpp"
+
+#include "io/file_manager.hpp"
+#include "io/xml_node.hpp"
+#include "utils/command_line.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/worker_pool.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <signal.h>
+#  include <sys/types.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
+bool ProfileBatch::m_is_child = false;
+
+// ----------------------------------------------------------------------------
+/** Reads the list of races from the batch file.
+ *  \param filename Name of the XML file.
+ *  \param races On return the list of races.
+ *  \return False if the file could not be read.
+ */
+bool ProfileBatch::readRaces(const std::string &filename,
+                             std::vector<Race> *races)
+{
+    XMLNode *root = file_manager->createXMLTree(filename);
+    if(!root || root->getName()!="batch")
+    {
+        Log::error("ProfileBatch", "Can't read batch file '%s'.",
+                   filename.c_str());
+        if(root) delete root;
+        return false;
+    }
+
+    for(unsigned int i=0; i<root->getNumNodes(); i++)
+    {
+        const XMLNode *node = root->getNode(i);
+        if(node->getName()!="race")
+        {
+            Log::warn("ProfileBatch", "Unknown node '%s' in '%s' ignored.",
+                      node->getName().c_str(), filename.c_str());
+            continue;
+        }
+        Race race;
+        race.m_num_karts  = 0;
+        race.m_difficulty = 2;
+        race.m_laps       = 0;
+        race.m_time       = 0;
+        race.m_seed       = i;
+        race.m_timeout    = 600;
+        node->get("track",      &race.m_track     );
+        node->get("karts",      &race.m_karts     );
+        node->get("num-karts",  &race.m_num_karts );
+        node->get("difficulty", &race.m_difficulty);
+        node->get("laps",       &race.m_laps      );
+        node->get("time",       &race.m_time      );
+        node->get("seed",       &race.m_seed      );
+        node->get("timeout",    &race.m_timeout   );
+        if(race.m_track.size()==0)
+        {
+            Log::warn("ProfileBatch", "Race %d in '%s' has no track, "
+                      "ignored.", i, filename.c_str());
+            continue;
+        }
+        if(race.m_laps<=0 && race.m_time<=0)
+            race.m_laps = 1;
+        races->push_back(race);
+    }   // for i<getNumNodes
+    delete root;
+    return true;
+}   // readRaces
+
+// ----------------------------------------------------------------------------
+/** Returns the command line to run one race in a separate process.
+ *  \param race The race to run.
+ *  \param results Name of the file the process writes its results to.
+ */
+std::vector<std::string> ProfileBatch::getArguments(const Race &race,
+                                                    const std::string &results)
+{
+    std::vector<std::string> args;
+#ifdef __linux__
+    // argv[0] might be relative to a directory STK has left
+    args.push_back("/proc/self/exe");
+#else
+    args.push_back(CommandLine::getExecName());
+#endif
+    args.push_back("--no-graphics");
+    args.push_back("--batch-child");
+    args.push_back("--track="+race.m_track);
+    if(race.m_karts.size()>0)
+        args.push_back("--ai="+race.m_karts);
+    if(race.m_num_karts>0)
+        args.push_back("--numkarts="+StringUtils::toString(race.m_num_karts));
+    args.push_back("--mode="+StringUtils::toString(race.m_difficulty));
+    if(race.m_laps>0)
+        args.push_back("--profile-laps="+StringUtils::toString(race.m_laps));
+    else
+        args.push_back("--profile-time="+StringUtils::toString(race.m_time));
+    args.push_back("--seed="+StringUtils::toString(race.m_seed));
+    args.push_back("--tick-rate=60");
+    // The races already run in parallel
+    args.push_back("--ai-threads=1");
+    args.push_back("--fast");
+    args.push_back("--tick-stats");
+    args.push_back("--profile-results="+results);
+    return args;
+}   // getArguments
+
+// ----------------------------------------------------------------------------
+/** Starts a process, with its output redirected to a log file.
+ *  \param args The command line, starting with the executable.
+ *  \param log_file File to write stdout and stderr of the process to.
+ *  \param job On success the job is set up with the process information.
+ *  \return False if the process could not be started.
+ */
+bool ProfileBatch::startJob(const std::vector<std::string> &args,
+                            const std::string &log_file, Job *job)
+{
+#ifdef WIN32
+    std::string command;
+    for(unsigned int i=0; i<args.size(); i++)
+        command += "\"" + args[i] + "\" ";
+
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength              = sizeof(sa);
+    sa.lpSecurityDescriptor = NULL;
+    sa.bInheritHandle       = TRUE;
+    HANDLE log = CreateFileA(log_file.c_str(), GENERIC_WRITE, FILE_SHARE_READ,
+                             &sa, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    STARTUPINFOA si;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    if(log!=INVALID_HANDLE_VALUE)
+    {
+        si.dwFlags    = STARTF_USESTDHANDLES;
+        si.hStdOutput = log;
+        si.hStdError  = log;
+        si.hStdInput  = GetStdHandle(STD_INPUT_HANDLE);
+    }
+    PROCESS_INFORMATION pi;
+    std::vector<char> buffer(command.begin(), command.end());
+    buffer.push_back(0);
+    BOOL ok = CreateProcessA(NULL, &buffer[0], NULL, NULL, TRUE, 0, NULL,
+                             NULL, &si, &pi);
+    if(log!=INVALID_HANDLE_VALUE)
+        CloseHandle(log);
+    if(!ok)
+        return false;
+    CloseHandle(pi.hThread);
+    job->m_process = pi.hProcess;
+    return true;
+#else
+    std::vector<char*> argv;
+    for(unsigned int i=0; i<args.size(); i++)
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    argv.push_back(NULL);
+
+    pid_t pid = fork();
+    if(pid<0)
+        return false;
+    if(pid==0)
+    {
+        int fd = open(log_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd>=0)
+        {
+            dup2(fd, 1);
+            dup2(fd, 2);
+            close(fd);
+        }
+        execvp(argv[0], &argv[0]);
+        _exit(127);
+    }
+    job->m_pid = pid;
+    return true;
+#endif
+}   // startJob
+
+// ----------------------------------------------------------------------------
+/** Waits till one of the running jobs has finished and removes it from the
+ *  list of jobs. Jobs that run longer than the timeout of their race are
+ *  killed, so that a race that hangs does not block the whole batch.
+ *  \param jobs The running jobs.
+ *  \param races All races.
+ *  \param race On return the index of the race that has finished.
+ *  \return The exit code of the process, or -1 if it did not exit normally.
+ */
+int ProfileBatch::waitForJob(std::vector<Job> *jobs,
+                             const std::vector<Race> &races,
+                             unsigned int *race)
+{
+    while(true)
+    {
+#ifdef WIN32
+        std::vector<HANDLE> handles;
+        for(unsigned int i=0; i<jobs->size(); i++)
+            handles.push_back((*jobs)[i].m_process);
+        DWORD n = WaitForMultipleObjects((DWORD)handles.size(), &handles[0],
+                                         FALSE, 1000);
+        if(n!=WAIT_TIMEOUT)
+        {
+            unsigned int index = n - WAIT_OBJECT_0;
+            if(index>=jobs->size())
+                index = 0;
+            DWORD code = (DWORD)-1;
+            GetExitCodeProcess(handles[index], &code);
+            CloseHandle(handles[index]);
+            *race = (*jobs)[index].m_race;
+            jobs->erase(jobs->begin()+index);
+            return (int)code;
+        }
+#else
+        int status;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if(pid<0)
+        {
+            // No children left (should not happen)
+            *race = jobs->back().m_race;
+            jobs->pop_back();
+            return -1;
+        }
+        for(unsigned int i=0; pid>0 && i<jobs->size(); i++)
+        {
+            if((*jobs)[i].m_pid!=pid) continue;
+            *race = (*jobs)[i].m_race;
+            jobs->erase(jobs->begin()+i);
+            return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        }
+        if(pid>0)
+            continue;
+        usleep(100000);
+#endif
+
+        // Kill the jobs that took too long. They are reported as finished
+        // once the process has ended.
+        const time_t now = time(NULL);
+        for(unsigned int i=0; i<jobs->size(); i++)
+        {
+            Job &job = (*jobs)[i];
+            if(now < job.m_deadline) continue;
+            Log::warn("ProfileBatch", "Race %d on '%s' did not finish "
+                      "within %d seconds, killing it.", job.m_race,
+                      races[job.m_race].m_track.c_str(),
+                      races[job.m_race].m_timeout);
+#ifdef WIN32
+            TerminateProcess(job.m_process, (UINT)-1);
+#else
+            kill(job.m_pid, SIGKILL);
+#endif
+            // Don't kill it again
+            job.m_deadline = now + 3600*24;
+        }
+    }   // while true
+}   // waitForJob
+
+// ----------------------------------------------------------------------------
+/** Merges the results of all races into one file.
+ *  \param races All races.
+ *  \param results The result file of each race.
+ *  \param exit_codes The exit code of each race process.
+ *  \param output The file to write. If it ends in '.json', JSON is written,
+ *         otherwise CSV.
+ */
+void ProfileBatch::writeResults(const std::vector<Race> &races,
+                                const std::vector<std::string> &results,
+                                const std::vector<int> &exit_codes,
+                                const std::string &output)
+{
+    FILE *out = fopen(output.c_str(), "w");
+    if(!out)
+    {
+        Log::error("ProfileBatch", "Can't open '%s' for writing.",
+                   output.c_str());
+        return;
+    }
+    const bool json = StringUtils::hasSuffix(output, ".json");
+    bool header_written = false;
+
+    if(json)
+        fprintf(out, "{\n  \"races\": [\n");
+    for(unsigned int i=0; i<races.size(); i++)
+    {
+        const Race &race = races[i];
+        std::vector<std::string> columns;
+        std::vector< std::vector<std::string> > rows;
+        FILE *f = fopen(results[i].c_str(), "r");
+        if(f)
+        {
+            char line[1024];
+            while(fgets(line, 1023, f))
+            {
+                std::string s(line);
+                while(s.size()>0 && (s[s.size()-1]=='\n' ||
+                                     s[s.size()-1]=='\r'))
+                    s.erase(s.size()-1);
+                if(s.size()==0) continue;
+                if(columns.size()==0)
+                    columns = StringUtils::split(s, ',');
+                else
+                    rows.push_back(StringUtils::split(s, ','));
+            }
+            fclose(f);
+        }
+
+        if(!json)
+        {
+            if(!header_written && columns.size()>0)
+            {
+                fprintf(out, "race,track,difficulty,seed,laps,time,");
+                for(unsigned int j=0; j<columns.size(); j++)
+                    fprintf(out, j+1<columns.size() ? "%s," : "%s\n",
+                            columns[j].c_str());
+                header_written = true;
+            }
+            for(unsigned int r=0; r<rows.size(); r++)
+            {
+                fprintf(out, "%d,%s,%d,%d,%d,%d,", i, race.m_track.c_str(),
+                        race.m_difficulty, race.m_seed, race.m_laps,
+                        race.m_time);
+                for(unsigned int j=0; j<rows[r].size(); j++)
+                    fprintf(out, j+1<rows[r].size() ? "%s," : "%s\n",
+                            rows[r][j].c_str());
+            }
+            continue;
+        }
+
+        fprintf(out, "    {\"race\": %d, \"track\": \"%s\", "
+                     "\"difficulty\": %d, \"seed\": %d, \"laps\": %d, "
+                     "\"time\": %d, \"exit_code\": %d,\n",
+                i, race.m_track.c_str(), race.m_difficulty, race.m_seed,
+                race.m_laps, race.m_time, exit_codes[i]);
+        fprintf(out, "     \"karts\": [");
+        for(unsigned int r=0; r<rows.size(); r++)
+        {
+            fprintf(out, r==0 ? "\n" : ",\n");
+            fprintf(out, "       {");
+            for(unsigned int j=0; j<rows[r].size() && j<columns.size(); j++)
+            {
+                const std::string &v = rows[r][j];
+                char *end;
+                strtod(v.c_str(), &end);
+                const bool is_number = v.size()>0 && *end==0;
+                fprintf(out, is_number ? "%s\"%s\": %s" : "%s\"%s\": \"%s\"",
+                        j==0 ? "" : ", ", columns[j].c_str(), v.c_str());
+            }
+            fprintf(out, "}");
+        }
+        fprintf(out, "]}%s\n", i+1<races.size() ? "," : "");
+    }   // for i<races.size()
+    if(json)
+        fprintf(out, "  ]\n}\n");
+    fclose(out);
+}   // writeResults
+
+// ----------------------------------------------------------------------------
+/** Runs all races of a batch file, and writes the combined results.
+ *  \param filename The batch file describing the races.
+ *  \param num_jobs Number of races to run at the same time, or 0 to use
+ *         the number of processors.
+ *  \param output Name of the result file.
+ *  \return 0 if all races were run successfully, 1 otherwise.
+ */
+int ProfileBatch::run(const std::string &filename, int num_jobs,
+                      const std::string &output)
+{
+    std::vector<Race> races;
+    if(!readRaces(filename, &races))
+        return 1;
+    if(num_jobs<=0)
+        num_jobs = WorkerPool::getNumCores();
+#ifdef WIN32
+    // Limit of WaitForMultipleObjects
+    if(num_jobs>MAXIMUM_WAIT_OBJECTS)
+        num_jobs = MAXIMUM_WAIT_OBJECTS;
+#endif
+    Log::info("ProfileBatch", "Running %d races, %d at a time.",
+              (int)races.size(), num_jobs);
+
+    std::vector<std::string> results, logs;
+    for(unsigned int i=0; i<races.size(); i++)
+    {
+        results.push_back(output+"."+StringUtils::toString(i)+".csv");
+        logs.push_back(output+"."+StringUtils::toString(i)+".log");
+    }
+
+    std::vector<int> exit_codes(races.size(), -1);
+    std::vector<Job> running;
+    unsigned int next = 0, finished = 0;
+    while(finished<races.size())
+    {
+        while(next<races.size() && (int)running.size()<num_jobs)
+        {
+            Job job;
+            job.m_race     = next;
+            job.m_deadline = time(NULL) + races[next].m_timeout;
+            if(startJob(getArguments(races[next], results[next]),
+                        logs[next], &job))
+                running.push_back(job);
+            else
+            {
+                Log::error("ProfileBatch", "Can't start race %d.", next);
+                finished++;
+            }
+            next++;
+        }
+        if(running.size()==0)
+            continue;
+
+        unsigned int race;
+        int code = waitForJob(&running, races, &race);
+        exit_codes[race] = code;
+        finished++;
+        Log::info("ProfileBatch", "Race %d/%d on '%s' finished%s.",
+                  finished, (int)races.size(), races[race].m_track.c_str(),
+                  code==0 ? "" : " with an error");
+    }   // while finished<races.size()
+
+    writeResults(races, results, exit_codes, output);
+
+    int failed = 0;
+    for(unsigned int i=0; i<races.size(); i++)
+    {
+        remove(results[i].c_str());
+        if(exit_codes[i]==0)
+            remove(logs[i].c_str());
+        else
+        {
+            failed++;
+            Log::warn("ProfileBatch", "Race %d failed, see '%s'.", i,
+                      logs[i].c_str());
+        }
+    }
+    Log::info("ProfileBatch", "Results written to '%s'.", output.c_str());
+    return failed>0 ? 1 : 0;
+}   // run
@@ -0,0 +1,108 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_PROFILE_BATCH_HPP
+#define HEADER_PROFILE_BATCH_HPP
+
+#include <string>
+#include <time.h>
+#include <vector>
+
+/**
+ * \brief Runs many profile races concurrently, and collects their results
+ *  in one CSV or JSON file.
+ *
+ *  Since World, the race manager and all other managers are global
+ *  singletons, each race is run in a separate STK process (started with
+ *  --no-graphics and a fixed time step), and up to a given number of
+ *  these processes run at the same time. Each process writes its results
+ *  with ProfileWorld::setResultsFile, and the batch runner merges them.
+ *
+ *  The races are described in an XML file:
+ *  \code
+ *  <batch>
+ *    <race track="lighthouse" karts="tux,gnu,nolok" difficulty="2"
+ *          laps="2" seed="1"/>
+ *    <race track="hacienda" num-karts="6" time="60" seed="2"/>
+ *  </batch>
+ *  \endcode
+ *  A race process that does not finish within 'timeout' seconds (default
+ *  600) is killed and reported as failed.
+ * \ingroup modes
+ */
+class ProfileBatch
+{
+private:
+    /** The description of one race. */
+    struct Race
+    {
+        std::string m_track;
+        std::string m_karts;
+        int         m_num_karts;
+        int         m_difficulty;
+        int         m_laps;
+        int         m_time;
+        int         m_seed;
+        /** Wall clock time in seconds after which the process is killed. */
+        int         m_timeout;
+    };   // Race
+
+    /** A running race process. */
+    struct Job
+    {
+        /** Index of the race in the list of all races. */
+        unsigned int m_race;
+        /** Time at which the process is killed if it is still running. */
+        time_t       m_deadline;
+#ifdef WIN32
+        void        *m_process;
+#else
+        int          m_pid;
+#endif
+    };   // Job
+
+    /** True if this process is a race started by the batch runner. */
+    static bool m_is_child;
+
+    static bool readRaces(const std::string &filename,
+                          std::vector<Race> *races);
+    static std::vector<std::string> getArguments(const Race &race,
+                                                 const std::string &results);
+    static bool startJob(const std::vector<std::string> &args,
+                         const std::string &log_file, Job *job);
+    static int  waitForJob(std::vector<Job> *jobs,
+                           const std::vector<Race> &races,
+                           unsigned int *race);
+    static void writeResults(const std::vector<Race> &races,
+                             const std::vector<std::string> &results,
+                             const std::vector<int> &exit_codes,
+                             const std::string &output);
+
+public:
+    static int  run(const std::string &filename, int num_jobs,
+                    const std::string &output);
+    // ------------------------------------------------------------------------
+    /** Marks this process as a race started by the batch runner. */
+    static void setIsChild() { m_is_child = true; }
+    // ------------------------------------------------------------------------
+    /** Returns true if this process was started by the batch runner. */
+    static bool isChild() { return m_is_child; }
+};   // ProfileBatch
+
+#endif
@@ -24,6 +24,8 @@
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
 #include "tracks/track.hpp"
+#include "utils/log.hpp"
+#include "utils/tick_stats.hpp"
 
 #include <ISceneManager.h>
 
@@ -31,6 +33,7 @@ ProfileWorld::ProfileType ProfileWorld::m_profile_mode=PROFILE_NONE;
 int   ProfileWorld::m_num_laps    = 0;
 float ProfileWorld::m_time        = 0.0f;
 bool  ProfileWorld::m_no_graphics = false;
+std::string ProfileWorld::m_results_file;
 
 //-----------------------------------------------------------------------------
 /** The constructor sets the number of (local) players to 0, since only AI
@@ -199,6 +202,14 @@ void ProfileWorld::enterRaceOverState()
     float runtime = (irr_driver->getRealTime()-m_start_time)*0.001f;
     printf("Number of frames: %d time %f, Average FPS: %f\n",
            m_frame_count, runtime, (float)m_frame_count/runtime);
+    if(m_ranking_count>0)
+    {
+        printf("Average ranking time for %d karts: %f ms\n",
+               (int)m_karts.size(), 1000.0*m_ranking_time/m_ranking_count);
+    }
+
+    if(m_results_file.size()>0)
+        writeResultsFile(runtime);
 
     // Print geometry statistics if we're not in no-graphics mode
     if(!m_no_graphics)
@@ -333,3 +344,47 @@ void ProfileWorld::enterRaceOverState()
     delete this;
     main_loop->abort();
 }   // enterRaceOverState
+
+//-----------------------------------------------------------------------------
+/** Writes one CSV line for each kart with its race result and the frame
+ *  time statistics of the race to m_results_file.
+ *  \param runtime Real time the race took.
+ */
+void ProfileWorld::writeResultsFile(float runtime)
+{
+    FILE *f = fopen(m_results_file.c_str(), "w");
+    if(!f)
+    {
+        Log::error("ProfileWorld", "Can't open '%s' for writing results.",
+                   m_results_file.c_str());
+        return;
+    }
+
+    // Prefer the CPU time per frame if it is measured.
+    float mean_frame = m_frame_count>0 ? runtime/m_frame_count : 0;
+    float max_frame  = 0;
+    if(TickStats::isEnabled() && TickStats::getNumTicks()>0)
+    {
+        mean_frame = (float)TickStats::getMeanTickTime();
+        max_frame  = (float)TickStats::getMaxTickTime();
+    }
+
+    fprintf(f, "kart,controller,start_position,end_position,time,"
+               "average_speed,top_speed,rescue_count,frames,runtime,"
+               "mean_frame_ms,max_frame_ms\n");
+    for(unsigned int i=0; i<m_karts.size(); i++)
+    {
+        KartWithStats* kart = dynamic_cast<KartWithStats*>(m_karts[i]);
+        float distance = (float)(m_profile_mode==PROFILE_LAPS
+                                 ? race_manager->getNumLaps() : 1);
+        distance *= m_track->getTrackLength();
+        fprintf(f, "%s,%s,%d,%d,%f,%f,%f,%d,%d,%f,%f,%f\n",
+                kart->getIdent().c_str(),
+                kart->getController()->getControllerName().c_str(),
+                1+i, kart->getPosition(), kart->getFinishTime(),
+                distance/kart->getFinishTime(), kart->getTopSpeed(),
+                kart->getRescueCount(), m_frame_count, runtime,
+                mean_frame*1000.0f, max_frame*1000.0f);
+    }
+    fclose(f);
+}   // writeResultsFile
@@ -43,6 +43,10 @@ private:
     /** In time based profiling only: time to run. */
     static float m_time;
 
+    /** If not empty, the results of each kart are also written as CSV to
+     *  this file (used by the batch runner). */
+    static std::string m_results_file;
+
     /** Return value of real time at start of race. */
     unsigned int m_start_time;
 
@@ -67,6 +71,8 @@ private:
     /** Number of calls to draw. */
     long long    m_num_calls;
 
+    void writeResultsFile(float runtime);
+
 protected:
     /** In laps based profiling: number of laps to run. Also
      *  used by DemoWorld. */
@@ -88,6 +94,9 @@ public:
     static   void setProfileModeTime(float time);
     static   void setProfileModeLaps(int laps);
     // ------------------------------------------------------------------------
+    /** Sets a file to which the results are written as CSV. */
+    static   void setResultsFile(const std::string &f) { m_results_file = f; }
+    // ------------------------------------------------------------------------
     /** Returns true if profile mode was selected. */
     static   bool isProfileMode() {return m_profile_mode!=PROFILE_NONE; }
     // ------------------------------------------------------------------------
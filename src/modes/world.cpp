@@ -58,12 +58,15 @@
 #include "states_screens/race_gui.hpp"
 #include "states_screens/race_result_gui.hpp"
 #include "states_screens/state_manager.hpp"
+#include "tracks/terrain_info.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/constants.hpp"
 #include "utils/profiler.hpp"
 #include "utils/translation.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/tick_stats.hpp"
+#include "utils/worker_pool.hpp"
 
 World* World::m_world = NULL;
 
@@ -109,6 +112,7 @@ World::World() : WorldStatus(), m_clear_color(255,100,101,140)
 #endif
 
     m_physics            = NULL;
+    m_ai_pool            = NULL;
     m_race_gui           = NULL;
     m_saved_race_gui     = NULL;
     m_use_highscores     = true;
@@ -193,6 +197,13 @@ void World::init()
         ReplayPlay::get()->Load();
 
     powerup_manager->updateWeightsForRace(num_karts);
+
+    unsigned int num_threads = UserConfigParams::m_ai_threads > 0
+                             ? UserConfigParams::m_ai_threads
+                             : WorkerPool::getNumCores();
+    if(num_threads>num_karts)
+        num_threads = num_karts;
+    m_ai_pool = new WorkerPool(num_threads>0 ? num_threads : 1);
 }   // init
 
 //-----------------------------------------------------------------------------
@@ -379,6 +390,8 @@ World::~World()
     m_karts.clear();
     Camera::removeAllCameras();
 
+    delete m_ai_pool;
+
     projectile_manager->cleanup();
     // In case that the track is not found, m_physics is still undefined.
     if(m_physics)
@@ -825,10 +838,42 @@ void World::update(float dt)
 
     if (!history->dontDoPhysics())
     {
+        TickStats::start(TickStats::TS_PHYSICS);
         m_physics->update(dt);
+        TickStats::stop(TickStats::TS_PHYSICS);
     }
 
+    // Take the new positions of all karts from the physics now, so that
+    // the terrain rays and the AI below see the same positions as the
+    // karts themselves in their update.
     const int kart_amount = m_karts.size();
+    for (int i = 0 ; i < kart_amount; ++i)
+    {
+        if(!m_karts[i]->isEliminated()) m_karts[i]->updatePosition();
+    }
+
+    // Find the terrain below all karts with one batch of rays. Each kart
+    // uses the result of its ray in update() unless it has moved since.
+    std::vector<TerrainInfo*> terrain_infos;
+    AlignedArray<btVector3> terrain_ray_start;
+    for (int i = 0 ; i < kart_amount; ++i)
+    {
+        if(m_karts[i]->isEliminated()) continue;
+        TerrainInfo *info = m_karts[i]->getTerrainInfo();
+        if(!info) continue;
+        terrain_infos.push_back(info);
+        terrain_ray_start.push_back(m_karts[i]->getTerrainRayStart());
+    }
+    if(terrain_infos.size()>0)
+        TerrainInfo::castRays(terrain_infos, terrain_ray_start);
+
+    if(!history->replayHistory())
+    {
+        TickStats::start(TickStats::TS_AI);
+        thinkControllers(dt);
+        TickStats::stop(TickStats::TS_AI);
+    }
+
     for (int i = 0 ; i < kart_amount; ++i)
     {
         // Update all karts that are not eliminated
@@ -840,7 +885,9 @@ void World::update(float dt)
         Camera::getCamera(i)->update(dt);
     }
 
+    TickStats::start(TickStats::TS_ITEMS);
     projectile_manager->update(dt);
+    TickStats::stop(TickStats::TS_ITEMS);
 
     PROFILER_POP_CPU_MARKER();
 
@@ -849,6 +896,40 @@ void World::update(float dt)
 #endif
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Runs the think stage (see Controller::think) of the controllers of all
+ *  karts that are not eliminated, spread over the threads of the AI pool.
+ *  Since each controller only modifies its own data when thinking, the
+ *  result does not depend on the number of threads. The decisions are
+ *  applied afterwards, one kart after the other, in Kart::update.
+ *  \param dt Time step size.
+ */
+void World::thinkControllers(float dt)
+{
+    m_thinking_controllers.clear();
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if(m_karts[i]->isEliminated()) continue;
+        Controller *controller = m_karts[i]->getController();
+        if(controller)
+            m_thinking_controllers.push_back(controller);
+    }
+    m_think_dt = dt;
+    m_ai_pool->run(&World::thinkController, this,
+                   m_thinking_controllers.size());
+}   // thinkControllers
+
+// ----------------------------------------------------------------------------
+/** Called by the AI pool to let one controller think.
+ *  \param obj The world.
+ *  \param index Index in the list of thinking controllers.
+ */
+void World::thinkController(void *obj, unsigned int index)
+{
+    World *world = (World*)obj;
+    world->m_thinking_controllers[index]->think(world->m_think_dt);
+}   // thinkController
+
 // ----------------------------------------------------------------------------
 /** Only updates the track. The order in which the various parts of STK are
  *  updated is quite important (i.e. the track can't be updated as part of
@@ -41,6 +41,7 @@ class Controller;
 class PhysicalObject;
 class Physics;
 class Track;
+class WorkerPool;
 
 namespace irr
 {
@@ -73,6 +74,17 @@ private:
     /** A pointer to the global world object for a race. */
     static World *m_world;
 
+    /** Threads that run the think stage of the kart controllers. */
+    WorkerPool *m_ai_pool;
+
+    /** The controllers that think in the current frame, and the time step
+     *  size they use. */
+    std::vector<Controller*> m_thinking_controllers;
+    float                    m_think_dt;
+
+    void         thinkControllers(float dt);
+    static void  thinkController(void *obj, unsigned int index);
+
 protected:
 
 #ifdef DEBUG
@@ -155,12 +155,18 @@ void ClientNetworkManager::reset()
 
 void ClientNetworkManager::sendPacket(const NetworkString& data, bool reliable)
 {
+    pthread_mutex_lock(&m_peers_mutex);
     if (m_peers.size() > 1)
         Log::warn("ClientNetworkManager", "Ambiguous send of data.\n");
-    m_peers[0]->sendPacket(data, reliable);
+    if (m_peers.size() > 0)
+        m_peers[0]->sendPacket(data, reliable);
+    pthread_mutex_unlock(&m_peers_mutex);
 }
 
 STKPeer* ClientNetworkManager::getPeer()
 {
-    return m_peers[0];
+    pthread_mutex_lock(&m_peers_mutex);
+    STKPeer* peer = m_peers.size() > 0 ? m_peers[0] : NULL;
+    pthread_mutex_unlock(&m_peers_mutex);
+    return peer;
 }
@@ -0,0 +1,113 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/clock_estimator.hpp"
+
+#include <math.h>
+
+ClockEstimator::ClockEstimator()
+{
+    for (unsigned int i = 0; i < PING_HISTORY; i++)
+    {
+        m_send_time[i] = 0;
+        m_sequence[i]  = 0;
+        m_pending[i]   = false;
+    }
+    m_next_sequence   = 0;
+    m_num_samples     = 0;
+    m_next_sample     = 0;
+    m_jitter          = 0;
+    m_last_round_trip = 0;
+    m_pings_sent      = 0;
+    m_pongs_received  = 0;
+}   // ClockEstimator
+
+// ----------------------------------------------------------------------------
+/** Stores the send time of a new ping.
+ *  \param local_time Local time at which the ping is sent.
+ *  \return The sequence number to send with the ping.
+ */
+uint32_t ClockEstimator::pingSent(double local_time)
+{
+    uint32_t sequence = m_next_sequence++;
+    unsigned int index = sequence % PING_HISTORY;
+    m_send_time[index] = local_time;
+    m_sequence[index]  = sequence;
+    m_pending[index]   = true;
+    m_pings_sent++;
+    return sequence;
+}   // pingSent
+
+// ----------------------------------------------------------------------------
+/** Adds a sample when the response to a ping is received.
+ *  \param sequence Sequence number of the ping.
+ *  \param remote_time Time of the peer when it answered.
+ *  \param local_time Local time at which the response arrived.
+ *  \return False if the ping is unknown, too old or was already answered.
+ */
+bool ClockEstimator::pongReceived(uint32_t sequence, double remote_time,
+                                  double local_time)
+{
+    unsigned int index = sequence % PING_HISTORY;
+    if (!m_pending[index] || m_sequence[index] != sequence)
+        return false;
+    m_pending[index] = false;
+    m_pongs_received++;
+
+    double round_trip = local_time - m_send_time[index];
+    if (m_num_samples > 0)
+    {
+        double d = fabs(round_trip - m_last_round_trip);
+        m_jitter += (d - m_jitter) / 16.0;
+    }
+    m_last_round_trip = round_trip;
+
+    // Assume the peer answered half way through the round trip
+    m_round_trip[m_next_sample] = round_trip;
+    m_offset[m_next_sample]     = remote_time
+                                - 0.5 * (m_send_time[index] + local_time);
+    m_next_sample = (m_next_sample + 1) % SAMPLE_WINDOW;
+    if (m_num_samples < SAMPLE_WINDOW)
+        m_num_samples++;
+    return true;
+}   // pongReceived
+
+// ----------------------------------------------------------------------------
+/** Returns the index of the sample with the smallest round trip. */
+unsigned int ClockEstimator::getBestSample() const
+{
+    unsigned int best = 0;
+    for (unsigned int i = 1; i < m_num_samples; i++)
+    {
+        if (m_round_trip[i] < m_round_trip[best])
+            best = i;
+    }
+    return best;
+}   // getBestSample
+
+// ----------------------------------------------------------------------------
+/** Returns the average round trip time in the window, in seconds. */
+double ClockEstimator::getAverageRoundTrip() const
+{
+    if (m_num_samples == 0)
+        return 0;
+    double sum = 0;
+    for (unsigned int i = 0; i < m_num_samples; i++)
+        sum += m_round_trip[i];
+    return sum / m_num_samples;
+}   // getAverageRoundTrip
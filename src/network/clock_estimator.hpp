@@ -0,0 +1,108 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file clock_estimator.hpp
+ *  \brief Estimates the round trip time and the clock offset to a peer from
+ *  the pings exchanged by the SynchronizationProtocol.
+ */
+
+#ifndef CLOCK_ESTIMATOR_HPP
+#define CLOCK_ESTIMATOR_HPP
+
+#include "utils/types.hpp"
+
+/** \brief Round trip time, jitter and clock offset estimation for one peer.
+ *
+ *  Only a fixed number of pings and samples is kept, so the memory used does
+ *  not grow during a session, and the estimate follows route changes after
+ *  SAMPLE_WINDOW pings. Queueing delays only ever make a round trip longer,
+ *  so the round trip time and the clock offset are taken from the sample
+ *  with the smallest round trip in the window: the shorter the round trip,
+ *  the less the one-way delays can differ and the more accurate the offset.
+ *  The jitter is the smoothed difference between consecutive round trips
+ *  (as in RFC 3550).
+ */
+class ClockEstimator
+{
+public:
+    /** Number of pings that can be waiting for a response. */
+    static const unsigned int PING_HISTORY  = 32;
+    /** Number of round trip samples used for the estimate. */
+    static const unsigned int SAMPLE_WINDOW = 16;
+
+private:
+    /** Send time and sequence number of the pings, indexed by sequence
+     *  number modulo PING_HISTORY. */
+    double       m_send_time[PING_HISTORY];
+    uint32_t     m_sequence[PING_HISTORY];
+    bool         m_pending[PING_HISTORY];
+    uint32_t     m_next_sequence;
+
+    /** The round trip time and clock offset of the last pings, in a ring
+     *  buffer. */
+    double       m_round_trip[SAMPLE_WINDOW];
+    double       m_offset[SAMPLE_WINDOW];
+    unsigned int m_num_samples;
+    unsigned int m_next_sample;
+
+    double       m_jitter;
+    double       m_last_round_trip;
+    unsigned int m_pings_sent;
+    unsigned int m_pongs_received;
+
+    unsigned int getBestSample() const;
+
+public:
+                 ClockEstimator();
+    uint32_t     pingSent(double local_time);
+    bool         pongReceived(uint32_t sequence, double remote_time,
+                              double local_time);
+    double       getAverageRoundTrip() const;
+
+    // ------------------------------------------------------------------------
+    /** True once at least one response was received. */
+    bool hasSamples() const { return m_num_samples > 0; }
+    // ------------------------------------------------------------------------
+    /** Returns the smallest round trip time in the window, in seconds. */
+    double getRoundTrip() const
+    {
+        return hasSamples() ? m_round_trip[getBestSample()] : 0;
+    }   // getRoundTrip
+    // ------------------------------------------------------------------------
+    /** Returns the variation of the round trip time, in seconds. */
+    double getJitter() const { return m_jitter; }
+    // ------------------------------------------------------------------------
+    /** Returns the time (in seconds) to add to a local time to get the time
+     *  of the peer. */
+    double getClockOffset() const
+    {
+        return hasSamples() ? m_offset[getBestSample()] : 0;
+    }   // getClockOffset
+    // ------------------------------------------------------------------------
+    /** Converts a local time into the time of the peer. */
+    double toRemoteTime(double local_time) const
+    {
+        return local_time + getClockOffset();
+    }   // toRemoteTime
+    // ------------------------------------------------------------------------
+    unsigned int getPingsSent() const     { return m_pings_sent;     }
+    // ------------------------------------------------------------------------
+    unsigned int getPongsReceived() const { return m_pongs_received; }
+};   // ClockEstimator
+
+#endif // CLOCK_ESTIMATOR_HPP
@@ -42,7 +42,7 @@ Event::Event(ENetEvent* event)
     }
     if (type == EVENT_TYPE_MESSAGE)
     {
-        m_data = NetworkString(std::string((char*)(event->packet->data), event->packet->dataLength-1));
+        m_data = NetworkString(event->packet->data, event->packet->dataLength-1);
     }
 
     m_packet = NULL;
@@ -83,6 +83,14 @@ Event::Event(const Event& event)
     type = event.type;
 }
 
+Event::Event(const Event& event, const NetworkString& data)
+{
+    m_packet = NULL;
+    m_data = data;
+    peer = event.peer;
+    type = event.type;
+}
+
 Event::~Event()
 {
     peer = NULL;
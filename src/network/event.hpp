@@ -60,6 +60,11 @@ class Event
          *  \param event : The event to copy.
          */
         Event(const Event& event);
+        /*! \brief Constructor
+         *  \param event : The event of a received packet.
+         *  \param data : One of the messages contained in the packet.
+         */
+        Event(const Event& event, const NetworkString& data);
         /*! \brief Destructor
          *  frees the memory of the ENetPacket.
          */
@@ -70,11 +75,11 @@ class Event
          */
         void removeFront(int size);
 
-        /*! \brief Get a copy of the data.
-         *  \return A copy of the message data. This is empty for events like
-         *  connection or disconnections.
+        /*! \brief Get the data of the event.
+         *  \return A reference to the message data. This is empty for events
+         *  like connection or disconnections.
          */
-        NetworkString data() const { return m_data; }
+        const NetworkString& data() const { return m_data; }
 
         EVENT_TYPE type;    //!< Type of the event.
         STKPeer** peer;     //!< Pointer to the peer that triggered that event.
@@ -0,0 +1,346 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/kart_snapshot.hpp"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+/** Writes the lowest 'bits' bits of value.
+ *  \param value The value to write.
+ *  \param bits Number of bits to write, at most 32.
+ */
+void BitWriter::write(uint32_t value, int bits)
+{
+    assert(bits >= 0 && bits <= 32);
+    while (bits > 0)
+    {
+        int n = std::min(bits, 8);
+        bits -= n;
+        m_buffer = (m_buffer << n) | ((value >> bits) & ((1u << n) - 1));
+        m_bits  += n;
+        if (m_bits >= 8)
+        {
+            m_bits -= 8;
+            m_string->addUInt8((m_buffer >> m_bits) & 0xff);
+        }
+    }
+}   // write
+
+// ----------------------------------------------------------------------------
+/** Writes the remaining bits to the string, padded with zeros to a full
+ *  byte. */
+void BitWriter::flush()
+{
+    if (m_bits > 0)
+        m_string->addUInt8((m_buffer << (8 - m_bits)) & 0xff);
+    m_bits   = 0;
+    m_buffer = 0;
+}   // flush
+
+// ----------------------------------------------------------------------------
+/** Reads 'bits' bits. Returns 0 and sets the overflow flag if the end of
+ *  the string is reached. */
+uint32_t BitReader::read(int bits)
+{
+    assert(bits >= 0 && bits <= 32);
+    uint32_t result = 0;
+    while (bits > 0)
+    {
+        if (m_bits == 0)
+        {
+            if (m_offset >= m_string.size())
+            {
+                m_overflow = true;
+                return 0;
+            }
+            m_buffer = m_string.getUInt8(m_offset++);
+            m_bits   = 8;
+        }
+        int n   = std::min(bits, m_bits);
+        m_bits -= n;
+        bits   -= n;
+        result  = (result << n) | ((m_buffer >> m_bits) & ((1u << n) - 1));
+    }
+    return result;
+}   // read
+
+// ============================================================================
+/** Returns the state of the given kart, or NULL if this snapshot does not
+ *  contain it. */
+const QuantizedKartState* KartSnapshot::getKart(uint8_t kart_id) const
+{
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (m_karts[i].m_kart_id == kart_id)
+            return &m_karts[i];
+    }
+    return NULL;
+}   // getKart
+
+// ============================================================================
+KartSnapshotCoder::KartSnapshotCoder()
+{
+    setBoundingBox(Vec3(-1000, -1000, -1000), Vec3(1000, 1000, 1000));
+}   // KartSnapshotCoder
+
+// ----------------------------------------------------------------------------
+/** Sets the box in which positions are quantized, usually the bounding box
+ *  of the track. A margin is added so that karts falling off the track or
+ *  being rescued are still represented correctly.
+ */
+void KartSnapshotCoder::setBoundingBox(const Vec3 &min, const Vec3 &max)
+{
+    const float margin = 50.0f;
+    m_min = min - Vec3(margin, margin, margin);
+    m_max = max + Vec3(margin, margin, margin);
+    const float steps = (float)((1u << POSITION_BITS) - 1);
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        float extent = m_max[i] - m_min[i];
+        m_scale[i] = extent > 0 ? steps / extent : 1.0f;
+    }
+}   // setBoundingBox
+
+// ----------------------------------------------------------------------------
+/** Converts a kart position and rotation into their quantized values. */
+void KartSnapshotCoder::quantize(uint8_t kart_id, const Vec3 &xyz,
+                                 const btQuaternion &q,
+                                 QuantizedKartState *state) const
+{
+    state->m_kart_id = kart_id;
+    const float max_position = (float)((1u << POSITION_BITS) - 1);
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        float f = (xyz[i] - m_min[i]) * m_scale[i] + 0.5f;
+        f = std::max(0.0f, std::min(max_position, f));
+        state->m_position[i] = (uint32_t)f;
+    }
+
+    // Smallest three: drop the largest component, it can be recomputed
+    // from the three others since the quaternion is normalised.
+    float c[4] = { q.getX(), q.getY(), q.getZ(), q.getW() };
+    unsigned int largest = 0;
+    for (unsigned int i = 1; i < 4; i++)
+    {
+        if (fabsf(c[i]) > fabsf(c[largest]))
+            largest = i;
+    }
+    // q and -q are the same rotation, make the dropped component positive
+    const float sign = c[largest] < 0 ? -1.0f : 1.0f;
+    const float max_component = 0.70710678f;
+    const float max_rotation  = (float)((1u << ROTATION_BITS) - 1);
+    uint32_t rotation = largest;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        float f = c[i] * sign;
+        f = std::max(-max_component, std::min(max_component, f));
+        f = (f + max_component) / (2.0f * max_component) * max_rotation + 0.5f;
+        rotation = (rotation << ROTATION_BITS) | (uint32_t)f;
+    }
+    state->m_rotation = rotation;
+}   // quantize
+
+// ----------------------------------------------------------------------------
+/** Converts a quantized state back into a position and a rotation. */
+void KartSnapshotCoder::dequantize(const QuantizedKartState &state, Vec3 *xyz,
+                                   btQuaternion *q) const
+{
+    for (unsigned int i = 0; i < 3; i++)
+        (*xyz)[i] = m_min[i] + state.m_position[i] / m_scale[i];
+
+    const float max_component = 0.70710678f;
+    const float max_rotation  = (float)((1u << ROTATION_BITS) - 1);
+    const uint32_t mask       = (1u << ROTATION_BITS) - 1;
+    unsigned int largest = state.m_rotation >> (3 * ROTATION_BITS);
+    float c[4];
+    float sum = 0;
+    int shift = 2 * ROTATION_BITS;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (i == largest) continue;
+        uint32_t v = (state.m_rotation >> shift) & mask;
+        shift -= ROTATION_BITS;
+        c[i] = v / max_rotation * 2.0f * max_component - max_component;
+        sum += c[i] * c[i];
+    }
+    c[largest] = sqrtf(std::max(0.0f, 1.0f - sum));
+    *q = btQuaternion(c[0], c[1], c[2], c[3]);
+}   // dequantize
+
+// ----------------------------------------------------------------------------
+/** Writes one kart. If base is not NULL, only the differences to it are
+ *  written.
+ */
+void KartSnapshotCoder::writeKart(BitWriter *writer,
+                                  const QuantizedKartState &state,
+                                  const QuantizedKartState *base) const
+{
+    writer->write(state.m_kart_id, 8);
+    if (!base)
+    {
+        for (unsigned int i = 0; i < 3; i++)
+            writer->write(state.m_position[i], POSITION_BITS);
+        writer->write(state.m_rotation, 2 + 3 * ROTATION_BITS);
+        return;
+    }
+
+    if (state == *base)
+    {
+        writer->write(0, 1);    // kart unchanged
+        return;
+    }
+    writer->write(1, 1);
+
+    const int max_delta = (1 << (DELTA_BITS - 1)) - 1;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        int delta = (int)state.m_position[i] - (int)base->m_position[i];
+        if (delta >= -max_delta && delta <= max_delta)
+        {
+            writer->write(1, 1);
+            writer->write((uint32_t)(delta + max_delta), DELTA_BITS);
+        }
+        else
+        {
+            writer->write(0, 1);
+            writer->write(state.m_position[i], POSITION_BITS);
+        }
+    }
+    if (state.m_rotation == base->m_rotation)
+    {
+        writer->write(0, 1);
+    }
+    else
+    {
+        writer->write(1, 1);
+        writer->write(state.m_rotation, 2 + 3 * ROTATION_BITS);
+    }
+}   // writeKart
+
+// ----------------------------------------------------------------------------
+/** Reads one kart written by writeKart.
+ *  \return False if the data is truncated.
+ */
+bool KartSnapshotCoder::readKart(BitReader *reader, const KartSnapshot *base,
+                                 QuantizedKartState *state) const
+{
+    state->m_kart_id = (uint8_t)reader->read(8);
+    if (!base)
+    {
+        for (unsigned int i = 0; i < 3; i++)
+            state->m_position[i] = reader->read(POSITION_BITS);
+        state->m_rotation = reader->read(2 + 3 * ROTATION_BITS);
+        return !reader->hasOverflown();
+    }
+
+    QuantizedKartState zero;
+    memset(&zero, 0, sizeof(zero));
+    const QuantizedKartState *base_kart = base->getKart(state->m_kart_id);
+    if (!base_kart)
+        base_kart = &zero;
+
+    if (reader->read(1) == 0)
+    {
+        const uint8_t kart_id = state->m_kart_id;
+        *state = *base_kart;
+        state->m_kart_id = kart_id;
+        return !reader->hasOverflown();
+    }
+
+    const int max_delta = (1 << (DELTA_BITS - 1)) - 1;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        if (reader->read(1))
+        {
+            int delta = (int)reader->read(DELTA_BITS) - max_delta;
+            state->m_position[i] = (uint32_t)((int)base_kart->m_position[i]
+                                              + delta);
+        }
+        else
+            state->m_position[i] = reader->read(POSITION_BITS);
+    }
+    if (reader->read(1))
+        state->m_rotation = reader->read(2 + 3 * ROTATION_BITS);
+    else
+        state->m_rotation = base_kart->m_rotation;
+    return !reader->hasOverflown();
+}   // readKart
+
+// ----------------------------------------------------------------------------
+/** Appends the karts of a snapshot to a message: the number of karts as one
+ *  byte, followed by the bit packed kart states.
+ *  \param snapshot The snapshot to encode.
+ *  \param base Snapshot the receiver already has and against which a delta
+ *         is encoded, or NULL to encode the full states.
+ *  \param ns The message to write to.
+ */
+void KartSnapshotCoder::encode(const KartSnapshot &snapshot,
+                               const KartSnapshot *base,
+                               NetworkString *ns) const
+{
+    QuantizedKartState zero;
+    memset(&zero, 0, sizeof(zero));
+
+    ns->addUInt8((uint8_t)snapshot.m_karts.size());
+    BitWriter writer(ns);
+    for (unsigned int i = 0; i < snapshot.m_karts.size(); i++)
+    {
+        const QuantizedKartState &kart = snapshot.m_karts[i];
+        const QuantizedKartState *base_kart = NULL;
+        if (base)
+        {
+            base_kart = base->getKart(kart.m_kart_id);
+            if (!base_kart)
+            {
+                // The decoder uses the same all zero state
+                zero.m_kart_id = kart.m_kart_id;
+                base_kart = &zero;
+            }
+        }
+        writeKart(&writer, kart, base_kart);
+    }
+    writer.flush();
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Reads the karts written by encode.
+ *  \param ns The message.
+ *  \param offset Offset of the kart count in the message.
+ *  \param base The snapshot used as base when encoding, or NULL.
+ *  \param snapshot Receives the decoded karts.
+ *  \return False if the message was truncated.
+ */
+bool KartSnapshotCoder::decode(const NetworkString &ns, int offset,
+                               const KartSnapshot *base,
+                               KartSnapshot *snapshot) const
+{
+    if (ns.size() <= offset)
+        return false;
+    unsigned int count = ns.getUInt8(offset);
+    snapshot->m_karts.resize(count);
+    BitReader reader(ns, offset+1);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!readKart(&reader, base, &snapshot->m_karts[i]))
+            return false;
+    }
+    return true;
+}   // decode
@@ -0,0 +1,154 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+/*! \file kart_snapshot.hpp
+ *  \brief Compact, quantized encoding of kart positions and rotations that
+ *  are exchanged by the KartUpdateProtocol.
+ */
+
+#ifndef KART_SNAPSHOT_HPP
+#define KART_SNAPSHOT_HPP
+
+#include "network/network_string.hpp"
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <vector>
+
+/** \brief Writes values with an arbitrary number of bits into a
+ *  NetworkString. Bits are stored most significant first. */
+class BitWriter
+{
+private:
+    NetworkString *m_string;
+    /** Bits that have not been written to the string yet. */
+    uint32_t       m_buffer;
+    /** Number of valid bits in m_buffer. */
+    int            m_bits;
+public:
+    BitWriter(NetworkString *string) : m_string(string), m_buffer(0),
+                                       m_bits(0) {}
+    void write(uint32_t value, int bits);
+    void flush();
+};   // BitWriter
+
+// ----------------------------------------------------------------------------
+/** \brief Reads values written by a BitWriter from a NetworkString, starting
+ *  at a given byte offset. */
+class BitReader
+{
+private:
+    const NetworkString &m_string;
+    /** Offset of the next byte to read in the string. */
+    int                  m_offset;
+    uint32_t             m_buffer;
+    int                  m_bits;
+    /** Set when trying to read past the end of the string. */
+    bool                 m_overflow;
+public:
+    BitReader(const NetworkString &string, int offset)
+            : m_string(string), m_offset(offset), m_buffer(0), m_bits(0),
+              m_overflow(false) {}
+    uint32_t read(int bits);
+    /** True if more bits were requested than the string contains. */
+    bool hasOverflown() const { return m_overflow; }
+};   // BitReader
+
+// ============================================================================
+/** \brief The quantized state of one kart. */
+struct QuantizedKartState
+{
+    uint8_t  m_kart_id;
+    /** Position on each axis, relative to the track bounding box. */
+    uint32_t m_position[3];
+    /** Rotation, compressed with the smallest three method. */
+    uint32_t m_rotation;
+
+    bool operator==(const QuantizedKartState &other) const
+    {
+        return m_kart_id     == other.m_kart_id     &&
+               m_position[0] == other.m_position[0] &&
+               m_position[1] == other.m_position[1] &&
+               m_position[2] == other.m_position[2] &&
+               m_rotation    == other.m_rotation;
+    }
+};   // QuantizedKartState
+
+// ============================================================================
+/** \brief The state of all karts sent in one kart update message. */
+struct KartSnapshot
+{
+    /** Sequence number of this snapshot, wrapping around. */
+    uint16_t                        m_sequence;
+    std::vector<QuantizedKartState> m_karts;
+
+    const QuantizedKartState* getKart(uint8_t kart_id) const;
+};   // KartSnapshot
+
+// ============================================================================
+/** \brief Quantizes kart states and encodes snapshots into messages.
+ *
+ *  Positions are stored with POSITION_BITS bits per axis, relative to the
+ *  axis aligned bounding box of the track (which is identical on all hosts).
+ *  Rotations use the smallest three encoding: the index of the largest
+ *  quaternion component is stored in 2 bits, and the three other components
+ *  (which are in [-1/sqrt(2), 1/sqrt(2)]) with ROTATION_BITS each.
+ *
+ *  A snapshot can be encoded as a delta against an older snapshot that the
+ *  receiver is known to have: unchanged karts then take one bit, and small
+ *  position changes are sent as short signed offsets.
+ */
+class KartSnapshotCoder
+{
+public:
+    /** Version of the encoding, sent with each message. Increase it whenever
+     *  the layout below changes. */
+    static const uint8_t SNAPSHOT_VERSION = 1;
+    static const int     POSITION_BITS    = 20;
+    static const int     ROTATION_BITS    = 10;
+    /** Number of bits of a position delta on one axis, including sign. */
+    static const int     DELTA_BITS       = 14;
+
+private:
+    /** Bounding box used to quantize positions. */
+    Vec3 m_min;
+    Vec3 m_max;
+    /** Scale from world units to quantized units on each axis. */
+    Vec3 m_scale;
+
+    void writeKart(BitWriter *writer, const QuantizedKartState &state,
+                   const QuantizedKartState *base) const;
+    bool readKart(BitReader *reader, const KartSnapshot *base,
+                  QuantizedKartState *state) const;
+
+public:
+         KartSnapshotCoder();
+    void setBoundingBox(const Vec3 &min, const Vec3 &max);
+    void quantize(uint8_t kart_id, const Vec3 &xyz, const btQuaternion &q,
+                  QuantizedKartState *state) const;
+    void dequantize(const QuantizedKartState &state, Vec3 *xyz,
+                    btQuaternion *q) const;
+    void encode(const KartSnapshot &snapshot, const KartSnapshot *base,
+                NetworkString *ns) const;
+    bool decode(const NetworkString &ns, int offset, const KartSnapshot *base,
+                KartSnapshot *snapshot) const;
+};   // KartSnapshotCoder
+
+#endif // KART_SNAPSHOT_HPP
@@ -27,9 +27,14 @@
 #include "network/server_network_manager.hpp"
 
 #include "utils/log.hpp"
+#include "utils/time.hpp"
 
 #include <pthread.h>
 #include <signal.h>
+#include <string.h>
+
+/** Interval in seconds in which the statistics of sent data are logged. */
+static const double STATS_INTERVAL = 10.0;
 
 //-----------------------------------------------------------------------------
 
@@ -39,6 +44,13 @@ NetworkManager::NetworkManager()
     m_public_address.port = 0;
     m_localhost = NULL;
     m_game_setup = NULL;
+    memset(m_sent_messages, 0, sizeof(m_sent_messages));
+    memset(m_sent_message_bytes, 0, sizeof(m_sent_message_bytes));
+    m_sent_packets = 0;
+    m_sent_packet_bytes = 0;
+    m_stats_start = -1;
+    pthread_mutex_init(&m_stats_mutex, NULL);
+    pthread_mutex_init(&m_peers_mutex, NULL);
 }
 
 //-----------------------------------------------------------------------------
@@ -49,11 +61,14 @@ NetworkManager::~NetworkManager()
 
     if (m_localhost)
         delete m_localhost;
+    pthread_mutex_lock(&m_peers_mutex);
     while(!m_peers.empty())
     {
         delete m_peers.back();
         m_peers.pop_back();
     }
+    pthread_mutex_unlock(&m_peers_mutex);
+    pthread_mutex_destroy(&m_peers_mutex);
 }
 
 //-----------------------------------------------------------------------------
@@ -69,11 +84,13 @@ void NetworkManager::reset()
     if (m_localhost)
         delete m_localhost;
     m_localhost = NULL;
+    pthread_mutex_lock(&m_peers_mutex);
     while(!m_peers.empty())
     {
         delete m_peers.back();
         m_peers.pop_back();
     }
+    pthread_mutex_unlock(&m_peers_mutex);
 }
 
 void NetworkManager::abort()
@@ -111,10 +128,12 @@ void NetworkManager::notifyEvent(Event* event)
     STKPeer* peer = *event->peer;
     if (event->type == EVENT_TYPE_CONNECTED)
     {
+        pthread_mutex_lock(&m_peers_mutex);
         Log::info("NetworkManager", "A client has just connected. There are now %lu peers.", m_peers.size() + 1);
         Log::debug("NetworkManager", "Addresses are : %lx, %lx, %lx", event->peer, *event->peer, peer);
         // create the new peer:
         m_peers.push_back(peer);
+        pthread_mutex_unlock(&m_peers_mutex);
     }
     if (event->type == EVENT_TYPE_MESSAGE)
     {
@@ -143,6 +162,7 @@ void NetworkManager::sendPacket(STKPeer* peer, const NetworkString& data, bool r
 
 void NetworkManager::sendPacketExcept(STKPeer* peer, const NetworkString& data, bool reliable)
 {
+    pthread_mutex_lock(&m_peers_mutex);
     for (unsigned int i = 0; i < m_peers.size(); i++)
     {
         STKPeer* p = m_peers[i];
@@ -151,6 +171,88 @@ void NetworkManager::sendPacketExcept(STKPeer* peer, const NetworkString& data,
             p->sendPacket(data, reliable);
         }
     }
+    pthread_mutex_unlock(&m_peers_mutex);
+}
+
+//-----------------------------------------------------------------------------
+
+/** \brief Sends all messages queued for the peers, see STKPeer::sendPacket.
+ *  This is called after each update of the protocols, and logs the
+ *  statistics of sent data at regular intervals.
+ */
+void NetworkManager::flushPackets()
+{
+    // The peers can't be removed while their packets are sent
+    pthread_mutex_lock(&m_peers_mutex);
+    for (unsigned int i = 0; i < m_peers.size(); i++)
+        m_peers[i]->flush();
+    pthread_mutex_unlock(&m_peers_mutex);
+
+    double now = StkTime::getRealTime();
+    pthread_mutex_lock(&m_stats_mutex);
+    if (m_stats_start < 0)
+        m_stats_start = now;
+    else if (now - m_stats_start >= STATS_INTERVAL)
+        logStatistics(now);
+    pthread_mutex_unlock(&m_stats_mutex);
+}
+
+//-----------------------------------------------------------------------------
+
+/** \brief Counts a message for the statistics.
+ *  \param data : The message, the first byte is the protocol type.
+ */
+void NetworkManager::addSentMessage(const NetworkString& data)
+{
+    if (data.size() == 0)
+        return;
+    pthread_mutex_lock(&m_stats_mutex);
+    m_sent_messages[data[0]]++;
+    m_sent_message_bytes[data[0]] += data.size();
+    pthread_mutex_unlock(&m_stats_mutex);
+}
+
+//-----------------------------------------------------------------------------
+
+/** \brief Counts a packet, i.e. a batch of messages, for the statistics.
+ *  \param size : Size of the packet without the ENet headers.
+ */
+void NetworkManager::addSentPacket(int size)
+{
+    pthread_mutex_lock(&m_stats_mutex);
+    m_sent_packets++;
+    m_sent_packet_bytes += size;
+    pthread_mutex_unlock(&m_stats_mutex);
+}
+
+//-----------------------------------------------------------------------------
+
+/** \brief Logs the messages and bytes per second sent for each protocol
+ *  type and the packets they were sent in, and resets the statistics. The
+ *  statistics mutex must be locked.
+ *  \param now : The current time.
+ */
+void NetworkManager::logStatistics(double now)
+{
+    const double dt = now - m_stats_start;
+    if (m_sent_packets > 0)
+    {
+        Log::info("NetworkManager", "Sent %.1f packets/s, %.1f bytes/s.",
+                  m_sent_packets/dt, m_sent_packet_bytes/dt);
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            if (m_sent_messages[i] == 0)
+                continue;
+            Log::info("NetworkManager", "  Protocol %u: %.1f messages/s, "
+                      "%.1f bytes/s.", i, m_sent_messages[i]/dt,
+                      m_sent_message_bytes[i]/dt);
+        }
+    }
+    memset(m_sent_messages, 0, sizeof(m_sent_messages));
+    memset(m_sent_message_bytes, 0, sizeof(m_sent_message_bytes));
+    m_sent_packets = 0;
+    m_sent_packet_bytes = 0;
+    m_stats_start = now;
 }
 
 //-----------------------------------------------------------------------------
@@ -174,12 +276,14 @@ void NetworkManager::disconnected()
     m_game_setup = NULL;
 
     // remove all peers
+    pthread_mutex_lock(&m_peers_mutex);
     for (unsigned int i = 0; i < m_peers.size(); i++)
     {
         delete m_peers[i];
         m_peers[i] = NULL;
     }
     m_peers.clear();
+    pthread_mutex_unlock(&m_peers_mutex);
 }
 
 //-----------------------------------------------------------------------------
@@ -209,6 +313,7 @@ void NetworkManager::removePeer(STKPeer* peer)
                peer->getAddress()&0xff,
                peer->getPort());
     // remove the peer:
+    pthread_mutex_lock(&m_peers_mutex);
     bool removed = false;
     for (unsigned int i = 0; i < m_peers.size(); i++)
     {
@@ -228,6 +333,29 @@ void NetworkManager::removePeer(STKPeer* peer)
         Log::warn("NetworkManager", "The peer that has been disconnected was not registered by the Network Manager.");
 
     Log::info("NetworkManager", "Somebody is now disconnected. There are now %lu peers.", m_peers.size());
+    pthread_mutex_unlock(&m_peers_mutex);
+}
+
+//-----------------------------------------------------------------------------
+
+/** \brief Returns a copy of the list of peers.
+ */
+std::vector<STKPeer*> NetworkManager::getPeers()
+{
+    pthread_mutex_lock(&m_peers_mutex);
+    std::vector<STKPeer*> peers = m_peers;
+    pthread_mutex_unlock(&m_peers_mutex);
+    return peers;
+}
+
+//-----------------------------------------------------------------------------
+
+unsigned int NetworkManager::getPeerCount()
+{
+    pthread_mutex_lock(&m_peers_mutex);
+    unsigned int count = m_peers.size();
+    pthread_mutex_unlock(&m_peers_mutex);
+    return count;
 }
 
 //-----------------------------------------------------------------------------
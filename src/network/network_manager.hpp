@@ -83,6 +83,9 @@ class NetworkManager : public Singleton<NetworkManager>
         virtual void sendPacketExcept(STKPeer* peer, 
                                 const NetworkString& data, 
                                 bool reliable = true);
+        void flushPackets();
+        void addSentMessage(const NetworkString& data);
+        void addSentPacket(int size);
 
         // Game related functions
         virtual GameSetup* setupNewGame(); //!< Creates a new game setup and returns it
@@ -101,8 +104,8 @@ class NetworkManager : public Singleton<NetworkManager>
         inline bool isClient()              { return !isServer();       }
         bool isPlayingOnline()              { return m_playing_online;  }
         STKHost* getHost()                  { return m_localhost;       }
-        std::vector<STKPeer*> getPeers()    { return m_peers;           }
-        unsigned int getPeerCount()         { return m_peers.size();    }
+        std::vector<STKPeer*> getPeers();
+        unsigned int getPeerCount();
         TransportAddress getPublicAddress() { return m_public_address;  }
         GameSetup* getGameSetup()           { return m_game_setup;      }
 
@@ -112,12 +115,27 @@ class NetworkManager : public Singleton<NetworkManager>
 
         // protected members
         std::vector<STKPeer*> m_peers;
+        /** Peers are added and removed by the protocol and listening
+         *  threads, while the main thread flushes their packets. */
+        pthread_mutex_t m_peers_mutex;
         STKHost* m_localhost;
         bool m_playing_online;
         GameSetup* m_game_setup;
 
         TransportAddress m_public_address;
         PlayerLogin m_player_login;
+
+        // statistics of the sent data
+        void logStatistics(double now);
+        /** Messages and bytes sent per protocol type since m_stats_start. */
+        uint32_t m_sent_messages[256];
+        uint32_t m_sent_message_bytes[256];
+        /** Packets (i.e. batches of messages) and bytes sent. */
+        uint32_t m_sent_packets;
+        uint32_t m_sent_packet_bytes;
+        /** Time at which the statistics were last reset. */
+        double m_stats_start;
+        pthread_mutex_t m_stats_mutex;
 };
 
 #endif // NETWORKMANAGER_HPP
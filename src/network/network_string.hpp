@@ -35,6 +35,9 @@ typedef unsigned char uchar;
 /** \class NetworkString
  *  \brief Describes a chain of 8-bit unsigned integers.
  *  This class allows you to easily create and parse 8-bit strings.
+ *  Reading is done through a cursor: removing bytes from the front of the
+ *  string does not move the remaining data, and all get functions are
+ *  relative to that cursor.
  */
 class NetworkString
 {
@@ -47,21 +50,58 @@ class NetworkString
     uint8_t i[8];
     } d_as_i; // double as integer
     public:
-        NetworkString() { }
-        NetworkString(const uint8_t& value) { m_string.push_back(value); }
-        NetworkString(NetworkString const& copy) { m_string = copy.m_string; }
-        NetworkString(const std::string & value) { m_string = std::vector<uint8_t>(value.begin(), value.end()); }
+        NetworkString() : m_current_offset(0) { }
+        NetworkString(const uint8_t& value) : m_current_offset(0) { m_string.push_back(value); }
+        NetworkString(NetworkString const& copy) : m_current_offset(0)
+        {
+            // only the bytes that have not been read yet are copied
+            m_string.assign(copy.m_string.begin()+copy.m_current_offset,
+                            copy.m_string.end());
+        }
+        NetworkString(const std::string & value) : m_current_offset(0) { m_string = std::vector<uint8_t>(value.begin(), value.end()); }
+        NetworkString(const uint8_t* data, int size) : m_current_offset(0)
+        {
+            m_string.assign(data, data+size);
+        }
 
+        NetworkString& operator=(NetworkString const& copy)
+        {
+            if (this == &copy)
+                return *this;
+            m_string.assign(copy.m_string.begin()+copy.m_current_offset,
+                            copy.m_string.end());
+            m_current_offset = 0;
+            return *this;
+        }
+
+        /** Skips the first bytes of the string. This only moves the read
+         *  cursor, so consuming a message field by field is linear in the
+         *  size of the message. */
         NetworkString& removeFront(int size)
         {
-            m_string.erase(m_string.begin(), m_string.begin()+size);
+            assert(size >= 0 && m_current_offset+size <= (int)m_string.size());
+            m_current_offset += size;
             return *this;
         }
         NetworkString& remove(int pos, int size)
         {
-            m_string.erase(m_string.begin()+pos, m_string.begin()+pos+size);
+            if (pos == 0)
+                return removeFront(size);
+            m_string.erase(m_string.begin()+m_current_offset+pos,
+                           m_string.begin()+m_current_offset+pos+size);
+            return *this;
+        }
+
+        /** Empties the string while keeping the allocated memory, so that a
+         *  string can be reused to write the next message. */
+        NetworkString& clear()
+        {
+            m_string.clear();
+            m_current_offset = 0;
             return *this;
         }
+        /** Reserves memory for the given number of bytes to be written. */
+        void reserve(int size) { m_string.reserve(m_current_offset+size); }
 
         uint8_t operator[](const int& pos) const
         {
@@ -142,18 +182,28 @@ class NetworkString
 
         NetworkString& operator+=(NetworkString const& value)
         {
-            m_string.insert( m_string.end(), value.m_string.begin(), value.m_string.end() );
+            m_string.insert( m_string.end(),
+                             value.m_string.begin()+value.m_current_offset,
+                             value.m_string.end() );
             return *this;
         }
 
         const char* c_str() const
         {
-            std::string str(m_string.begin(), m_string.end());
+            std::string str(m_string.begin()+m_current_offset, m_string.end());
             return str.c_str();
         }
+        /** Returns a pointer to the unread bytes of this string, or NULL if
+         *  the string is empty. */
+        const uint8_t* getBytes() const
+        {
+            if (size() == 0)
+                return NULL;
+            return &m_string[m_current_offset];
+        }
         int size() const
         {
-            return m_string.size();
+            return (int)m_string.size() - m_current_offset;
         }
 
         template<typename T, size_t n>
@@ -164,7 +214,7 @@ class NetworkString
             while(a--)
             {
                 result <<= 8; // offset one byte
-                result += ((uint8_t)(m_string[pos+n-1-a]) & 0xff); // add the data to result
+                result += ((uint8_t)(m_string[m_current_offset+pos+n-1-a]) & 0xff); // add the data to result
             }
             return result;
         }
@@ -176,7 +226,7 @@ class NetworkString
         inline uint8_t      getUInt8(int pos = 0)  const { return get<uint8_t,1>(pos);         }
         inline char         getChar(int pos = 0)   const { return get<char,1>(pos);            }
         inline unsigned char getUChar(int pos = 0) const { return get<unsigned char,1>(pos);   }
-        std::string         getString(int pos, int len) const { return std::string(m_string.begin()+pos, m_string.begin()+pos+len); }
+        std::string         getString(int pos, int len) const { return std::string(m_string.begin()+m_current_offset+pos, m_string.begin()+m_current_offset+pos+len); }
 
         inline int          gi(int pos = 0)        const { return get<int,4>(pos);             }
         inline uint32_t     gui(int pos = 0)       const { return get<uint32_t,4>(pos);        }
@@ -185,18 +235,20 @@ class NetworkString
         inline uint8_t      gui8(int pos = 0)      const { return get<uint8_t,1>(pos);         }
         inline char         gc(int pos = 0)        const { return get<char,1>(pos);            }
         inline unsigned char guc(int pos = 0)      const { return get<unsigned char,1>(pos);   }
-        std::string         gs(int pos, int len)   const { return std::string(m_string.begin()+pos, m_string.begin()+pos+len); }
+        std::string         gs(int pos, int len)   const { return getString(pos, len); }
 
-        double getDouble(int pos = 0) //!< BEWARE OF PRECISION
+        double getDouble(int pos = 0) const //!< BEWARE OF PRECISION
         {
+            union { double d; uint8_t i[8]; } d_as_i;
             for (int i = 0; i < 8; i++)
-                d_as_i.i[i] = m_string[pos+i];
+                d_as_i.i[i] = m_string[m_current_offset+pos+i];
             return d_as_i.d;
         }
-        float getFloat(int pos = 0) //!< BEWARE OF PRECISION
+        float getFloat(int pos = 0) const //!< BEWARE OF PRECISION
         {
+            union { float f; uint8_t i[4]; } f_as_i;
             for (int i = 0; i < 4; i++)
-                f_as_i.i[i] = m_string[pos+i];
+                f_as_i.i[i] = m_string[m_current_offset+pos+i];
             return f_as_i.f;
         }
 
@@ -204,13 +256,7 @@ class NetworkString
         template<typename T, size_t n>
         T getAndRemove(int pos)
         {
-            int a = n;
-            T result = 0;
-            while(a--)
-            {
-                result <<= 8; // offset one byte
-                result += ((uint8_t)(m_string[pos+n-1-a]) & 0xff); // add the data
-            }
+            T result = get<T,n>(pos);
             remove(pos,n);
             return result;
         }
@@ -224,17 +270,15 @@ class NetworkString
         inline unsigned char getAndRemoveUChar(int pos = 0)  { return getAndRemove<unsigned char,1>(pos);   }
         double getAndRemoveDouble(int pos = 0) //!< BEWARE OF PRECISION
         {
-            for (int i = 0; i < 8; i++)
-                d_as_i.i[i] = m_string[pos+i];
-            return d_as_i.d;
+            double result = getDouble(pos);
             remove(pos, 8);
+            return result;
         }
         float getAndRemoveFloat(int pos = 0) //!< BEWARE OF PRECISION
         {
-            for (int i = 0; i < 4; i++)
-                f_as_i.i[i] = m_string[pos+i];
-            return f_as_i.f;
+            float result = getFloat(pos);
             remove(pos, 4);
+            return result;
         }
 
         inline NetworkString& gui8(uint8_t* dst)   { *dst = getAndRemoveUInt8(0);  return *this; }
@@ -249,6 +293,9 @@ class NetworkString
 
     protected:
         std::vector<uint8_t> m_string;
+        /** Read cursor: index of the first byte of m_string that has not
+         *  been consumed yet by removeFront() or getAndRemove*(). */
+        int                  m_current_offset;
 };
 
 NetworkString operator+(NetworkString const& a, NetworkString const& b);
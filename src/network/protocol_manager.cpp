@@ -26,7 +26,18 @@
 #include <assert.h>
 #include <cstdlib>
 #include <errno.h>
+#include <string.h>
 #include <typeinfo>
+#ifdef WIN32
+#  include <sys/timeb.h>
+#else
+#  include <sys/time.h>
+#endif
+
+/** Upper limits (in ms) of the buckets of a DispatchLatency histogram, the
+ *  last bucket contains all longer latencies. */
+static const double DISPATCH_LATENCY_LIMITS[DispatchLatency::BUCKET_COUNT-1] =
+    { 1.0, 2.0, 5.0, 10.0, 20.0, 50.0, 100.0 };
 
 void* protocolManagerUpdate(void* data)
 {
@@ -45,7 +56,7 @@ void* protocolManagerAsynchronousUpdate(void* data)
     while(manager && !manager->exit())
     {
         manager->asynchronousUpdate();
-        StkTime::sleep(2);
+        manager->waitForWork();
     }
     manager->m_asynchronous_thread_running = false;
     return NULL;
@@ -59,6 +70,9 @@ ProtocolManager::ProtocolManager()
     pthread_mutex_init(&m_requests_mutex, NULL);
     pthread_mutex_init(&m_id_mutex, NULL);
     pthread_mutex_init(&m_exit_mutex, NULL);
+    pthread_mutex_init(&m_work_mutex, NULL);
+    pthread_cond_init(&m_work_cond, NULL);
+    m_has_work = false;
     m_next_protocol_id = 0;
 
 
@@ -82,7 +96,9 @@ ProtocolManager::~ProtocolManager()
 void ProtocolManager::abort()
 {
     pthread_mutex_unlock(&m_exit_mutex); // will stop the update function
+    signalWork(); // wake up the thread so that it notices
     pthread_join(*m_asynchronous_update_thread, NULL); // wait the thread to finish
+    logDispatchLatencies();
     pthread_mutex_lock(&m_events_mutex);
     pthread_mutex_lock(&m_protocols_mutex);
     pthread_mutex_lock(&m_asynchronous_protocols_mutex);
@@ -107,6 +123,8 @@ void ProtocolManager::abort()
     pthread_mutex_destroy(&m_requests_mutex);
     pthread_mutex_destroy(&m_id_mutex);
     pthread_mutex_destroy(&m_exit_mutex);
+    pthread_mutex_destroy(&m_work_mutex);
+    pthread_cond_destroy(&m_work_cond);
 }
 
 void ProtocolManager::notifyEvent(Event* event)
@@ -150,7 +168,7 @@ void ProtocolManager::notifyEvent(Event* event)
     if (protocols_ids.size() != 0)
     {
         EventProcessingInfo epi;
-        epi.arrival_time = (double)StkTime::getTimeSinceEpoch();
+        epi.arrival_time = StkTime::getRealTime();
         epi.event = event2;
         epi.protocols_ids = protocols_ids;
         m_events_to_process.push_back(epi); // add the event to the queue
@@ -158,11 +176,13 @@ void ProtocolManager::notifyEvent(Event* event)
     else
         Log::warn("ProtocolManager", "Received an event for %d that has no destination protocol.", searchedProtocol);
     pthread_mutex_unlock(&m_events_mutex);
+    signalWork();
 }
 
 void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message, bool reliable)
 {
     NetworkString newMessage;
+    newMessage.reserve(message.size()+1);
     newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
     newMessage += message;
     NetworkManager::getInstance()->sendPacket(newMessage, reliable);
@@ -171,6 +191,7 @@ void ProtocolManager::sendMessage(Protocol* sender, const NetworkString& message
 void ProtocolManager::sendMessage(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable)
 {
     NetworkString newMessage;
+    newMessage.reserve(message.size()+1);
     newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
     newMessage += message;
     NetworkManager::getInstance()->sendPacket(peer, newMessage, reliable);
@@ -178,6 +199,7 @@ void ProtocolManager::sendMessage(Protocol* sender, STKPeer* peer, const Network
 void ProtocolManager::sendMessageExcept(Protocol* sender, STKPeer* peer, const NetworkString& message, bool reliable)
 {
     NetworkString newMessage;
+    newMessage.reserve(message.size()+1);
     newMessage.ai8(sender->getProtocolType()); // add one byte to add protocol type
     newMessage += message;
     NetworkManager::getInstance()->sendPacketExcept(peer, newMessage, reliable);
@@ -197,6 +219,7 @@ uint32_t ProtocolManager::requestStart(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    signalWork();
 
     return info.id;
 }
@@ -213,6 +236,7 @@ void ProtocolManager::requestStop(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    signalWork();
 }
 
 void ProtocolManager::requestPause(Protocol* protocol)
@@ -227,6 +251,7 @@ void ProtocolManager::requestPause(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    signalWork();
 }
 
 void ProtocolManager::requestUnpause(Protocol* protocol)
@@ -241,6 +266,7 @@ void ProtocolManager::requestUnpause(Protocol* protocol)
     pthread_mutex_lock(&m_requests_mutex);
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    signalWork();
 }
 
 void ProtocolManager::requestTerminate(Protocol* protocol)
@@ -264,6 +290,7 @@ void ProtocolManager::requestTerminate(Protocol* protocol)
     }
     m_requests.push_back(req);
     pthread_mutex_unlock(&m_requests_mutex);
+    signalWork();
 }
 
 void ProtocolManager::startProtocol(ProtocolInfo protocol)
@@ -338,12 +365,17 @@ bool ProtocolManager::propagateEvent(EventProcessingInfo* event, bool synchronou
             else
                 result = m_protocols[i].protocol->notifyEventAsynchronous(event->event);
             if (result)
+            {
                 event->protocols_ids.pop_back();
+                addDispatchLatency(m_protocols[i].protocol->getProtocolType(),
+                                   synchronous,
+                                   StkTime::getRealTime()-event->arrival_time);
+            }
             else
                 index++;
         }
     }
-    if (event->protocols_ids.size() == 0 || (StkTime::getTimeSinceEpoch()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
+    if (event->protocols_ids.size() == 0 || (StkTime::getRealTime()-event->arrival_time) >= TIME_TO_KEEP_EVENTS)
     {
         // because we made a copy of the event
         delete event->event->peer; // no more need of that
@@ -377,6 +409,8 @@ void ProtocolManager::update()
             m_protocols[i].protocol->update();
     }
     pthread_mutex_unlock(&m_protocols_mutex);
+    // send all messages of this update together
+    NetworkManager::getInstance()->flushPackets();
 }
 
 void ProtocolManager::asynchronousUpdate()
@@ -431,6 +465,8 @@ void ProtocolManager::asynchronousUpdate()
     }
     m_requests.clear();
     pthread_mutex_unlock(&m_requests_mutex);
+    // send all messages of this update together
+    NetworkManager::getInstance()->flushPackets();
 }
 
 int ProtocolManager::runningProtocolsCount()
@@ -516,6 +552,104 @@ int ProtocolManager::exit()
   return 1;
 }
 
+void ProtocolManager::signalWork()
+{
+    pthread_mutex_lock(&m_work_mutex);
+    m_has_work = true;
+    pthread_cond_signal(&m_work_cond);
+    pthread_mutex_unlock(&m_work_mutex);
+}
+
+void ProtocolManager::waitForWork()
+{
+    // Only this thread modifies the protocols vector, no lock is needed.
+    bool protocols_running = m_protocols.size() > 0;
+    // pthread_cond_timedwait needs an absolute time since the epoch
+#ifdef WIN32
+    struct _timeb now;
+    _ftime(&now);
+    long sec  = (long)now.time;
+    long nsec = now.millitm*1000000L;
+#else
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    long sec  = now.tv_sec;
+    long nsec = now.tv_usec*1000L;
+#endif
+    nsec += ASYNCHRONOUS_UPDATE_MAX_WAIT*1000000L;
+    struct timespec timeout;
+    timeout.tv_sec  = sec + nsec / 1000000000L;
+    timeout.tv_nsec = nsec % 1000000000L;
+
+    pthread_mutex_lock(&m_work_mutex);
+    // The 'while' is necessary because of spurious wakeups
+    while (!m_has_work && !exit())
+    {
+        if (!protocols_running)
+            pthread_cond_wait(&m_work_cond, &m_work_mutex);
+        else if (pthread_cond_timedwait(&m_work_cond, &m_work_mutex,
+                                        &timeout) == ETIMEDOUT)
+            break;
+    }
+    m_has_work = false;
+    pthread_mutex_unlock(&m_work_mutex);
+}
+
+void ProtocolManager::addDispatchLatency(PROTOCOL_TYPE type, bool synchronous,
+                                         double latency)
+{
+    std::map<PROTOCOL_TYPE, DispatchLatency> &all =
+        m_dispatch_latency[synchronous ? 1 : 0];
+    std::map<PROTOCOL_TYPE, DispatchLatency>::iterator it = all.find(type);
+    if (it == all.end())
+    {
+        DispatchLatency empty;
+        memset(&empty, 0, sizeof(empty));
+        it = all.insert(std::make_pair(type, empty)).first;
+    }
+    DispatchLatency &histogram = it->second;
+    double ms = latency*1000.0;
+    int bucket = 0;
+    while (bucket < DispatchLatency::BUCKET_COUNT-1 &&
+           ms > DISPATCH_LATENCY_LIMITS[bucket])
+        bucket++;
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.total += latency;
+    if (latency > histogram.max)
+        histogram.max = latency;
+}
+
+void ProtocolManager::logDispatchLatencies()
+{
+    for (unsigned int mode = 0; mode < 2; mode++)
+    {
+        std::map<PROTOCOL_TYPE, DispatchLatency>::iterator it;
+        for (it = m_dispatch_latency[mode].begin();
+             it != m_dispatch_latency[mode].end(); it++)
+        {
+            const DispatchLatency &h = it->second;
+            Log::info("ProtocolManager", "%s dispatch latency for protocol "
+                      "type %d: %u events, average %.3f ms, max %.3f ms",
+                      mode == 0 ? "Asynchronous" : "Synchronous", it->first,
+                      h.count, h.total*1000.0/h.count, h.max*1000.0);
+            std::string buckets;
+            for (int i = 0; i < DispatchLatency::BUCKET_COUNT; i++)
+            {
+                char s[64];
+                if (i < DispatchLatency::BUCKET_COUNT-1)
+                    sprintf(s, " <=%.1fms:%u", DISPATCH_LATENCY_LIMITS[i],
+                            h.buckets[i]);
+                else
+                    sprintf(s, " >%.1fms:%u", DISPATCH_LATENCY_LIMITS[i-1],
+                            h.buckets[i]);
+                buckets += s;
+            }
+            Log::info("ProtocolManager", "   %s", buckets.c_str());
+        }
+    }
+}
+
 void ProtocolManager::assignProtocolId(ProtocolInfo* protocol_info)
 {
     pthread_mutex_lock(&m_id_mutex);
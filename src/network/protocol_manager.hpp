@@ -29,9 +29,13 @@
 #include "network/protocol.hpp"
 #include "utils/types.hpp"
 
+#include <map>
 #include <vector>
 
 #define TIME_TO_KEEP_EVENTS 1.0
+/** Maximum time (in ms) the asynchronous thread sleeps when there is no new
+ *  event or request, so that running protocols are still updated. */
+#define ASYNCHRONOUS_UPDATE_MAX_WAIT 10
 
 /*!
  * \enum PROTOCOL_STATE
@@ -86,10 +90,24 @@ typedef struct ProtocolRequest
 typedef struct EventProcessingInfo
 {
     Event* event;
-    double arrival_time;
+    double arrival_time; //!< Real time (StkTime::getRealTime) of arrival.
     std::vector<unsigned int> protocols_ids;
 } EventProcessingInfo;
 
+/*! \struct DispatchLatency
+ *  \brief Histogram of the time events waited before being processed by a
+ *  protocol.
+ */
+typedef struct DispatchLatency
+{
+    /*! Number of buckets, the upper limits are in DISPATCH_LATENCY_LIMITS. */
+    static const int BUCKET_COUNT = 8;
+    uint32_t buckets[BUCKET_COUNT]; //!< Number of events in each bucket.
+    uint32_t count;                 //!< Total number of events.
+    double   total;                 //!< Sum of all latencies, in seconds.
+    double   max;                   //!< Largest latency, in seconds.
+} DispatchLatency;
+
 /*!
  * \class ProtocolManager
  * \brief Manages the protocols at runtime.
@@ -234,6 +252,10 @@ class ProtocolManager : public Singleton<ProtocolManager>
         /*! \brief Tells if we need to stop the update thread. */
         int                     exit();
 
+        /*! \brief Prints the event dispatch latency histograms of all
+         *  protocol types to the log. */
+        void                    logDispatchLatencies();
+
     protected:
         // protected functions
         /*!
@@ -286,6 +308,28 @@ class ProtocolManager : public Singleton<ProtocolManager>
 
         bool                    propagateEvent(EventProcessingInfo* event, bool synchronous);
 
+        /*!
+         * \brief Wakes up the asynchronous update thread.
+         * Called whenever an event or a request is added.
+         */
+        void                    signalWork();
+        /*!
+         * \brief Blocks the asynchronous update thread until there is work.
+         * Returns as soon as an event or request is added. If protocols are
+         * running, it also returns after ASYNCHRONOUS_UPDATE_MAX_WAIT ms so
+         * that they are updated regularly.
+         */
+        void                    waitForWork();
+        /*!
+         * \brief Adds the time an event waited before being processed.
+         * \param type : The type of protocol that processed the event.
+         * \param synchronous : True if processed in the main thread.
+         * \param latency : Time the event waited, in seconds.
+         */
+        void                    addDispatchLatency(PROTOCOL_TYPE type,
+                                                   bool synchronous,
+                                                   double latency);
+
         // protected members
         /*!
          * \brief Contains the running protocols.
@@ -321,6 +365,17 @@ class ProtocolManager : public Singleton<ProtocolManager>
         pthread_mutex_t                 m_id_mutex;
         /*! Used when need to quit.*/
         pthread_mutex_t                 m_exit_mutex;
+        /*! Protects m_has_work and is used with m_work_cond. */
+        pthread_mutex_t                 m_work_mutex;
+        /*! Signaled when an event or a request is added. */
+        pthread_cond_t                  m_work_cond;
+        /*! True if work was added since the thread last woke up. */
+        bool                            m_has_work;
+
+        /*! Event dispatch latencies per protocol type, index 0 for the
+         *  asynchronous thread and 1 for the main thread. Each map is only
+         *  accessed by its own thread. */
+        std::map<PROTOCOL_TYPE, DispatchLatency> m_dispatch_latency[2];
 
         /*! Update thread.*/
         pthread_t* m_update_thread;
@@ -5,18 +5,37 @@
 #include "network/network_manager.hpp"
 #include "network/network_world.hpp"
 #include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+/** Time after which the ticks that were not acknowledged (or on the server,
+ *  the relayed ticks) are sent again if no new input happened. */
+static const double RESEND_INTERVAL = 0.05;
+/** The server stops repeating a relayed tick after this time. */
+static const double MAX_RELAY_AGE   = 0.3;
+/** Time between two logs of the input statistics on the server. */
+static const double STATS_INTERVAL  = 10.0;
 
 //-----------------------------------------------------------------------------
 
 ControllerEventsProtocol::ControllerEventsProtocol() :
         Protocol(NULL, PROTOCOL_CONTROLLER_EVENTS)
 {
+    m_next_tick       = 0;
+    m_round_trip      = 0;
+    m_last_stats_time = StkTime::getRealTime();
+    pthread_mutex_init(&m_streams_mutex, NULL);
 }
 
 //-----------------------------------------------------------------------------
 
 ControllerEventsProtocol::~ControllerEventsProtocol()
 {
+    if (m_listener->isServer())
+        printStats();
+    pthread_mutex_destroy(&m_streams_mutex);
 }
 
 //-----------------------------------------------------------------------------
@@ -57,85 +76,349 @@ void ControllerEventsProtocol::setup()
         }
         m_controllers.push_back(std::pair<Controller*, STKPeer*>(karts[i]->getController(), peer));
     }
+
+    InputStream stream;
+    stream.m_has_new       = false;
+    stream.m_last_send     = 0;
+    stream.m_ack_pending   = false;
+    stream.m_has_received  = false;
+    stream.m_last_received = 0;
+    stream.m_measured      = false;
+    memset(&stream.m_stats, 0, sizeof(stream.m_stats));
+    m_streams.resize(m_controllers.size(), stream);
 }
 
 //-----------------------------------------------------------------------------
 
+/** Message layout:
+ *  - uint32 token of the receiver
+ *  - uint8  message type
+ *  - uint8  controller index
+ *  For MSG_ACK:
+ *  - uint16 newest tick received from this controller
+ *  For MSG_INPUT:
+ *  - uint16 round trip time of the sender in ms (0 if unknown)
+ *  - uint8  number of ticks, followed by the ticks, oldest first:
+ *    - uint16 tick id
+ *    - uint16 time since the tick was created on the sender, in ms
+ *    - uint8  number of actions, followed by the actions:
+ *      - uint8 serialized kart controls, uint8 action, uint32 value
+ *  Input messages are sent unreliably. Each repeats the last ticks that
+ *  were not acknowledged, so a lost message does not delay later inputs,
+ *  and the receiver drops the ticks it already applied.
+ */
 bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 {
-    NetworkString data = event->data();
-    if (data.size() < 17)
+    if (event->type != EVENT_TYPE_MESSAGE)
+        return true;
+    const NetworkString &ns = event->data();
+    if (ns.size() < 8)
     {
-        Log::error("ControllerEventsProtocol", "The data supplied was not complete. Size was %d.", data.size());
+        Log::error("ControllerEventsProtocol", "The data supplied was not complete. Size was %d.", ns.size());
         return true;
     }
-    uint32_t token = data.gui32();
-    NetworkString pure_message = data;
-    pure_message.removeFront(4);
+    uint32_t token = ns.getUInt32(0);
     if (token != (*event->peer)->getClientServerToken())
     {
         Log::error("ControllerEventsProtocol", "Bad token from peer.");
         return true;
     }
-    NetworkString ns = pure_message;
+    uint8_t type = ns.getUInt8(4);
+    uint8_t controller_index = ns.getUInt8(5);
+    if (controller_index >= m_controllers.size())
+    {
+        Log::warn("ControllerEventsProtocol", "Unknown controller %d.", controller_index);
+        return true;
+    }
 
-    ns.removeFront(4);
-    uint8_t client_index = -1;
-    while (ns.size() >= 9)
+    double now = StkTime::getRealTime();
+    if (type == MSG_ACK)
     {
-        uint8_t controller_index = ns.gui8();
-        client_index = controller_index;
-        uint8_t serialized_1 = ns.gui8(1);
-        PlayerAction action  = (PlayerAction)(ns.gui8(4));
-        int action_value = ns.gui32(5);
-
-        KartControl* controls   = m_controllers[controller_index].first->getControls();
-        controls->m_brake       = (serialized_1 & 0x40)!=0;
-        controls->m_nitro       = (serialized_1 & 0x20)!=0;
-        controls->m_rescue      = (serialized_1 & 0x10)!=0;
-        controls->m_fire        = (serialized_1 & 0x08)!=0;
-        controls->m_look_back   = (serialized_1 & 0x04)!=0;
-        controls->m_skid        = KartControl::SkidControl(serialized_1 & 0x03);
-
-        m_controllers[controller_index].first->action(action, action_value);
-        ns.removeFront(9);
-        //Log::info("ControllerEventProtocol", "Registered one action.");
+        if (!m_listener->isServer())
+            receivedAck(controller_index, ns.getUInt16(6), now);
     }
-    if (ns.size() > 0 && ns.size() != 9)
+    else if (type == MSG_INPUT)
     {
-        Log::warn("ControllerEventProtocol", "The data seems corrupted. Remains %d", ns.size());
-        return true;
+        if (ns.size() < 9)
+        {
+            Log::warn("ControllerEventsProtocol", "Input message too short.");
+            return true;
+        }
+        readInput(ns, controller_index, now);
     }
-    if (client_index < 0)
+    else
+        Log::warn("ControllerEventsProtocol", "Unknown message type %d.", type);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+/** Applies the ticks of an input message that were not received before. On
+ *  the server they are also queued to be relayed to the other clients.
+ */
+void ControllerEventsProtocol::readInput(const NetworkString &ns,
+                                         unsigned int controller, double now)
+{
+    float round_trip = ns.getUInt16(6) / 1000.0f;
+    unsigned int count = ns.getUInt8(8);
+    int offset = 9;
+
+    pthread_mutex_lock(&m_streams_mutex);
+    InputStream &stream = m_streams[controller];
+    for (unsigned int i = 0; i < count; i++)
     {
-        Log::warn("ControllerEventProtocol", "Couldn't have a client id.");
-        return true;
+        if (ns.size() < offset + 5)
+            break;
+        uint16_t id          = ns.getUInt16(offset);
+        float    age         = ns.getUInt16(offset+2) / 1000.0f;
+        unsigned int actions = ns.getUInt8(offset+4);
+        offset += 5;
+        if (ns.size() < offset + 6 * (int)actions)
+            break;
+
+        if (stream.m_has_received &&
+            (int16_t)(id - stream.m_last_received) <= 0)
+        {
+            stream.m_stats.m_duplicates++;
+            offset += 6 * actions;
+            continue;
+        }
+        if (stream.m_has_received)
+            stream.m_stats.m_lost += (uint16_t)(id - stream.m_last_received) - 1;
+        stream.m_has_received  = true;
+        stream.m_last_received = id;
+        // Half the round trip as estimate of the transmission time, plus
+        // the time the tick waited for a message that was not lost.
+        float latency = age + round_trip * 0.5f;
+        stream.m_stats.m_received++;
+        stream.m_stats.m_total_latency += latency;
+        stream.m_stats.m_max_latency = std::max(stream.m_stats.m_max_latency,
+                                                latency);
+
+        InputTick tick;
+        tick.m_id         = id;
+        tick.m_first_sent = now;
+        tick.m_actions.resize(actions);
+        for (unsigned int j = 0; j < actions; j++)
+        {
+            InputAction &action = tick.m_actions[j];
+            action.m_controls = ns.getUInt8(offset);
+            action.m_action   = ns.getUInt8(offset+1);
+            action.m_value    = (int)ns.getUInt32(offset+2);
+            offset += 6;
+
+            uint8_t serialized_1  = action.m_controls;
+            KartControl* controls = m_controllers[controller].first->getControls();
+            controls->m_brake     = (serialized_1 & 0x40)!=0;
+            controls->m_nitro     = (serialized_1 & 0x20)!=0;
+            controls->m_rescue    = (serialized_1 & 0x10)!=0;
+            controls->m_fire      = (serialized_1 & 0x08)!=0;
+            controls->m_look_back = (serialized_1 & 0x04)!=0;
+            controls->m_skid      = KartControl::SkidControl(serialized_1 & 0x03);
+            m_controllers[controller].first->action((PlayerAction)action.m_action,
+                                                    action.m_value);
+        }
+
+        if (m_listener->isServer())
+        {
+            stream.m_ticks.push_back(tick);
+            if (stream.m_ticks.size() > MAX_REDUNDANT_TICKS)
+                stream.m_ticks.pop_front();
+            stream.m_has_new     = true;
+            stream.m_ack_pending = true;
+        }
     }
-    if (m_listener->isServer())
+    if (m_listener->isServer() && count > 0 && !stream.m_has_new)
     {
-        // notify everybody of the event :
-        for (unsigned int i = 0; i < m_controllers.size(); i++)
+        // Only old ticks, the acknowledgement was probably lost
+        stream.m_ack_pending = true;
+    }
+    pthread_mutex_unlock(&m_streams_mutex);
+    if (offset != ns.size())
+        Log::warn("ControllerEventsProtocol", "The data seems corrupted. Remains %d", ns.size() - offset);
+}
+
+//-----------------------------------------------------------------------------
+/** Called on a client when the server acknowledged the ticks up to 'ack'.
+ *  They are not repeated anymore.
+ */
+void ControllerEventsProtocol::receivedAck(unsigned int controller,
+                                           uint16_t ack, double now)
+{
+    if (controller != m_self_controller_index)
+        return;
+    pthread_mutex_lock(&m_streams_mutex);
+    InputStream &stream = m_streams[controller];
+    while (!stream.m_ticks.empty() &&
+           (int16_t)(stream.m_ticks.front().m_id - ack) <= 0)
+    {
+        const InputTick &tick = stream.m_ticks.front();
+        if (tick.m_id == ack && !stream.m_measured)
         {
-            if (i == client_index) // don't send that message to the sender
-                continue;
-            NetworkString ns2;
-            ns2.ai32(m_controllers[i].second->getClientServerToken());
-            ns2 += pure_message;
-            m_listener->sendMessage(this, m_controllers[i].second, ns2, false);
-            //Log::info("ControllerEventsProtocol", "Sizes are %d and %d", ns2.size(), pure_message.size());
+            float sample = (float)(now - tick.m_first_sent);
+            m_round_trip = m_round_trip > 0 ? m_round_trip*0.9f + sample*0.1f
+                                            : sample;
+            stream.m_measured = true;
+        }
+        stream.m_ticks.pop_front();
+    }
+    pthread_mutex_unlock(&m_streams_mutex);
+}
+
+//-----------------------------------------------------------------------------
+/** Writes an input message with all ticks of a controller's stream. The
+ *  mutex must be locked.
+ */
+void ControllerEventsProtocol::writeInput(unsigned int controller,
+                                          uint32_t token, double now,
+                                          NetworkString *ns) const
+{
+    const InputStream &stream = m_streams[controller];
+    ns->clear();
+    ns->ai32(token).ai8(MSG_INPUT).ai8((uint8_t)controller);
+    ns->ai16((uint16_t)std::min(m_round_trip*1000.0f, 65535.0f));
+    ns->ai8((uint8_t)stream.m_ticks.size());
+    for (unsigned int i = 0; i < stream.m_ticks.size(); i++)
+    {
+        const InputTick &tick = stream.m_ticks[i];
+        double age = std::min((now - tick.m_first_sent)*1000.0, 65535.0);
+        unsigned int actions = std::min((int)tick.m_actions.size(), 255);
+        ns->ai16(tick.m_id).ai16((uint16_t)age).ai8((uint8_t)actions);
+        for (unsigned int j = 0; j < actions; j++)
+        {
+            const InputAction &action = tick.m_actions[j];
+            ns->ai8(action.m_controls).ai8(action.m_action);
+            ns->ai32((uint32_t)action.m_value);
         }
     }
-    return true;
 }
 
 //-----------------------------------------------------------------------------
 
 void ControllerEventsProtocol::update()
 {
+    if (m_streams.empty())
+        return;
+    double now = StkTime::getRealTime();
+    std::vector<std::pair<STKPeer*, NetworkString> > messages;
+
+    pthread_mutex_lock(&m_streams_mutex);
+    if (!m_listener->isServer())
+    {
+        // All actions of this frame are sent as one tick
+        InputStream &stream = m_streams[m_self_controller_index];
+        if (!m_pending_actions.empty())
+        {
+            InputTick tick;
+            tick.m_id         = m_next_tick++;
+            tick.m_first_sent = now;
+            tick.m_actions.swap(m_pending_actions);
+            stream.m_ticks.push_back(tick);
+            if (stream.m_ticks.size() > MAX_REDUNDANT_TICKS)
+                stream.m_ticks.pop_front();
+            stream.m_has_new  = true;
+            stream.m_measured = false;
+        }
+        STKPeer *server = m_controllers[m_self_controller_index].second;
+        if (server && !stream.m_ticks.empty() &&
+            (stream.m_has_new || now > stream.m_last_send + RESEND_INTERVAL))
+        {
+            messages.push_back(std::make_pair(server, NetworkString()));
+            writeInput(m_self_controller_index,
+                       server->getClientServerToken(), now,
+                       &messages.back().second);
+            stream.m_has_new   = false;
+            stream.m_last_send = now;
+        }
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_streams.size(); i++)
+        {
+            InputStream &stream = m_streams[i];
+            STKPeer *sender = m_controllers[i].second;
+            if (stream.m_ack_pending && sender)
+            {
+                NetworkString ack;
+                ack.ai32(sender->getClientServerToken()).ai8(MSG_ACK);
+                ack.ai8((uint8_t)i).ai16(stream.m_last_received);
+                messages.push_back(std::make_pair(sender, ack));
+                stream.m_ack_pending = false;
+            }
+
+            while (!stream.m_ticks.empty() &&
+                   now > stream.m_ticks.front().m_first_sent + MAX_RELAY_AGE)
+                stream.m_ticks.pop_front();
+            if (stream.m_ticks.empty() ||
+                (!stream.m_has_new &&
+                 now <= stream.m_last_send + RESEND_INTERVAL))
+                continue;
+            // Relay the ticks to everybody but the sender
+            for (unsigned int j = 0; j < m_controllers.size(); j++)
+            {
+                STKPeer *peer = m_controllers[j].second;
+                if (j == i || !peer || peer == sender)
+                    continue;
+                messages.push_back(std::make_pair(peer, NetworkString()));
+                writeInput(i, peer->getClientServerToken(), now,
+                           &messages.back().second);
+            }
+            stream.m_has_new   = false;
+            stream.m_last_send = now;
+        }
+    }
+    pthread_mutex_unlock(&m_streams_mutex);
+
+    for (unsigned int i = 0; i < messages.size(); i++)
+        m_listener->sendMessage(this, messages[i].first, messages[i].second,
+                                false);
+
+    if (m_listener->isServer() && now > m_last_stats_time + STATS_INTERVAL)
+    {
+        m_last_stats_time = now;
+        printStats();
+    }
 }
 
 //-----------------------------------------------------------------------------
+/** Returns the statistics of the inputs received for a controller. */
+ControllerEventsProtocol::InputStats
+    ControllerEventsProtocol::getInputStats(unsigned int controller)
+{
+    pthread_mutex_lock(&m_streams_mutex);
+    InputStats stats = m_streams[controller].m_stats;
+    pthread_mutex_unlock(&m_streams_mutex);
+    return stats;
+}
 
+//-----------------------------------------------------------------------------
+/** Logs the input latency and loss of each client. */
+void ControllerEventsProtocol::printStats()
+{
+    pthread_mutex_lock(&m_streams_mutex);
+    for (unsigned int i = 0; i < m_streams.size(); i++)
+    {
+        const InputStats &stats = m_streams[i].m_stats;
+        if (stats.m_received == 0)
+            continue;
+        STKPeer *peer = m_controllers[i].second;
+        const char *name = peer && peer->getPlayerProfile()
+                         ? peer->getPlayerProfile()->kart_name.c_str() : "?";
+        unsigned int sent = stats.m_received + stats.m_lost;
+        Log::info("ControllerEventsProtocol", "Input of controller %d (%s): "
+                  "%d ticks, %d lost (%.1f%%), %d duplicates, latency "
+                  "%.0f ms average, %.0f ms max.", i, name, stats.m_received,
+                  stats.m_lost, 100.0f * stats.m_lost / sent,
+                  stats.m_duplicates,
+                  1000.0f * stats.m_total_latency / stats.m_received,
+                  1000.0f * stats.m_max_latency);
+    }
+    pthread_mutex_unlock(&m_streams_mutex);
+}
+
+//-----------------------------------------------------------------------------
+/** Called on a client when the local player does an action. The actions are
+ *  sent together with the next update.
+ */
 void ControllerEventsProtocol::controllerAction(Controller* controller,
         PlayerAction action, int value)
 {
@@ -154,18 +437,14 @@ void ControllerEventsProtocol::controllerAction(Controller* controller,
     serialized_1 |= (controls->m_look_back==true);
     serialized_1 <<= 2;
     serialized_1 += controls->m_skid;
-    uint8_t serialized_2 = (uint8_t)(controls->m_accel*255.0);
-    uint8_t serialized_3 = (uint8_t)(controls->m_steer*127.0);
-
-    NetworkString ns;
-    ns.ai32(m_controllers[m_self_controller_index].second->getClientServerToken());
-    ns.af(World::getWorld()->getTime());
-    ns.ai8(m_self_controller_index);
-    ns.ai8(serialized_1).ai8(serialized_2).ai8(serialized_3);
-    ns.ai8((uint8_t)(action)).ai32(value);
-
-    Log::info("ControllerEventsProtocol", "Action %d value %d", action, value);
-    m_listener->sendMessage(this, ns, false); // send message to server
-}
 
+    InputAction input;
+    input.m_controls = serialized_1;
+    input.m_action   = (uint8_t)action;
+    input.m_value    = value;
+    pthread_mutex_lock(&m_streams_mutex);
+    m_pending_actions.push_back(input);
+    pthread_mutex_unlock(&m_streams_mutex);
 
+    Log::verbose("ControllerEventsProtocol", "Action %d value %d", action, value);
+}
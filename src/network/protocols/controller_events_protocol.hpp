@@ -6,12 +6,94 @@
 #include "input/input.hpp"
 #include "karts/controller/controller.hpp"
 
+#include <deque>
+
 class ControllerEventsProtocol : public Protocol
 {
+    public:
+        /** Statistics about the inputs received for one controller. */
+        struct InputStats
+        {
+            /** Number of ticks received and applied. */
+            unsigned int m_received;
+            /** Number of ticks that never arrived, not even redundantly. */
+            unsigned int m_lost;
+            /** Number of redundant copies of ticks that were dropped. */
+            unsigned int m_duplicates;
+            /** Sum and maximum of the estimated time (in seconds) between
+             *  an input on the sender and its arrival. */
+            float        m_total_latency;
+            float        m_max_latency;
+        };
+
     protected:
+        /** Maximum number of ticks repeated in each input message. */
+        static const unsigned int MAX_REDUNDANT_TICKS = 8;
+
+        enum MessageType { MSG_INPUT = 1, MSG_ACK = 2 };
+
+        /** One action of a player, with the kart controls at that time. */
+        struct InputAction
+        {
+            uint8_t m_controls;
+            uint8_t m_action;
+            int     m_value;
+        };
+
+        /** All actions of a controller during one frame of the sender. */
+        struct InputTick
+        {
+            /** Number of the tick, increasing by one for each tick sent. */
+            uint16_t                 m_id;
+            /** Real time at which the tick was created or received. */
+            double                   m_first_sent;
+            std::vector<InputAction> m_actions;
+        };
+
+        /** The input stream of one controller. A client sends the ticks of
+         *  its own controller, and the server relays the ticks it received
+         *  from a client to all other clients. */
+        struct InputStream
+        {
+            /** The ticks that are repeated in each message, oldest first. */
+            std::deque<InputTick> m_ticks;
+            /** True if a tick was added since the last message was sent. */
+            bool                  m_has_new;
+            double                m_last_send;
+            /** On the server, true if the client needs to be acknowledged
+             *  the newest received tick. */
+            bool                  m_ack_pending;
+            /** Newest tick received and applied, to drop duplicates. */
+            bool                  m_has_received;
+            uint16_t              m_last_received;
+            /** True once the round trip time of the newest tick was
+             *  measured (clients only). */
+            bool                  m_measured;
+            InputStats            m_stats;
+        };
+
         std::vector<std::pair<Controller*, STKPeer*> > m_controllers;
         uint32_t m_self_controller_index;
 
+        /** The input stream of each controller. */
+        std::vector<InputStream> m_streams;
+        /** Actions of the local player since the last tick was sent. */
+        std::vector<InputAction> m_pending_actions;
+        uint16_t m_next_tick;
+        /** On clients, the smoothed time (in seconds) until a tick is
+         *  acknowledged by the server. */
+        float    m_round_trip;
+        double   m_last_stats_time;
+
+        pthread_mutex_t m_streams_mutex;
+
+        void writeInput(unsigned int controller, uint32_t token, double now,
+                        NetworkString *ns) const;
+        void readInput(const NetworkString &ns, unsigned int controller,
+                       double now);
+        void receivedAck(unsigned int controller, uint16_t ack, double now);
+        void printStats();
+
     public:
         ControllerEventsProtocol();
         virtual ~ControllerEventsProtocol();
@@ -22,6 +104,7 @@ class ControllerEventsProtocol : public Protocol
         virtual void asynchronousUpdate() {}
 
         void controllerAction(Controller* controller, PlayerAction action, int value);
+        InputStats getInputStats(unsigned int controller);
 
 };
 
@@ -2,8 +2,26 @@
 
 #include "karts/abstract_kart.hpp"
 #include "modes/world.hpp"
+#include "network/network_manager.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/network_world.hpp"
+#include "tracks/track.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+/** Time between two kart updates sent, in seconds. */
+static const double SEND_INTERVAL        = 0.1;
+/** Clients show remote karts this much behind the newest received
+ *  snapshot. With two send intervals a single lost snapshot can still be
+ *  interpolated. */
+static const float INTERPOLATION_DELAY   = 0.2f;
+/** Maximum time a kart is extrapolated when no new snapshot arrives. */
+static const float MAX_EXTRAPOLATION     = 0.25f;
+/** If the render time differs more than this from where it should be
+ *  (e.g. after a long freeze), it jumps instead of slowly catching up. */
+static const float MAX_RENDER_TIME_ERROR = 0.5f;
 
 KartUpdateProtocol::KartUpdateProtocol()
     : Protocol(NULL, PROTOCOL_KART_UPDATE)
@@ -22,116 +40,390 @@ KartUpdateProtocol::KartUpdateProtocol()
         }
     }
     pthread_mutex_init(&m_positions_updates_mutex, NULL);
+
+    // All hosts load the same track, so positions can be quantized
+    // relative to its bounding box.
+    const Vec3 *min, *max;
+    World::getWorld()->getTrack()->getAABB(&min, &max);
+    m_coder.setBoundingBox(*min, *max);
+    m_next_sequence          = 0;
+    m_has_received_sequence  = false;
+    m_last_received_sequence = 0;
+    m_snapshot_history.resize(SNAPSHOT_HISTORY_SIZE);
+    m_snapshot_valid.resize(SNAPSHOT_HISTORY_SIZE, false);
+    m_samples.resize(m_karts.size());
+    m_newest_time      = 0;
+    m_has_newest_time  = false;
+    m_render_time      = 0;
+    m_last_update_time = StkTime::getRealTime();
+    m_last_send_time   = 0;
 }
 
 KartUpdateProtocol::~KartUpdateProtocol()
 {
 }
 
+/** Message layout (all versions start with the version byte):
+ *  - uint8  snapshot version (KartSnapshotCoder::SNAPSHOT_VERSION)
+ *  - float  world time
+ *  - uint16 sequence number of this snapshot
+ *  - uint8  flags: 0x01 delta against a base snapshot, 0x02 acknowledge
+ *  - uint16 base sequence number (only if 0x01)
+ *  - uint16 newest snapshot received from the other side (only if 0x02)
+ *  - the karts, as written by KartSnapshotCoder::encode
+ */
 bool KartUpdateProtocol::notifyEventAsynchronous(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
         return true;
-    NetworkString ns = event->data();
-    if (ns.size() < 36)
+    // Read the message in place, the payload is never copied or shifted.
+    const NetworkString &ns = event->data();
+    if (ns.size() < 9)
     {
         Log::info("KartUpdateProtocol", "Message too short.");
         return true;
     }
-    ns.removeFront(4);
-    while(ns.size() >= 16)
-    {
-        uint32_t kart_id = ns.getUInt32(0);
-
-        float a,b,c;
-        a = ns.getFloat(4);
-        b = ns.getFloat(8);
-        c = ns.getFloat(12);
-        float d,e,f,g;
-        d = ns.getFloat(16);
-        e = ns.getFloat(20);
-        f = ns.getFloat(24);
-        g = ns.getFloat(28);
-        pthread_mutex_trylock(&m_positions_updates_mutex);
-        m_next_positions.push_back(Vec3(a,b,c));
-        m_next_quaternions.push_back(btQuaternion(d,e,f,g));
-        m_karts_ids.push_back(kart_id);
+    if (ns.getUInt8(0) != KartSnapshotCoder::SNAPSHOT_VERSION)
+    {
+        Log::warn("KartUpdateProtocol", "Unsupported snapshot version %d.",
+                  ns.getUInt8(0));
+        return true;
+    }
+    float    time     = ns.getFloat(1);
+    uint16_t sequence = ns.getUInt16(5);
+    uint8_t  flags    = ns.getUInt8(7);
+    // Make the time increase during the race, see KartSample
+    if (World::getWorld()->getClockMode() == WorldStatus::CLOCK_COUNTDOWN)
+        time = -time;
+    int offset = 8;
+    const KartSnapshot *base = NULL;
+    if (flags & 0x01)
+    {
+        if (ns.size() < offset + 2)
+            return true;
+        uint16_t base_sequence = ns.getUInt16(offset);
+        offset += 2;
+        base = getSnapshot(base_sequence);
+        if (!base)
+        {
+            Log::verbose("KartUpdateProtocol", "Base snapshot %d unknown, "
+                         "dropping snapshot %d.", base_sequence, sequence);
+            return true;
+        }
+    }
+    if (flags & 0x02)
+    {
+        if (ns.size() < offset + 2)
+            return true;
+        uint16_t ack = ns.getUInt16(offset);
+        offset += 2;
+        if (m_listener->isServer())
+        {
+            STKPeer *peer = *(event->peer);
+            pthread_mutex_lock(&m_positions_updates_mutex);
+            std::map<STKPeer*, uint16_t>::iterator it = m_peer_acks.find(peer);
+            if (it == m_peer_acks.end() || (int16_t)(ack - it->second) > 0)
+                m_peer_acks[peer] = ack;
+            pthread_mutex_unlock(&m_positions_updates_mutex);
+        }
+    }
+
+    KartSnapshot snapshot;
+    snapshot.m_sequence = sequence;
+    if (!m_coder.decode(ns, offset, base, &snapshot))
+    {
+        Log::warn("KartUpdateProtocol", "Corrupted kart snapshot.");
+        return true;
+    }
+    bool in_order;
+    if (!m_listener->isServer())
+    {
+        // Keep the snapshot so that the server can send deltas against it
+        storeSnapshot(snapshot);
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        in_order = !m_has_received_sequence ||
+                   (int16_t)(sequence - m_last_received_sequence) > 0;
+        if (in_order)
+        {
+            m_last_received_sequence = sequence;
+            m_has_received_sequence  = true;
+        }
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+    }
+    else
+    {
+        STKPeer *peer = *(event->peer);
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        std::map<STKPeer*, uint16_t>::iterator it = m_peer_sequences.find(peer);
+        in_order = it == m_peer_sequences.end() ||
+                   (int16_t)(sequence - it->second) > 0;
+        if (in_order)
+            m_peer_sequences[peer] = sequence;
         pthread_mutex_unlock(&m_positions_updates_mutex);
-        ns.removeFront(32);
     }
+    if (!in_order)
+    {
+        Log::verbose("KartUpdateProtocol", "Dropping snapshot %d, which "
+                     "arrived out of order.", sequence);
+        return true;
+    }
+
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    for (unsigned int i = 0; i < snapshot.m_karts.size(); i++)
+    {
+        const QuantizedKartState &state = snapshot.m_karts[i];
+        if (state.m_kart_id >= m_karts.size())
+            continue;
+        // A client controls its own kart
+        if (!m_listener->isServer() && state.m_kart_id == m_self_kart_index)
+            continue;
+        Vec3 xyz;
+        btQuaternion rotation;
+        m_coder.dequantize(state, &xyz, &rotation);
+        addSample(state.m_kart_id, time, xyz, rotation);
+    }
+    if (!m_listener->isServer() &&
+        (!m_has_newest_time || time > m_newest_time))
+    {
+        m_newest_time     = time;
+        m_has_newest_time = true;
+    }
+    pthread_mutex_unlock(&m_positions_updates_mutex);
     return true;
 }
 
+/** Adds a received sample of a kart. Samples that are not newer than the
+ *  newest sample of the kart are ignored. The mutex must be locked.
+ *  \param kart_id Index of the kart.
+ *  \param time Time of the sample, see KartSample.
+ */
+void KartUpdateProtocol::addSample(unsigned int kart_id, float time,
+                                   const Vec3 &xyz,
+                                   const btQuaternion &rotation)
+{
+    std::deque<KartSample> &samples = m_samples[kart_id];
+    KartSample sample;
+    sample.m_time     = time;
+    sample.m_xyz      = xyz;
+    sample.m_rotation = rotation;
+    sample.m_velocity = Vec3(0, 0, 0);
+    if (!samples.empty())
+    {
+        const KartSample &previous = samples.back();
+        if (time <= previous.m_time)
+            return;
+        sample.m_velocity = (xyz - previous.m_xyz) / (time - previous.m_time);
+    }
+    samples.push_back(sample);
+    if (samples.size() > MAX_SAMPLES)
+        samples.pop_front();
+}
+
 void KartUpdateProtocol::setup()
 {
 }
 
+/** Fills a snapshot with the quantized state of the karts.
+ *  \param only_self True to only add the kart controlled by this client.
+ */
+void KartUpdateProtocol::createSnapshot(KartSnapshot *snapshot, bool only_self)
+{
+    snapshot->m_sequence = m_next_sequence++;
+    snapshot->m_karts.clear();
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (only_self && i != m_self_kart_index)
+            continue;
+        AbstractKart* kart = m_karts[i];
+        QuantizedKartState state;
+        m_coder.quantize((uint8_t)kart->getWorldKartId(), kart->getXYZ(),
+                         kart->getRotation(), &state);
+        snapshot->m_karts.push_back(state);
+        Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), kart->getXYZ()[0], kart->getXYZ()[1], kart->getXYZ()[2]);
+    }
+}
+
+/** Writes a kart update message.
+ *  \param snapshot The snapshot to send.
+ *  \param peer The server sends a delta against the newest snapshot this
+ *         peer acknowledged. NULL to always send full states.
+ *  \param has_ack, ack Newest snapshot received from the other side.
+ *  \param ns The message to write to.
+ */
+void KartUpdateProtocol::writeMessage(const KartSnapshot &snapshot,
+                                      STKPeer *peer, bool has_ack,
+                                      uint16_t ack, NetworkString *ns)
+{
+    const KartSnapshot *base = NULL;
+    if (peer)
+    {
+        pthread_mutex_lock(&m_positions_updates_mutex);
+        std::map<STKPeer*, uint16_t>::iterator it = m_peer_acks.find(peer);
+        if (it != m_peer_acks.end())
+            base = getSnapshot(it->second);
+        pthread_mutex_unlock(&m_positions_updates_mutex);
+    }
+    uint8_t flags = (base ? 0x01 : 0) | (has_ack ? 0x02 : 0);
+    ns->clear();
+    ns->reserve(12 + 13 * snapshot.m_karts.size());
+    ns->ai8(KartSnapshotCoder::SNAPSHOT_VERSION);
+    ns->af(World::getWorld()->getTime());
+    ns->ai16(snapshot.m_sequence).ai8(flags);
+    if (base)
+        ns->ai16(base->m_sequence);
+    if (has_ack)
+        ns->ai16(ack);
+    m_coder.encode(snapshot, base, ns);
+}
+
+/** Returns the stored snapshot with the given sequence number, or NULL if
+ *  it is not in the history (anymore). */
+const KartSnapshot* KartUpdateProtocol::getSnapshot(uint16_t sequence) const
+{
+    unsigned int index = sequence % SNAPSHOT_HISTORY_SIZE;
+    if (!m_snapshot_valid[index] ||
+        m_snapshot_history[index].m_sequence != sequence)
+        return NULL;
+    return &m_snapshot_history[index];
+}
+
+void KartUpdateProtocol::storeSnapshot(const KartSnapshot &snapshot)
+{
+    unsigned int index = snapshot.m_sequence % SNAPSHOT_HISTORY_SIZE;
+    m_snapshot_history[index] = snapshot;
+    m_snapshot_valid[index]   = true;
+}
+
+/** Moves a kart to the given position and rotation. */
+void KartUpdateProtocol::setKartTransform(unsigned int kart_id,
+                                          const Vec3 &xyz,
+                                          const btQuaternion &rotation)
+{
+    btTransform transform =
+        m_karts[kart_id]->getBody()->getInterpolationWorldTransform();
+    transform.setOrigin(xyz);
+    transform.setRotation(rotation);
+    m_karts[kart_id]->getBody()->setCenterOfMassTransform(transform);
+    Log::verbose("KartUpdateProtocol", "Update kart %i pos to %f %f %f",
+                 kart_id, xyz[0], xyz[1], xyz[2]);
+}
+
+/** Shows a remote kart at the render time on a client: between the two
+ *  samples around the render time, or extrapolated from the newest sample
+ *  if no newer sample was received (yet). The mutex must be locked.
+ *  \param kart_id Index of the kart.
+ */
+void KartUpdateProtocol::interpolateKart(unsigned int kart_id)
+{
+    std::deque<KartSample> &samples = m_samples[kart_id];
+    if (samples.empty())
+        return;
+    // Remove the samples that are not needed anymore, i.e. keep the newest
+    // sample that is older than the render time.
+    while (samples.size() >= 2 && samples[1].m_time <= m_render_time)
+        samples.pop_front();
+
+    const KartSample &a = samples[0];
+    if (m_render_time <= a.m_time)
+    {
+        // All samples are in the future, which only happens at the start
+        setKartTransform(kart_id, a.m_xyz, a.m_rotation);
+    }
+    else if (samples.size() >= 2)
+    {
+        const KartSample &b = samples[1];
+        float f = (m_render_time - a.m_time) / (b.m_time - a.m_time);
+        setKartTransform(kart_id, a.m_xyz + (b.m_xyz - a.m_xyz) * f,
+                         a.m_rotation.slerp(b.m_rotation, f));
+    }
+    else
+    {
+        // A sample is missing or late: continue with the last velocity for
+        // a short time, then stop.
+        float dt = std::min(m_render_time - a.m_time, MAX_EXTRAPOLATION);
+        setKartTransform(kart_id, a.m_xyz + a.m_velocity * dt, a.m_rotation);
+    }
+}
+
+/** Moves the karts of the other hosts. The server uses the newest state
+ *  received from each client. Clients show the karts with a small delay,
+ *  which allows to interpolate between the received snapshots.
+ */
+void KartUpdateProtocol::updateKarts()
+{
+    double now = StkTime::getRealTime();
+    float dt = (float)(now - m_last_update_time);
+    m_last_update_time = now;
+
+    pthread_mutex_lock(&m_positions_updates_mutex);
+    if (m_listener->isServer())
+    {
+        for (unsigned int i = 0; i < m_samples.size(); i++)
+        {
+            if (m_samples[i].empty())
+                continue;
+            const KartSample &sample = m_samples[i].back();
+            setKartTransform(i, sample.m_xyz, sample.m_rotation);
+            // Keep the newest sample to drop older ones arriving later
+            m_samples[i].erase(m_samples[i].begin(), m_samples[i].end()-1);
+        }
+    }
+    else if (m_has_newest_time)
+    {
+        // Advance the render time, and let it slowly catch up with the
+        // received snapshots to compensate for drift and jitter.
+        float target = m_newest_time - INTERPOLATION_DELAY;
+        m_render_time += dt;
+        float error = target - m_render_time;
+        if (fabsf(error) > MAX_RENDER_TIME_ERROR)
+            m_render_time = target;
+        else
+            m_render_time += error * 0.1f;
+
+        for (unsigned int i = 0; i < m_samples.size(); i++)
+        {
+            if (i != m_self_kart_index)
+                interpolateKart(i);
+        }
+    }
+    pthread_mutex_unlock(&m_positions_updates_mutex);
+}
+
 void KartUpdateProtocol::update()
 {
     if (!World::getWorld())
         return;
-    static double time = 0;
     double current_time = StkTime::getRealTime();
-    if (current_time > time + 0.1) // 10 updates per second
+    if (current_time > m_last_send_time + SEND_INTERVAL)
     {
-        time = current_time;
+        m_last_send_time = current_time;
         if (m_listener->isServer())
         {
+            KartSnapshot snapshot;
+            createSnapshot(&snapshot, false);
+            storeSnapshot(snapshot);
+            // Each peer gets a delta against what it has acknowledged
+            std::vector<STKPeer*> peers =
+                NetworkManager::getInstance()->getPeers();
             NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            for (unsigned int i = 0; i < m_karts.size(); i++)
+            for (unsigned int i = 0; i < peers.size(); i++)
             {
-                AbstractKart* kart = m_karts[i];
-                Vec3 v = kart->getXYZ();
-                btQuaternion quat = kart->getRotation();
-                ns.ai32( kart->getWorldKartId());
-                ns.af(v[0]).af(v[1]).af(v[2]); // add position
-                ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-                Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
+                writeMessage(snapshot, peers[i], false, 0, &ns);
+                m_listener->sendMessage(this, peers[i], ns, false);
             }
-            m_listener->sendMessage(this, ns, false);
         }
         else
         {
-            AbstractKart* kart = m_karts[m_self_kart_index];
-            Vec3 v = kart->getXYZ();
-            btQuaternion quat = kart->getRotation();
+            KartSnapshot snapshot;
+            createSnapshot(&snapshot, true);
+            pthread_mutex_lock(&m_positions_updates_mutex);
+            bool has_ack = m_has_received_sequence;
+            uint16_t ack = m_last_received_sequence;
+            pthread_mutex_unlock(&m_positions_updates_mutex);
             NetworkString ns;
-            ns.af( World::getWorld()->getTime());
-            ns.ai32( kart->getWorldKartId());
-            ns.af(v[0]).af(v[1]).af(v[2]); // add position
-            ns.af(quat.x()).af(quat.y()).af(quat.z()).af(quat.w()); // add rotation
-            Log::verbose("KartUpdateProtocol", "Sending %d's positions %f %f %f", kart->getWorldKartId(), v[0], v[1], v[2]);
+            writeMessage(snapshot, NULL, has_ack, ack, &ns);
             m_listener->sendMessage(this, ns, false);
         }
     }
-    switch(pthread_mutex_trylock(&m_positions_updates_mutex))
-    {
-        case 0: /* if we got the lock */
-            while (!m_next_positions.empty())
-            {
-                uint32_t id = m_karts_ids.back();
-                if (id != m_self_kart_index || m_listener->isServer()) // server takes all updates
-                {
-                    Vec3 pos = m_next_positions.back();
-                    btTransform transform = m_karts[id]->getBody()->getInterpolationWorldTransform();
-                    transform.setOrigin(pos);
-                    transform.setRotation(m_next_quaternions.back());
-                    m_karts[id]->getBody()->setCenterOfMassTransform(transform);
-                    //m_karts[id]->getBody()->setLinearVelocity(Vec3(0,0,0));
-                    Log::verbose("KartUpdateProtocol", "Update kart %i pos to %f %f %f", id, pos[0], pos[1], pos[2]);
-                }
-                m_next_positions.pop_back();
-                m_next_quaternions.pop_back();
-                m_karts_ids.pop_back();
-            }
-            pthread_mutex_unlock(&m_positions_updates_mutex);
-            break;
-        default:
-            break;
-    }
+    updateKarts();
 }
-
-
-
-
@@ -2,11 +2,14 @@
 #define KART_UPDATE_PROTOCOL_HPP
 
 #include "network/protocol.hpp"
+#include "network/kart_snapshot.hpp"
 #include "utils/vec3.hpp"
 #include "LinearMath/btQuaternion.h"
-#include <list>
+#include <deque>
+#include <map>
 
 class AbstractKart;
+class STKPeer;
 
 class KartUpdateProtocol : public Protocol
 {
@@ -20,14 +23,68 @@ class KartUpdateProtocol : public Protocol
         virtual void asynchronousUpdate() {};
 
     protected:
+        /** Number of snapshots kept to decode or encode deltas. */
+        static const unsigned int SNAPSHOT_HISTORY_SIZE = 32;
+        /** Maximum number of received samples kept for each kart. */
+        static const unsigned int MAX_SAMPLES = 32;
+
+        /** A received position and rotation of a kart. */
+        struct KartSample
+        {
+            /** World time of the sender when the sample was taken, negated
+             *  for count down clocks, so that it always increases. */
+            float        m_time;
+            Vec3         m_xyz;
+            btQuaternion m_rotation;
+            /** Velocity since the previous sample, used to extrapolate. */
+            Vec3         m_velocity;
+        };
+
+        void createSnapshot(KartSnapshot *snapshot, bool only_self);
+        void writeMessage(const KartSnapshot &snapshot, STKPeer *peer,
+                          bool has_ack, uint16_t ack, NetworkString *ns);
+        const KartSnapshot* getSnapshot(uint16_t sequence) const;
+        void storeSnapshot(const KartSnapshot &snapshot);
+        void addSample(unsigned int kart_id, float time, const Vec3 &xyz,
+                       const btQuaternion &rotation);
+        void updateKarts();
+        void interpolateKart(unsigned int kart_id);
+        void setKartTransform(unsigned int kart_id, const Vec3 &xyz,
+                              const btQuaternion &rotation);
+
         std::vector<AbstractKart*> m_karts;
         uint32_t m_self_kart_index;
 
-        std::list<Vec3> m_next_positions;
-        std::list<btQuaternion> m_next_quaternions;
-        std::list<uint32_t> m_karts_ids;
+        /** The received samples of each kart, oldest first. */
+        std::vector<std::deque<KartSample> > m_samples;
+        /** On clients, the newest sample time received from the server. */
+        float  m_newest_time;
+        bool   m_has_newest_time;
+        /** On clients, the time (in sample time) at which remote karts are
+         *  shown. It follows m_newest_time with a delay, so that karts are
+         *  interpolated between received samples. */
+        float  m_render_time;
+        /** Real time of the last updateKarts and the last message sent. */
+        double m_last_update_time;
+        double m_last_send_time;
+        /** On the server, the newest sequence number received from each
+         *  peer, to drop messages that arrive out of order. */
+        std::map<STKPeer*, uint16_t> m_peer_sequences;
 
         pthread_mutex_t m_positions_updates_mutex;
+
+        KartSnapshotCoder m_coder;
+        /** Sequence number of the next snapshot sent. */
+        uint16_t m_next_sequence;
+        /** On the server, the snapshots sent. On clients, the snapshots
+         *  received. Indexed by sequence number modulo the history size. */
+        std::vector<KartSnapshot> m_snapshot_history;
+        std::vector<bool> m_snapshot_valid;
+        /** On a client, the newest snapshot received from the server. */
+        bool m_has_received_sequence;
+        uint16_t m_last_received_sequence;
+        /** On the server, the newest snapshot acknowledged by each peer. */
+        std::map<STKPeer*, uint16_t> m_peer_acks;
 };
 
 #endif // KART_UPDATE_PROTOCOL_HPP
@@ -6,20 +6,16 @@
 #include "network/protocols/game_events_protocol.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
+
 //-----------------------------------------------------------------------------
 
 SynchronizationProtocol::SynchronizationProtocol() : Protocol(NULL, PROTOCOL_SYNCHRONIZATION)
 {
     unsigned int size = NetworkManager::getInstance()->getPeerCount();
-    m_pings.resize(size, std::map<uint32_t,double>());
-    m_pings_count.resize(size);
-    for (unsigned int i = 0; i < size; i++)
-    {
-        m_pings_count[i] = 0;
-    }
-    m_successed_pings.resize(size);
-    m_total_diff.resize(size);
-    m_average_ping.resize(size);
+    m_clocks.resize(size);
+    pthread_mutex_init(&m_clocks_mutex, NULL);
+    m_last_stats_time = StkTime::getRealTime();
     m_countdown_activated = false;
 }
 
@@ -27,10 +23,15 @@ SynchronizationProtocol::SynchronizationProtocol() : Protocol(NULL, PROTOCOL_SYN
 
 SynchronizationProtocol::~SynchronizationProtocol()
 {
+    pthread_mutex_destroy(&m_clocks_mutex);
 }
 
 //-----------------------------------------------------------------------------
-
+/** A ping request is: uint8 peer id, uint32 token, uint8 1, uint32 sequence
+ *  and on the server optionally the uint32 countdown in ms. The response is:
+ *  uint8 peer id, uint32 token, uint8 0, uint32 sequence and the double
+ *  time of the answering host, used to estimate the clock offset.
+ */
 bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
 {
     if (event->type != EVENT_TYPE_MESSAGE)
@@ -75,12 +76,18 @@ bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
     {
         NetworkString response;
         response.ai8(data.gui8(talk_id)).ai32(token).ai8(0).ai32(sequence);
+        response.ad(StkTime::getRealTime());
         m_listener->sendMessage(this, peers[peer_id], response, false);
         Log::verbose("SynchronizationProtocol", "Answering sequence %u", sequence);
         if (data.size() == 14 && !m_listener->isServer()) // countdown time in the message
         {
             uint32_t time_to_start = data.gui32(10);
             Log::debug("SynchronizationProtocol", "Request to start game in %d.", time_to_start);
+            // The countdown was sent about half a round trip ago
+            pthread_mutex_lock(&m_clocks_mutex);
+            int one_way = (int)(m_clocks[peer_id].getRoundTrip()*500.0);
+            pthread_mutex_unlock(&m_clocks_mutex);
+            time_to_start = std::max((int)time_to_start - one_way, 0);
             if (!m_countdown_activated)
                 startCountdown(time_to_start);
             else
@@ -91,19 +98,24 @@ bool SynchronizationProtocol::notifyEventAsynchronous(Event* event)
     }
     else // response
     {
-        if (sequence >= m_pings[peer_id].size())
+        if (data.size() < 18)
         {
-            Log::warn("SynchronizationProtocol", "The sequence# %u isn't known.", sequence);
+            Log::warn("SynchronizationProtocol", "Response without time.");
             return true;
         }
         double current_time = StkTime::getRealTime();
-        m_total_diff[peer_id] += current_time - m_pings[peer_id][sequence];
-        Log::verbose("SynchronizationProtocol", "InstantPing is %u",
-            (unsigned int)((current_time - m_pings[peer_id][sequence])*1000));
-        m_successed_pings[peer_id]++;
-        m_average_ping[peer_id] = (int)((m_total_diff[peer_id]/m_successed_pings[peer_id])*1000.0);
-
-        Log::debug("SynchronizationProtocol", "Ping is %u", m_average_ping[peer_id]);
+        double remote_time  = data.getDouble(10);
+        pthread_mutex_lock(&m_clocks_mutex);
+        ClockEstimator &clock = m_clocks[peer_id];
+        bool known = clock.pongReceived(sequence, remote_time, current_time);
+        double ping = clock.getRoundTrip();
+        pthread_mutex_unlock(&m_clocks_mutex);
+        if (!known)
+        {
+            Log::warn("SynchronizationProtocol", "The sequence# %u isn't known.", sequence);
+            return true;
+        }
+        Log::debug("SynchronizationProtocol", "Ping is %u", (unsigned int)(ping*1000));
     }
     return true;
 }
@@ -132,6 +144,8 @@ void SynchronizationProtocol::asynchronousUpdate()
         {
             m_has_quit = true;
             Log::info("SynchronizationProtocol", "Countdown finished. Starting now.");
+            if (m_listener->isServer())
+                printStats();
             m_listener->requestStart(new KartUpdateProtocol());
             m_listener->requestStart(new ControllerEventsProtocol());
             m_listener->requestStart(new GameEventsProtocol());
@@ -149,29 +163,73 @@ void SynchronizationProtocol::asynchronousUpdate()
             Log::info("SynchronizationProtocol", "Starting in %d seconds.", seconds);
         }
     }
+    if (m_listener->isServer() && current_time > m_last_stats_time + 5.0)
+    {
+        m_last_stats_time = current_time;
+        printStats();
+    }
     if (current_time > timer+0.1)
     {
         std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
-        for (unsigned int i = 0; i < peers.size(); i++)
+        for (unsigned int i = 0; i < peers.size() && i < m_clocks.size(); i++)
         {
+            pthread_mutex_lock(&m_clocks_mutex);
+            uint32_t sequence = m_clocks[i].pingSent(current_time);
+            pthread_mutex_unlock(&m_clocks_mutex);
             NetworkString ns;
-            ns.ai8(i).addUInt32(peers[i]->getClientServerToken()).addUInt8(1).addUInt32(m_pings[i].size());
+            ns.ai8(i).addUInt32(peers[i]->getClientServerToken()).addUInt8(1).addUInt32(sequence);
             // now add the countdown if necessary
             if (m_countdown_activated && m_listener->isServer())
             {
                 ns.addUInt32((int)(m_countdown*1000.0));
                 Log::debug("SynchronizationProtocol", "CNTActivated: Countdown value : %f", m_countdown);
             }
-            Log::verbose("SynchronizationProtocol", "Added sequence number %u for peer %d", m_pings[i].size(), i);
+            Log::verbose("SynchronizationProtocol", "Added sequence number %u for peer %d", sequence, i);
             timer = current_time;
-            m_pings[i].insert(std::pair<int,double>(m_pings_count[i], timer));
             m_listener->sendMessage(this, peers[i], ns, false);
-            m_pings_count[i]++;
         }
     }
 
 }
 
+//-----------------------------------------------------------------------------
+/** Returns a copy of the round trip and clock offset estimation of a peer,
+ *  e.g. to align the start of the race on all hosts.
+ */
+ClockEstimator SynchronizationProtocol::getClockEstimator(unsigned int peer_id)
+{
+    pthread_mutex_lock(&m_clocks_mutex);
+    ClockEstimator clock = m_clocks[peer_id];
+    pthread_mutex_unlock(&m_clocks_mutex);
+    return clock;
+}
+
+//-----------------------------------------------------------------------------
+/** Logs the round trip time, jitter, clock offset and ping loss of each
+ *  peer. */
+void SynchronizationProtocol::printStats()
+{
+    std::vector<STKPeer*> peers = NetworkManager::getInstance()->getPeers();
+    pthread_mutex_lock(&m_clocks_mutex);
+    for (unsigned int i = 0; i < m_clocks.size(); i++)
+    {
+        const ClockEstimator &clock = m_clocks[i];
+        if (!clock.hasSamples())
+            continue;
+        const char *name = i < peers.size() && peers[i]->getPlayerProfile()
+                         ? peers[i]->getPlayerProfile()->kart_name.c_str()
+                         : "?";
+        unsigned int lost = clock.getPingsSent() - clock.getPongsReceived();
+        Log::info("SynchronizationProtocol", "Peer %d (%s): round trip "
+                  "%.1f ms (average %.1f ms), jitter %.1f ms, clock offset "
+                  "%.1f ms, %d of %d pings unanswered.", i, name,
+                  clock.getRoundTrip()*1000, clock.getAverageRoundTrip()*1000,
+                  clock.getJitter()*1000, clock.getClockOffset()*1000, lost,
+                  clock.getPingsSent());
+    }
+    pthread_mutex_unlock(&m_clocks_mutex);
+}
+
 //-----------------------------------------------------------------------------
 
 void SynchronizationProtocol::startCountdown(int ms_countdown)
@@ -2,8 +2,8 @@
 #define SYNCHRONIZATION_PROTOCOL_HPP
 
 #include "network/protocol.hpp"
+#include "network/clock_estimator.hpp"
 #include <vector>
-#include <map>
 
 class SynchronizationProtocol : public Protocol
 {
@@ -20,12 +20,17 @@ class SynchronizationProtocol : public Protocol
 
         int getCountdown() { return (int)(m_countdown*1000.0); }
 
+        ClockEstimator getClockEstimator(unsigned int peer_id);
+
     protected:
-        std::vector<std::map<uint32_t, double> > m_pings;
-        std::vector<uint32_t> m_average_ping;
-        std::vector<uint32_t> m_pings_count;
-        std::vector<uint32_t> m_successed_pings;
-        std::vector<double> m_total_diff;
+        void printStats();
+
+        /** Round trip and clock offset estimation for each peer. */
+        std::vector<ClockEstimator> m_clocks;
+        /** The clocks are updated in the protocol thread, and read from the
+         *  main thread. */
+        pthread_mutex_t m_clocks_mutex;
+        double m_last_stats_time;
         bool m_countdown_activated;
         double m_countdown;
         double m_last_countdown_update;
@@ -120,13 +120,20 @@ void ServerNetworkManager::run()
 
 void ServerNetworkManager::kickAllPlayers()
 {
+    pthread_mutex_lock(&m_peers_mutex);
     for (unsigned int i = 0; i < m_peers.size(); i++)
     {
         m_peers[i]->disconnect();
     }
+    pthread_mutex_unlock(&m_peers_mutex);
 }
 
 void ServerNetworkManager::sendPacket(const NetworkString& data, bool reliable)
 {
-    m_localhost->broadcastPacket(data, reliable);
+    // Queue the message for each peer, so that it is batched with the other
+    // messages to that peer
+    pthread_mutex_lock(&m_peers_mutex);
+    for (unsigned int i = 0; i < m_peers.size(); i++)
+        m_peers[i]->sendPacket(data, reliable);
+    pthread_mutex_unlock(&m_peers_mutex);
 }
@@ -37,7 +37,7 @@
 FILE* STKHost::m_log_file = NULL;
 pthread_mutex_t STKHost::m_log_mutex;
 
-void STKHost::logPacket(const NetworkString ns, bool incoming)
+void STKHost::logPacket(const NetworkString &ns, bool incoming)
 {
     if (m_log_file == NULL)
         return;
@@ -65,9 +65,22 @@ void* STKHost::receive_data(void* self)
     {
         while (enet_host_service(host, &event, 20) != 0) {
             Event* evt = new Event(&event);
-            if (evt->type == EVENT_TYPE_MESSAGE)
-                logPacket(evt->data(), true);
-            if (event.type != ENET_EVENT_TYPE_NONE)
+            if (event.type == ENET_EVENT_TYPE_RECEIVE)
+            {
+                // A packet contains all messages the peer sent to this host
+                // in one update, see STKPeer::sendPacket
+                std::vector<NetworkString> messages;
+                if (!STKPeer::splitPacket(evt->data(), &messages))
+                    Log::warn("STKHost", "Received a damaged packet.");
+                for (unsigned int i = 0; i < messages.size(); i++)
+                {
+                    Event* message = new Event(*evt, messages[i]);
+                    logPacket(message->data(), true);
+                    NetworkManager::getInstance()->notifyEvent(message);
+                    delete message;
+                }
+            }
+            else if (event.type != ENET_EVENT_TYPE_NONE)
                 NetworkManager::getInstance()->notifyEvent(evt);
             delete evt;
         }
@@ -302,8 +315,11 @@ uint8_t* STKHost::receiveRawPacket(TransportAddress sender, int max_tries)
 
 void STKHost::broadcastPacket(const NetworkString& data, bool reliable)
 {
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1,
+    ENetPacket* packet = enet_packet_create(NULL, data.size()+1,
                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
+    if (data.size() > 0)
+        memcpy(packet->data, data.getBytes(), data.size());
+    packet->data[data.size()] = 0;
     enet_host_broadcast(m_host, 0, packet);
     STKHost::logPacket(data, false);
 }
@@ -25,6 +25,7 @@
 STKPeer::STKPeer()
 {
     m_peer = NULL;
+    pthread_mutex_init(&m_queue_mutex, NULL);
     m_player_profile = new NetworkPlayerProfile*;
     *m_player_profile = NULL;
     m_client_server_token = new uint32_t;
@@ -37,6 +38,8 @@ STKPeer::STKPeer()
 
 STKPeer::STKPeer(const STKPeer& peer)
 {
+    // The queued messages are not copied, they are sent by the original peer
+    pthread_mutex_init(&m_queue_mutex, NULL);
     m_peer = peer.m_peer;
     m_player_profile = peer.m_player_profile;
     m_client_server_token = peer.m_client_server_token;
@@ -52,6 +55,7 @@ STKPeer::~STKPeer()
     if (m_player_profile)
         delete m_player_profile;
     m_player_profile = NULL;
+    pthread_mutex_destroy(&m_queue_mutex);
 }
 
 //-----------------------------------------------------------------------------
@@ -89,23 +93,112 @@ void STKPeer::disconnect()
 
 //-----------------------------------------------------------------------------
 
+/*! \brief Queues a message for this peer.
+ *  All messages queued during one update of the protocols are sent together
+ *  in as few ENet packets as possible when flush() is called, which is done
+ *  by the ProtocolManager after each update. Reliable and unreliable messages
+ *  are kept apart and use different channels. A packet is sent as soon as
+ *  the next message would not fit in one datagram anymore.
+ *  \param data : The message, starting with the protocol type.
+ *  \param reliable : True if the message must arrive.
+ */
 void STKPeer::sendPacket(NetworkString const& data, bool reliable)
 {
+    if (data.size() > 0xffff)
+    {
+        Log::error("STKPeer", "Message of size %d is too big to be sent.",
+                   data.size());
+        return;
+    }
+    const int channel = reliable ? CHANNEL_RELIABLE : CHANNEL_UNRELIABLE;
+    pthread_mutex_lock(&m_queue_mutex);
+    std::vector<uint8_t>& queue = m_queue[channel];
+    if (!queue.empty() &&
+        (int)queue.size() + 2 + data.size() > getMaxPacketSize())
+        flushQueue(channel);
+    queue.push_back((data.size() >> 8) & 0xff);
+    queue.push_back( data.size()       & 0xff);
+    if (data.size() > 0)
+        queue.insert(queue.end(), data.getBytes(), data.getBytes()+data.size());
+    pthread_mutex_unlock(&m_queue_mutex);
+
+    NetworkManager::getInstance()->addSentMessage(data);
+}
+
+//-----------------------------------------------------------------------------
+
+/*! \brief Sends all queued messages.
+ */
+void STKPeer::flush()
+{
+    pthread_mutex_lock(&m_queue_mutex);
+    flushQueue(CHANNEL_RELIABLE);
+    flushQueue(CHANNEL_UNRELIABLE);
+    pthread_mutex_unlock(&m_queue_mutex);
+}
+
+//-----------------------------------------------------------------------------
+
+/*! \brief Sends the queued messages of one channel as one ENet packet. The
+ *  queue mutex must be locked.
+ *  \param channel : The channel to flush.
+ */
+void STKPeer::flushQueue(int channel)
+{
+    std::vector<uint8_t>& queue = m_queue[channel];
+    if (queue.empty())
+        return;
     Log::verbose("STKPeer", "sending packet of size %d to %i.%i.%i.%i:%i",
-                data.size(), (m_peer->address.host>>0)&0xff,
+                queue.size(), (m_peer->address.host>>0)&0xff,
                 (m_peer->address.host>>8)&0xff,(m_peer->address.host>>16)&0xff,
                 (m_peer->address.host>>24)&0xff,m_peer->address.port);
-    ENetPacket* packet = enet_packet_create(data.c_str(), data.size()+1,
-                (reliable ? ENET_PACKET_FLAG_RELIABLE : ENET_PACKET_FLAG_UNSEQUENCED));
-    /* to debug the packet output
-    printf("STKPeer: ");
-    for (unsigned int i = 0; i < data.size(); i++)
+    ENetPacket* packet = enet_packet_create(NULL, queue.size()+1,
+                (channel == CHANNEL_RELIABLE ? ENET_PACKET_FLAG_RELIABLE
+                                             : ENET_PACKET_FLAG_UNSEQUENCED));
+    memcpy(packet->data, &queue[0], queue.size());
+    packet->data[queue.size()] = 0;
+    enet_peer_send(m_peer, channel, packet);
+    NetworkManager::getInstance()->addSentPacket(queue.size());
+    queue.clear();
+}
+
+//-----------------------------------------------------------------------------
+
+/*! \brief Returns the maximum size of the messages in a packet, so that the
+ *  packet still fits in one datagram.
+ */
+int STKPeer::getMaxPacketSize() const
+{
+    // Space for the ENet protocol and command headers
+    const int overhead = 32;
+    int mtu = (m_peer && m_peer->mtu > 0) ? m_peer->mtu
+                                          : ENET_HOST_DEFAULT_MTU;
+    return mtu - overhead;
+}
+
+//-----------------------------------------------------------------------------
+
+/*! \brief Splits a received packet into the messages it contains.
+ *  \param packet : The data of the packet.
+ *  \param messages : Receives the messages.
+ *  \return False if the packet is damaged, messages then contains all
+ *  messages before the damaged part.
+ */
+bool STKPeer::splitPacket(const NetworkString& packet,
+                          std::vector<NetworkString>* messages)
+{
+    const uint8_t* data = packet.getBytes();
+    int offset = 0;
+    while (offset + 2 <= packet.size())
     {
-        printf("%d ", (uint8_t)(data[i]));
+        int size = (data[offset] << 8) | data[offset+1];
+        offset += 2;
+        if (offset + size > packet.size())
+            return false;
+        messages->push_back(NetworkString(data+offset, size));
+        offset += size;
     }
-    printf("\n");
-    */
-    enet_peer_send(m_peer, 0, packet);
+    return offset == packet.size();
 }
 
 //-----------------------------------------------------------------------------
@@ -145,4 +238,3 @@ bool STKPeer::isSamePeer(const STKPeer* peer) const
 }
 
 //-----------------------------------------------------------------------------
-
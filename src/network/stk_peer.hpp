@@ -27,6 +27,8 @@
 #include "network/network_string.hpp"
 #include "network/game_setup.hpp"
 #include <enet/enet.h>
+#include <pthread.h>
+#include <vector>
 
 /*! \class STKPeer
  *  \brief Represents a peer.
@@ -41,6 +43,9 @@ class STKPeer
         virtual ~STKPeer();
 
         virtual void sendPacket(const NetworkString& data, bool reliable = true);
+        void flush();
+        static bool splitPacket(const NetworkString& packet,
+                                std::vector<NetworkString>* messages);
         static bool connectToHost(STKHost* localhost, TransportAddress host, uint32_t channel_count, uint32_t data);
         void disconnect();
 
@@ -60,7 +65,18 @@ class STKPeer
         bool isSamePeer(const STKPeer* peer) const;
 
     protected:
+        /*! \brief Channel used for reliable and unreliable messages. */
+        enum { CHANNEL_RELIABLE = 0, CHANNEL_UNRELIABLE = 1 };
+
+        void flushQueue(int channel);
+        int  getMaxPacketSize() const;
+
         ENetPeer* m_peer;
+        /*! \brief Messages that are sent in the next packet on each channel,
+         *  each message preceded by its size as 16 bit value. */
+        std::vector<uint8_t> m_queue[2];
+        /*! \brief Messages are sent from the main and the protocol thread. */
+        pthread_mutex_t m_queue_mutex;
         NetworkPlayerProfile** m_player_profile;
         uint32_t *m_client_server_token;
         bool *m_token_set;
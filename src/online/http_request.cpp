@@ -90,6 +90,9 @@ namespace Online
         m_filename      = "";
         m_parameters    = "";
         m_curl_code     = CURLE_OK;
+        m_curl_session  = NULL;
+        m_headers       = NULL;
+        m_file          = NULL;
         m_progress.setAtomic(0);
     }   // init
 
@@ -144,12 +147,14 @@ namespace Online
         curl_easy_setopt(m_curl_session, CURLOPT_CONNECTTIMEOUT, 20);
         curl_easy_setopt(m_curl_session, CURLOPT_LOW_SPEED_LIMIT, 10);
         curl_easy_setopt(m_curl_session, CURLOPT_LOW_SPEED_TIME, 20);
+        // Reuse connections, DNS lookups and SSL sessions of other requests
+        curl_easy_setopt(m_curl_session, CURLOPT_SHARE,
+                         RequestManager::get()->getCurlShare());
         if(m_filename.size()==0)
         {
             //https
-            struct curl_slist *chunk = NULL;
-            chunk = curl_slist_append(chunk, "Host: api.stkaddons.net");
-            curl_easy_setopt(m_curl_session, CURLOPT_HTTPHEADER, chunk);
+            m_headers = curl_slist_append(m_headers, "Host: api.stkaddons.net");
+            curl_easy_setopt(m_curl_session, CURLOPT_HTTPHEADER, m_headers);
             curl_easy_setopt(m_curl_session, CURLOPT_CAINFO, 
                 file_manager->getAsset("web.tuxfamily.org.pem").c_str());
             curl_easy_setopt(m_curl_session, CURLOPT_SSL_VERIFYPEER, 0L);
@@ -158,26 +163,68 @@ namespace Online
     }   // prepareOperation
 
     // ------------------------------------------------------------------------
-    /** The actual curl download happens here.
+    /** The actual curl download happens here. This is used when the request
+     *  is executed directly (executeNow), the request manager uses
+     *  startOperation() and finishOperation() instead.
      */
     void HTTPRequest::operation()
     {
-        if(!m_curl_session)
+        if(!startTransfer())
             return;
+        finishTransfer(curl_easy_perform(m_curl_session));
+    }   // operation
+
+    // ------------------------------------------------------------------------
+    /** Starts the download without waiting for it.
+     *  \return The curl handle that needs to be performed, or NULL if the
+     *          download could not be started.
+     */
+    CURL* HTTPRequest::startOperation()
+    {
+        if(!startTransfer())
+            return NULL;
+        return m_curl_session;
+    }   // startOperation
+
+    // ------------------------------------------------------------------------
+    /** Called by the request manager when the download is finished.
+     *  \param code The curl result of the download.
+     */
+    void HTTPRequest::finishOperation(CURLcode code)
+    {
+        finishTransfer(code);
+    }   // finishOperation
+
+    // ------------------------------------------------------------------------
+    /** Sets up the data output and post parameters of the curl session.
+     *  \return False if the transfer can not be done. In this case the
+     *          curl session is already freed.
+     */
+    bool HTTPRequest::startTransfer()
+    {
+        if(!m_curl_session)
+        {
+            m_curl_code = CURLE_FAILED_INIT;
+            return false;
+        }
 
-        FILE *fout = NULL;
         if(m_filename.size()>0)
         {
-            fout = fopen((m_filename+".part").c_str(), "wb");
+            m_file = fopen((m_filename+".part").c_str(), "wb");
 
-            if(!fout)
+            if(!m_file)
             {
                 Log::error("HTTPRequest",
                            "Can't open '%s' for writing, ignored.",
                            (m_filename+".part").c_str());
-                return;
+                m_curl_code = CURLE_WRITE_ERROR;
+                curl_easy_cleanup(m_curl_session);
+                m_curl_session = NULL;
+                curl_slist_free_all(m_headers);
+                m_headers = NULL;
+                return false;
             }
-            curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     fout  );
+            curl_easy_setopt(m_curl_session,  CURLOPT_WRITEDATA,     m_file);
             curl_easy_setopt(m_curl_session,  CURLOPT_WRITEFUNCTION, fwrite);
         }
         else
@@ -214,13 +261,27 @@ namespace Online
                     // Unknown system type
             #endif
         curl_easy_setopt(m_curl_session, CURLOPT_USERAGENT, uagent.c_str());
+        return true;
+    }   // startTransfer
 
-        m_curl_code = curl_easy_perform(m_curl_session);
+    // ------------------------------------------------------------------------
+    /** Frees the curl session once the transfer is finished, and moves a
+     *  downloaded file to its final name.
+     *  \param code The curl result of the transfer.
+     */
+    void HTTPRequest::finishTransfer(CURLcode code)
+    {
+        m_curl_code = code;
         Request::operation();
+        curl_easy_cleanup(m_curl_session);
+        m_curl_session = NULL;
+        curl_slist_free_all(m_headers);
+        m_headers = NULL;
 
-        if(fout)
+        if(m_file)
         {
-            fclose(fout);
+            fclose(m_file);
+            m_file = NULL;
             if(m_curl_code==CURLE_OK)
             {
                 if(UserConfigParams::logAddons())
@@ -244,8 +305,8 @@ namespace Online
                     m_curl_code = CURLE_WRITE_ERROR;
                 }
             }   // m_curl_code ==CURLE_OK
-        }   // if fout
-    }   // operation
+        }   // if m_file
+    }   // finishTransfer
 
     // ------------------------------------------------------------------------
     /** Cleanup once the download is finished. The value of progress is 
@@ -259,7 +320,6 @@ namespace Online
         else
             setProgress(-1.0f);
         Request::afterOperation();
-        curl_easy_cleanup(m_curl_session);
     }   // afterOperation
 
     // ------------------------------------------------------------------------
@@ -58,6 +58,12 @@ namespace Online
         /** Pointer to the curl data structure for this request. */
         CURL *m_curl_session;
 
+        /** Additional http headers, freed when the transfer is finished. */
+        struct curl_slist *m_headers;
+
+        /** The file the data is written to while downloading into a file. */
+        FILE *m_file;
+
         /** curl return code. */
         CURLcode m_curl_code;
 
@@ -68,6 +74,8 @@ namespace Online
         virtual void prepareOperation() OVERRIDE;
         virtual void operation() OVERRIDE;
         virtual void afterOperation() OVERRIDE;
+        virtual CURL* startOperation() OVERRIDE;
+        virtual void finishOperation(CURLcode code) OVERRIDE;
 
         static int progressDownload(void *clientp, double dltotal,
                                     double dlnow,  double ultotal,
@@ -76,6 +84,8 @@ namespace Online
         static size_t writeCallback(void *contents, size_t size,
                                     size_t nmemb,   void *userp);
         void init();
+        bool startTransfer();
+        void finishTransfer(CURLcode code);
 
     public :
                            HTTPRequest(bool manage_memory = false, 
@@ -66,6 +66,36 @@ namespace Online
         setExecuted();
         afterOperation();
     }   // execute
+
+    // ------------------------------------------------------------------------
+    /** Starts executing the request without blocking, used by the request
+     *  manager to execute several requests at the same time. If a curl
+     *  handle is returned, the manager must call finishExecution() once the
+     *  transfer is finished. Otherwise the request is already executed.
+     */
+    CURL* Request::startExecution()
+    {
+        assert(isBusy());
+        prepareOperation();
+        CURL *handle = startOperation();
+        if(!handle)
+        {
+            setExecuted();
+            afterOperation();
+        }
+        return handle;
+    }   // startExecution
+
+    // ------------------------------------------------------------------------
+    /** Finishes a request started with startExecution().
+     *  \param code The curl result of the transfer.
+     */
+    void Request::finishExecution(CURLcode code)
+    {
+        finishOperation(code);
+        setExecuted();
+        afterOperation();
+    }   // finishExecution
     // ------------------------------------------------------------------------
     /** Executes the request now, i.e. in the main thread and without involving
      *  the manager thread.. This calles prepareOperation, operation, and
@@ -117,6 +117,18 @@ namespace Online
         // --------------------------------------------------------------------
         /** Virtual function to be called after an operation. */
         virtual void afterOperation()   {}
+        // --------------------------------------------------------------------
+        /** Starts the operation without waiting for it to finish. The
+         *  default executes operation() directly.
+         *  \return The curl handle that the request manager has to perform
+         *          to finish the operation, or NULL if the operation is
+         *          already finished. */
+        virtual CURL* startOperation() { operation(); return NULL; }
+        // --------------------------------------------------------------------
+        /** Called when the transfer of the curl handle returned by
+         *  startOperation() has finished.
+         *  \param code The curl result of the transfer. */
+        virtual void finishOperation(CURLcode code) {}
 
     public:
         enum RequestType
@@ -127,6 +139,8 @@ namespace Online
                  Request(bool manage_memory, int priority, int type);
         virtual ~Request() {}
         void     execute();
+        CURL*    startExecution();
+        void     finishExecution(CURLcode code);
         void     executeNow();
         void     queue();
         // --------------------------------------------------------------------
@@ -20,9 +20,11 @@
 
 #include "online/request_manager.hpp"
 
+#include "config/user_config.hpp"
 #include "online/current_user.hpp"
 #include "states_screens/state_manager.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <stdio.h>
 #include <memory.h>
@@ -82,6 +84,23 @@ namespace Online
         pthread_cond_init(&m_cond_request, NULL);
         m_abort.setAtomic(false);
         m_time_since_poll = MENU_POLLING_INTERVAL * 0.9;
+
+        m_curl_multi = curl_multi_init();
+
+        // Connections are reused by the multi handle. Connections are not
+        // shared with requests executed in other threads, since libcurl
+        // does not support sharing connections between threads safely.
+        for(unsigned int i=0; i<CURL_LOCK_DATA_LAST; i++)
+            pthread_mutex_init(&m_share_mutex[i], NULL);
+        m_curl_share = curl_share_init();
+        curl_share_setopt(m_curl_share, CURLSHOPT_LOCKFUNC,
+                          &RequestManager::lockShare);
+        curl_share_setopt(m_curl_share, CURLSHOPT_UNLOCKFUNC,
+                          &RequestManager::unlockShare);
+        curl_share_setopt(m_curl_share, CURLSHOPT_USERDATA, this);
+        curl_share_setopt(m_curl_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(m_curl_share, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION);
     }
 
     // ------------------------------------------------------------------------
@@ -92,9 +111,35 @@ namespace Online
         delete m_thread_id.getData();
         m_thread_id.unlock();
         pthread_cond_destroy(&m_cond_request);
+        curl_multi_cleanup(m_curl_multi);
+        curl_share_cleanup(m_curl_share);
+        for(unsigned int i=0; i<CURL_LOCK_DATA_LAST; i++)
+            pthread_mutex_destroy(&m_share_mutex[i]);
         curl_global_cleanup();
     }
 
+    // ------------------------------------------------------------------------
+    /** Called by libcurl to lock data shared between requests.
+     *  \param obj Pointer to the request manager.
+     */
+    void RequestManager::lockShare(CURL *handle, curl_lock_data data,
+                                   curl_lock_access access, void *obj)
+    {
+        RequestManager *me = (RequestManager*)obj;
+        pthread_mutex_lock(&me->m_share_mutex[data]);
+    }   // lockShare
+
+    // ------------------------------------------------------------------------
+    /** Called by libcurl to unlock data shared between requests.
+     *  \param obj Pointer to the request manager.
+     */
+    void RequestManager::unlockShare(CURL *handle, curl_lock_data data,
+                                     void *obj)
+    {
+        RequestManager *me = (RequestManager*)obj;
+        pthread_mutex_unlock(&me->m_share_mutex[data]);
+    }   // unlockShare
+
 
     // ------------------------------------------------------------------------
     /** Start the actual network thread. This can not be done as part of
@@ -177,8 +222,11 @@ namespace Online
 
     // ------------------------------------------------------------------------
     /** The actual main loop, which is started as a separate thread from the
-     *  constructor. After testing for a new server, fetching news, the list
-     *  of packages to download, it will wait for commands to be issued.
+     *  constructor. It waits for requests, and starts the most important
+     *  ones as long as less than the maximum number of requests are
+     *  downloading. When the quit request is the most important request, no
+     *  more requests are started, the running requests are finished, and all
+     *  remaining requests are deleted.
      *  \param obj: A pointer to this object, passed on by pthread_create
      */
     void *RequestManager::mainLoop(void *obj)
@@ -187,31 +235,53 @@ namespace Online
 
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 
-        me->m_current_request = NULL;
-        me->m_request_queue.lock();
-        while( me->m_request_queue.getData().empty() || 
-               me->m_request_queue.getData().top()->getType() != Request::RT_QUIT)
+        const unsigned int max_requests =
+            std::max(1, (int)UserConfigParams::m_max_http_requests);
+
+        bool quit = false;
+        while(true)
         {
-            bool empty = me->m_request_queue.getData().empty();
+            me->m_request_queue.lock();
             // Wait in cond_wait for a request to arrive. The 'while' is necessary
             // since "spurious wakeups from the pthread_cond_wait ... may occur"
             // (pthread_cond_wait man page)!
-            while(empty)
+            while(!quit && me->m_request_queue.getData().empty() &&
+                  me->m_running_requests.empty())
             {
                 pthread_cond_wait(&me->m_cond_request, me->m_request_queue.getMutex());
-                empty = me->m_request_queue.getData().empty();
             }
-            me->m_current_request = me->m_request_queue.getData().top();
-            me->m_request_queue.getData().pop();
-            if(me->m_current_request->getType()==Request::RT_QUIT)
-                break;
+            while(!quit && !me->m_request_queue.getData().empty() &&
+                  me->m_running_requests.size() < max_requests)
+            {
+                Online::Request *request = me->m_request_queue.getData().top();
+                if(request->getType()==Request::RT_QUIT)
+                {
+                    quit = true;
+                    break;
+                }
+                me->m_request_queue.getData().pop();
+                me->m_request_queue.unlock();
+                CURL *handle = request->startExecution();
+                if(handle)
+                {
+                    curl_multi_add_handle(me->m_curl_multi, handle);
+                    me->m_running_requests[handle] = request;
+                }
+                else
+                    me->addResult(request);
+                me->m_request_queue.lock();
+            }
             me->m_request_queue.unlock();
-            me->m_current_request->execute();
-            me->addResult(me->m_current_request);
-            me->m_request_queue.lock();
-        }   // while
 
-        // At this stage we have the lock for m_request_queue
+            if(me->m_running_requests.empty())
+            {
+                if(quit) break;
+                continue;
+            }
+            me->performRequests();
+        }   // while true
+
+        me->m_request_queue.lock();
         while(!me->m_request_queue.getData().empty())
         {
             Online::Request * request = me->m_request_queue.getData().top();
@@ -225,6 +295,41 @@ namespace Online
         return 0;
     }   // mainLoop
 
+    // ------------------------------------------------------------------------
+    /** Lets curl download the running requests, and finishes the requests
+     *  whose download is complete. If the downloads are still running it
+     *  waits a short time for data to arrive.
+     */
+    void RequestManager::performRequests()
+    {
+        int running = 0;
+        curl_multi_perform(m_curl_multi, &running);
+
+        int messages_left = 0;
+        CURLMsg *message;
+        while((message = curl_multi_info_read(m_curl_multi, &messages_left)))
+        {
+            if(message->msg != CURLMSG_DONE)
+                continue;
+            // The message is invalid once the handle is removed
+            CURL *handle  = message->easy_handle;
+            CURLcode code = message->data.result;
+            curl_multi_remove_handle(m_curl_multi, handle);
+
+            std::map<CURL*, Request*>::iterator i =
+                                              m_running_requests.find(handle);
+            assert(i!=m_running_requests.end());
+            Request *request = i->second;
+            m_running_requests.erase(i);
+            request->finishExecution(code);
+            addResult(request);
+        }
+
+        // Don't wait too long, so that new requests are started quickly
+        if(!m_running_requests.empty())
+            curl_multi_wait(m_curl_multi, NULL, 0, 50, NULL);
+    }   // performRequests
+
     // ------------------------------------------------------------------------
     /** Inserts a request into the queue of results.
      *  \param request The pointer to the request to insert.
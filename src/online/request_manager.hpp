@@ -35,6 +35,7 @@
 #endif
 
 #include <curl/curl.h>
+#include <map>
 #include <queue>
 #include <pthread.h>
 
@@ -44,6 +45,11 @@ namespace Online
 
     /**
       * \brief Class to connect with a server over HTTP(S)
+      * The requests are executed by a separate thread. Up to
+      * UserConfigParams::m_max_http_requests requests are downloaded at the
+      * same time using a curl multi handle, which keeps connections to the
+      * servers open for the next requests. Requests are started in the order
+      * of their priority.
       * \ingroup online
       */
     class RequestManager
@@ -62,8 +68,20 @@ namespace Online
 
             float                     m_time_since_poll;
 
-            /** The current requested being worked on. */
-            Online::Request *         m_current_request;
+            /** The requests currently downloaded, indexed by their curl
+             *  handle. Only accessed by the network thread. */
+            std::map<CURL*, Online::Request*> m_running_requests;
+
+            /** The curl multi handle used to download several requests at
+             *  the same time. */
+            CURLM *                   m_curl_multi;
+
+            /** Shares DNS lookups and SSL sessions between all requests,
+             *  including requests executed without the network thread. */
+            CURLSH *                  m_curl_share;
+
+            /** Locks for the data shared with m_curl_share. */
+            pthread_mutex_t           m_share_mutex[CURL_LOCK_DATA_LAST];
 
             /** A conditional variable to wake up the main loop. */
             pthread_cond_t            m_cond_request;
@@ -88,7 +106,13 @@ namespace Online
             void addResult(Online::Request *request);
             void handleResultQueue();
 
+            void performRequests();
+
             static void  *mainLoop(void *obj);
+            static void   lockShare(CURL *handle, curl_lock_data data,
+                                    curl_lock_access access, void *obj);
+            static void   unlockShare(CURL *handle, curl_lock_data data,
+                                      void *obj);
 
             RequestManager(); //const std::string &url
             ~RequestManager();
@@ -107,6 +131,8 @@ namespace Online
             void stopNetworkThread();
 
             bool getAbort(){ return m_abort.getAtomic(); };
+            /** Returns the curl share handle to use for all requests. */
+            CURLSH *getCurlShare() { return m_curl_share; }
             void update(float dt);
 
     }; //class RequestManager
@@ -20,12 +20,17 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include "graphics/material.hpp"
+#include "graphics/material_manager.hpp"
 #include "modes/world.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <string.h>
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
@@ -41,6 +46,7 @@ TriangleMesh::TriangleMesh() : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_cached_bvh       = NULL;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -50,6 +56,7 @@ TriangleMesh::TriangleMesh() : m_mesh()
 TriangleMesh::~TriangleMesh()
 {
     removeAll();
+    freeCachedBvh();
 }   // ~TriangleMesh
 
 // -----------------------------------------------------------------------------
@@ -65,6 +72,9 @@ void TriangleMesh::addTriangle(const btVector3 &t1, const btVector3 &t2,
                                const btVector3 &n3,
                                const Material* m)
 {
+    // A cached bvh does not contain the new triangle
+    if(m_cached_bvh)
+        freeCachedBvh();
     m_triangleIndex2Material.push_back(m);
 
     btVector3 normal = (t2-t1).cross(t3-t1);
@@ -125,6 +135,12 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
         //free(bytes);
 
     }
+    else if (m_cached_bvh)
+    {
+        bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */,
+                                                       false /* buildBvh */);
+        bhv_triangle_mesh->setOptimizedBvh(m_cached_bvh);
+    }
     else
     {
         bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
@@ -216,6 +232,195 @@ void TriangleMesh::removeAll()
     m_collision_shape = NULL;
 }   // removeAll
 
+// ----------------------------------------------------------------------------
+/** Frees a bvh read from the physics cache. The collision shape using it
+ *  must have been deleted before.
+ */
+void TriangleMesh::freeCachedBvh()
+{
+    if(!m_cached_bvh) return;
+    // The bvh was created with placement new in the aligned buffer
+    m_cached_bvh->~btOptimizedBvh();
+    btAlignedFree(m_cached_bvh);
+    m_cached_bvh = NULL;
+}   // freeCachedBvh
+
+// ----------------------------------------------------------------------------
+/** Writes all triangles, normals, materials and the bvh of this mesh to the
+ *  physics cache file, in native byte order. The collision shape must have
+ *  been created. Materials are stored by their texture name, which is the
+ *  key used by the material manager.
+ *  \param f The file to write to.
+ *  \return False if the data could not be written.
+ */
+bool TriangleMesh::writeCache(FILE *f) const
+{
+    std::vector<const Material*> materials;
+    std::map<const Material*, uint32_t> material_index;
+    std::vector<uint32_t> triangle_material;
+    const unsigned int num_triangles = getNumTriangles();
+    for(unsigned int i=0; i<num_triangles; i++)
+    {
+        const Material *m = m_triangleIndex2Material[i];
+        std::map<const Material*, uint32_t>::iterator it =
+            material_index.find(m);
+        if(it==material_index.end())
+        {
+            it = material_index.insert(
+                 std::make_pair(m, (uint32_t)materials.size())).first;
+            materials.push_back(m);
+        }
+        triangle_material.push_back(it->second);
+    }
+
+    bool ok = true;
+    uint32_t n = materials.size();
+    ok &= fwrite(&n, sizeof(n), 1, f)==1;
+    for(unsigned int i=0; i<materials.size(); i++)
+    {
+        // Triangles without texture have no material
+        std::string name = materials[i] ? materials[i]->getTexFname() : "";
+        n = name.size();
+        ok &= fwrite(&n, sizeof(n), 1, f)==1;
+        if(n>0)
+            ok &= fwrite(name.c_str(), n, 1, f)==1;
+    }
+
+    n = num_triangles;
+    ok &= fwrite(&n, sizeof(n), 1, f)==1;
+    std::vector<float> vertices, normals;
+    vertices.reserve(9*num_triangles);
+    normals.reserve(9*num_triangles);
+    for(unsigned int i=0; i<num_triangles; i++)
+    {
+        btVector3 p[3];
+        getTriangle(i, &p[0], &p[1], &p[2]);
+        for(unsigned int j=0; j<3; j++)
+        {
+            const btVector3 &normal = m_normals[3*i+j];
+            for(unsigned int k=0; k<3; k++)
+            {
+                vertices.push_back(p[j][k]);
+                normals.push_back(normal[k]);
+            }
+        }
+    }   // for i<num_triangles
+    if(num_triangles>0)
+    {
+        ok &= fwrite(&vertices[0], sizeof(float), vertices.size(), f)
+              ==vertices.size();
+        ok &= fwrite(&normals[0], sizeof(float), normals.size(), f)
+              ==normals.size();
+        ok &= fwrite(&triangle_material[0], sizeof(uint32_t), num_triangles, f)
+              ==num_triangles;
+    }
+
+    // Meshes without triangles have no collision shape
+    if(!m_collision_shape)
+    {
+        n = 0;
+        ok &= fwrite(&n, sizeof(n), 1, f)==1;
+        return ok;
+    }
+    btOptimizedBvh *bvh =
+        ((btBvhTriangleMeshShape*)m_collision_shape)->getOptimizedBvh();
+    n = bvh->calculateSerializeBufferSize();
+    void *buffer = btAlignedAlloc(n, 16);
+    if(!bvh->serialize(buffer, n, /*swap endian*/false))
+        n = 0;
+    ok &= fwrite(&n, sizeof(n), 1, f)==1;
+    if(n>0)
+        ok &= fwrite(buffer, n, 1, f)==1;
+    btAlignedFree(buffer);
+    return ok;
+}   // writeCache
+
+// ----------------------------------------------------------------------------
+/** Reads a mesh written by writeCache. The mesh must be empty. The bvh is
+ *  kept and used when the collision shape is created.
+ *  \param data Pointer to the data, on return it points to the data after
+ *         this mesh.
+ *  \param end End of the data.
+ *  \return False if the data is truncated.
+ */
+bool TriangleMesh::readCache(const unsigned char **data,
+                             const unsigned char *end)
+{
+    assert(getNumTriangles()==0);
+    const unsigned char *p = *data;
+    uint32_t n;
+#define READ(dest, size)                        \
+    if((size_t)(end-p) < (size_t)(size))        \
+        return false;                           \
+    memcpy(dest, p, size);                      \
+    p += size;
+
+    READ(&n, sizeof(n));
+    std::vector<const Material*> materials;
+    for(unsigned int i=0; i<n; i++)
+    {
+        uint32_t len;
+        READ(&len, sizeof(len));
+        if((size_t)(end-p) < len)
+            return false;
+        std::string name((const char*)p, len);
+        p += len;
+        materials.push_back(name.size()==0
+                            ? NULL
+                            : material_manager->getMaterial(name,
+                                                  /*is_full_path*/false,
+                                                  /*make_permanent*/false,
+                                                  /*complain_if_not_found*/false));
+    }
+
+    uint32_t num_triangles;
+    READ(&num_triangles, sizeof(num_triangles));
+    const size_t array_size = 9*sizeof(float)*(size_t)num_triangles;
+    if((size_t)(end-p) < 2*array_size + sizeof(uint32_t)*num_triangles)
+        return false;
+    const float    *vertices = (const float*)p;
+    const float    *normals  = (const float*)(p+array_size);
+    const uint32_t *index    = (const uint32_t*)(p+2*array_size);
+    for(unsigned int i=0; i<num_triangles; i++)
+    {
+        float v[9], nv[9];
+        uint32_t m;
+        memcpy(v,  vertices+9*i, sizeof(v));
+        memcpy(nv, normals +9*i, sizeof(nv));
+        memcpy(&m, index+i,      sizeof(m));
+        if(m>=materials.size())
+            return false;
+        m_triangleIndex2Material.push_back(materials[m]);
+        for(unsigned int j=0; j<3; j++)
+            m_normals.push_back(btVector3(nv[3*j], nv[3*j+1], nv[3*j+2]));
+        m_mesh.addTriangle(btVector3(v[0], v[1], v[2]),
+                           btVector3(v[3], v[4], v[5]),
+                           btVector3(v[6], v[7], v[8]));
+    }   // for i<num_triangles
+    p += 2*array_size + sizeof(uint32_t)*num_triangles;
+
+    READ(&n, sizeof(n));
+    if(n>0)
+    {
+        if((size_t)(end-p) < n)
+            return false;
+        // deSerializeInPlace needs an aligned and writable buffer
+        void *buffer = btAlignedAlloc(n, 16);
+        memcpy(buffer, p, n);
+        p += n;
+        m_cached_bvh = btOptimizedBvh::deSerializeInPlace(buffer, n,
+                                                    /*swap endian*/false);
+        if(!m_cached_bvh)
+        {
+            btAlignedFree(buffer);
+            return false;
+        }
+    }
+#undef READ
+    *data = p;
+    return true;
+}   // readCache
+
 // -----------------------------------------------------------------------------
 /** Interpolates the normal at the given position for the triangle with
  *  a given index. The position must be inside of the given triangle.
@@ -353,3 +558,233 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     return ray_callback.hasHit();
 
 }   // castRay
+
+// ----------------------------------------------------------------------------
+/** Gives access to the nodes of a bullet bvh, which are protected members of
+ *  btQuantizedBvh. A pointer to a member can be taken in a derived class and
+ *  then be applied to any btQuantizedBvh.
+ */
+class BvhNodeAccess : public btOptimizedBvh
+{
+public:
+    static const btOptimizedBvhNode *getNodes(const btQuantizedBvh *bvh,
+                                              int *count)
+    {
+        NodeArray btQuantizedBvh::*nodes = &BvhNodeAccess::m_contiguousNodes;
+        int btQuantizedBvh::*node_count  = &BvhNodeAccess::m_curNodeIndex;
+        *count = bvh->*node_count;
+        return *count>0 ? &(bvh->*nodes)[0] : NULL;
+    }   // getNodes
+};   // BvhNodeAccess
+
+// ----------------------------------------------------------------------------
+/** Casts many rays at once. The result for each ray is the same as the
+ *  result of castRay. Rays that are close to each other are grouped into
+ *  packets of RAY_PACKET_SIZE rays which are traversed together through the
+ *  bvh, so each node is loaded only once per packet. This is used to find
+ *  the terrain below all karts in one call.
+ *  \param from, to Start and end points of all rays.
+ *  \param hits On return the result for each ray.
+ */
+void TriangleMesh::castRays(const AlignedArray<btVector3> &from,
+                            const AlignedArray<btVector3> &to,
+                            AlignedArray<RayHit> *hits) const
+{
+    assert(from.size()==to.size());
+    hits->resize(from.size());
+    for(unsigned int i=0; i<hits->size(); i++)
+    {
+        RayHit &hit = (*hits)[i];
+        hit.m_hit      = false;
+        hit.m_material = NULL;
+        hit.m_normal.setValue(0, 1, 0);
+    }
+    if(!m_collision_shape || from.size()==0)
+        return;
+
+    // Sort the rays by the grid cell their start point is in, so that
+    // one packet contains rays that are close to each other and mostly
+    // traverse the same nodes.
+    const float cell_size = 32.0f;
+    std::vector<std::pair<uint64_t, unsigned int> > order;
+    order.reserve(from.size());
+    for(unsigned int i=0; i<from.size(); i++)
+    {
+        uint32_t x = (uint32_t)(int32_t)floorf(from[i].getX()/cell_size);
+        uint32_t z = (uint32_t)(int32_t)floorf(from[i].getZ()/cell_size);
+        order.push_back(std::make_pair(((uint64_t)x<<32) | z, i));
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<unsigned int> indices(order.size());
+    for(unsigned int i=0; i<order.size(); i++)
+        indices[i] = order[i].second;
+    for(unsigned int i=0; i<indices.size(); i+=RAY_PACKET_SIZE)
+    {
+        castRayPacket(&indices[i],
+                      std::min(RAY_PACKET_SIZE,
+                               (unsigned int)indices.size()-i),
+                      from, to, hits);
+    }
+}   // castRays
+
+// ----------------------------------------------------------------------------
+/** Casts up to RAY_PACKET_SIZE rays together through the bvh. The ray/box
+ *  tests are done for all rays of the packet with the same operations on
+ *  arrays (one entry per ray), which the compiler can turn into SIMD
+ *  instructions. The ray/triangle test is the one of bullet's
+ *  btTriangleRaycastCallback, so that the results match castRay.
+ *  \param indices Indices of the rays of this packet.
+ *  \param n Number of rays in this packet.
+ *  \param from, to Start and end points of all rays.
+ *  \param hits Results of all rays.
+ */
+void TriangleMesh::castRayPacket(const unsigned int *indices, unsigned int n,
+                                 const AlignedArray<btVector3> &from,
+                                 const AlignedArray<btVector3> &to,
+                                 AlignedArray<RayHit> *hits) const
+{
+    const unsigned int P = RAY_PACKET_SIZE;
+    // Bounding box, start point and inverse direction of each ray, stored
+    // per axis, so that the box tests work on consecutive values.
+    float ray_min[3][P], ray_max[3][P], origin[3][P], inv_dir[3][P];
+    btScalar hit_fraction[P];
+    int      hit_triangle[P];
+    btVector3 hit_normal[P];
+    const float large = 1e18f;
+    for(unsigned int l=0; l<P; l++)
+    {
+        hit_fraction[l] = 1.0f;
+        hit_triangle[l] = -1;
+        for(unsigned int k=0; k<3; k++)
+        {
+            if(l>=n)
+            {
+                // Unused lanes never overlap any box
+                ray_min[k][l] = large;  ray_max[k][l] = -large;
+                origin [k][l] = 0;      inv_dir[k][l] = 0;
+                continue;
+            }
+            const float f = from[indices[l]][k];
+            const float t = to  [indices[l]][k];
+            ray_min[k][l] = std::min(f, t);
+            ray_max[k][l] = std::max(f, t);
+            origin [k][l] = f;
+            // Same as bullet: use a large value for axis parallel rays
+            inv_dir[k][l] = t==f ? large : 1.0f/(t-f);
+        }
+    }
+
+    btOptimizedBvh *bvh =
+        ((btBvhTriangleMeshShape*)m_collision_shape)->getOptimizedBvh();
+    int num_nodes;
+    const btOptimizedBvhNode *node = BvhNodeAccess::getNodes(bvh, &num_nodes);
+    // Tolerance for the box tests, so that they never reject a box that
+    // bullet's own test would accept.
+    const float eps = 1e-4f;
+    int index = 0;
+    while(index < num_nodes)
+    {
+        const float box_min[3] = { node->m_aabbMinOrg.getX(),
+                                   node->m_aabbMinOrg.getY(),
+                                   node->m_aabbMinOrg.getZ() };
+        const float box_max[3] = { node->m_aabbMaxOrg.getX(),
+                                   node->m_aabbMaxOrg.getY(),
+                                   node->m_aabbMaxOrg.getZ() };
+        int lane_hit[P];
+        int any_hit = 0;
+        // First the cheap test of the box of the rays against the node
+        for(unsigned int l=0; l<P; l++)
+        {
+            lane_hit[l] = (ray_min[0][l] <= box_max[0]) &
+                          (ray_max[0][l] >= box_min[0]) &
+                          (ray_min[1][l] <= box_max[1]) &
+                          (ray_max[1][l] >= box_min[1]) &
+                          (ray_min[2][l] <= box_max[2]) &
+                          (ray_max[2][l] >= box_min[2]);
+            any_hit |= lane_hit[l];
+        }
+        if(any_hit)
+        {
+            any_hit = 0;
+            for(unsigned int l=0; l<P; l++)
+            {
+                float t_min = -large, t_max = large;
+                for(unsigned int k=0; k<3; k++)
+                {
+                    const float t0 = (box_min[k]-origin[k][l])*inv_dir[k][l];
+                    const float t1 = (box_max[k]-origin[k][l])*inv_dir[k][l];
+                    t_min = std::max(t_min, std::min(t0, t1));
+                    t_max = std::min(t_max, std::max(t0, t1));
+                }
+                lane_hit[l] &= (t_min <= t_max+eps) & (t_max >= -eps)
+                             & (t_min <= 1.0f+eps);
+                any_hit |= lane_hit[l];
+            }   // for l<P
+        }   // if any_hit
+        const bool is_leaf = node->m_escapeIndex == -1;
+        if(is_leaf && any_hit)
+        {
+            btVector3 v[3];
+            getTriangle(node->m_triangleIndex, &v[0], &v[1], &v[2]);
+            const btVector3 v10 = v[1] - v[0];
+            const btVector3 v20 = v[2] - v[0];
+            const btVector3 triangle_normal = v10.cross(v20);
+            const btScalar dist = v[0].dot(triangle_normal);
+            for(unsigned int l=0; l<n; l++)
+            {
+                if(!lane_hit[l]) continue;
+                const btVector3 &ray_from = from[indices[l]];
+                const btVector3 &ray_to   = to  [indices[l]];
+                const btScalar dist_a = triangle_normal.dot(ray_from) - dist;
+                const btScalar dist_b = triangle_normal.dot(ray_to  ) - dist;
+                if(dist_a * dist_b >= btScalar(0.0))
+                    continue;
+                const btScalar distance = dist_a/(dist_a-dist_b);
+                if(distance >= hit_fraction[l])
+                    continue;
+                btScalar edge_tolerance = triangle_normal.length2();
+                edge_tolerance *= btScalar(-0.0001);
+                btVector3 point;
+                point.setInterpolate3(ray_from, ray_to, distance);
+                const btVector3 v0p = v[0] - point;
+                const btVector3 v1p = v[1] - point;
+                if(v0p.cross(v1p).dot(triangle_normal) < edge_tolerance)
+                    continue;
+                const btVector3 v2p = v[2] - point;
+                if(v1p.cross(v2p).dot(triangle_normal) < edge_tolerance)
+                    continue;
+                if(v2p.cross(v0p).dot(triangle_normal) < edge_tolerance)
+                    continue;
+                hit_fraction[l] = distance;
+                hit_triangle[l] = node->m_triangleIndex;
+                hit_normal[l]   = triangle_normal.normalized();
+                if(dist_a <= btScalar(0.0))
+                    hit_normal[l] = -hit_normal[l];
+            }   // for l<n
+        }   // if is_leaf && any_hit
+
+        if(any_hit || is_leaf)
+        {
+            node++;
+            index++;
+        }
+        else
+        {
+            index += node->m_escapeIndex;
+            node  += node->m_escapeIndex;
+        }
+    }   // while index < num_nodes
+
+    for(unsigned int l=0; l<n; l++)
+    {
+        if(hit_triangle[l]<0) continue;
+        RayHit &hit = (*hits)[indices[l]];
+        hit.m_hit      = true;
+        hit.m_material = getMaterial(hit_triangle[l]);
+        hit.m_xyz.setInterpolate3(from[indices[l]], to[indices[l]],
+                                  hit_fraction[l]);
+        hit.m_normal   = hit_normal[l];
+        hit.m_normal.normalize();
+    }
+}   // castRayPacket
@@ -19,6 +19,7 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <stdio.h>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
@@ -33,7 +34,24 @@ class Material;
  */
 class TriangleMesh
 {
+public:
+    /** The result of one ray of castRays. */
+    struct RayHit
+    {
+        /** True if a triangle was hit. */
+        bool             m_hit;
+        /** The point where the ray hit, only set if m_hit is true. */
+        btVector3        m_xyz;
+        /** The normal of the triangle that was hit, or (0,1,0). */
+        btVector3        m_normal;
+        /** The material of the triangle that was hit, or NULL. */
+        const Material  *m_material;
+    };   // RayHit
+
 private:
+    /** Number of rays that castRays traverses together through the bvh. */
+    static const unsigned int RAY_PACKET_SIZE = 4;
+
     UserPointer                  m_user_pointer;
     std::vector<const Material*> m_triangleIndex2Material;
     btRigidBody                 *m_body;
@@ -44,6 +62,16 @@ private:
     btCollisionShape            *m_collision_shape;
     /** The three normals for each triangle. */
     AlignedArray<btVector3>      m_normals;
+    /** A bvh read from the physics cache, or NULL. It is deserialized in
+     *  place in an aligned buffer, and used by createCollisionShape
+     *  instead of building a new bvh. */
+    btOptimizedBvh              *m_cached_bvh;
+
+    void freeCachedBvh();
+    void castRayPacket(const unsigned int *indices, unsigned int n,
+                       const AlignedArray<btVector3> &from,
+                       const AlignedArray<btVector3> &to,
+                       AlignedArray<RayHit> *hits) const;
 public:
          TriangleMesh();
         ~TriangleMesh();
@@ -57,12 +85,18 @@ public:
                             const char* serializedBhv = NULL);
     void removeAll();
     void removeCollisionObject();
+    bool writeCache(FILE *f) const;
+    bool readCache(const unsigned char **data, const unsigned char *end);
     btVector3 getInterpolatedNormal(unsigned int index,
                                     const btVector3 &position) const;
     // ------------------------------------------------------------------------
     const Material* getMaterial(int n) const
                                           {return m_triangleIndex2Material[n];}
     // ------------------------------------------------------------------------
+    /** Returns the number of triangles in this mesh. */
+    unsigned int getNumTriangles() const
+                             { return m_triangleIndex2Material.size(); }
+    // ------------------------------------------------------------------------
     const btCollisionShape &getCollisionShape() const
                                           { return *m_collision_shape; }
     // ------------------------------------------------------------------------
@@ -71,6 +105,9 @@ public:
     bool castRay(const btVector3 &from, const btVector3 &to,
                  btVector3 *xyz, const Material **material,
                  btVector3 *normal=NULL) const;
+    void castRays(const AlignedArray<btVector3> &from,
+                  const AlignedArray<btVector3> &to,
+                  AlignedArray<RayHit> *hits) const;
     // ------------------------------------------------------------------------
     /** Returns the points of the 'indx' triangle.
      *  \param indx Index of the triangle to get.
@@ -20,6 +20,12 @@
 #include "io/file_manager.hpp"
 #include "race/race_manager.hpp"
 
+#include <algorithm>
+
+#ifdef WIN32
+#  include <windows.h>
+#endif
+
 // -----------------------------------------------------------------------------
 ReplayBase::ReplayBase()
 {
@@ -27,20 +33,187 @@ ReplayBase::ReplayBase()
 }   // ReplayBaese
 // -----------------------------------------------------------------------------
 /** Opens a replay file (depending on the track name, which is taken from
- *  the race manager).
+ *  the race manager). A file opened for writing is a temporary file, which
+ *  replaces the replay file in closeReplayFile: the replay file might be
+ *  memory mapped by the ghost karts of the current race, and must not be
+ *  truncated.
  *  \param writeable True if the file should be opened for writing.
  *  \return A FILE *, or NULL if the file could not be opened.
  */
 FILE* ReplayBase::openReplayFile(bool writeable)
 {
+    const char *suffix = writeable ? ".tmp" : "";
     m_filename = file_manager->getUserConfigFile(
                                        race_manager->getTrackName()+".replay");
-    FILE *fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+    FILE *fd = fopen((m_filename+suffix).c_str(), writeable ? "wb" : "rb");
     if(!fd)
     {
         m_filename = race_manager->getTrackName()+".replay";
-        fd = fopen(m_filename.c_str(), writeable ? "w" : "r");
+        fd = fopen((m_filename+suffix).c_str(), writeable ? "wb" : "rb");
     }
     return fd;
 
 }   // openReplayFilen
+
+// -----------------------------------------------------------------------------
+/** Closes a replay file opened for writing, and replaces the replay file
+ *  with it. On POSIX systems a ghost kart reading the old file keeps its
+ *  mapping of the old data.
+ *  \param fd The file returned by openReplayFile(true).
+ *  \param ok False if writing failed, in which case the old replay file
+ *         is kept.
+ *  \return True if the replay file was replaced.
+ */
+bool ReplayBase::closeReplayFile(FILE *fd, bool ok)
+{
+    const std::string tmp = m_filename+".tmp";
+    if(fclose(fd)!=0)
+        ok = false;
+    if(ok)
+    {
+#ifdef WIN32
+        // rename() does not replace an existing file on windows. This fails
+        // while the file is mapped by a ghost kart.
+        ok = MoveFileExA(tmp.c_str(), m_filename.c_str(),
+                         MOVEFILE_REPLACE_EXISTING)!=0;
+#else
+        ok = rename(tmp.c_str(), m_filename.c_str())==0;
+#endif
+    }
+    if(!ok)
+        remove(tmp.c_str());
+    return ok;
+}   // closeReplayFile
+
+// -----------------------------------------------------------------------------
+/** Appends a 32 bit number in little endian order to a buffer. */
+void ReplayBase::writeUInt32(std::vector<unsigned char> *buffer, uint32_t n)
+{
+    buffer->push_back( n        & 0xff);
+    buffer->push_back((n >>  8) & 0xff);
+    buffer->push_back((n >> 16) & 0xff);
+    buffer->push_back((n >> 24) & 0xff);
+}   // writeUInt32
+
+// -----------------------------------------------------------------------------
+/** Appends a float in little endian order to a buffer. */
+void ReplayBase::writeFloat(std::vector<unsigned char> *buffer, float f)
+{
+    union { uint32_t i; float f; } u;
+    u.f = f;
+    writeUInt32(buffer, u.i);
+}   // writeFloat
+
+// -----------------------------------------------------------------------------
+/** Appends a string (its length followed by the characters) to a buffer. */
+void ReplayBase::writeString(std::vector<unsigned char> *buffer,
+                             const std::string &s)
+{
+    writeUInt32(buffer, (uint32_t)s.size());
+    buffer->insert(buffer->end(), s.begin(), s.end());
+}   // writeString
+
+// =============================================================================
+ReplayBase::TransformStream::TransformStream()
+{
+    m_data        = NULL;
+    m_count       = 0;
+    m_index       = NULL;
+    m_index_count = 0;
+}   // TransformStream
+
+// -----------------------------------------------------------------------------
+/** Adds a transform, used when reading a text replay file. */
+void ReplayBase::TransformStream::add(float time, const btTransform &transform)
+{
+    assert(!m_data);
+    TransformEvent e;
+    e.m_time      = time;
+    e.m_transform = transform;
+    m_events.push_back(e);
+}   // add
+
+// -----------------------------------------------------------------------------
+/** Uses the transforms of a memory mapped binary replay file. The data must
+ *  stay valid as long as this object is used.
+ *  \param data Start of the transforms.
+ *  \param count Number of transforms.
+ *  \param index Start of the seek index.
+ *  \param index_count Number of entries in the seek index.
+ */
+void ReplayBase::TransformStream::setMapped(const unsigned char *data,
+                                            unsigned int count,
+                                            const unsigned char *index,
+                                            unsigned int index_count)
+{
+    m_events.clear();
+    m_data        = data;
+    m_count       = count;
+    m_index       = index;
+    m_index_count = index_count;
+}   // setMapped
+
+// -----------------------------------------------------------------------------
+/** Returns the number of transforms. */
+unsigned int ReplayBase::TransformStream::size() const
+{
+    return m_data ? m_count : (unsigned int)m_events.size();
+}   // size
+
+// -----------------------------------------------------------------------------
+/** Returns the time of the i-th transform. */
+float ReplayBase::TransformStream::getTime(unsigned int i) const
+{
+    assert(i<size());
+    if(!m_data)
+        return m_events[i].m_time;
+    return readFloat(m_data + i*TRANSFORM_SIZE);
+}   // getTime
+
+// -----------------------------------------------------------------------------
+/** Returns the i-th transform. */
+btTransform ReplayBase::TransformStream::getTransform(unsigned int i) const
+{
+    assert(i<size());
+    if(!m_data)
+        return m_events[i].m_transform;
+    const unsigned char *p = m_data + i*TRANSFORM_SIZE;
+    btVector3    xyz(readFloat(p+ 4), readFloat(p+ 8), readFloat(p+12));
+    btQuaternion q  (readFloat(p+16), readFloat(p+20), readFloat(p+24),
+                     readFloat(p+28));
+    return btTransform(q, xyz);
+}   // getTransform
+
+// -----------------------------------------------------------------------------
+/** Returns the index of the last transform with a time not later than the
+ *  given time (or 0 if there is none). The seek index of a binary file
+ *  is used to limit the search to INDEX_STRIDE transforms.
+ */
+unsigned int ReplayBase::TransformStream::find(float time) const
+{
+    unsigned int low = 0, high = size();
+    if(m_data && m_index_count>0)
+    {
+        // Find the last index entry not later than time
+        unsigned int a = 0, b = m_index_count;
+        while(b-a>1)
+        {
+            unsigned int m = (a+b)/2;
+            if(readFloat(m_index + m*INDEX_SIZE) <= time)
+                a = m;
+            else
+                b = m;
+        }
+        low  = readUInt32(m_index + a*INDEX_SIZE + 4);
+        high = std::min(low+INDEX_STRIDE+1, size());
+    }
+    while(high-low>1)
+    {
+        unsigned int m = (low+high)/2;
+        if(getTime(m) <= time)
+            low = m;
+        else
+            high = m;
+    }
+    return low;
+}   // find
@@ -21,11 +21,29 @@
 
 #include "LinearMath/btTransform.h"
 #include "utils/no_copy.hpp"
+#include "utils/types.hpp"
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 /**
+  * \brief Base class for recording and playing replays.
+  *
+  * Replays are saved in a binary format, which can be used directly from
+  * a memory mapping of the file. All numbers are 32 bit little endian
+  * (floats as IEEE 754), strings are stored as their length followed by
+  * the characters:
+  *
+  *  - Header: magic 'STKR', version, difficulty, number of laps, track name,
+  *    number of karts.
+  *  - For each kart a directory entry: kart name, then number and file
+  *    offset of the transforms, of the events, and of the seek index.
+  *  - The chunks: a transform is a time, position (3 floats) and rotation
+  *    (4 floats); an event is a time and type; the seek index contains for
+  *    every INDEX_STRIDE-th transform its time and number.
+  *
+  * Old replays in the text format can still be read.
   * \ingroup race
   */
 class ReplayBase : public NoCopy
@@ -62,16 +80,78 @@ protected:
     };   // KartReplayEvent
 
     // ------------------------------------------------------------------------
+    /** Gives access to the transforms of a kart, either stored in memory
+     *  (when read from a text replay file) or read on demand from a
+     *  memory mapped binary replay file. */
+    class TransformStream
+    {
+    private:
+        /** The transforms if not read from a binary file. */
+        std::vector<TransformEvent> m_events;
+        /** Start of the transform chunk in a binary file, or NULL. */
+        const unsigned char *m_data;
+        /** Number of transforms in the binary file. */
+        unsigned int         m_count;
+        /** Start of the seek index in a binary file. */
+        const unsigned char *m_index;
+        /** Number of entries in the seek index. */
+        unsigned int         m_index_count;
+    public:
+                     TransformStream();
+        void         add(float time, const btTransform &transform);
+        void         setMapped(const unsigned char *data, unsigned int count,
+                               const unsigned char *index,
+                               unsigned int index_count);
+        unsigned int size() const;
+        float        getTime(unsigned int i) const;
+        btTransform  getTransform(unsigned int i) const;
+        unsigned int find(float time) const;
+    };   // TransformStream
+
+    // ------------------------------------------------------------------------
+    /** Identifies a binary replay file ('STKR'). */
+    static const uint32_t BINARY_MAGIC = 0x524B5453;
+    /** Size of a transform and of an event in a binary replay file. */
+    static const unsigned int TRANSFORM_SIZE = 8*4;
+    static const unsigned int EVENT_SIZE     = 2*4;
+    /** Size of an entry of the seek index. */
+    static const unsigned int INDEX_SIZE     = 2*4;
+    /** Number of transforms between two entries of the seek index. */
+    static const unsigned int INDEX_STRIDE   = 64;
+
+    // ------------------------------------------------------------------------
+    /** Reads a little endian 32 bit number. */
+    static uint32_t readUInt32(const unsigned char *p)
+    {
+        return  (uint32_t)p[0]        | ((uint32_t)p[1] <<  8) |
+               ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }   // readUInt32
+    // ------------------------------------------------------------------------
+    /** Reads a little endian float. */
+    static float readFloat(const unsigned char *p)
+    {
+        union { uint32_t i; float f; } u;
+        u.i = readUInt32(p);
+        return u.f;
+    }   // readFloat
+    // ------------------------------------------------------------------------
+    static void writeUInt32(std::vector<unsigned char> *buffer, uint32_t n);
+    static void writeFloat(std::vector<unsigned char> *buffer, float f);
+    static void writeString(std::vector<unsigned char> *buffer,
+                            const std::string &s);
+
           ReplayBase();
     FILE *openReplayFile(bool writeable);
+    bool  closeReplayFile(FILE *fd, bool ok);
     // ----------------------------------------------------------------------
     /** Returns the filename that was opened. */
     const std::string &getReplayFilename() const { return m_filename;}
     // ----------------------------------------------------------------------
     /** Returns the version number of the replay file. This is used to check
      *  that a loaded replay file can still be understood by this
-     *  executable. */
-    unsigned int getReplayVersion() const { return 1; }
+     *  executable. Version 1 is the text format, version 2 the first
+     *  binary format. */
+    unsigned int getReplayVersion() const { return 2; }
 };   // ReplayBase
 
 #endif
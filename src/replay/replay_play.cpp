@@ -78,12 +78,14 @@ void ReplayPlay::update(float dt)
 }   // update
 
 //-----------------------------------------------------------------------------
-/** Loads a replay data from  file called 'trackname'.replay.
+/** Loads a replay data from  file called 'trackname'.replay. Binary replay
+ *  files are used through a memory mapping, older text replay files are
+ *  parsed completely.
  */
 void ReplayPlay::Load()
 {
     m_ghost_karts.clearAndDeleteAll();
-    char s[1024], s1[1024];
+    m_replay_file.close();
 
     FILE *fd = openReplayFile(/*writeable*/false);
     if(!fd)
@@ -96,6 +98,151 @@ void ReplayPlay::Load()
 
     printf("Reading replay file '%s'.\n", getReplayFilename().c_str());
 
+    unsigned char magic[4];
+    if(fread(magic, 1, 4, fd)==4 && readUInt32(magic)==BINARY_MAGIC)
+    {
+        fclose(fd);
+        if(!loadBinary())
+        {
+            fprintf(stderr, "ERROR: replay file '%s' is corrupt, ghost "
+                            "replay disabled.\n",
+                    getReplayFilename().c_str());
+            m_ghost_karts.clearAndDeleteAll();
+            destroy();
+        }
+        return;
+    }
+    rewind(fd);
+    loadText(fd);
+}   // Load
+
+//-----------------------------------------------------------------------------
+/** Reads a number from the binary replay file.
+ *  \param offset Offset in the file, which is increased.
+ *  \param n On return the number read.
+ *  \return False if the end of the file was reached.
+ */
+bool ReplayPlay::getUInt32(size_t *offset, uint32_t *n) const
+{
+    if(*offset+4 > m_replay_file.getSize())
+        return false;
+    *n = readUInt32(m_replay_file.getData() + *offset);
+    *offset += 4;
+    return true;
+}   // getUInt32
+
+//-----------------------------------------------------------------------------
+/** Reads a string from the binary replay file.
+ *  \param offset Offset in the file, which is increased.
+ *  \param s On return the string read.
+ *  \return False if the end of the file was reached.
+ */
+bool ReplayPlay::getString(size_t *offset, std::string *s) const
+{
+    uint32_t length;
+    if(!getUInt32(offset, &length) ||
+       length > m_replay_file.getSize() - *offset)
+        return false;
+    s->assign((const char*)m_replay_file.getData() + *offset, length);
+    *offset += length;
+    return true;
+}   // getString
+
+//-----------------------------------------------------------------------------
+/** Loads a binary replay file. Only the header, the directory and the events
+ *  are read here, the ghost karts read the transforms from the mapped file
+ *  when they are needed.
+ *  \return False if the file could not be read or is corrupt.
+ */
+bool ReplayPlay::loadBinary()
+{
+    if(!m_replay_file.open(getReplayFilename()))
+        return false;
+
+    const unsigned char *data = m_replay_file.getData();
+    const size_t         size = m_replay_file.getSize();
+    size_t offset = 4;   // skip magic
+
+    uint32_t version, difficulty, num_laps, num_karts;
+    std::string track;
+    if(!getUInt32(&offset, &version)    ||
+       !getUInt32(&offset, &difficulty) ||
+       !getUInt32(&offset, &num_laps)   ||
+       !getString(&offset, &track)      ||
+       !getUInt32(&offset, &num_karts)     )
+        return false;
+
+    if (version!=getReplayVersion())
+    {
+        fprintf(stderr, "WARNING: replay is version '%d'\n",version);
+        fprintf(stderr, "         STK version is '%d'\n",getReplayVersion());
+        fprintf(stderr, "         We try to proceed, but it may fail.\n");
+    }
+    if(race_manager->getDifficulty()!=(RaceManager::Difficulty)difficulty)
+        printf("Warning, difficulty of replay is '%d', "
+               "while '%d' is selected.\n",
+               race_manager->getDifficulty(), difficulty);
+    if(track!=race_manager->getTrackName())
+        fprintf(stderr, "WARNING: replay is for track '%s'.\n",
+                track.c_str());
+    race_manager->setTrack(track);
+    race_manager->setNumLaps(num_laps);
+
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        std::string ident;
+        uint32_t num_transforms, transform_offset, num_events, event_offset,
+                 index_count, index_offset;
+        if(!getString(&offset, &ident)                 ||
+           !getUInt32(&offset, &num_transforms)        ||
+           !getUInt32(&offset, &transform_offset)      ||
+           !getUInt32(&offset, &num_events)            ||
+           !getUInt32(&offset, &event_offset)          ||
+           !getUInt32(&offset, &index_count)           ||
+           !getUInt32(&offset, &index_offset)             )
+            return false;
+
+        // Make sure that all chunks are inside of the file
+        if(transform_offset > size || index_offset > size ||
+           event_offset > size                                          ||
+           num_transforms > (size-transform_offset)/TRANSFORM_SIZE     ||
+           num_events     > (size-event_offset)/EVENT_SIZE             ||
+           index_count    > (size-index_offset)/INDEX_SIZE               )
+            return false;
+        for(unsigned int i=0; i<index_count; i++)
+        {
+            if(readUInt32(data+index_offset+i*INDEX_SIZE+4)>=num_transforms)
+                return false;
+        }
+
+        GhostKart *ghost = new GhostKart(ident);
+        m_ghost_karts.push_back(ghost);
+        ghost->init(RaceManager::KT_GHOST);
+        ghost->setMappedTransforms(data+transform_offset, num_transforms,
+                                   data+index_offset, index_count);
+
+        for(unsigned int i=0; i<num_events; i++)
+        {
+            const unsigned char *p = data + event_offset + i*EVENT_SIZE;
+            KartReplayEvent kre;
+            kre.m_time = readFloat(p);
+            kre.m_type = (KartReplayEvent::KartReplayEventType)
+                         readUInt32(p+4);
+            ghost->addReplayEvent(kre);
+        }
+    }   // for k<num_karts
+
+    return true;
+}   // loadBinary
+
+//-----------------------------------------------------------------------------
+/** Loads a replay file in the old text format.
+ *  \param fd The opened replay file.
+ */
+void ReplayPlay::loadText(FILE *fd)
+{
+    char s[1024], s1[1024];
+
     if (fgets(s, 1023, fd) == NULL)
     {
         fprintf(stderr, "ERROR: could not read '%s'.\n",
@@ -111,10 +258,11 @@ void ReplayPlay::Load()
         exit(-2);
     }
 
-    if (version!=getReplayVersion())
+    // Version 1 is the only text version
+    if (version!=1)
     {
         fprintf(stderr, "WARNING: replay is version '%d'\n",version);
-        fprintf(stderr, "         STK version is '%d'\n",getReplayVersion());
+        fprintf(stderr, "         Text replays are version '1'\n");
         fprintf(stderr, "         We try to proceed, but it may fail.\n");
     }
 
@@ -163,9 +311,8 @@ void ReplayPlay::Load()
         readKartData(fd, s);
     }   // for k<num_ghost_karts
 
-    fprintf(fd, "Replay file end.\n");
     fclose(fd);
-}   // Load
+}   // loadText
 
 //-----------------------------------------------------------------------------
 /** Reads all data from a replay file for a specific kart.
@@ -19,6 +19,7 @@
 #ifndef HEADER_REPLAY__PLAY_HPP
 #define HEADER_REPLAY__PLAY_HPP
 
+#include "io/mapped_file.hpp"
 #include "replay/replay_base.hpp"
 #include "utils/ptr_vector.hpp"
 
@@ -41,9 +42,17 @@ private:
     /** All ghost karts. */
     PtrVector<GhostKart>    m_ghost_karts;
 
+    /** The binary replay file. The ghost karts read their transforms
+     *  directly from it, so it must stay open while they exist. */
+    MappedFile              m_replay_file;
+
           ReplayPlay();
          ~ReplayPlay();
+    bool  loadBinary();
+    void  loadText(FILE *fd);
     void  readKartData(FILE *fd, char *next_line);
+    bool  getUInt32(size_t *offset, uint32_t *n) const;
+    bool  getString(size_t *offset, std::string *s) const;
 public:
     void  init();
     void  update(float dt);
@@ -158,44 +158,90 @@ void ReplayRecorder::Save()
         return;
     }
 
-    printf("Replay saved in '%s'.\n", getReplayFilename().c_str());
-
     World *world   = World::getWorld();
     unsigned int num_karts = world->getNumKarts();
-    fprintf(fd, "Version:  %d\n",   getReplayVersion());
-    fprintf(fd, "difficulty: %d\n", race_manager->getDifficulty());
-    fprintf(fd, "track: %s\n",      world->getTrack()->getIdent().c_str());
-    fprintf(fd, "Laps: %d\n",       race_manager->getNumLaps());
 
+    // Only keep the first of several transforms with the same time, the
+    // ghost kart can't interpolate between them.
+    std::vector< std::vector<unsigned int> > transforms(num_karts);
     for(unsigned int k=0; k<num_karts; k++)
     {
-        fprintf(fd, "model: %s\n", world->getKart(k)->getIdent().c_str());
-        fprintf(fd, "size:     %d\n", m_count_transforms[k]);
-
         unsigned int num_transforms =
             std::min((unsigned int)stk_config->m_max_history,
                       m_count_transforms[k]                   );
         for(unsigned int i=0; i<num_transforms; i++)
         {
-            const TransformEvent *p=&(m_transform_events[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW()
-                );
+            if(i>0 && m_transform_events[k][i].m_time ==
+                      m_transform_events[k][transforms[k].back()].m_time)
+                continue;
+            transforms[k].push_back(i);
+        }
+    }   // for k<num_karts
+
+    std::vector<unsigned char> buffer;
+    writeUInt32(&buffer, BINARY_MAGIC);
+    writeUInt32(&buffer, getReplayVersion());
+    writeUInt32(&buffer, race_manager->getDifficulty());
+    writeUInt32(&buffer, race_manager->getNumLaps());
+    writeString(&buffer, world->getTrack()->getIdent());
+    writeUInt32(&buffer, num_karts);
+
+    // The directory: the offsets of the chunks are only known once the
+    // directory is complete, so remember where to write them.
+    std::vector<size_t> directory(num_karts);
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        writeString(&buffer, world->getKart(k)->getIdent());
+        directory[k] = buffer.size();
+        for(unsigned int i=0; i<6; i++)
+            writeUInt32(&buffer, 0);
+    }
+
+    for(unsigned int k=0; k<num_karts; k++)
+    {
+        std::vector<unsigned char> entry;
+        const std::vector<unsigned int> &all = transforms[k];
+        writeUInt32(&entry, (uint32_t)all.size());
+        writeUInt32(&entry, (uint32_t)buffer.size());
+        for(unsigned int i=0; i<all.size(); i++)
+        {
+            const TransformEvent *p=&(m_transform_events[k][all[i]]);
+            writeFloat(&buffer, p->m_time);
+            writeFloat(&buffer, p->m_transform.getOrigin().getX());
+            writeFloat(&buffer, p->m_transform.getOrigin().getY());
+            writeFloat(&buffer, p->m_transform.getOrigin().getZ());
+            writeFloat(&buffer, p->m_transform.getRotation().getX());
+            writeFloat(&buffer, p->m_transform.getRotation().getY());
+            writeFloat(&buffer, p->m_transform.getRotation().getZ());
+            writeFloat(&buffer, p->m_transform.getRotation().getW());
         }   // for i
-        fprintf(fd, "events: %d\n", (int)m_kart_replay_event[k].size());
+
+        writeUInt32(&entry, (uint32_t)m_kart_replay_event[k].size());
+        writeUInt32(&entry, (uint32_t)buffer.size());
         for(unsigned int i=0; i<m_kart_replay_event[k].size(); i++)
         {
             const KartReplayEvent *p=&(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f %d\n", p->m_time, p->m_type);
+            writeFloat (&buffer, p->m_time);
+            writeUInt32(&buffer, p->m_type);
         }
-    }
-    fclose(fd);
+
+        const unsigned int index_count =
+            (all.size()+INDEX_STRIDE-1)/INDEX_STRIDE;
+        writeUInt32(&entry, index_count);
+        writeUInt32(&entry, (uint32_t)buffer.size());
+        for(unsigned int i=0; i<all.size(); i+=INDEX_STRIDE)
+        {
+            writeFloat (&buffer, m_transform_events[k][all[i]].m_time);
+            writeUInt32(&buffer, i);
+        }
+        std::copy(entry.begin(), entry.end(), buffer.begin()+directory[k]);
+    }   // for k<num_karts
+
+    bool ok = fwrite(&(buffer[0]), 1, buffer.size(), fd)==buffer.size();
+    if(closeReplayFile(fd, ok))
+        printf("Replay saved in '%s'.\n", getReplayFilename().c_str());
+    else
+        printf("Could not write all replay data to '%s'.\n",
+               getReplayFilename().c_str());
 }   // Save
 
@@ -45,8 +45,6 @@ AmbientLightSphere::AmbientLightSphere(const XMLNode &node,
 // ----------------------------------------------------------------------------
 void AmbientLightSphere::update(float dt)
 {
-    CheckStructure::update(dt);
-
     World *world = World::getWorld();
     for(unsigned int i=0; i<Camera::getNumCameras(); i++)
     {
@@ -22,6 +22,8 @@
 #include "tracks/track.hpp"
 #include "tracks/track_object_manager.hpp"
 #include "modes/soccer_world.hpp"
+#include <algorithm>
+#include <float.h>
 #include <stdio.h>
 
 /** Constructor for a check goal line.
@@ -127,3 +129,16 @@ void CheckGoal::reset(const Track &track)
         m_previous_position.push_back(xyz);
     }
 }   // reset
+
+// ----------------------------------------------------------------------------
+/** Returns the box in which the goal line can be crossed. The height is
+ *  not tested when crossing a goal line.
+ */
+bool CheckGoal::getBoundingBox(Vec3 *min, Vec3 *max) const
+{
+    *min = Vec3(std::min(m_line.start.X, m_line.end.X), -FLT_MAX,
+                std::min(m_line.start.Y, m_line.end.Y));
+    *max = Vec3(std::max(m_line.start.X, m_line.end.X),  FLT_MAX,
+                std::max(m_line.start.Y, m_line.end.Y));
+    return true;
+}   // getBoundingBox
@@ -36,9 +36,6 @@
 CheckLine::CheckLine(const XMLNode &node,  unsigned int index)
          : CheckStructure(node, index)
 {
-    // Note that when this is called the karts have not been allocated
-    // in world, so we can't call world->getNumKarts()
-    m_previous_sign.resize(race_manager->getNumberOfKarts());
     std::string p1_string("p1");
     std::string p2_string("p2");
 
@@ -115,15 +112,19 @@ CheckLine::~CheckLine()
 
 }   // CheckLine
 // ----------------------------------------------------------------------------
-void CheckLine::reset(const Track &track)
+/** Returns the box in which this line can be crossed, i.e. the 2d line
+ *  extended by the allowed height differences.
+ */
+bool CheckLine::getBoundingBox(Vec3 *min, Vec3 *max) const
 {
-    CheckStructure::reset(track);
-    for(unsigned int i=0; i<m_previous_sign.size(); i++)
-    {
-        core::vector2df p = m_previous_position[i].toIrrVector2d();
-        m_previous_sign[i] = m_line.getPointOrientation(p)>=0;
-    }
-}   // reset
+    *min = Vec3(std::min(m_line.start.X, m_line.end.X),
+                m_min_height - m_under_min_height,
+                std::min(m_line.start.Y, m_line.end.Y));
+    *max = Vec3(std::max(m_line.start.X, m_line.end.X),
+                m_min_height + m_over_min_height,
+                std::max(m_line.start.Y, m_line.end.Y));
+    return true;
+}   // getBoundingBox
 
 // ----------------------------------------------------------------------------
 void CheckLine::changeDebugColor(bool is_active)
@@ -154,10 +155,12 @@ bool CheckLine::isTriggered(const Vec3 &old_pos, const Vec3 &new_pos,
 {
     core::vector2df p=new_pos.toIrrVector2d();
     bool sign = m_line.getPointOrientation(p)>=0;
+    bool previous_sign =
+        m_line.getPointOrientation(old_pos.toIrrVector2d())>=0;
     bool result;
     // If the sign has changed, i.e. the infinite line was crossed somewhere,
     // check if the finite line was actually crossed:
-    if(sign!=m_previous_sign[indx] &&
+    if(sign!=previous_sign &&
         m_line.intersectWith(core::line2df(old_pos.toIrrVector2d(),
                                            new_pos.toIrrVector2d()),
                              m_cross_point) )
@@ -185,6 +188,5 @@ bool CheckLine::isTriggered(const Vec3 &old_pos, const Vec3 &new_pos,
     }
     else
         result = false;
-    m_previous_sign[indx] = sign;
     return result;
 }   // isTriggered
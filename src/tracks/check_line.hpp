@@ -56,11 +56,6 @@ private:
      *  points are set from the 2d points and the min height. */
     Vec3            m_left_point, m_right_point;
 
-    /** Stores the sign (i.e. side) of the previous line to save some
-     *  computations. True if the value is >=0, i.e. the point is on
-     *  or to the right of the line. */
-    std::vector<bool> m_previous_sign;
-
     /** Used to display debug information about checklines. */
     scene::IMeshSceneNode *m_debug_node;
 
@@ -76,8 +71,8 @@ public:
     virtual     ~CheckLine();
     virtual bool isTriggered(const Vec3 &old_pos, const Vec3 &new_pos,
                              unsigned int indx);
-    virtual void reset(const Track &track);
     virtual void changeDebugColor(bool is_active);
+    virtual bool getBoundingBox(Vec3 *min, Vec3 *max) const;
     /** Returns the actual line data for this checkpoint. */
     const core::line2df &getLine2D() const {return m_line;}
     // ------------------------------------------------------------------------
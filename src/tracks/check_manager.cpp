@@ -22,6 +22,8 @@
 #include <algorithm>
 
 #include "io/xml_node.hpp"
+#include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
 #include "tracks/ambient_light_sphere.hpp"
 #include "tracks/check_cannon.hpp"
 #include "tracks/check_goal.hpp"
@@ -92,8 +94,123 @@ void CheckManager::load(const XMLNode &node)
         }
 
     }
+    buildGrid();
 }   // load
 
+// ----------------------------------------------------------------------------
+/** Sorts all check structures with a bounding box into a 2d grid, so that
+ *  only the check structures close to a kart need to be tested.
+ */
+void CheckManager::buildGrid()
+{
+    m_always_tested.clear();
+    m_grid.clear();
+    m_box_min.resize(m_all_checks.size());
+    m_box_max.resize(m_all_checks.size());
+
+    bool has_box = false;
+    Vec3 all_min, all_max;
+    for(unsigned int i=0; i<m_all_checks.size(); i++)
+    {
+        if(!m_all_checks[i]->getBoundingBox(&m_box_min[i], &m_box_max[i]))
+        {
+            m_always_tested.push_back(i);
+            continue;
+        }
+        if(!has_box)
+        {
+            all_min = m_box_min[i];
+            all_max = m_box_max[i];
+            has_box = true;
+        }
+        else
+        {
+            all_min.min(m_box_min[i]);
+            all_max.max(m_box_max[i]);
+        }
+    }   // for i<m_all_checks.size()
+
+    m_grid_width = m_grid_height = 0;
+    if(!has_box) return;
+
+    // Use at most 64x64 cells, but don't make the cells smaller than a
+    // kart moves in a few frames.
+    const float extent = std::max(all_max.getX()-all_min.getX(),
+                                  all_max.getZ()-all_min.getZ());
+    m_cell_size    = std::max(extent/64.0f, 10.0f);
+    m_grid_min_x   = all_min.getX();
+    m_grid_min_z   = all_min.getZ();
+    m_grid_width   = (int)((all_max.getX()-m_grid_min_x)/m_cell_size) + 1;
+    m_grid_height  = (int)((all_max.getZ()-m_grid_min_z)/m_cell_size) + 1;
+    m_grid.resize(m_grid_width*m_grid_height);
+
+    for(unsigned int i=0; i<m_all_checks.size(); i++)
+    {
+        if(std::find(m_always_tested.begin(), m_always_tested.end(), i)
+            != m_always_tested.end())
+            continue;
+        const int x0 = (int)((m_box_min[i].getX()-m_grid_min_x)/m_cell_size);
+        const int x1 = (int)((m_box_max[i].getX()-m_grid_min_x)/m_cell_size);
+        const int z0 = (int)((m_box_min[i].getZ()-m_grid_min_z)/m_cell_size);
+        const int z1 = (int)((m_box_max[i].getZ()-m_grid_min_z)/m_cell_size);
+        for(int z=z0; z<=z1; z++)
+            for(int x=x0; x<=x1; x++)
+                m_grid[z*m_grid_width+x].push_back(i);
+    }
+}   // buildGrid
+
+// ----------------------------------------------------------------------------
+/** Finds all check structures that could be triggered when moving from
+ *  'from' to 'to', i.e. the ones whose bounding box overlaps the bounding
+ *  box of the movement, and the ones that are always tested.
+ *  \param from Start of the movement.
+ *  \param to End of the movement.
+ *  \param candidates On return the indices of the check structures to test,
+ *         sorted by index so that they are triggered in the same order as
+ *         when testing all check structures.
+ */
+void CheckManager::findCandidates(const Vec3 &from, const Vec3 &to,
+                                  std::vector<unsigned int> *candidates) const
+{
+    candidates->assign(m_always_tested.begin(), m_always_tested.end());
+
+    Vec3 move_min = from, move_max = from;
+    move_min.min(to);
+    move_max.max(to);
+
+    const int x0 = std::max((int)floorf((move_min.getX()-m_grid_min_x)
+                                        / m_cell_size), 0);
+    const int x1 = std::min((int)floorf((move_max.getX()-m_grid_min_x)
+                                        / m_cell_size), m_grid_width-1);
+    const int z0 = std::max((int)floorf((move_min.getZ()-m_grid_min_z)
+                                        / m_cell_size), 0);
+    const int z1 = std::min((int)floorf((move_max.getZ()-m_grid_min_z)
+                                        / m_cell_size), m_grid_height-1);
+    for(int z=z0; z<=z1; z++)
+    {
+        for(int x=x0; x<=x1; x++)
+        {
+            const std::vector<unsigned int> &cell = m_grid[z*m_grid_width+x];
+            for(unsigned int j=0; j<cell.size(); j++)
+            {
+                const unsigned int i = cell[j];
+                if(m_box_min[i].getX() <= move_max.getX() &&
+                   m_box_max[i].getX() >= move_min.getX() &&
+                   m_box_min[i].getY() <= move_max.getY() &&
+                   m_box_max[i].getY() >= move_min.getY() &&
+                   m_box_min[i].getZ() <= move_max.getZ() &&
+                   m_box_max[i].getZ() >= move_min.getZ()    )
+                    candidates->push_back(i);
+            }
+        }
+    }
+
+    // A check structure can be in several cells
+    std::sort(candidates->begin(), candidates->end());
+    candidates->erase(std::unique(candidates->begin(), candidates->end()),
+                      candidates->end());
+}   // findCandidates
+
 // ----------------------------------------------------------------------------
 /** Private destructor (to make sure it is only called using the static
  *  destroy function). Frees all check structures.
@@ -115,14 +232,83 @@ void CheckManager::reset(const Track &track)
     std::vector<CheckStructure*>::iterator i;
     for(i=m_all_checks.begin(); i!=m_all_checks.end(); i++)
         (*i)->reset(track);
+
+    m_previous_position.clear();
+    m_skipped_position.clear();
+    World *world = World::getWorld();
+    for(unsigned int k=0; k<world->getNumKarts(); k++)
+    {
+        m_previous_position.push_back(world->getKart(k)->getXYZ());
+        m_skipped_position.push_back(world->getKart(k)->getXYZ());
+    }
+    m_first_skipped.assign(world->getNumKarts(), -1);
 }   // reset
 
+// ----------------------------------------------------------------------------
+/** Tests the movement of a kart against all check structures with an index
+ *  in [first, last) that are close to this movement.
+ *  \param kart_index Index of the kart.
+ *  \param from Start position of the movement.
+ *  \param to End position of the movement.
+ *  \return The index of the check structure that started an animation for
+ *          the kart (in which case no further structures are tested), or -1.
+ */
+int CheckManager::checkKart(unsigned int kart_index, const Vec3 &from,
+                            const Vec3 &to, unsigned int first,
+                            unsigned int last)
+{
+    AbstractKart *kart = World::getWorld()->getKart(kart_index);
+    findCandidates(from, to, &m_candidates);
+    for(unsigned int j=0; j<m_candidates.size(); j++)
+    {
+        const unsigned int i = m_candidates[j];
+        if(i<first) continue;
+        if(i>=last) break;
+        CheckStructure *cs = m_all_checks[i];
+        if(!cs->isTriggeredByKarts()) continue;
+        cs->checkKart(kart_index, from, to);
+        // E.g. a cannon starts an animation, in which case the kart is
+        // not tested against any further check structures.
+        if(kart->getKartAnimation()) return i;
+    }
+    return -1;
+}   // checkKart
+
 // ----------------------------------------------------------------------------
 /** Updates all animations. Called one per time step.
  *  \param dt Time since last call.
  */
 void CheckManager::update(float dt)
 {
+    World *world = World::getWorld();
+    for(unsigned int k=0; k<world->getNumKarts(); k++)
+    {
+        AbstractKart *kart = world->getKart(k);
+        if(kart->getKartAnimation()) continue;
+        const Vec3 &xyz = kart->getXYZ();
+        const unsigned int count = m_all_checks.size();
+        const int first_skipped = m_first_skipped[k];
+        int triggered = checkKart(k, m_previous_position[k], xyz, 0,
+                                  first_skipped<0 ? count : first_skipped);
+        if(triggered>=0)
+        {
+            // The structures after the triggered one have not seen this
+            // movement yet. If an earlier animation had skipped structures,
+            // their older start position is dropped.
+            m_skipped_position[k] = m_previous_position[k];
+            m_first_skipped[k]    = triggered+1;
+        }
+        else if(first_skipped>=0)
+        {
+            // Test the structures that were skipped when the last animation
+            // started from the position before that animation.
+            triggered = checkKart(k, m_skipped_position[k], xyz,
+                                  first_skipped, count);
+            m_first_skipped[k] = triggered>=0 ? triggered+1 : -1;
+        }
+        m_previous_position[k] = xyz;
+    }   // for k<getNumKarts
+
     std::vector<CheckStructure*>::iterator i;
     for(i=m_all_checks.begin(); i!=m_all_checks.end(); i++)
         (*i)->update(dt);
@@ -164,8 +350,11 @@ unsigned int CheckManager::getLapLineIndex() const
 int CheckManager::getChecklineTriggering(const Vec3 &from,
                                          const Vec3 &to) const
 {
-    for (unsigned int i=0; i<getCheckStructureCount(); i++)
+    std::vector<unsigned int> candidates;
+    findCandidates(from, to, &candidates);
+    for (unsigned int j=0; j<candidates.size(); j++)
     {
+        const unsigned int i = candidates[j];
         CheckStructure* c = getCheckStructure(i);
 
         // FIXME: why is the lapline skipped?
@@ -19,7 +19,9 @@
 #ifndef HEADER_CHECK_MANAGER_HPP
 #define HEADER_CHECK_MANAGER_HPP
 
+#include "utils/aligned_array.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/vec3.hpp"
 
 #include <assert.h>
 #include <string>
@@ -28,10 +30,15 @@
 class CheckStructure;
 class Track;
 class XMLNode;
-class Vec3;
 
 /**
   * \brief Controls all checks structures of a track.
+  *
+  *  To avoid testing every check structure against every kart, the check
+  *  structures are sorted into a 2d grid (on the X/Z plane) using their
+  *  bounding boxes. Each frame only the structures in the grid cells that
+  *  the movement of a kart touches are tested. Structures without a
+  *  bounding box (e.g. lap counters) are tested for all karts.
   * \ingroup tracks
   */
 class CheckManager : public NoCopy
@@ -39,10 +46,52 @@ class CheckManager : public NoCopy
 private:
     std::vector<CheckStructure*> m_all_checks;
     static CheckManager         *m_check_manager;
+
+    /** The previous position of each kart, used to test which check
+     *  structures a kart crossed. */
+    AlignedArray<Vec3>           m_previous_position;
+
+    /** When a check structure starts an animation for a kart (e.g. a
+     *  cannon), the structures with a higher index are not tested in that
+     *  frame. For each kart this stores the index of the first skipped
+     *  structure (or -1), and the position the skipped structures have to
+     *  be tested from once the animation is finished. */
+    std::vector<int>             m_first_skipped;
+    AlignedArray<Vec3>           m_skipped_position;
+
+    /** The bounding box of each check structure. */
+    AlignedArray<Vec3>           m_box_min;
+    AlignedArray<Vec3>           m_box_max;
+
+    /** Indices of check structures that have no bounding box and must
+     *  always be tested. */
+    std::vector<unsigned int>    m_always_tested;
+
+    /** For each grid cell the indices of the check structures whose
+     *  bounding box overlaps this cell. */
+    std::vector<std::vector<unsigned int> > m_grid;
+    /** Minimum X and Z coordinate of the grid. */
+    float                        m_grid_min_x, m_grid_min_z;
+    float                        m_cell_size;
+    int                          m_grid_width, m_grid_height;
+
+    /** Reused by update to avoid memory allocations. */
+    std::vector<unsigned int>    m_candidates;
+
            /** Private constructor, to make sure it is only called via
             *  the static create function. */
-           CheckManager()       {m_all_checks.clear();};
+           CheckManager() : m_grid_min_x(0), m_grid_min_z(0),
+                            m_cell_size(1), m_grid_width(0),
+                            m_grid_height(0)
+           {
+               m_all_checks.clear();
+           };
           ~CheckManager();
+    void   buildGrid();
+    void   findCandidates(const Vec3 &from, const Vec3 &to,
+                          std::vector<unsigned int> *candidates) const;
+    int    checkKart(unsigned int kart_index, const Vec3 &from,
+                     const Vec3 &to, unsigned int first, unsigned int last);
 public:
     void   load(const XMLNode &node);
     void   update(float dt);
@@ -18,6 +18,7 @@
 
 #include "tracks/check_sphere.hpp"
 
+#include <math.h>
 #include <string>
 #include <stdio.h>
 
@@ -68,3 +69,15 @@ bool CheckSphere::isTriggered(const Vec3 &old_pos, const Vec3 &new_pos,
     return (old_dist2>=m_radius2 && new_dist2 < m_radius2) ||
            (old_dist2< m_radius2 && new_dist2 >=m_radius2);
 }   // isTriggered
+
+// ----------------------------------------------------------------------------
+/** Returns the bounding box of the sphere. A kart can only enter or leave
+ *  the sphere if its movement touches this box.
+ */
+bool CheckSphere::getBoundingBox(Vec3 *min, Vec3 *max) const
+{
+    const float r = sqrtf(m_radius2);
+    *min = m_center_point - Vec3(r, r, r);
+    *max = m_center_point + Vec3(r, r, r);
+    return true;
+}   // getBoundingBox
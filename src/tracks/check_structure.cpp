@@ -72,8 +72,8 @@ CheckStructure::CheckStructure(const XMLNode &node, unsigned int index)
 }   // CheckStructure
 
 // ----------------------------------------------------------------------------
-/** Initialises the 'previous positions' of all karts with the start position
- *  defined for this track.
+/** Resets the active state of this check structure for all karts. The
+ *  previous positions of the karts are kept by the CheckManager.
  *  \param track The track object defining the start positions.
  */
 void CheckStructure::reset(const Track &track)
@@ -84,36 +84,32 @@ void CheckStructure::reset(const Track &track)
     World *world = World::getWorld();
     for(unsigned int i=0; i<world->getNumKarts(); i++)
     {
-        const Vec3 &xyz = world->getKart(i)->getXYZ();
-        m_previous_position.push_back(xyz);
-
         // Activate all checkline
         m_is_active.push_back(m_active_at_reset);
     }   // for i<getNumKarts
 }   // reset
 
 // ----------------------------------------------------------------------------
-/** Updates all check structures. Called one per time step.
- *  \param dt Time since last call.
+/** Tests if a kart triggers this check structure, and if so triggers it.
+ *  This is called by the check manager for all karts that are close to
+ *  this check structure.
+ *  \param kart_index Index of the kart.
+ *  \param old_pos Position of the kart in the previous frame.
+ *  \param new_pos Current position of the kart.
  */
-void CheckStructure::update(float dt)
+void CheckStructure::checkKart(unsigned int kart_index, const Vec3 &old_pos,
+                               const Vec3 &new_pos)
 {
-    World *world = World::getWorld();
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
+    // Only check active checklines.
+    if(m_is_active[kart_index] && isTriggered(old_pos, new_pos, kart_index))
     {
-        const Vec3 &xyz = world->getKart(i)->getXYZ();
-        if(world->getKart(i)->getKartAnimation()) continue;
-        // Only check active checklines.
-        if(m_is_active[i] && isTriggered(m_previous_position[i], xyz, i))
-        {
-            if(UserConfigParams::m_check_debug)
-                printf("CHECK: Check structure %d triggered for kart %s.\n",
-                       m_index, world->getKart(i)->getIdent().c_str());
-            trigger(i);
-        }
-        m_previous_position[i] = xyz;
-    }   // for i<getNumKarts
-}   // update
+        if(UserConfigParams::m_check_debug)
+            printf("CHECK: Check structure %d triggered for kart %s.\n",
+                   m_index,
+                   World::getWorld()->getKart(kart_index)->getIdent().c_str());
+        trigger(kart_index);
+    }
+}   // checkKart
 
 // ----------------------------------------------------------------------------
 /** Changes the status (active/inactive) of all check structures contained
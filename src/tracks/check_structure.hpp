@@ -67,9 +67,9 @@ public:
                     CT_GOAL, CT_AMBIENT_SPHERE};
 
 protected:
-    /** Stores the previous position of all karts. This is needed to detect
-     *  when e.g. a check point is reached the first time, or a checkline is
-     *  crossed. */
+    /** Stores the previous position of objects that are tested by the check
+     *  structure itself, e.g. the soccer balls for goals. The previous kart
+     *  positions are stored in the check manager. */
     AlignedArray<Vec3> m_previous_position;
     /** Stores if this check structure is active (for a given kart). */
     std::vector<bool> m_is_active;
@@ -104,7 +104,10 @@ private:
 public:
                 CheckStructure(const XMLNode &node, unsigned int index);
     virtual    ~CheckStructure() {};
-    virtual void update(float dt);
+    /** Called once per time step after all karts were tested. */
+    virtual void update(float dt) {};
+    void         checkKart(unsigned int kart_index, const Vec3 &old_pos,
+                           const Vec3 &new_pos);
     virtual void changeDebugColor(bool is_active) {}
     /** True if going from old_pos to new_pos crosses this checkline. This function
      *  is called from update (of the checkline structure).
@@ -117,6 +120,14 @@ public:
                              unsigned int indx)=0;
     virtual void trigger(unsigned int kart_index);
     virtual void reset(const Track &track);
+    /** Returns a box that contains all places in which this check structure
+     *  can be triggered, which is used by the check manager to only test
+     *  check structures close to a kart. If false is returned, this check
+     *  structure is tested for all karts in every frame. */
+    virtual bool getBoundingBox(Vec3 *min, Vec3 *max) const { return false; }
+    /** Returns if this check structure is triggered by karts. Structures that
+     *  test other objects (e.g. goals) do this in their update function. */
+    virtual bool isTriggeredByKarts() const { return true; }
 
     // ------------------------------------------------------------------------
     /** Returns the type of this check structure. */
@@ -23,6 +23,8 @@
 #include <IMesh.h>
 #include <ICameraSceneNode.h>
 
+#include <algorithm>
+
 #include "config/user_config.hpp"
 #include "graphics/callbacks.hpp"
 #include "graphics/irr_driver.hpp"
@@ -31,12 +33,14 @@
 #include "graphics/rtts.hpp"
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
+#include "io/xml_stream_reader.hpp"
 #include "modes/world.hpp"
 #include "tracks/check_lap.hpp"
 #include "tracks/check_line.hpp"
 #include "tracks/check_manager.hpp"
 #include "tracks/quad_set.hpp"
 #include "tracks/track.hpp"
+#include "utils/time.hpp"
 
 const int QuadGraph::UNKNOWN_SECTOR  = -1;
 QuadGraph *QuadGraph::m_quad_graph = NULL;
@@ -54,6 +58,11 @@ QuadGraph::QuadGraph(const std::string &quad_file_name,
     m_mesh                 = NULL;
     m_mesh_buffer          = NULL;
     m_lap_length           = 0;
+    m_grid_min_x           = 0;
+    m_grid_min_z           = 0;
+    m_grid_cell_size       = 1.0f;
+    m_grid_size_x          = 0;
+    m_grid_size_z          = 0;
     QuadSet::create();
     QuadSet::get()->init(quad_file_name);
     m_quad_filename        = quad_file_name;
@@ -88,10 +97,11 @@ void QuadGraph::addSuccessor(unsigned int from, unsigned int to) {
  */
 void QuadGraph::load(const std::string &filename)
 {
-    const XMLNode *xml = file_manager->createXMLTree(filename);
+    XMLStreamReader *xml = file_manager->createXMLStreamReader(filename);
 
-    if(!xml)
+    if(!xml || !xml->next())
     {
+        delete xml;
         // No graph file exist, assume a default loop X -> X+1
         // i.e. each quad is part of the graph exactly once.
         // First create an empty graph node for each quad:
@@ -111,15 +121,17 @@ void QuadGraph::load(const std::string &filename)
             Log::error("Quad Graph", "No node in driveline graph.");
             m_lap_length = 10.0f;
         }
+        buildSectorGrid();
 
         return;
     }
 
     // The graph file exist, so read it in. The graph file must first contain
     // the node definitions, before the edges can be set.
-    for(unsigned int node_index=0; node_index<xml->getNumNodes(); node_index++)
+    while(xml->next())
     {
-        const XMLNode *xml_node = xml->getNode(node_index);
+        if(xml->getDepth()!=1) continue;
+        const XMLNode *xml_node = &xml->getElement();
         // First graph node definitions:
         // -----------------------------
         if(xml_node->getName()=="node-list")
@@ -201,8 +213,70 @@ void QuadGraph::load(const std::string &filename)
         if(l > m_lap_length)
             m_lap_length = l;
     }
+    buildSectorGrid();
 }   // load
 
+// ----------------------------------------------------------------------------
+/** Creates the grid used by findRoadSector and findOutOfRoadSector. The
+ *  cell size is chosen so that there is about one cell per graph node, and
+ *  each graph node is added to all cells its quad's 2d bounding box overlaps.
+ */
+void QuadGraph::buildSectorGrid()
+{
+    m_sector_grid.clear();
+    m_grid_size_x = 0;
+    m_grid_size_z = 0;
+    if(m_all_nodes.size()==0)
+        return;
+
+    float min_x =  999999.9f, min_z =  999999.9f;
+    float max_x = -999999.9f, max_z = -999999.9f;
+    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        for(unsigned int j=0; j<4; j++)
+        {
+            min_x = std::min(min_x, q[j].getX());
+            max_x = std::max(max_x, q[j].getX());
+            min_z = std::min(min_z, q[j].getZ());
+            max_z = std::max(max_z, q[j].getZ());
+        }
+    }
+
+    const float size_x = std::max(max_x-min_x, 1.0f);
+    const float size_z = std::max(max_z-min_z, 1.0f);
+    m_grid_cell_size = sqrtf(size_x*size_z/m_all_nodes.size());
+    if(m_grid_cell_size < 1.0f)
+        m_grid_cell_size = 1.0f;
+    m_grid_min_x  = min_x;
+    m_grid_min_z  = min_z;
+    m_grid_size_x = (int)(size_x/m_grid_cell_size)+1;
+    m_grid_size_z = (int)(size_z/m_grid_cell_size)+1;
+    m_sector_grid.resize(m_grid_size_x*m_grid_size_z);
+
+    // Nodes are added in increasing order, so each cell is sorted.
+    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    {
+        const Quad &q = getQuadOfNode(i);
+        float q_min_x = q[0].getX(), q_max_x = q[0].getX();
+        float q_min_z = q[0].getZ(), q_max_z = q[0].getZ();
+        for(unsigned int j=1; j<4; j++)
+        {
+            q_min_x = std::min(q_min_x, q[j].getX());
+            q_max_x = std::max(q_max_x, q[j].getX());
+            q_min_z = std::min(q_min_z, q[j].getZ());
+            q_max_z = std::max(q_max_z, q[j].getZ());
+        }
+        const int x0 = std::max(getGridX(q_min_x), 0);
+        const int x1 = std::min(getGridX(q_max_x), m_grid_size_x-1);
+        const int z0 = std::max(getGridZ(q_min_z), 0);
+        const int z1 = std::min(getGridZ(q_max_z), m_grid_size_z-1);
+        for(int z=z0; z<=z1; z++)
+            for(int x=x0; x<=x1; x++)
+                m_sector_grid[z*m_grid_size_x+x].push_back(i);
+    }
+}   // buildSectorGrid
+
 // ----------------------------------------------------------------------------
 /** Returns the index of the first graph node (i.e. the graph node which
  *  will trigger a new lap when a kart first enters it). This is always
@@ -823,6 +897,58 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
         return;
     }   // if still on same quad
 
+    // The AI only searches its own (short) list of graph nodes.
+    if(all_sectors || m_sector_grid.empty())
+    {
+        findRoadSectorLinear(xyz, sector, all_sectors);
+        return;
+    }
+
+    const int start = *sector;
+    *sector         = UNKNOWN_SECTOR;
+    const int x     = getGridX(xyz.getX());
+    const int z     = getGridZ(xyz.getZ());
+    if(x<0 || x>=m_grid_size_x || z<0 || z>=m_grid_size_z)
+        return;
+
+    // Several quads can be on top of each other, the lowest quad below
+    // the kart is used. If two quads have the same minimum height, the
+    // one found first by findRoadSectorLinear (which starts testing with
+    // the node after the previous sector) is used.
+    const int n        = m_all_nodes.size();
+    float     min_dist = 999999.9f;
+    int       min_order= n;
+    const std::vector<int> &cell = m_sector_grid[z*m_grid_size_x+x];
+    for(unsigned int i=0; i<cell.size(); i++)
+    {
+        const int indx = cell[i];
+        const Quad &q  = getQuadOfNode(indx);
+        float dist     = xyz.getY() - q.getMinHeight();
+        // While negative distances are unlikely, we allow some small negative
+        // numbers in case that the kart is partly in the track.
+        if(dist > min_dist || dist<=-1.0f)
+            continue;
+        const int order = ((indx-start-1) % n + n) % n;
+        if(dist==min_dist && order>=min_order)
+            continue;
+        if(q.pointInQuad(xyz))
+        {
+            min_dist  = dist;
+            min_order = order;
+            *sector   = indx;
+        }
+    }   // for i<cell.size()
+}   // findRoadSector
+
+//-----------------------------------------------------------------------------
+/** Tests all graph nodes (or all nodes in all_sectors) to find the sector
+ *  the point xyz is on. See findRoadSector() for the parameters, this
+ *  function is used if there is no sector grid or the AI restricts the
+ *  search.
+ */
+void QuadGraph::findRoadSectorLinear(const Vec3& xyz, int *sector,
+                                     std::vector<int> *all_sectors) const
+{
     // Now we search through all graph nodes, starting with
     // the current one
     int indx       = *sector;
@@ -859,7 +985,7 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
     }   // for i<m_all_nodes.size()
 
     return;
-}   // findRoadSector
+}   // findRoadSectorLinear
 
 //-----------------------------------------------------------------------------
 /** findOutOfRoadSector finds the sector where XYZ is, but as it name
@@ -892,6 +1018,104 @@ void QuadGraph::findRoadSector(const Vec3& xyz, int *sector,
 int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
                                    const int curr_sector,
                                    std::vector<int> *all_sectors) const
+{
+    if(all_sectors || m_sector_grid.empty())
+        return findOutOfRoadSectorLinear(xyz, curr_sector, all_sectors);
+
+    // findOutOfRoadSectorLinear starts 10 quads before the current quad,
+    // use the same start so that ties are resolved identically.
+    int start = 0;
+    if(curr_sector != UNKNOWN_SECTOR)
+        start = curr_sector - 10;
+
+    // If a kart is falling and in between (or too far below)
+    // a driveline point it might not fulfill
+    // the height condition. So we run the test twice: first with height
+    // condition, then again without the height condition - just to make sure
+    // it always comes back with some kind of quad.
+    for(int phase=0; phase<2; phase++)
+    {
+        int min_sector = findOutOfRoadSectorInGrid(xyz, start, phase==0);
+        if(min_sector!=UNKNOWN_SECTOR)
+            return min_sector;
+    }   // phase
+
+    Log::info("Quad Grap", "unknown sector found.");
+    return UNKNOWN_SECTOR;
+}   // findOutOfRoadSector
+
+//-----------------------------------------------------------------------------
+/** Finds the graph node whose driveline segment is closest to xyz (in 2d)
+ *  using the sector grid. The cells are searched in growing square rings
+ *  around the cell containing xyz, until no untested cell can contain a
+ *  closer graph node.
+ *  \param xyz The point for which to find the closest graph node.
+ *  \param start If two graph nodes have the same distance, the first one
+ *         after start (wrapping around) is used.
+ *  \param test_height If true, only accept nodes whose quad's minimum height
+ *         is in the range accepted by findOutOfRoadSectorLinear in phase 0.
+ */
+int QuadGraph::findOutOfRoadSectorInGrid(const Vec3& xyz, int start,
+                                         bool test_height) const
+{
+    const int n  = m_all_nodes.size();
+    const int cx = getGridX(xyz.getX());
+    const int cz = getGridZ(xyz.getZ());
+    // Number of rings after which the whole grid has been searched. Note
+    // that xyz can be outside of the grid.
+    const int max_ring = std::max(std::max(cx, m_grid_size_x-1-cx),
+                                  std::max(cz, m_grid_size_z-1-cz) );
+
+    int   min_sector = UNKNOWN_SECTOR;
+    float min_dist_2 = 999999.0f*999999.0f;
+    int   min_order  = n;
+    for(int ring=0; ring<=max_ring; ring++)
+    {
+        for(int z=cz-ring; z<=cz+ring; z++)
+        {
+            if(z<0 || z>=m_grid_size_z) continue;
+            // Only the border of the ring has not been searched before.
+            const int step = (z==cz-ring || z==cz+ring) ? 1 : 2*ring;
+            for(int x=cx-ring; x<=cx+ring; x+=step)
+            {
+                if(x<0 || x>=m_grid_size_x) continue;
+                const std::vector<int> &cell = m_sector_grid[z*m_grid_size_x+x];
+                for(unsigned int i=0; i<cell.size(); i++)
+                {
+                    const int indx = cell[i];
+                    float dist_2   = m_all_nodes[indx]->getDistance2FromPoint(xyz);
+                    if(dist_2 > min_dist_2) continue;
+                    const int order = ((indx-start-1) % n + n) % n;
+                    if(dist_2==min_dist_2 && order>=min_order) continue;
+                    if(test_height)
+                    {
+                        float dist = xyz.getY() - getQuadOfNode(indx).getMinHeight();
+                        if(dist >= 5.0f || dist <= -1.0f) continue;
+                    }
+                    min_dist_2 = dist_2;
+                    min_order  = order;
+                    min_sector = indx;
+                }   // for i<cell.size()
+            }   // for x
+        }   // for z
+
+        // All graph nodes that have not been tested are at least 'ring'
+        // cells away from xyz.
+        const float d = ring*m_grid_cell_size;
+        if(min_sector!=UNKNOWN_SECTOR && min_dist_2 < d*d)
+            break;
+    }   // for ring
+    return min_sector;
+}   // findOutOfRoadSectorInGrid
+
+//-----------------------------------------------------------------------------
+/** Tests all graph nodes (or all nodes in all_sectors) to find the closest
+ *  sector of a point that is not on the road. See findOutOfRoadSector() for
+ *  the parameters.
+ */
+int QuadGraph::findOutOfRoadSectorLinear(const Vec3& xyz,
+                                         const int curr_sector,
+                                         std::vector<int> *all_sectors) const
 {
     int count = (all_sectors!=NULL) ? all_sectors->size() : getNumNodes();
     int current_sector = 0;
@@ -965,7 +1189,89 @@ int QuadGraph::findOutOfRoadSector(const Vec3& xyz,
         Log::info("Quad Grap", "unknown sector found.");
     }
     return min_sector;
-}   // findOutOfRoadSector
+}   // findOutOfRoadSectorLinear
+
+//-----------------------------------------------------------------------------
+/** Compares the time needed to find the sectors of a set of points using
+ *  the sector grid and using the linear search over all graph nodes, and
+ *  checks that both return the same sectors. This is used by the command
+ *  line option --benchmark-sectors, which runs it for each track.
+ *  \param quad_file_name Name of the quad file of the track.
+ *  \param graph_file_name Name of the graph file of the track.
+ */
+void QuadGraph::benchmarkSectorLookup(const std::string &quad_file_name,
+                                      const std::string &graph_file_name)
+{
+    create(quad_file_name, graph_file_name, /*reverse*/false);
+    const QuadGraph *qg = get();
+    if(qg->getNumNodes()==0)
+    {
+        destroy();
+        return;
+    }
+
+    // Test on the road (the center of each quad), close to the road
+    // (which might or might not be on a quad), and off the road.
+    std::vector<Vec3> points;
+    for(unsigned int i=0; i<qg->getNumNodes(); i++)
+    {
+        const Vec3 &center = qg->getQuadOfNode(i).getCenter();
+        points.push_back(center + Vec3(  0.0f, 0.5f,  0.0f));
+        points.push_back(center + Vec3(  3.7f, 0.5f, -2.1f));
+        points.push_back(center + Vec3(-23.0f, 4.0f, 17.0f));
+    }
+    // Repeat the test so that the timer resolution does not matter.
+    const unsigned int repeat = std::max(1, 100000/(int)points.size());
+
+    int mismatches = 0;
+    for(unsigned int i=0; i<points.size(); i++)
+    {
+        int linear = UNKNOWN_SECTOR, grid = UNKNOWN_SECTOR;
+        qg->findRoadSectorLinear(points[i], &linear, NULL);
+        qg->findRoadSector(points[i], &grid);
+        if(linear==UNKNOWN_SECTOR)
+            linear = qg->findOutOfRoadSectorLinear(points[i], UNKNOWN_SECTOR,
+                                                   NULL);
+        if(grid==UNKNOWN_SECTOR)
+            grid = qg->findOutOfRoadSector(points[i]);
+        if(linear!=grid)
+            mismatches++;
+    }
+
+    double start = StkTime::getRealTime();
+    for(unsigned int r=0; r<repeat; r++)
+    {
+        for(unsigned int i=0; i<points.size(); i++)
+        {
+            int sector = UNKNOWN_SECTOR;
+            qg->findRoadSectorLinear(points[i], &sector, NULL);
+            if(sector==UNKNOWN_SECTOR)
+                qg->findOutOfRoadSectorLinear(points[i], UNKNOWN_SECTOR, NULL);
+        }
+    }
+    const double linear_time = StkTime::getRealTime() - start;
+
+    start = StkTime::getRealTime();
+    for(unsigned int r=0; r<repeat; r++)
+    {
+        for(unsigned int i=0; i<points.size(); i++)
+        {
+            int sector = UNKNOWN_SECTOR;
+            qg->findRoadSector(points[i], &sector);
+            if(sector==UNKNOWN_SECTOR)
+                qg->findOutOfRoadSector(points[i]);
+        }
+    }
+    const double grid_time = StkTime::getRealTime() - start;
+
+    const unsigned int lookups = repeat*points.size();
+    Log::info("Quad Graph", "%s: %d nodes, %dx%d cells, %d lookups: "
+              "linear %.3f us, grid %.3f us per lookup, %d mismatches.",
+              quad_file_name.c_str(), qg->getNumNodes(), qg->m_grid_size_x,
+              qg->m_grid_size_z, lookups, linear_time*1.0e6/lookups,
+              grid_time*1.0e6/lookups, mismatches);
+    destroy();
+}   // benchmarkSectorLookup
 
 //-----------------------------------------------------------------------------
 /** Takes a snapshot of the driveline quads so they can be used as minimap.
@@ -19,6 +19,7 @@
 #ifndef HEADER_QUAD_GRAPH_HPP
 #define HEADER_QUAD_GRAPH_HPP
 
+#include <math.h>
 #include <vector>
 #include <string>
 #include <set>
@@ -78,6 +79,21 @@ private:
     /** Wether the graph should be reverted or not */
     bool                     m_reverse;
 
+    /** A uniform grid in the x/z plane over the driveline, used to find
+     *  the graph nodes close to a point without testing all nodes. Each
+     *  cell stores the indices of all graph nodes whose quad overlaps the
+     *  cell, sorted by index. */
+    std::vector<std::vector<int> > m_sector_grid;
+
+    /** Minimum x and z coordinate of the sector grid. */
+    float                    m_grid_min_x, m_grid_min_z;
+
+    /** Size of a (square) cell of the sector grid. */
+    float                    m_grid_cell_size;
+
+    /** Number of cells of the sector grid along the x and z axis. */
+    int                      m_grid_size_x, m_grid_size_z;
+
     void setDefaultSuccessors();
     void computeChecklineRequirements(GraphNode* node, int latest_checkline);
     void computeDirectionData();
@@ -92,6 +108,28 @@ private:
                     const video::SColor *track_color=NULL,
                     const video::SColor *lap_color=NULL);
     unsigned int getStartNode() const;
+    void buildSectorGrid();
+    void findRoadSectorLinear(const Vec3& xyz, int *sector,
+                              std::vector<int> *all_sectors) const;
+    int  findOutOfRoadSectorLinear(const Vec3& xyz, const int curr_sector,
+                                   std::vector<int> *all_sectors) const;
+    int  findOutOfRoadSectorInGrid(const Vec3& xyz, int start,
+                                   bool test_height) const;
+    // ------------------------------------------------------------------------
+    /** Returns the grid cell along the x axis of a coordinate. The result
+     *  can be outside of the grid. */
+    int getGridX(float x) const
+    {
+        return (int)floorf((x-m_grid_min_x)/m_grid_cell_size);
+    }   // getGridX
+    // ------------------------------------------------------------------------
+    /** Returns the grid cell along the z axis of a coordinate. The result
+     *  can be outside of the grid. */
+    int getGridZ(float z) const
+    {
+        return (int)floorf((z-m_grid_min_z)/m_grid_cell_size);
+    }   // getGridZ
+    // ------------------------------------------------------------------------
          QuadGraph     (const std::string &quad_file_name,
                         const std::string graph_file_name,
                         const bool reverse);
@@ -128,6 +166,8 @@ public:
                                                  unsigned int count);
     void         setupPaths();
     void         computeChecklineRequirements();
+    static void  benchmarkSectorLookup(const std::string &quad_file_name,
+                                       const std::string &graph_file_name);
 // ----------------------------------------------------------------------
     /** Returns the one instance of this object. It is possible that there
      *  is no instance created (e.g. in battle mode, since it doesn't have
@@ -23,6 +23,7 @@
 
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
+#include "io/xml_stream_reader.hpp"
 #include "utils/string_utils.hpp"
 
 QuadSet *QuadSet::m_quad_set = NULL;
@@ -82,15 +83,19 @@ void QuadSet::init(const std::string &filename)
     m_min = Vec3( 99999,  99999,  99999);
     m_max = Vec3(-99999, -99999, -99999);
 
-    XMLNode *xml = file_manager->createXMLTree(filename);
-    if(!xml || xml->getName()!="quads")
+    // The file can contain thousands of quads, so it is read one quad at
+    // a time instead of creating a XMLNode tree.
+    XMLStreamReader *xml = file_manager->createXMLStreamReader(filename);
+    if(!xml || !xml->next() || xml->getName()!="quads")
     {
         fprintf(stderr, "[QuadSet::load] ERROR : QuadSet '%s' not found.\n", filename.c_str());
+        delete xml;
         return;
     }
-    for(unsigned int i=0; i<xml->getNumNodes(); i++)
+    while(xml->next())
     {
-        const XMLNode *xml_node = xml->getNode(i);
+        if(xml->getDepth()!=1) continue;
+        const XMLNode *xml_node = &xml->getElement();
         if(xml_node->getName()!="quad")
         {
             printf("[QuadSet::load] WARNING: Unsupported node type '%s' found in '%s' - ignored.\n",
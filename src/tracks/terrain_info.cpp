@@ -18,6 +18,7 @@
 
 #include "tracks/terrain_info.hpp"
 
+#include <assert.h>
 #include <math.h>
 
 #include "modes/world.hpp"
@@ -30,8 +31,9 @@
  */
 TerrainInfo::TerrainInfo()
 {
-    m_last_material = NULL;
-    m_material      = NULL;
+    m_last_material   = NULL;
+    m_material        = NULL;
+    m_has_pending_hit = false;
 }   // TerrainInfo
 
 //-----------------------------------------------------------------------------
@@ -40,6 +42,7 @@ TerrainInfo::TerrainInfo()
  */
 TerrainInfo::TerrainInfo(const Vec3 &pos)
 {
+    m_has_pending_hit = false;
     // initialise HoT
     update(pos);
 }   // TerrainInfo
@@ -50,13 +53,58 @@ TerrainInfo::TerrainInfo(const Vec3 &pos)
 void TerrainInfo::update(const Vec3& pos)
 {
     m_last_material = m_material;
-    btVector3 to(pos);
-    to.setY(-100000.f);
+    if(m_has_pending_hit && m_pending_from==pos)
+    {
+        // Same as castRay: the hit point is only set if there was a hit
+        m_has_pending_hit = false;
+        if(m_pending_hit.m_hit)
+            m_hit_point = m_pending_hit.m_xyz;
+        m_material = m_pending_hit.m_material;
+        m_normal   = m_pending_hit.m_normal;
+        return;
+    }
+    m_has_pending_hit = false;
 
     const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
-    tm.castRay(pos, to, &m_hit_point, &m_material, &m_normal);
+    tm.castRay(pos, getRayEnd(pos), &m_hit_point, &m_material, &m_normal);
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Returns the end point of the ray cast down from the given position. */
+Vec3 TerrainInfo::getRayEnd(const Vec3 &from)
+{
+    Vec3 to(from);
+    to.setY(-100000.f);
+    return to;
+}   // getRayEnd
+
+//-----------------------------------------------------------------------------
+/** Casts the rays down from the given positions for many terrain infos in
+ *  one batch (see TriangleMesh::castRays). The results are used by the next
+ *  update of each terrain info, if it is called with the same position.
+ *  \param infos The terrain infos to cast a ray for.
+ *  \param from The start position of the ray of each terrain info.
+ */
+void TerrainInfo::castRays(const std::vector<TerrainInfo*> &infos,
+                           const AlignedArray<btVector3> &from)
+{
+    assert(infos.size()==from.size());
+    AlignedArray<btVector3> to;
+    to.reserve(from.size());
+    for(unsigned int i=0; i<from.size(); i++)
+        to.push_back(getRayEnd(from[i]));
+
+    AlignedArray<TriangleMesh::RayHit> hits;
+    const TriangleMesh &tm = World::getWorld()->getTrack()->getTriangleMesh();
+    tm.castRays(from, to, &hits);
+    for(unsigned int i=0; i<infos.size(); i++)
+    {
+        infos[i]->m_has_pending_hit = true;
+        infos[i]->m_pending_from    = from[i];
+        infos[i]->m_pending_hit     = hits[i];
+    }
+}   // castRays
+
 // -----------------------------------------------------------------------------
 /** Does a raycast upwards from the given position
 If the raycast indicated that the kart is 'under something' (i.e. a
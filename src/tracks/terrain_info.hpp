@@ -19,8 +19,11 @@
 #ifndef HEADER_TERRAIN_INFO_HPP
 #define HEADER_TERRAIN_INFO_HPP
 
+#include "physics/triangle_mesh.hpp"
 #include "utils/vec3.hpp"
 
+#include <vector>
+
 class Material;
 
 /** This class stores information about the triangle that's under an object, i.e.:
@@ -38,6 +41,15 @@ private:
     const Material   *m_last_material;
     /** The point that was hit. */
     Vec3              m_hit_point;
+    /** True if m_pending_hit contains the result of a ray cast by
+     *  castRays for the next update. */
+    bool              m_has_pending_hit;
+    /** The start of the ray of m_pending_hit. */
+    Vec3              m_pending_from;
+    /** Result of the ray cast by castRays. */
+    TriangleMesh::RayHit m_pending_hit;
+
+    static Vec3 getRayEnd(const Vec3 &from);
 
 public:
              TerrainInfo();
@@ -45,6 +57,8 @@ public:
     virtual ~TerrainInfo() {};
 
     virtual void update(const Vec3 &pos);
+    static  void castRays(const std::vector<TerrainInfo*> &infos,
+                          const AlignedArray<btVector3> &from);
     bool     getSurfaceInfo(const Vec3 &from, Vec3 *position,
                             const Material **m);
 
@@ -20,12 +20,25 @@
 #include "tracks/track.hpp"
 
 #include <iostream>
+#include <set>
 #include <stdexcept>
 #include <sstream>
+#include <stdio.h>
+#ifdef WIN32
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
 #include <IBillboardTextSceneNode.h>
 
 using namespace irr;
 
+/** Identifies physics cache files. */
+static const uint32_t PHYSICS_CACHE_MAGIC   = 0x504B5453;
+/** Increase whenever the format of the physics cache changes. */
+static const int      PHYSICS_CACHE_VERSION = 1;
+
 #include "addons/addon.hpp"
 #include "audio/music_manager.hpp"
 #include "challenges/challenge.hpp"
@@ -43,7 +56,9 @@ using namespace irr;
 #include "graphics/particle_kind.hpp"
 #include "graphics/particle_kind_manager.hpp"
 #include "guiengine/scalable_font.hpp"
+#include "io/content_cache.hpp"
 #include "io/file_manager.hpp"
+#include "io/mapped_file.hpp"
 #include "io/xml_node.hpp"
 #include "items/item.hpp"
 #include "items/item_manager.hpp"
@@ -66,6 +81,7 @@ using namespace irr;
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/tick_stats.hpp"
 #include "utils/translation.hpp"
 
 #include <ISceneManager.h>
@@ -102,6 +118,7 @@ Track::Track(const std::string &filename)
     m_version               = 0;
     m_track_mesh            = NULL;
     m_gfx_effect_mesh       = NULL;
+    m_physics_from_cache    = false;
     m_internal              = false;
     m_enable_auto_rescue    = true;  // Below set to false in arenas
     m_enable_push_back      = true;
@@ -338,7 +355,7 @@ void Track::loadTrackInfo()
     m_sun_specular_color    = video::SColor(255, 255, 255, 255);
     m_sun_diffuse_color     = video::SColor(255, 255, 255, 255);
     m_sun_position          = core::vector3df(0, 0, 0);
-    XMLNode *root           = file_manager->createXMLTree(m_filename);
+    XMLNode *root           = ContentCache::get()->createXMLTree(m_filename);
 
     if(!root || root->getName()!="track")
     {
@@ -416,7 +433,7 @@ void Track::loadTrackInfo()
     std::string dir = StringUtils::getPath(m_filename);
     std::string easter_name = dir+"/easter_eggs.xml";
 
-    XMLNode *easter = file_manager->createXMLTree(easter_name); 
+    XMLNode *easter = ContentCache::get()->createXMLTree(easter_name);
   
     if(easter) 
     {
@@ -582,14 +599,216 @@ void Track::createPhysicsModel(unsigned int main_track_count)
 
     m_track_mesh->removeAll();
     m_gfx_effect_mesh->removeAll();
-    for(unsigned int i=main_track_count; i<m_all_nodes.size(); i++)
+    // If the meshes were read from the physics cache, they already contain
+    // all objects, and the cached bvh is used for the collision shapes.
+    if(!m_physics_from_cache)
     {
-        convertTrackToBullet(m_all_nodes[i]);
+        for(unsigned int i=main_track_count; i<m_all_nodes.size(); i++)
+        {
+            convertTrackToBullet(m_all_nodes[i]);
+        }
     }
     m_track_mesh->createPhysicalBody();
     m_gfx_effect_mesh->createCollisionShape();
+    if(!m_physics_from_cache && m_physics_cache_key.size()>0)
+        savePhysicsCache();
 }   // createPhysicsModel
 
+// ----------------------------------------------------------------------------
+/** Adds the content of a file to a FNV-1a hash.
+ *  \param filename The file to hash.
+ *  \param hash The hash so far.
+ *  \return The new hash.
+ */
+static uint64_t hashFile(const std::string &filename, uint64_t hash)
+{
+    const uint64_t prime = 1099511628211ULL;
+    // Include the name, so that renaming files changes the hash
+    for(unsigned int i=0; i<filename.size(); i++)
+        hash = (hash ^ (unsigned char)filename[i]) * prime;
+    MappedFile file;
+    if(!file.open(filename))
+        return hash;
+    const unsigned char *data = file.getData();
+    for(size_t i=0; i<file.getSize(); i++)
+        hash = (hash ^ data[i]) * prime;
+    return hash;
+}   // hashFile
+
+// ----------------------------------------------------------------------------
+/** Adds all files in a directory that can influence the physics meshes (i.e.
+ *  all files except images and sounds) to a hash.
+ *  \param dir The directory, ending in '/'.
+ *  \param hash The hash so far.
+ *  \return The new hash.
+ */
+static uint64_t hashDirectory(const std::string &dir, uint64_t hash)
+{
+    std::set<std::string> files;
+    file_manager->listFiles(files, dir);
+    for(std::set<std::string>::iterator i=files.begin(); i!=files.end(); i++)
+    {
+        const std::string &name = *i;
+        if(name=="." || name==".." || file_manager->isDirectory(dir+name))
+            continue;
+        std::string ext = StringUtils::toLowerCase(
+                                             StringUtils::getExtension(name));
+        if(ext=="png" || ext=="jpg" || ext=="jpeg" || ext=="dds" ||
+           ext=="bmp" || ext=="tga" || ext=="ogg"  || ext=="wav"    )
+            continue;
+        hash = hashFile(dir+name, hash);
+    }
+    return hash;
+}   // hashDirectory
+
+// ----------------------------------------------------------------------------
+/** Adds the names of all libraries used in a scene (including libraries
+ *  used by libraries) to a set.
+ *  \param root The scene or library node.
+ *  \param libraries The set of library names.
+ */
+static void collectLibraries(const XMLNode &root,
+                             std::set<std::string> *libraries)
+{
+    for(unsigned int i=0; i<root.getNumNodes(); i++)
+    {
+        const XMLNode *node = root.getNode(i);
+        if(node->getName()!="library") continue;
+        std::string name;
+        node->get("name", &name);
+        if(!libraries->insert(name).second) continue;
+        XMLNode *lib = file_manager->createXMLTree(
+                   file_manager->getAsset("library/"+name+"/node.xml"));
+        if(!lib) continue;
+        collectLibraries(*lib, libraries);
+        delete lib;
+    }
+}   // collectLibraries
+
+// ----------------------------------------------------------------------------
+/** Computes the key of the physics cache. It is a hash of all files of the
+ *  track and the libraries it uses, the global materials, and the settings
+ *  that influence the conversion into triangle meshes. The overworld and
+ *  cutscenes are not cached, since the objects they contain depend on the
+ *  state of the player.
+ *  \param root The scene node of the track.
+ *  \param mode_id The mode of the track that is loaded.
+ */
+void Track::computePhysicsCacheKey(const XMLNode &root, unsigned int mode_id)
+{
+    m_physics_cache_key  = "";
+    m_physics_cache_file = "";
+    if(m_internal || m_is_cutscene)
+        return;
+
+    uint64_t hash = 14695981039346656037ULL;
+    hash = hashDirectory(m_root, hash);
+    std::set<std::string> libraries;
+    collectLibraries(root, &libraries);
+    for(std::set<std::string>::iterator i =libraries.begin();
+                                        i!=libraries.end(); i++)
+        hash = hashDirectory(file_manager->getAsset("library/"+*i)+"/", hash);
+    hash = hashFile(file_manager->getAssetChecked(FileManager::TEXTURE,
+                                                  "materials.xml"), hash);
+
+    std::ostringstream key;
+    key << PHYSICS_CACHE_VERSION << " " << m_all_modes[mode_id].m_scene
+        << " " << stk_config->m_smooth_angle_limit << " " << sizeof(btScalar)
+        << " " << std::hex << hash;
+    m_physics_cache_key = key.str();
+
+    std::string dir = file_manager->getUserConfigFile("physics_cache/");
+    if(!file_manager->checkAndCreateDirectoryP(dir))
+    {
+        m_physics_cache_key = "";
+        return;
+    }
+    m_physics_cache_file = dir + m_ident + "-"
+                         + StringUtils::toString(mode_id) + ".bin";
+}   // computePhysicsCacheKey
+
+// ----------------------------------------------------------------------------
+/** Reads the track and gfx effect meshes from the physics cache, if the
+ *  cache file exists and matches the current key.
+ *  \return True if the meshes were read.
+ */
+bool Track::loadPhysicsCache()
+{
+    MappedFile file;
+    if(!file.open(m_physics_cache_file))
+        return false;
+    const unsigned char *p   = file.getData();
+    const unsigned char *end = p + file.getSize();
+
+    uint32_t magic, key_size;
+    if(end-p < (int)(2*sizeof(uint32_t)))
+        return false;
+    memcpy(&magic,    p,                  sizeof(magic));
+    memcpy(&key_size, p+sizeof(uint32_t), sizeof(key_size));
+    p += 2*sizeof(uint32_t);
+    if(magic!=PHYSICS_CACHE_MAGIC || (size_t)(end-p)<key_size ||
+       std::string((const char*)p, key_size)!=m_physics_cache_key)
+    {
+        Log::info("track", "Physics cache of '%s' is out of date.",
+                  m_ident.c_str());
+        return false;
+    }
+    p += key_size;
+
+    if(!m_track_mesh->readCache(&p, end) ||
+       !m_gfx_effect_mesh->readCache(&p, end))
+    {
+        Log::warn("track", "Physics cache '%s' is damaged, ignored.",
+                  m_physics_cache_file.c_str());
+        // Start again with empty meshes
+        delete m_track_mesh;
+        delete m_gfx_effect_mesh;
+        m_track_mesh      = new TriangleMesh();
+        m_gfx_effect_mesh = new TriangleMesh();
+        return false;
+    }
+    Log::info("track", "Using physics cache '%s'.",
+              m_physics_cache_file.c_str());
+    return true;
+}   // loadPhysicsCache
+
+// ----------------------------------------------------------------------------
+/** Writes the track and gfx effect meshes (which must have their collision
+ *  shapes) to the physics cache. The data is written to a temporary file
+ *  first, so that races running at the same time never read a partial file.
+ */
+void Track::savePhysicsCache() const
+{
+    std::string tmp = m_physics_cache_file + "."
+                    + StringUtils::toString(getpid()) + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "wb");
+    if(!f)
+    {
+        Log::warn("track", "Can't write physics cache '%s'.", tmp.c_str());
+        return;
+    }
+    uint32_t magic    = PHYSICS_CACHE_MAGIC;
+    uint32_t key_size = m_physics_cache_key.size();
+    bool ok = fwrite(&magic,    sizeof(magic),    1, f)==1 &&
+              fwrite(&key_size, sizeof(key_size), 1, f)==1 &&
+              fwrite(m_physics_cache_key.c_str(), key_size, 1, f)==1 &&
+              m_track_mesh->writeCache(f) &&
+              m_gfx_effect_mesh->writeCache(f);
+    ok &= fclose(f)==0;
+    if(ok)
+    {
+        // rename does not overwrite existing files on windows
+        remove(m_physics_cache_file.c_str());
+        ok = rename(tmp.c_str(), m_physics_cache_file.c_str())==0;
+    }
+    if(!ok)
+    {
+        Log::warn("track", "Can't write physics cache '%s'.",
+                  m_physics_cache_file.c_str());
+        remove(tmp.c_str());
+    }
+}   // savePhysicsCache
+
 // -----------------------------------------------------------------------------
 /** Convert the graohics track into its physics equivalents.
  *  \param mesh The mesh to convert.
@@ -789,6 +1008,7 @@ bool Track::loadMainTrack(const XMLNode &root)
 
     m_track_mesh      = new TriangleMesh();
     m_gfx_effect_mesh = new TriangleMesh();
+    m_physics_from_cache = m_physics_cache_key.size()>0 && loadPhysicsCache();
 
     const XMLNode *track_node = root.getNode("track");
     std::string model_name;
@@ -1207,7 +1427,8 @@ bool Track::loadMainTrack(const XMLNode &root)
     }   // for i
 
     // This will (at this stage) only convert the main track model.
-    for(unsigned int i=0; i<m_all_nodes.size(); i++)
+    // With the physics cache all triangles are already loaded.
+    for(unsigned int i=0; i<m_all_nodes.size() && !m_physics_from_cache; i++)
     {
         convertTrackToBullet(m_all_nodes[i]);
     }
@@ -1216,7 +1437,8 @@ bool Track::loadMainTrack(const XMLNode &root)
     // (like invisible walls).
     for(unsigned int i=0; i<m_all_physics_only_nodes.size(); i++)
     {
-        convertTrackToBullet(m_all_physics_only_nodes[i]);
+        if(!m_physics_from_cache)
+            convertTrackToBullet(m_all_physics_only_nodes[i]);
         irr_driver->removeNode(m_all_physics_only_nodes[i]);
     }
     m_all_physics_only_nodes.clear();
@@ -1285,7 +1507,9 @@ void Track::update(float dt)
         m_animated_textures[i]->update(dt);
     }
     CheckManager::get()->update(dt);
+    TickStats::start(TickStats::TS_ITEMS);
     ItemManager::get()->update(dt);
+    TickStats::stop(TickStats::TS_ITEMS);
 
 }   // update
 
@@ -1525,6 +1749,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         node->get("fog-end-height",   &m_fog_height_end);
     }
 
+    computePhysicsCacheKey(*root, mode_id);
     loadMainTrack(*root);
     unsigned int main_track_count = m_all_nodes.size();
 
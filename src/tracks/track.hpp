@@ -231,6 +231,13 @@ private:
      *  allowing the kart to drive in/partly under water), but the
      *  actual surface position is needed for the water splash effect. */
     TriangleMesh*            m_gfx_effect_mesh;
+    /** Identifies the track files and settings the physics meshes were
+     *  created from, or empty if the physics cache is not used. */
+    std::string              m_physics_cache_key;
+    /** Name of the physics cache file for the current mode. */
+    std::string              m_physics_cache_file;
+    /** True if the physics meshes were read from the physics cache. */
+    bool                     m_physics_from_cache;
     /** Minimum coordinates of this track. */
     Vec3                     m_aabb_min;
     /** Maximum coordinates of this track. */
@@ -394,6 +401,9 @@ private:
     void loadTrackInfo();
     void loadQuadGraph(unsigned int mode_id, const bool reverse);
     void convertTrackToBullet(scene::ISceneNode *node);
+    void computePhysicsCacheKey(const XMLNode &root, unsigned int mode_id);
+    bool loadPhysicsCache();
+    void savePhysicsCache() const;
     bool loadMainTrack(const XMLNode &node);
     void createWater(const XMLNode &node);
     void getMusicInformation(std::vector<std::string>&  filenames,
@@ -26,8 +26,10 @@
 
 #include "audio/music_manager.hpp"
 #include "config/stk_config.hpp"
+#include "io/content_cache.hpp"
 #include "io/file_manager.hpp"
 #include "tracks/track.hpp"
+#include "utils/string_utils.hpp"
 
 TrackManager* track_manager = 0;
 std::vector<std::string>  TrackManager::m_track_search_path;
@@ -134,6 +136,26 @@ void TrackManager::loadTrackList()
     m_track_avail.clear();
     m_tracks.clear();
 
+    // Find all directories that might contain a track, and read all their
+    // track files (in parallel, or from the content cache) before the
+    // tracks are created.
+    std::vector<std::set<std::string> > all_dirs(m_track_search_path.size());
+    std::vector<std::string> files;
+    for(unsigned int i=0; i<m_track_search_path.size(); i++)
+    {
+        const std::string &dir = m_track_search_path[i];
+        addTrackFiles(dir, &files);
+        if(file_manager->fileExists(dir+"track.xml")) continue;
+        file_manager->listFiles(all_dirs[i], dir);
+        for(std::set<std::string>::iterator subdir = all_dirs[i].begin();
+            subdir != all_dirs[i].end(); subdir++)
+        {
+            if(*subdir=="." || *subdir=="..") continue;
+            addTrackFiles(dir+*subdir+"/", &files);
+        }
+    }
+    ContentCache::get()->prefetch(files);
+
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
         const std::string &dir = m_track_search_path[i];
@@ -144,8 +166,9 @@ void TrackManager::loadTrackList()
 
         // Then see if a subdir of this dir contains tracks
         // ------------------------------------------------
-        std::set<std::string> dirs;
-        file_manager->listFiles(dirs, dir);
+        std::set<std::string> &dirs = all_dirs[i];
+        if(dirs.size()==0)
+            file_manager->listFiles(dirs, dir);
         for(std::set<std::string>::iterator subdir = dirs.begin();
             subdir != dirs.end(); subdir++)
         {
@@ -155,6 +178,21 @@ void TrackManager::loadTrackList()
     }   // for i <m_track_search_path.size()
 }  // loadTrackList
 
+// ----------------------------------------------------------------------------
+/** Adds the names of the XML files that are read when loading a track from
+ *  the given directory to a list.
+ *  \param dirname Name of the directory, ending in '/'.
+ *  \param files The list of files.
+ */
+void TrackManager::addTrackFiles(const std::string &dirname,
+                                 std::vector<std::string> *files)
+{
+    // Same names as used in Track::loadTrackInfo
+    const std::string config_file = dirname+"track.xml";
+    files->push_back(config_file);
+    files->push_back(StringUtils::getPath(config_file)+"/easter_eggs.xml");
+}   // addTrackFiles
+
 // ----------------------------------------------------------------------------
 /** Tries to load a track from a single directory. Returns true if a track was
  *  successfully loaded.
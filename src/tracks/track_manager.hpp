@@ -71,6 +71,8 @@ private:
     std::vector<bool>                        m_track_avail;
 
     void          updateGroups(const Track* track);
+    static void   addTrackFiles(const std::string &dirname,
+                                std::vector<std::string> *files);
 
 public:
                 TrackManager();
@@ -20,9 +20,12 @@
 #include "guiengine/event_handler.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/scalable_font.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
 #include <assert.h>
 #include <stack>
 #include <sstream>
+#include <string.h>
 
 Profiler profiler;
 
@@ -59,6 +62,11 @@ Profiler profiler;
         return double(tv.tv_sec * 1000) + (double(tv.tv_usec) / 1000.0);
     }
 #endif
+#if defined(__APPLE__)
+    #include <mach/mach_time.h>
+#elif !defined(WIN32)
+    #include <time.h>
+#endif
 // --- End portable precise timer ---
 
 //-----------------------------------------------------------------------------
@@ -69,17 +77,90 @@ Profiler::Profiler()
     m_time_last_sync = _getTimeMilliseconds();
     m_time_between_sync = 0.0;
     m_freeze_state = UNFROZEN;
+    m_main_thread = pthread_self();
+    m_trace_enabled = false;
+    m_trace_size = 0;
+    pthread_mutex_init(&m_trace_mutex, NULL);
+    pthread_key_create(&m_trace_key, NULL);
 }
 
 //-----------------------------------------------------------------------------
 Profiler::~Profiler()
 {
+    for(unsigned int i=0; i<m_trace_buffers.size(); i++)
+        delete m_trace_buffers[i];
+    pthread_key_delete(m_trace_key);
+    pthread_mutex_destroy(&m_trace_mutex);
+}
+
+//-----------------------------------------------------------------------------
+/// Returns a monotonic time stamp in nanoseconds
+uint64_t Profiler::getTimeNanoseconds()
+{
+#if defined(WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    // Split the computation to avoid an overflow of counter*10^9
+    uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+    uint64_t rest    = counter.QuadPart % frequency.QuadPart;
+    return seconds*1000000000ULL + rest*1000000000ULL/frequency.QuadPart;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if(timebase.denom==0)
+        mach_timebase_info(&timebase);
+    return mach_absolute_time()*timebase.numer/timebase.denom;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+/// Returns the trace buffer of the calling thread, and creates it the first
+/// time a thread uses a marker
+Profiler::TraceBuffer* Profiler::getTraceBuffer()
+{
+    TraceBuffer *buffer = (TraceBuffer*)pthread_getspecific(m_trace_key);
+    if(buffer)
+        return buffer;
+
+    buffer = new TraceBuffer();
+    buffer->m_events.resize(m_trace_size);
+    buffer->m_num_events = 0;
+    buffer->m_depth      = 0;
+    buffer->m_is_main_thread = pthread_equal(pthread_self(), m_main_thread)!=0;
+    pthread_mutex_lock(&m_trace_mutex);
+    buffer->m_thread_index = m_trace_buffers.size();
+    m_trace_buffers.push_back(buffer);
+    pthread_mutex_unlock(&m_trace_mutex);
+    pthread_setspecific(m_trace_key, buffer);
+    return buffer;
 }
 
 //-----------------------------------------------------------------------------
 /// Push a new marker that starts now
 void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
 {
+    if(m_trace_enabled)
+    {
+        TraceBuffer *buffer = getTraceBuffer();
+        if(buffer->m_depth < TRACE_MAX_DEPTH)
+        {
+            TraceEvent &e = buffer->m_open[buffer->m_depth];
+            e.m_start = getTimeNanoseconds();
+            e.m_depth = buffer->m_depth;
+            strncpy(e.m_name, name, TRACE_NAME_LENGTH-1);
+            e.m_name[TRACE_NAME_LENGTH-1] = 0;
+        }
+        buffer->m_depth++;
+    }
+
+    // Only markers of the main thread are drawn
+    if(!pthread_equal(pthread_self(), m_main_thread))
+        return;
+
     // Don't do anything when frozen
     if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
         return;
@@ -97,6 +178,28 @@ void Profiler::pushCpuMarker(const char* name, const video::SColor& color)
 /// Stop the last pushed marker
 void Profiler::popCpuMarker()
 {
+    if(m_trace_enabled)
+    {
+        TraceBuffer *buffer = getTraceBuffer();
+        // The depth is 0 if the marker was pushed before enabling the trace
+        if(buffer->m_depth > 0)
+        {
+            uint64_t now = getTimeNanoseconds();
+            buffer->m_depth--;
+            if(buffer->m_depth < TRACE_MAX_DEPTH)
+            {
+                std::vector<TraceEvent> &events = buffer->m_events;
+                TraceEvent &e = events[buffer->m_num_events % events.size()];
+                e = buffer->m_open[buffer->m_depth];
+                e.m_duration = now - e.m_start;
+                buffer->m_num_events++;
+            }
+        }
+    }
+
+    if(!pthread_equal(pthread_self(), m_main_thread))
+        return;
+
     // Don't do anything when frozen
     if(m_freeze_state == FROZEN || m_freeze_state == WAITING_FOR_UNFREEZE)
         return;
@@ -316,3 +419,140 @@ void Profiler::drawBackground()
     video::SColor   color(0xFF, 0xFF, 0xFF, 0xFF);
     driver->draw2DRectangle(color, background_rect);
 }
+
+//-----------------------------------------------------------------------------
+/// Starts recording all markers of all threads, which are written to a file
+/// by writeTrace(). This works without graphics, so it can be used to
+/// profile servers or races run with --no-graphics.
+/// \param filename File to write to. If it ends in .csv, a CSV file with one
+///        line per marker is written, otherwise a JSON file that can be
+///        loaded in chrome://tracing.
+/// \param events_per_thread Size of the ring buffer of each thread, if more
+///        markers are recorded, the oldest ones are lost.
+void Profiler::enableTrace(const std::string &filename,
+                           unsigned int events_per_thread)
+{
+    assert(!m_trace_enabled && events_per_thread > 0);
+    m_trace_file    = filename;
+    m_trace_size    = events_per_thread;
+    m_trace_enabled = true;
+}
+
+//-----------------------------------------------------------------------------
+/// Stops recording and writes the trace to the file given in enableTrace().
+/// Should be called when no other thread uses markers anymore.
+void Profiler::writeTrace()
+{
+    if(!m_trace_enabled)
+        return;
+    m_trace_enabled = false;
+
+    FILE *f = fopen(m_trace_file.c_str(), "w");
+    if(!f)
+    {
+        Log::error("Profiler", "Can't open '%s' to write the trace.",
+                   m_trace_file.c_str());
+        return;
+    }
+    if(StringUtils::hasSuffix(StringUtils::toLowerCase(m_trace_file), ".csv"))
+        writeCSV(f);
+    else
+        writeChromeTrace(f);
+    fclose(f);
+
+    uint64_t lost = 0;
+    for(unsigned int i=0; i<m_trace_buffers.size(); i++)
+    {
+        const TraceBuffer *buffer = m_trace_buffers[i];
+        if(buffer->m_num_events > buffer->m_events.size())
+            lost += buffer->m_num_events - buffer->m_events.size();
+    }
+    Log::info("Profiler", "Trace of %d threads written to '%s'.",
+              (int)m_trace_buffers.size(), m_trace_file.c_str());
+    if(lost>0)
+        Log::warn("Profiler", "%lu old markers were overwritten, increase "
+                  "the size of the trace to keep them.", (unsigned long)lost);
+}
+
+//-----------------------------------------------------------------------------
+/// Writes all recorded markers in the chrome trace event format. Times are
+/// in microseconds relative to the oldest marker.
+void Profiler::writeChromeTrace(FILE *f) const
+{
+    uint64_t base = (uint64_t)-1;
+    for(unsigned int i=0; i<m_trace_buffers.size(); i++)
+    {
+        const TraceBuffer *buffer = m_trace_buffers[i];
+        const uint64_t size = buffer->m_events.size();
+        uint64_t first = buffer->m_num_events > size
+                       ? buffer->m_num_events - size : 0;
+        if(first < buffer->m_num_events &&
+           buffer->m_events[first % size].m_start < base)
+            base = buffer->m_events[first % size].m_start;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    const char *separator = "";
+    for(unsigned int i=0; i<m_trace_buffers.size(); i++)
+    {
+        const TraceBuffer *buffer = m_trace_buffers[i];
+        if(buffer->m_is_main_thread)
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                       "\"tid\":%u,\"args\":{\"name\":\"main\"}}",
+                    separator, buffer->m_thread_index);
+        else
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                       "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                    separator, buffer->m_thread_index, buffer->m_thread_index);
+        separator = ",\n";
+
+        const uint64_t size = buffer->m_events.size();
+        uint64_t first = buffer->m_num_events > size
+                       ? buffer->m_num_events - size : 0;
+        for(uint64_t j=first; j<buffer->m_num_events; j++)
+        {
+            const TraceEvent &e = buffer->m_events[j % size];
+            fprintf(f, "%s{\"name\":\"", separator);
+            // Escape the characters that are not allowed in JSON strings
+            for(const char *c=e.m_name; *c; c++)
+            {
+                if(*c=='"' || *c=='\\')
+                    fprintf(f, "\\%c", *c);
+                else if((unsigned char)*c >= 0x20)
+                    fputc(*c, f);
+            }
+            fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                       "\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer->m_thread_index, (e.m_start-base)/1000.0,
+                    e.m_duration/1000.0);
+        }
+    }
+    fprintf(f, "\n]}\n");
+}
+
+//-----------------------------------------------------------------------------
+/// Writes all recorded markers as CSV, one line per marker with the thread,
+/// nesting depth, name, start and duration in nanoseconds.
+void Profiler::writeCSV(FILE *f) const
+{
+    fprintf(f, "thread,depth,name,start_ns,duration_ns\n");
+    for(unsigned int i=0; i<m_trace_buffers.size(); i++)
+    {
+        const TraceBuffer *buffer = m_trace_buffers[i];
+        const uint64_t size = buffer->m_events.size();
+        uint64_t first = buffer->m_num_events > size
+                       ? buffer->m_num_events - size : 0;
+        for(uint64_t j=first; j<buffer->m_num_events; j++)
+        {
+            const TraceEvent &e = buffer->m_events[j % size];
+            fprintf(f, "%u,%u,\"", buffer->m_thread_index, e.m_depth);
+            for(const char *c=e.m_name; *c; c++)
+            {
+                if(*c=='"') fputc('"', f);
+                fputc(*c, f);
+            }
+            fprintf(f, "\",%llu,%llu\n", (unsigned long long)e.m_start,
+                    (unsigned long long)e.m_duration);
+        }
+    }
+}
@@ -18,7 +18,11 @@
 #ifndef PROFILER_HPP
 #define PROFILER_HPP
 
+#include "utils/types.hpp"
+
 #include <irrlicht.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <list>
 #include <vector>
 #include <stack>
@@ -104,6 +108,63 @@ private:
 
     FreezeState     m_freeze_state;
 
+    /** The thread that created the profiler. Only markers of this thread
+     *  are drawn, markers of all threads are recorded in the trace. */
+    pthread_t       m_main_thread;
+
+    // Trace recording
+    // ---------------
+    /** Maximum length of a marker name in the trace, longer names are
+     *  truncated. Names are copied, so that recording a marker does not
+     *  allocate memory. */
+    static const unsigned int TRACE_NAME_LENGTH = 48;
+    /** Maximum nesting of markers that is recorded in the trace. */
+    static const unsigned int TRACE_MAX_DEPTH   = 32;
+
+    /** A finished marker in the trace. Times are in nanoseconds. */
+    struct TraceEvent
+    {
+        uint64_t m_start;
+        uint64_t m_duration;
+        uint32_t m_depth;
+        char     m_name[TRACE_NAME_LENGTH];
+    };
+
+    /** The trace of one thread: a fixed size ring buffer of finished
+     *  markers (the oldest markers are overwritten), and the markers that
+     *  are currently open. It is only written by its own thread. */
+    struct TraceBuffer
+    {
+        unsigned int            m_thread_index;
+        bool                    m_is_main_thread;
+        std::vector<TraceEvent> m_events;
+        /** Number of events recorded, the next event is written at this
+         *  number modulo the size of m_events. */
+        uint64_t                m_num_events;
+        /** Number of open markers, which can be bigger than
+         *  TRACE_MAX_DEPTH, deeper markers are then ignored. */
+        unsigned int            m_depth;
+        TraceEvent              m_open[TRACE_MAX_DEPTH];
+    };
+
+    /** True if markers are recorded for the trace. */
+    bool                       m_trace_enabled;
+    /** File the trace is written to, CSV if the name ends in .csv,
+     *  otherwise chrome trace JSON. */
+    std::string                m_trace_file;
+    /** Number of events in the ring buffer of each thread. */
+    unsigned int               m_trace_size;
+    /** The trace buffers of all threads, a buffer is created the first
+     *  time a thread uses a marker. */
+    std::vector<TraceBuffer*>  m_trace_buffers;
+    pthread_mutex_t            m_trace_mutex;
+    /** Stores the trace buffer of each thread. */
+    pthread_key_t              m_trace_key;
+
+    TraceBuffer* getTraceBuffer();
+    void         writeChromeTrace(FILE *f) const;
+    void         writeCSV(FILE *f) const;
+
 public:
     Profiler();
     virtual ~Profiler();
@@ -116,6 +177,11 @@ public:
 
     void    onClick(const core::vector2di& mouse_pos);
 
+    void    enableTrace(const std::string &filename,
+                        unsigned int events_per_thread=65536);
+    void    writeTrace();
+    static uint64_t getTimeNanoseconds();
+
 protected:
     // TODO: detect on which thread this is called to support multithreading
     ThreadInfo& getThreadInfo() { return m_thread_infos[0]; }
@@ -0,0 +1,178 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/tick_stats.hpp"
+
+#include "utils/log.hpp"
+
+#include <stdio.h>
+
+#if defined(WIN32)
+#  include <windows.h>
+#elif defined(__APPLE__)
+#  include <mach/mach_time.h>
+#else
+#  include <time.h>
+#endif
+
+bool               TickStats::m_enabled         = false;
+std::string        TickStats::m_summary_file;
+TickStats::Stats   TickStats::m_subsystems[TickStats::TS_COUNT];
+TickStats::Stats   TickStats::m_tick;
+TickStats::Stats   TickStats::m_other;
+unsigned int       TickStats::m_num_ticks       = 0;
+unsigned int       TickStats::m_num_over_budget = 0;
+double             TickStats::m_simulated_time  = 0;
+
+// ----------------------------------------------------------------------------
+/** Returns a high resolution monotonic real time in seconds. Real time is
+ *  used (and not the CPU time of the main thread) since subsystems like the
+ *  AI run partly on other threads, while the main thread waits for them.
+ */
+double TickStats::getTime()
+{
+#if defined(WIN32)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart/(double)frequency.QuadPart;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if(timebase.denom==0)
+        mach_timebase_info(&timebase);
+    return mach_absolute_time()*1.0e-9*timebase.numer/timebase.denom;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1.0e-9;
+#endif
+}   // getTime
+
+// ----------------------------------------------------------------------------
+/** Enables the collection of statistics.
+ *  \param summary_file File to write the summary to at exit. If empty,
+ *         the summary is printed.
+ */
+void TickStats::enable(const std::string &summary_file)
+{
+    m_enabled      = true;
+    m_summary_file = summary_file;
+    for(unsigned int i=0; i<TS_COUNT; i++)
+    {
+        m_subsystems[i].m_total   = 0;
+        m_subsystems[i].m_max     = 0;
+        m_subsystems[i].m_current = 0;
+        m_subsystems[i].m_start   = 0;
+    }
+    m_tick.m_total  = m_tick.m_max  = m_tick.m_current  = m_tick.m_start  = 0;
+    m_other.m_total = m_other.m_max = m_other.m_current = m_other.m_start = 0;
+    m_num_ticks       = 0;
+    m_num_over_budget = 0;
+    m_simulated_time  = 0;
+}   // enable
+
+// ----------------------------------------------------------------------------
+/** Adds the time of one tick to the statistics. */
+void TickStats::addTime(Stats *stats, double t)
+{
+    stats->m_total += t;
+    if(t > stats->m_max)
+        stats->m_max = t;
+    stats->m_current = 0;
+}   // addTime
+
+// ----------------------------------------------------------------------------
+/** Called at the start of each main loop iteration. */
+void TickStats::startTick()
+{
+    if(!m_enabled) return;
+    m_tick.m_start = getTime();
+}   // startTick
+
+// ----------------------------------------------------------------------------
+/** Called at the end of each main loop iteration.
+ *  \param dt The time step of this tick, which is also its time budget.
+ */
+void TickStats::endTick(float dt)
+{
+    if(!m_enabled) return;
+    const double tick = getTime() - m_tick.m_start;
+    double other = tick;
+    for(unsigned int i=0; i<TS_COUNT; i++)
+    {
+        other -= m_subsystems[i].m_current;
+        addTime(&m_subsystems[i], m_subsystems[i].m_current);
+    }
+    addTime(&m_tick, tick);
+    addTime(&m_other, other > 0 ? other : 0);
+    m_num_ticks++;
+    m_simulated_time += dt;
+    if(tick > dt)
+        m_num_over_budget++;
+}   // endTick
+
+// ----------------------------------------------------------------------------
+/** Writes the summary of all ticks as JSON. Times are in milliseconds. */
+void TickStats::writeSummary()
+{
+    if(!m_enabled) return;
+
+    FILE *f = stdout;
+    if(m_summary_file.size()>0)
+    {
+        f = fopen(m_summary_file.c_str(), "w");
+        if(!f)
+        {
+            Log::error("TickStats", "Can't open '%s', printing summary.",
+                       m_summary_file.c_str());
+            f = stdout;
+        }
+    }
+
+    const double n = m_num_ticks>0 ? (double)m_num_ticks : 1.0;
+    static const char *names[TS_COUNT] = { "physics", "ai", "items",
+                                           "protocols" };
+    fprintf(f, "{\n");
+    fprintf(f, "  \"ticks\": %u,\n", m_num_ticks);
+    fprintf(f, "  \"simulated_time\": %f,\n", m_simulated_time);
+    fprintf(f, "  \"real_time\": %f,\n", m_tick.m_total);
+    fprintf(f, "  \"over_budget_ticks\": %u,\n", m_num_over_budget);
+    fprintf(f, "  \"tick\": {\"mean_ms\": %f, \"max_ms\": %f},\n",
+            m_tick.m_total*1000.0/n, m_tick.m_max*1000.0);
+    fprintf(f, "  \"subsystems\": {\n");
+    for(unsigned int i=0; i<TS_COUNT; i++)
+    {
+        fprintf(f, "    \"%s\": {\"total_ms\": %f, \"mean_ms\": %f, "
+                   "\"max_ms\": %f},\n", names[i],
+                m_subsystems[i].m_total*1000.0,
+                m_subsystems[i].m_total*1000.0/n,
+                m_subsystems[i].m_max*1000.0);
+    }
+    fprintf(f, "    \"other\": {\"total_ms\": %f, \"mean_ms\": %f, "
+               "\"max_ms\": %f}\n",
+            m_other.m_total*1000.0, m_other.m_total*1000.0/n,
+            m_other.m_max*1000.0);
+    fprintf(f, "  }\n}\n");
+    if(f!=stdout)
+    {
+        fclose(f);
+        Log::info("TickStats", "Tick statistics written to '%s'.",
+                  m_summary_file.c_str());
+    }
+}   // writeSummary
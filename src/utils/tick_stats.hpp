@@ -0,0 +1,111 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_TICK_STATS_HPP
+#define HEADER_TICK_STATS_HPP
+
+#include <string>
+
+/**
+ * \brief Measures the time of each main loop iteration (tick), split
+ *  by subsystem, and writes a machine readable summary at exit.
+ *
+ *  This is used together with a fixed time step (see
+ *  MainLoop::setFixedTimestep) to run many races without graphics and
+ *  compare their cost. All functions are static and do nothing unless
+ *  the statistics are enabled. Times are high resolution monotonic real
+ *  times, so that work done on other threads (e.g. the AI with
+ *  --ai-threads) is included in the subsystem that waits for it.
+ * \ingroup utils
+ */
+class TickStats
+{
+public:
+    /** The subsystems whose time is measured separately. Everything not
+     *  covered is reported as 'other'. */
+    enum Subsystem { TS_PHYSICS, TS_AI, TS_ITEMS, TS_PROTOCOLS, TS_COUNT };
+
+private:
+    /** Statistics of one subsystem. */
+    struct Stats
+    {
+        /** Total time over all ticks. */
+        double m_total;
+        /** Maximum time in one tick. */
+        double m_max;
+        /** Time in the current tick. */
+        double m_current;
+        /** Start time of the current measurement. */
+        double m_start;
+    };
+
+    static bool        m_enabled;
+    /** File to write the summary to, or empty for stdout. */
+    static std::string m_summary_file;
+    static Stats       m_subsystems[TS_COUNT];
+    /** Statistics of the whole tick, and of the time not covered by any
+     *  subsystem. */
+    static Stats       m_tick, m_other;
+    /** Number of ticks measured. */
+    static unsigned int m_num_ticks;
+    /** Number of ticks that took longer than their time step. */
+    static unsigned int m_num_over_budget;
+    /** Sum of all time steps, i.e. the simulated time. */
+    static double      m_simulated_time;
+
+    static void addTime(Stats *stats, double t);
+
+public:
+    static double getTime();
+    static void   enable(const std::string &summary_file);
+    static void   startTick();
+    static void   endTick(float dt);
+    static void   writeSummary();
+    // ------------------------------------------------------------------------
+    /** Returns true if tick statistics are collected. */
+    static bool   isEnabled() { return m_enabled; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of ticks measured so far. */
+    static unsigned int getNumTicks() { return m_num_ticks; }
+    // ------------------------------------------------------------------------
+    /** Returns the average time of a tick in seconds. */
+    static double getMeanTickTime()
+    {
+        return m_num_ticks>0 ? m_tick.m_total/m_num_ticks : 0;
+    }   // getMeanTickTime
+    // ------------------------------------------------------------------------
+    /** Returns the longest time of a tick in seconds. */
+    static double getMaxTickTime() { return m_tick.m_max; }
+    // ------------------------------------------------------------------------
+    /** Starts measuring the time of a subsystem. */
+    static void   start(Subsystem s)
+    {
+        if(m_enabled) m_subsystems[s].m_start = getTime();
+    }   // start
+    // ------------------------------------------------------------------------
+    /** Stops measuring the time of a subsystem, and adds the time since
+     *  start() to the current tick. */
+    static void   stop(Subsystem s)
+    {
+        if(m_enabled)
+            m_subsystems[s].m_current += getTime()-m_subsystems[s].m_start;
+    }   // stop
+};   // TickStats
+
+#endif
@@ -0,0 +1,181 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "utils/worker_pool.hpp"
+
+#include "utils/log.hpp"
+
+#include <assert.h>
+
+#ifdef WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+/** Starts the worker threads.
+ *  \param num_threads Number of threads used by run(), including the thread
+ *         that calls run(). So 1 means that no additional thread is started.
+ */
+WorkerPool::WorkerPool(unsigned int num_threads)
+{
+    pthread_mutex_init(&m_mutex, NULL);
+    pthread_cond_init(&m_start_cond, NULL);
+    pthread_cond_init(&m_done_cond, NULL);
+    m_generation = 0;
+    m_function   = NULL;
+    m_data       = NULL;
+    m_count      = 0;
+    m_next       = 0;
+    m_num_done   = 0;
+    m_quit       = false;
+
+    for(unsigned int i=1; i<num_threads; i++)
+    {
+        pthread_t thread;
+        int error = pthread_create(&thread, NULL, &WorkerPool::mainLoop,
+                                   this);
+        if(error)
+        {
+            Log::warn("WorkerPool", "Could not create thread, error=%d.",
+                      error);
+            break;
+        }
+        m_threads.push_back(thread);
+    }
+}   // WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Stops and joins all worker threads. */
+WorkerPool::~WorkerPool()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_quit = true;
+    pthread_cond_broadcast(&m_start_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    for(unsigned int i=0; i<m_threads.size(); i++)
+        pthread_join(m_threads[i], NULL);
+
+    pthread_cond_destroy(&m_done_cond);
+    pthread_cond_destroy(&m_start_cond);
+    pthread_mutex_destroy(&m_mutex);
+}   // ~WorkerPool
+
+// ----------------------------------------------------------------------------
+/** Returns the number of processors. */
+unsigned int WorkerPool::getNumCores()
+{
+#ifdef WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors>0 ? info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? (unsigned int)n : 1;
+#endif
+}   // getNumCores
+
+// ----------------------------------------------------------------------------
+/** Calls function(data, i) for all i in [0, count), spread over all threads
+ *  of this pool. Returns when all calls are finished.
+ *  \param function The function to call.
+ *  \param data Passed on to the function.
+ *  \param count Number of indices.
+ */
+void WorkerPool::run(JobFunction function, void *data, unsigned int count)
+{
+    if(m_threads.size()==0 || count<2)
+    {
+        for(unsigned int i=0; i<count; i++)
+            function(data, i);
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_function = function;
+    m_data     = data;
+    m_count    = count;
+    m_next     = 0;
+    m_num_done = 0;
+    m_generation++;
+    pthread_cond_broadcast(&m_start_cond);
+    pthread_mutex_unlock(&m_mutex);
+
+    // The calling thread works on the jobs as well
+    runJobs();
+
+    pthread_mutex_lock(&m_mutex);
+    while(m_num_done<m_count)
+        pthread_cond_wait(&m_done_cond, &m_mutex);
+    pthread_mutex_unlock(&m_mutex);
+}   // run
+
+// ----------------------------------------------------------------------------
+/** Takes indices of the current run and executes them, until all indices
+ *  have been handed out. */
+void WorkerPool::runJobs()
+{
+    while(true)
+    {
+        pthread_mutex_lock(&m_mutex);
+        if(m_next>=m_count)
+        {
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        unsigned int index   = m_next++;
+        JobFunction function = m_function;
+        void *data           = m_data;
+        pthread_mutex_unlock(&m_mutex);
+
+        function(data, index);
+
+        pthread_mutex_lock(&m_mutex);
+        m_num_done++;
+        assert(m_num_done<=m_count);
+        if(m_num_done==m_count)
+            pthread_cond_signal(&m_done_cond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}   // runJobs
+
+// ----------------------------------------------------------------------------
+/** The main loop of a worker thread: waits for a new run, and then helps
+ *  executing its jobs. */
+void* WorkerPool::mainLoop(void *obj)
+{
+    WorkerPool *pool = (WorkerPool*)obj;
+
+    pthread_mutex_lock(&pool->m_mutex);
+    unsigned int generation = pool->m_generation;
+    while(true)
+    {
+        while(!pool->m_quit && generation==pool->m_generation)
+            pthread_cond_wait(&pool->m_start_cond, &pool->m_mutex);
+        if(pool->m_quit)
+            break;
+        generation = pool->m_generation;
+        pthread_mutex_unlock(&pool->m_mutex);
+        pool->runJobs();
+        pthread_mutex_lock(&pool->m_mutex);
+    }
+    pthread_mutex_unlock(&pool->m_mutex);
+    return NULL;
+}   // mainLoop
@@ -0,0 +1,82 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2013 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#ifndef HEADER_WORKER_POOL_HPP
+#define HEADER_WORKER_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+/**
+ * \brief A small set of threads that run the same function for a range of
+ *  indices in parallel.
+ *
+ *  run() hands the indices out to the worker threads and the calling
+ *  thread, and only returns once the function was called for all indices.
+ *  The order in which the indices are processed is undefined, so the
+ *  function must only modify data that belongs to its index. The threads
+ *  are kept waiting between calls, so the pool can be used every frame.
+ * \ingroup utils
+ */
+class WorkerPool : public NoCopy
+{
+public:
+    /** The function run for each index. */
+    typedef void (*JobFunction)(void *data, unsigned int index);
+
+private:
+    std::vector<pthread_t> m_threads;
+
+    /** Protects all data below. */
+    pthread_mutex_t m_mutex;
+    /** Signalled when a new set of jobs is available, or on exit. */
+    pthread_cond_t  m_start_cond;
+    /** Signalled when all jobs of a run are finished. */
+    pthread_cond_t  m_done_cond;
+
+    /** Increased with each call of run(), so that waiting workers can
+     *  detect new jobs. */
+    unsigned int    m_generation;
+    JobFunction     m_function;
+    void           *m_data;
+    /** Number of indices in the current run. */
+    unsigned int    m_count;
+    /** Next index to hand out. */
+    unsigned int    m_next;
+    /** Number of indices that have been finished. */
+    unsigned int    m_num_done;
+    bool            m_quit;
+
+    void runJobs();
+    static void* mainLoop(void *obj);
+
+public:
+                 WorkerPool(unsigned int num_threads);
+                ~WorkerPool();
+    void         run(JobFunction function, void *data, unsigned int count);
+    static unsigned int getNumCores();
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads used by run(), including the calling
+     *  thread. */
+    unsigned int getNumThreads() const { return m_threads.size()+1; }
+};   // WorkerPool
+
+#endif